@@ -0,0 +1,194 @@
+#include "benchmark_runner.hpp"
+#include "streaming_stats.hpp"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+BenchmarkRunner::BenchmarkRunner(TestFramework& framework, ESPNowManager& manager)
+    : test_framework_(framework), manager_(manager) {
+}
+
+std::vector<bench_case_t> BenchmarkRunner::default_suite() {
+    std::vector<bench_case_t> cases;
+    auto rtt = [&cases](uint16_t payload_len, uint8_t peers, uint8_t queue_depth) {
+        cases.push_back({BENCH_CASE_RTT, payload_len, peers, queue_depth, 500, 0});
+    };
+    auto goodput = [&cases](uint16_t payload_len, uint8_t peers, uint8_t queue_depth) {
+        cases.push_back({BENCH_CASE_GOODPUT, payload_len, peers, queue_depth, 0, 5000});
+    };
+
+    const uint16_t rtt_sizes[] = {16, 64, 200, ESP_NOW_MAX_PAYLOAD_LEN, 1024};
+    for (uint16_t size : rtt_sizes) {
+        rtt(size, 1, 1);
+    }
+    rtt(64, 1, 4);
+    rtt(64, 1, 16);
+    rtt(64, 2, 4);
+    rtt(64, 4, 4);
+
+    const uint16_t goodput_sizes[] = {64, 200, ESP_NOW_MAX_PAYLOAD_LEN, 1024};
+    for (uint16_t size : goodput_sizes) {
+        goodput(size, 1, 4);
+    }
+    goodput(200, 1, 1);
+    goodput(200, 1, 8);
+    goodput(200, 2, 4);
+    goodput(200, 4, 4);
+    return cases;
+}
+
+const char* BenchmarkRunner::kind_name(bench_case_kind_t kind) {
+    switch (kind) {
+        case BENCH_CASE_RTT: return "rtt";
+        case BENCH_CASE_GOODPUT: return "goodput";
+        default: return "unknown";
+    }
+}
+
+void BenchmarkRunner::case_name(const bench_case_t& bench_case, char* out, size_t len) {
+    snprintf(out, len, "%s_p%u_n%u_q%u", kind_name(bench_case.kind), bench_case.payload_len,
+             bench_case.peers, bench_case.queue_depth);
+}
+
+bool BenchmarkRunner::payload_fits(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers) {
+    for (size_t i = 0; i < bench_case.peers && i < peers.size(); i++) {
+        if (bench_case.payload_len > manager_.get_max_payload_len(peers[i].mac_addr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BenchmarkRunner::run_rtt(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers,
+                              result_benchmark_record_t* record) {
+    rtt_measure_config_t config = RttEngine::default_config(std::max<uint32_t>(bench_case.count / bench_case.peers, 1));
+    config.window = std::min<uint32_t>(std::max<uint8_t>(bench_case.queue_depth, 1), RTT_ENGINE_SLOTS);
+    config.timeout_ms = BENCH_RTT_TIMEOUT_MS;
+    config.payload_len = std::max<size_t>(bench_case.payload_len, sizeof(esp_now_ping_payload_t));
+
+    StreamingStats rtt_ms;
+    uint32_t sent = 0;
+    bool failed = false;
+    uint64_t start_us = esp_timer_get_time();
+    for (size_t i = 0; i < bench_case.peers; i++) {
+        rtt_run_stats_t stats = {};
+        esp_err_t ret = manager_.get_rtt_engine().measure(peers[i].mac_addr, config,
+            [&rtt_ms](const rtt_sample_t& sample) {
+                rtt_ms.add(sample.rtt_us / 1000.0f);
+            }, &stats);
+        failed |= ret != ESP_OK && ret != ESP_ERR_TIMEOUT;
+        sent += stats.sent;
+    }
+
+    record->duration_ms = (esp_timer_get_time() - start_us) / 1000;
+    record->samples = rtt_ms.count();
+    record->latency_mean_ms = rtt_ms.mean();
+    record->latency_p50_ms = rtt_ms.p50();
+    record->latency_p99_ms = rtt_ms.p99();
+    record->latency_max_ms = rtt_ms.max();
+    record->loss_percent = TestFramework::calculate_packet_loss_rate(sent, rtt_ms.count());
+    record->status = failed || rtt_ms.count() == 0 ? RESULT_BENCH_FAILED : RESULT_BENCH_OK;
+}
+
+void BenchmarkRunner::run_goodput(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers,
+                                  result_benchmark_record_t* record) {
+    std::vector<const uint8_t*> nodes;
+    nodes.push_back(manager_.get_local_mac());
+    for (size_t i = 0; i < bench_case.peers; i++) {
+        nodes.push_back(peers[i].mac_addr);
+    }
+
+    bench_plan_t plan = {};
+    plan.flow_count = bench_case.peers;
+    plan.payload_len = std::max<uint16_t>(bench_case.payload_len, sizeof(esp_now_bench_data_t));
+    plan.duration_ms = bench_case.duration_ms;
+    for (size_t i = 0; i < plan.flow_count; i++) {
+        memcpy(plan.flows[i].src_mac, nodes[i], 6);
+        memcpy(plan.flows[i].dst_mac, nodes[(i + 1) % nodes.size()], 6);
+    }
+
+    // Only this node's window is set; the other senders keep their own
+    esp_now_flow_control_config_t original = manager_.get_flow_control_config();
+    esp_now_flow_control_config_t flow = original;
+    flow.peer_window = bench_case.queue_depth;
+    flow.max_in_flight = std::max(flow.max_in_flight, bench_case.queue_depth);
+    manager_.set_flow_control_config(flow);
+
+    bench_run_result_t result = {};
+    esp_err_t ret = test_framework_.get_mesh_benchmark().run(plan, &result);
+    manager_.set_flow_control_config(original);
+
+    // The worst flow's echo RTT: a gate should catch one starved sender
+    uint32_t samples = 0;
+    for (size_t i = 0; i < result.flow_count; i++) {
+        const bench_flow_result_t& flow_result = result.flows[i];
+        samples += flow_result.frames_received;
+        record->latency_p50_ms = std::max(record->latency_p50_ms, flow_result.rtt_p50_us / 1000.0f);
+        record->latency_p99_ms = std::max(record->latency_p99_ms, flow_result.rtt_p99_us / 1000.0f);
+        record->latency_max_ms = std::max(record->latency_max_ms, flow_result.rtt_max_us / 1000.0f);
+    }
+
+    record->duration_ms = result.duration_ms;
+    record->samples = samples;
+    record->goodput_kbps = result.aggregate_goodput_kbps;
+    record->loss_percent = result.mean_loss_percent;
+    record->status = ret == ESP_OK ? RESULT_BENCH_OK : RESULT_BENCH_FAILED;
+}
+
+esp_err_t BenchmarkRunner::run(const std::vector<bench_case_t>& cases, result_export_sink_t sink) {
+    // Best link first, so the same peers carry the single-peer cases from run to run
+    std::vector<esp_now_peer_info_t> peers = manager_.get_peers_by_rssi(INT8_MIN);
+    ESP_LOGI(BENCHMARK_RUNNER_TAG, "Running %zu benchmark cases with %zu peers", cases.size(), peers.size());
+
+    // Per-case progress stays visible; it is logged from this task, between records
+    ConsoleExportScope console_scope(BENCHMARK_RUNNER_TAG);
+    ResultExporter exporter(sink);
+    esp_err_t ret = exporter.begin(manager_.get_local_mac());
+
+    for (size_t i = 0; i < cases.size() && ret == ESP_OK; i++) {
+        const bench_case_t& bench_case = cases[i];
+        result_benchmark_record_t record = {};
+        case_name(bench_case, record.case_name, sizeof(record.case_name));
+        record.kind = bench_case.kind;
+        record.payload_len = bench_case.payload_len;
+        record.peers = bench_case.peers;
+        record.queue_depth = bench_case.queue_depth;
+        record.status = RESULT_BENCH_SKIPPED;
+
+        size_t max_peers = bench_case.kind == BENCH_CASE_GOODPUT ? BENCH_MAX_FLOWS - 1 : peers.size();
+        if (bench_case.peers > 0 && bench_case.peers <= std::min(peers.size(), max_peers) &&
+            payload_fits(bench_case, peers)) {
+            if (bench_case.kind == BENCH_CASE_RTT) {
+                run_rtt(bench_case, peers, &record);
+            } else {
+                run_goodput(bench_case, peers, &record);
+            }
+        }
+
+        if (record.status == RESULT_BENCH_SKIPPED) {
+            ESP_LOGI(BENCHMARK_RUNNER_TAG, "[%zu/%zu] %s skipped", i + 1, cases.size(), record.case_name);
+        } else {
+            ESP_LOGI(BENCHMARK_RUNNER_TAG, "[%zu/%zu] %s %s: p50 %.2f ms, p99 %.2f ms, %.1f kbps, loss %.2f%%",
+                     i + 1, cases.size(), record.case_name, record.status == RESULT_BENCH_OK ? "ok" : "FAILED",
+                     record.latency_p50_ms, record.latency_p99_ms, record.goodput_kbps, record.loss_percent);
+            vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+        }
+        ret = exporter.write_benchmark(record);
+    }
+
+    if (ret == ESP_OK) {
+        ret = exporter.write_statistics(manager_.get_statistics());
+    }
+    if (ret == ESP_OK) {
+        ret = exporter.end();
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(BENCHMARK_RUNNER_TAG, "Benchmark export failed after %lu records: %s",
+                 exporter.records_written(), esp_err_to_name(ret));
+    }
+    return ret;
+}
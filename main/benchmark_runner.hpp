@@ -0,0 +1,60 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "esp_now_manager.hpp"
+#include "test_framework.hpp"
+#include "result_export.hpp"
+
+#define BENCHMARK_RUNNER_TAG "BENCH_RUN"
+#define BENCH_RTT_TIMEOUT_MS 200
+#define BENCH_SETTLE_MS 200             // Between cases, for queues to drain
+
+typedef enum {
+    BENCH_CASE_RTT = 0,
+    BENCH_CASE_GOODPUT = 1,
+} bench_case_kind_t;
+
+// RTT: count pings split evenly over the first peers peers (best RSSI first), queue_depth
+// of them in flight. GOODPUT: peers senders for duration_ms in a ring over this node and
+// the first peers peers (node i sends to node i + 1), measured at the receivers; this
+// node's flow-control window is set to queue_depth for the run.
+typedef struct {
+    bench_case_kind_t kind;
+    uint16_t payload_len;
+    uint8_t peers;
+    uint8_t queue_depth;
+    uint32_t count;
+    uint32_t duration_ms;
+} bench_case_t;
+
+// Machine-readable benchmark gate for the coordinator. Every case of a declared suite
+// becomes one BENCHMARK record on the result stream; tools/compare_benchmarks.py checks
+// a capture against stored baselines.
+class BenchmarkRunner {
+private:
+    TestFramework& test_framework_;
+    ESPNowManager& manager_;
+
+    void run_rtt(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers,
+                 result_benchmark_record_t* record);
+    void run_goodput(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers,
+                     result_benchmark_record_t* record);
+    bool payload_fits(const bench_case_t& bench_case, const std::vector<esp_now_peer_info_t>& peers);
+
+public:
+    BenchmarkRunner(TestFramework& framework, ESPNowManager& manager);
+
+    // Payload sizes, peer counts and queue depths; cases beyond the peers present are
+    // recorded as skipped, not dropped, so a smaller bench run stays comparable
+    static std::vector<bench_case_t> default_suite();
+    static const char* kind_name(bench_case_kind_t kind);
+    static void case_name(const bench_case_t& bench_case, char* out, size_t len);
+
+    // Runs every case and streams the header, one record per case, the link statistics
+    // and the end record to the sink. Fails only when the sink does.
+    esp_err_t run(const std::vector<bench_case_t>& cases, result_export_sink_t sink);
+};
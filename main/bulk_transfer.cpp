@@ -0,0 +1,447 @@
+#include "bulk_transfer.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <new>
+#include <algorithm>
+
+static inline bool bitmap_test(const uint8_t* bitmap, size_t index) {
+    return bitmap[index / 8] & (1u << (index % 8));
+}
+
+static inline void bitmap_set(uint8_t* bitmap, size_t index) {
+    bitmap[index / 8] |= (1u << (index % 8));
+}
+
+BulkTransfer::BulkTransfer(ESPNowManager& manager)
+    : manager_(manager), config_(default_config()), next_transfer_id_(1), rx_storage_(nullptr),
+      completed_next_(0), status_queue_(nullptr), send_mutex_(nullptr) {
+    memset(rx_slots_, 0, sizeof(rx_slots_));
+    memset(completed_, 0, sizeof(completed_));
+    memset(&last_rejected_, 0, sizeof(last_rejected_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+BulkTransfer::~BulkTransfer() {
+    deinitialize();
+}
+
+esp_err_t BulkTransfer::initialize() {
+    if (status_queue_) {
+        return ESP_OK;
+    }
+
+    rx_storage_ = new (std::nothrow) uint8_t[BULK_RX_SLOTS * BULK_MAX_TRANSFER_LEN];
+    status_queue_ = xQueueCreate(4, sizeof(status_event_t));
+    send_mutex_ = xSemaphoreCreateMutex();
+
+    if (!rx_storage_ || !status_queue_ || !send_mutex_) {
+        ESP_LOGE(BULK_TRANSFER_TAG, "Failed to allocate %d reassembly buffers of %d bytes",
+                 BULK_RX_SLOTS, BULK_MAX_TRANSFER_LEN);
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(rx_slots_, 0, sizeof(rx_slots_));
+    for (size_t i = 0; i < BULK_RX_SLOTS; i++) {
+        rx_slots_[i].data = rx_storage_ + i * BULK_MAX_TRANSFER_LEN;
+    }
+    memset(completed_, 0, sizeof(completed_));
+    memset(&last_rejected_, 0, sizeof(last_rejected_));
+
+    // Ids restart on every boot; random start avoids matching a stale completed entry on the peer
+    next_transfer_id_ = (uint16_t)(esp_timer_get_time() & 0xFFFF) | 1;
+    return ESP_OK;
+}
+
+void BulkTransfer::deinitialize() {
+    if (status_queue_) {
+        vQueueDelete(status_queue_);
+        status_queue_ = nullptr;
+    }
+
+    if (send_mutex_) {
+        vSemaphoreDelete(send_mutex_);
+        send_mutex_ = nullptr;
+    }
+
+    delete[] rx_storage_;
+    rx_storage_ = nullptr;
+    memset(rx_slots_, 0, sizeof(rx_slots_));
+}
+
+bulk_config_t BulkTransfer::default_config() {
+    bulk_config_t config;
+    config.rx_timeout_ms = 3000;
+    config.status_timeout_ms = 200;
+    config.max_repair_rounds = 5;
+    config.progress_every = 16;
+    return config;
+}
+
+void BulkTransfer::set_config(const bulk_config_t& config) {
+    config_ = config;
+    config_.progress_every = std::max<uint16_t>(config.progress_every, 1);
+}
+
+bulk_config_t BulkTransfer::get_config() const {
+    return config_;
+}
+
+bulk_stats_t BulkTransfer::get_stats() const {
+    return stats_;
+}
+
+esp_err_t BulkTransfer::send_fragment(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                                      const esp_now_bulk_header_t& header) {
+    uint8_t payload[ESP_NOW_MAX_PAYLOAD_LEN_V2];
+    memcpy(payload, &header, sizeof(header));
+    memcpy(payload + sizeof(header), data, len);
+
+    // Blocks while the flow-control window is full, which keeps the pipeline saturated
+    return manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BULK_DATA, payload,
+                                 sizeof(header) + len, pdMS_TO_TICKS(1000));
+}
+
+esp_err_t BulkTransfer::send(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                             bulk_progress_callback_t on_progress, bulk_progress_t* result) {
+    if (!status_queue_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!data || len == 0 || len > BULK_MAX_TRANSFER_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // The pending bitmap and the receiver's slot hold at most BULK_MAX_FRAGMENTS
+    size_t fragment_size = manager_.get_max_payload_len(mac_addr) - sizeof(esp_now_bulk_header_t);
+    size_t fragment_count = (len + fragment_size - 1) / fragment_size;
+    if (fragment_count > BULK_MAX_FRAGMENTS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(send_mutex_, portMAX_DELAY);
+
+    esp_now_bulk_header_t header;
+    header.transfer_id = next_transfer_id_++;
+    header.fragment_count = fragment_count;
+    header.fragment_size = fragment_size;
+    header.total_len = len;
+
+    bulk_progress_t progress = {};
+    progress.transfer_id = header.transfer_id;
+    progress.total_bytes = len;
+    progress.fragments_total = fragment_count;
+
+    uint8_t pending[BULK_BITMAP_LEN];
+    memset(pending, 0, sizeof(pending));
+    for (uint16_t i = 0; i < fragment_count; i++) {
+        bitmap_set(pending, i);
+    }
+
+    xQueueReset(status_queue_);
+    uint64_t start_us = esp_timer_get_time();
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+
+    for (uint32_t round = 0; round <= config_.max_repair_rounds; round++) {
+        for (uint16_t i = 0; i < fragment_count; i++) {
+            if (!bitmap_test(pending, i)) {
+                continue;
+            }
+
+            size_t offset = (size_t)i * fragment_size;
+            size_t chunk = std::min(fragment_size, len - offset);
+            header.fragment_index = i;
+            if (send_fragment(mac_addr, data + offset, chunk, header) != ESP_OK) {
+                continue;  // Left for the next repair round
+            }
+
+            stats_.fragments_sent++;
+            if (round == 0) {
+                progress.fragments_done++;
+                progress.bytes_done += chunk;
+            } else {
+                progress.fragments_resent++;
+                stats_.fragments_resent++;
+            }
+
+            if (on_progress && (progress.fragments_done % config_.progress_every == 0 ||
+                                progress.fragments_done == fragment_count)) {
+                progress.elapsed_us = esp_timer_get_time() - start_us;
+                progress.throughput_bps = progress.elapsed_us > 0 ?
+                    progress.bytes_done * 8.0f * 1000000.0f / progress.elapsed_us : 0.0f;
+                on_progress(mac_addr, progress);
+            }
+        }
+        memset(pending, 0, sizeof(pending));
+
+        // The receiver reports on the last fragment; poll if that report was lost
+        status_event_t event;
+        bool received = false;
+        for (int attempt = 0; attempt < 2 && !received; attempt++) {
+            if (attempt > 0) {
+                esp_now_bulk_poll_t poll = {header.transfer_id};
+                manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BULK_POLL, (const uint8_t*)&poll, sizeof(poll));
+            }
+
+            TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(config_.status_timeout_ms);
+            while (!received) {
+                TickType_t now = xTaskGetTickCount();
+                if ((int32_t)(deadline - now) <= 0 ||
+                    xQueueReceive(status_queue_, &event, deadline - now) != pdPASS) {
+                    break;
+                }
+                received = event.status.transfer_id == header.transfer_id &&
+                           memcmp(event.mac_addr, mac_addr, 6) == 0;
+            }
+        }
+
+        if (!received) {
+            continue;
+        }
+
+        if (event.status.state == ESP_NOW_BULK_STATE_COMPLETE) {
+            ret = ESP_OK;
+            break;
+        }
+        if (event.status.state == ESP_NOW_BULK_STATE_REJECTED) {
+            ret = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        // Resend whatever the receiver's bitmap does not hold
+        for (uint16_t i = 0; i < fragment_count; i++) {
+            bool have = event.status.state == ESP_NOW_BULK_STATE_IN_PROGRESS &&
+                        i / 8 < event.status.bitmap_len && bitmap_test(event.bitmap, i);
+            if (!have) {
+                bitmap_set(pending, i);
+            }
+        }
+    }
+
+    progress.elapsed_us = esp_timer_get_time() - start_us;
+    progress.throughput_bps = progress.elapsed_us > 0 ?
+        len * 8.0f * 1000000.0f / progress.elapsed_us : 0.0f;
+
+    if (ret == ESP_OK) {
+        stats_.transfers_sent++;
+        ESP_LOGI(BULK_TRANSFER_TAG, "Transfer %u: %u bytes in %u fragments (%u resent), %.0f bps",
+                 header.transfer_id, (unsigned)len, fragment_count, progress.fragments_resent,
+                 progress.throughput_bps);
+    } else {
+        stats_.transfers_failed++;
+        ESP_LOGW(BULK_TRANSFER_TAG, "Transfer %u failed: %s", header.transfer_id, esp_err_to_name(ret));
+    }
+
+    if (result) {
+        *result = progress;
+    }
+
+    xSemaphoreGive(send_mutex_);
+    return ret;
+}
+
+BulkTransfer::rx_slot_t* BulkTransfer::find_slot(const uint8_t* mac_addr, uint16_t transfer_id) {
+    for (auto& slot : rx_slots_) {
+        if (slot.in_use && slot.transfer_id == transfer_id && memcmp(slot.mac_addr, mac_addr, 6) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+BulkTransfer::rx_slot_t* BulkTransfer::allocate_slot() {
+    for (auto& slot : rx_slots_) {
+        if (!slot.in_use) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void BulkTransfer::expire_slots(uint64_t now_us) {
+    for (auto& slot : rx_slots_) {
+        if (slot.in_use && now_us - slot.last_activity_us > config_.rx_timeout_ms * 1000ULL) {
+            ESP_LOGW(BULK_TRANSFER_TAG, "Transfer %u from %02x:%02x:%02x:%02x:%02x:%02x timed out (%u/%u fragments)",
+                     slot.transfer_id, slot.mac_addr[0], slot.mac_addr[1], slot.mac_addr[2],
+                     slot.mac_addr[3], slot.mac_addr[4], slot.mac_addr[5],
+                     slot.received_count, slot.fragment_count);
+            slot.in_use = false;
+            stats_.transfers_expired++;
+        }
+    }
+}
+
+bool BulkTransfer::was_completed(const uint8_t* mac_addr, uint16_t transfer_id) const {
+    for (const auto& entry : completed_) {
+        if (entry.transfer_id == transfer_id && memcmp(entry.mac_addr, mac_addr, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BulkTransfer::send_status(const uint8_t* mac_addr, uint16_t transfer_id, const rx_slot_t* slot, uint8_t state) {
+    uint8_t payload[sizeof(esp_now_bulk_status_t) + BULK_BITMAP_LEN];
+
+    esp_now_bulk_status_t status = {};
+    status.transfer_id = transfer_id;
+    status.state = state;
+    if (slot && state == ESP_NOW_BULK_STATE_IN_PROGRESS) {
+        status.received_fragments = slot->received_count;
+        status.bitmap_len = (slot->fragment_count + 7) / 8;
+        memcpy(payload + sizeof(status), slot->bitmap, status.bitmap_len);
+    }
+    memcpy(payload, &status, sizeof(status));
+
+    manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BULK_STATUS, payload,
+                          sizeof(status) + status.bitmap_len, pdMS_TO_TICKS(10));
+}
+
+void BulkTransfer::handle_fragment(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!rx_storage_ || msg->payload_length < sizeof(esp_now_bulk_header_t)) {
+        return;
+    }
+
+    esp_now_bulk_header_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+    const uint8_t* chunk = msg->payload + sizeof(header);
+    size_t chunk_len = msg->payload_length - sizeof(header);
+    bool is_last = header.fragment_index + 1 == header.fragment_count;
+
+    uint64_t now_us = esp_timer_get_time();
+    expire_slots(now_us);
+
+    rx_slot_t* slot = find_slot(mac_addr, header.transfer_id);
+    if (!slot) {
+        if (was_completed(mac_addr, header.transfer_id)) {
+            stats_.duplicate_fragments++;
+            if (is_last) {
+                send_status(mac_addr, header.transfer_id, nullptr, ESP_NOW_BULK_STATE_COMPLETE);
+            }
+            return;
+        }
+        // The rest of a rejected transfer is dropped; a poll repeats the answer
+        if (last_rejected_.transfer_id == header.transfer_id && memcmp(last_rejected_.mac_addr, mac_addr, 6) == 0) {
+            return;
+        }
+
+        bool valid = header.total_len > 0 && header.fragment_size > 0 && header.fragment_count > 0 &&
+                     header.total_len <= BULK_MAX_TRANSFER_LEN && header.fragment_count <= BULK_MAX_FRAGMENTS &&
+                     (uint32_t)(header.fragment_count - 1) * header.fragment_size < header.total_len &&
+                     (uint32_t)header.fragment_count * header.fragment_size >= header.total_len;
+
+        slot = valid ? allocate_slot() : nullptr;
+        if (!slot) {
+            stats_.transfers_rejected++;
+            memcpy(last_rejected_.mac_addr, mac_addr, 6);
+            last_rejected_.transfer_id = header.transfer_id;
+            send_status(mac_addr, header.transfer_id, nullptr, ESP_NOW_BULK_STATE_REJECTED);
+            return;
+        }
+
+        slot->in_use = true;
+        memcpy(slot->mac_addr, mac_addr, 6);
+        slot->transfer_id = header.transfer_id;
+        slot->fragment_count = header.fragment_count;
+        slot->fragment_size = header.fragment_size;
+        slot->total_len = header.total_len;
+        slot->received_count = 0;
+        slot->received_bytes = 0;
+        slot->start_us = now_us;
+        memset(slot->bitmap, 0, sizeof(slot->bitmap));
+    }
+
+    size_t offset = (size_t)header.fragment_index * slot->fragment_size;
+    size_t expected_len = header.fragment_index + 1 == slot->fragment_count ?
+                          slot->total_len - offset : slot->fragment_size;
+    if (header.fragment_index >= slot->fragment_count || header.fragment_count != slot->fragment_count ||
+        header.total_len != slot->total_len || chunk_len != expected_len) {
+        ESP_LOGW(BULK_TRANSFER_TAG, "Fragment %u of transfer %u does not match its transfer",
+                 header.fragment_index, header.transfer_id);
+        return;
+    }
+
+    slot->last_activity_us = now_us;
+    if (bitmap_test(slot->bitmap, header.fragment_index)) {
+        stats_.duplicate_fragments++;
+    } else {
+        memcpy(slot->data + offset, chunk, chunk_len);
+        bitmap_set(slot->bitmap, header.fragment_index);
+        slot->received_count++;
+        slot->received_bytes += chunk_len;
+        stats_.fragments_received++;
+
+        if (rx_progress_callback_ && (slot->received_count % config_.progress_every == 0 ||
+                                      slot->received_count == slot->fragment_count)) {
+            bulk_progress_t progress = {};
+            progress.transfer_id = slot->transfer_id;
+            progress.total_bytes = slot->total_len;
+            progress.bytes_done = slot->received_bytes;
+            progress.fragments_total = slot->fragment_count;
+            progress.fragments_done = slot->received_count;
+            progress.elapsed_us = now_us - slot->start_us;
+            progress.throughput_bps = progress.elapsed_us > 0 ?
+                slot->received_bytes * 8.0f * 1000000.0f / progress.elapsed_us : 0.0f;
+            rx_progress_callback_(mac_addr, progress);
+        }
+    }
+
+    if (slot->received_count == slot->fragment_count) {
+        stats_.transfers_received++;
+        completed_[completed_next_].transfer_id = slot->transfer_id;
+        memcpy(completed_[completed_next_].mac_addr, mac_addr, 6);
+        completed_next_ = (completed_next_ + 1) % BULK_COMPLETED_HISTORY;
+
+        send_status(mac_addr, slot->transfer_id, nullptr, ESP_NOW_BULK_STATE_COMPLETE);
+        if (receive_callback_) {
+            receive_callback_(mac_addr, slot->transfer_id, slot->data, slot->total_len);
+        }
+        slot->in_use = false;
+    } else if (is_last) {
+        send_status(mac_addr, slot->transfer_id, slot, ESP_NOW_BULK_STATE_IN_PROGRESS);
+    }
+}
+
+void BulkTransfer::handle_poll(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!rx_storage_ || msg->payload_length < sizeof(esp_now_bulk_poll_t)) {
+        return;
+    }
+
+    esp_now_bulk_poll_t poll;
+    memcpy(&poll, msg->payload, sizeof(poll));
+
+    rx_slot_t* slot = find_slot(mac_addr, poll.transfer_id);
+    if (slot) {
+        slot->last_activity_us = esp_timer_get_time();
+        send_status(mac_addr, poll.transfer_id, slot, ESP_NOW_BULK_STATE_IN_PROGRESS);
+    } else if (was_completed(mac_addr, poll.transfer_id)) {
+        send_status(mac_addr, poll.transfer_id, nullptr, ESP_NOW_BULK_STATE_COMPLETE);
+    } else if (last_rejected_.transfer_id == poll.transfer_id && memcmp(last_rejected_.mac_addr, mac_addr, 6) == 0) {
+        send_status(mac_addr, poll.transfer_id, nullptr, ESP_NOW_BULK_STATE_REJECTED);
+    } else {
+        send_status(mac_addr, poll.transfer_id, nullptr, ESP_NOW_BULK_STATE_UNKNOWN);
+    }
+}
+
+void BulkTransfer::handle_status(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!status_queue_ || msg->payload_length < sizeof(esp_now_bulk_status_t)) {
+        return;
+    }
+
+    status_event_t event = {};
+    memcpy(event.mac_addr, mac_addr, 6);
+    memcpy(&event.status, msg->payload, sizeof(event.status));
+    event.status.bitmap_len = std::min<uint16_t>(event.status.bitmap_len,
+                                                 std::min<size_t>(BULK_BITMAP_LEN, msg->payload_length - sizeof(event.status)));
+    memcpy(event.bitmap, msg->payload + sizeof(event.status), event.status.bitmap_len);
+
+    xQueueSend(status_queue_, &event, 0);
+}
+
+void BulkTransfer::set_receive_callback(bulk_receive_callback_t callback) {
+    receive_callback_ = callback;
+}
+
+void BulkTransfer::set_rx_progress_callback(bulk_rx_progress_callback_t callback) {
+    rx_progress_callback_ = callback;
+}
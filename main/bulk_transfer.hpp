@@ -0,0 +1,142 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "delegate.hpp"
+#include "esp_now_protocol.hpp"
+
+#define BULK_TRANSFER_TAG "BULK"
+#define BULK_MAX_TRANSFER_LEN 32768  // Size of each preallocated reassembly buffer
+#define BULK_RX_SLOTS 2              // Transfers reassembled concurrently
+#define BULK_MIN_FRAGMENT_LEN (ESP_NOW_MAX_TAGGED_PAYLOAD_LEN - sizeof(esp_now_bulk_header_t))
+#define BULK_MAX_FRAGMENTS ((BULK_MAX_TRANSFER_LEN + BULK_MIN_FRAGMENT_LEN - 1) / BULK_MIN_FRAGMENT_LEN)
+#define BULK_BITMAP_LEN ((BULK_MAX_FRAGMENTS + 7) / 8)
+#define BULK_COMPLETED_HISTORY 4     // Finished transfers remembered for late polls
+
+class ESPNowManager;
+
+typedef struct {
+    uint16_t transfer_id;
+    uint32_t total_bytes;
+    uint32_t bytes_done;          // Sender: bytes queued; receiver: bytes reassembled
+    uint16_t fragments_total;
+    uint16_t fragments_done;
+    uint16_t fragments_resent;
+    uint64_t elapsed_us;
+    float throughput_bps;
+} bulk_progress_t;
+
+typedef struct {
+    uint32_t rx_timeout_ms;       // Incomplete transfers are dropped after this much silence
+    uint32_t status_timeout_ms;   // Sender wait for a STATUS before polling again
+    uint32_t max_repair_rounds;   // POLL/resend rounds before the sender gives up
+    uint16_t progress_every;      // Fragments between progress callbacks
+} bulk_config_t;
+
+typedef struct {
+    uint32_t transfers_sent;
+    uint32_t transfers_failed;
+    uint32_t transfers_received;
+    uint32_t transfers_expired;
+    uint32_t transfers_rejected;
+    uint32_t fragments_sent;
+    uint32_t fragments_resent;
+    uint32_t fragments_received;
+    uint32_t duplicate_fragments;
+} bulk_stats_t;
+
+// Sender side, per send() call and on the sending task; it may capture freely
+typedef std::function<void(const uint8_t* mac_addr, const bulk_progress_t& progress)> bulk_progress_callback_t;
+// Receiver side, invoked from the receive task
+typedef Delegate<void(const uint8_t* mac_addr, const bulk_progress_t& progress)> bulk_rx_progress_callback_t;
+// data points into the reassembly buffer and is only valid during the callback
+typedef Delegate<void(const uint8_t* mac_addr, uint16_t transfer_id,
+                       const uint8_t* data, size_t len)> bulk_receive_callback_t;
+
+// Fragments buffers larger than one frame and reassembles them on the receiver.
+// Fragments are pushed back to back and paced by the manager's flow-control
+// window; missing fragments are repaired from the receiver's STATUS bitmap.
+class BulkTransfer {
+private:
+    typedef struct {
+        bool in_use;
+        uint8_t mac_addr[6];
+        uint16_t transfer_id;
+        uint16_t fragment_count;
+        uint16_t fragment_size;
+        uint16_t received_count;
+        uint32_t total_len;
+        uint32_t received_bytes;
+        uint64_t start_us;
+        uint64_t last_activity_us;
+        uint8_t bitmap[BULK_BITMAP_LEN];
+        uint8_t* data;
+    } rx_slot_t;
+
+    typedef struct {
+        uint8_t mac_addr[6];
+        uint16_t transfer_id;
+    } completed_t;
+
+    typedef struct {
+        uint8_t mac_addr[6];
+        esp_now_bulk_status_t status;
+        uint8_t bitmap[BULK_BITMAP_LEN];
+    } status_event_t;
+
+    ESPNowManager& manager_;
+    bulk_config_t config_;
+    uint16_t next_transfer_id_;
+
+    rx_slot_t rx_slots_[BULK_RX_SLOTS];
+    uint8_t* rx_storage_;
+    completed_t completed_[BULK_COMPLETED_HISTORY];
+    size_t completed_next_;
+    completed_t last_rejected_;      // Answered once, not once per fragment
+    bulk_stats_t stats_;
+
+    QueueHandle_t status_queue_;
+    SemaphoreHandle_t send_mutex_;
+
+    bulk_receive_callback_t receive_callback_;
+    bulk_rx_progress_callback_t rx_progress_callback_;
+
+    rx_slot_t* find_slot(const uint8_t* mac_addr, uint16_t transfer_id);
+    rx_slot_t* allocate_slot();
+    void expire_slots(uint64_t now_us);
+    bool was_completed(const uint8_t* mac_addr, uint16_t transfer_id) const;
+    void send_status(const uint8_t* mac_addr, uint16_t transfer_id, const rx_slot_t* slot, uint8_t state);
+    esp_err_t send_fragment(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                            const esp_now_bulk_header_t& header);
+
+public:
+    explicit BulkTransfer(ESPNowManager& manager);
+    ~BulkTransfer();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Blocks until the receiver confirms the whole buffer, or the repair rounds run out
+    esp_err_t send(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                   bulk_progress_callback_t on_progress = nullptr, bulk_progress_t* result = nullptr);
+
+    // Called from the receive task
+    void handle_fragment(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_poll(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_status(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    void set_config(const bulk_config_t& config);
+    bulk_config_t get_config() const;
+    static bulk_config_t default_config();
+    bulk_stats_t get_stats() const;
+
+    void set_receive_callback(bulk_receive_callback_t callback);
+    // Receiver-side progress, invoked from the receive task
+    void set_rx_progress_callback(bulk_rx_progress_callback_t callback);
+};
@@ -0,0 +1,498 @@
+#include "channel_manager.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+
+std::atomic<ChannelManager*> ChannelManager::listener_(nullptr);
+
+static const uint8_t DEFAULT_CANDIDATES[] = {1, 6, 11, 36, 40, 44, 48, 149, 153, 157, 161, 165};
+
+ChannelManager::ChannelManager(ESPNowManager& manager)
+    : manager_(manager), hop_queue_(nullptr), hop_task_handle_(nullptr), run_mutex_(nullptr),
+      ack_signal_(nullptr), next_id_(1), last_survey_id_(0), last_switch_id_(0),
+      awaiting_switch_id_(0), acks_received_(0), frames_(0), airtime_us_(0), rssi_sum_(0),
+      noise_sum_(0) {
+}
+
+ChannelManager::~ChannelManager() {
+    deinitialize();
+}
+
+esp_err_t ChannelManager::initialize() {
+    if (hop_queue_) {
+        return ESP_OK;
+    }
+
+    hop_queue_ = xQueueCreate(CHANNEL_HOP_QUEUE_LEN, sizeof(hop_t));
+    run_mutex_ = xSemaphoreCreateMutex();
+    ack_signal_ = xSemaphoreCreateBinary();
+    if (!hop_queue_ || !run_mutex_ || !ack_signal_) {
+        ESP_LOGE(CHANNEL_MANAGER_TAG, "Failed to create channel manager queue or semaphores");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Ids only have to differ from what peers saw before our reboot
+    next_id_ = (uint16_t)(esp_timer_get_time() | 1);
+
+    if (xTaskCreate(hop_task, "esp_now_chan", CHANNEL_TASK_STACK_SIZE, this,
+                    CHANNEL_TASK_PRIORITY, &hop_task_handle_) != pdPASS) {
+        hop_task_handle_ = nullptr;
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void ChannelManager::deinitialize() {
+    if (hop_task_handle_) {
+        vTaskDelete(hop_task_handle_);
+        hop_task_handle_ = nullptr;
+    }
+
+    if (listener_.load() == this) {
+        esp_wifi_set_promiscuous(false);
+        listener_ = nullptr;
+    }
+
+    if (hop_queue_) {
+        vQueueDelete(hop_queue_);
+        hop_queue_ = nullptr;
+    }
+
+    if (run_mutex_) {
+        vSemaphoreDelete(run_mutex_);
+        run_mutex_ = nullptr;
+    }
+
+    if (ack_signal_) {
+        vSemaphoreDelete(ack_signal_);
+        ack_signal_ = nullptr;
+    }
+}
+
+void ChannelManager::hop_task(void* parameter) {
+    ChannelManager* channels = static_cast<ChannelManager*>(parameter);
+    hop_t hop;
+
+    while (true) {
+        if (xQueueReceive(channels->hop_queue_, &hop, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+
+        TimeSync::sleep_until_us(hop.at_us);
+        channels->manager_.set_channel(hop.channel);
+
+        if (hop.acknowledge) {
+            ESP_LOGI(CHANNEL_MANAGER_TAG, "Switched to channel %u", hop.channel);
+            esp_now_channel_switch_ack_t ack = {hop.switch_id, hop.channel};
+            channels->manager_.send_message(hop.coordinator_mac, ESP_NOW_MSG_TYPE_CHANNEL_SWITCH_ACK,
+                                            (const uint8_t*)&ack, sizeof(ack));
+        }
+    }
+}
+
+void ChannelManager::handle_survey(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < offsetof(esp_now_channel_survey_t, channels) || !hop_queue_) {
+        return;
+    }
+
+    esp_now_channel_survey_t survey = {};
+    memcpy(&survey, msg->payload, std::min<size_t>(msg->payload_length, sizeof(survey)));
+    size_t count = std::min<size_t>(survey.channel_count, ESP_NOW_CHANNEL_SURVEY_MAX);
+    uint64_t now_us = esp_timer_get_time();
+
+    if (survey.survey_id == last_survey_id_ || count == 0 ||
+        survey.start_at_us > now_us + CHANNEL_MAX_SCHEDULE_AHEAD_MS * 1000ULL) {
+        return;
+    }
+    last_survey_id_ = survey.survey_id;
+
+    ESP_LOGI(CHANNEL_MANAGER_TAG, "Joining survey %u: %zu channels, %u ms each", survey.survey_id,
+             count, survey.dwell_ms);
+
+    // Replaces whatever schedule is still pending
+    xQueueReset(hop_queue_);
+    hop_t hop = {};
+    for (size_t i = 0; i < count; i++) {
+        hop.channel = survey.channels[i];
+        hop.at_us = survey.start_at_us + i * survey.dwell_ms * 1000ULL;
+        xQueueSend(hop_queue_, &hop, 0);
+    }
+    hop.channel = manager_.get_channel();
+    hop.at_us = survey.start_at_us + count * survey.dwell_ms * 1000ULL;
+    xQueueSend(hop_queue_, &hop, 0);
+}
+
+void ChannelManager::handle_switch(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_channel_switch_t) || !hop_queue_) {
+        return;
+    }
+
+    esp_now_channel_switch_t request;
+    memcpy(&request, msg->payload, sizeof(request));
+    uint64_t now_us = esp_timer_get_time();
+
+    if (request.switch_id == last_switch_id_ ||
+        request.switch_at_us > now_us + CHANNEL_MAX_SCHEDULE_AHEAD_MS * 1000ULL) {
+        return;
+    }
+    last_switch_id_ = request.switch_id;
+
+    // Unsynced peers get no instant and move a lead time after receipt
+    hop_t hop = {};
+    hop.channel = request.channel;
+    hop.at_us = request.switch_at_us ? request.switch_at_us : now_us + CHANNEL_SWITCH_LEAD_MS * 1000ULL;
+    hop.acknowledge = true;
+    hop.switch_id = request.switch_id;
+    memcpy(hop.coordinator_mac, mac_addr, 6);
+
+    xQueueReset(hop_queue_);
+    xQueueSend(hop_queue_, &hop, 0);
+}
+
+void ChannelManager::handle_switch_ack(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_channel_switch_ack_t) || !ack_signal_) {
+        return;
+    }
+
+    esp_now_channel_switch_ack_t ack;
+    memcpy(&ack, msg->payload, sizeof(ack));
+    if (ack.switch_id != 0 && ack.switch_id == awaiting_switch_id_.load()) {
+        acks_received_.fetch_add(1);
+        xSemaphoreGive(ack_signal_);
+    }
+}
+
+void ChannelManager::promiscuous_cb(void* buf, wifi_promiscuous_pkt_type_t type) {
+    ChannelManager* self = listener_.load(std::memory_order_relaxed);
+    if (!self || !buf) {
+        return;
+    }
+
+    const wifi_promiscuous_pkt_t* pkt = static_cast<const wifi_promiscuous_pkt_t*>(buf);
+    uint32_t airtime_us = CHANNEL_PREAMBLE_US + pkt->rx_ctrl.sig_len * 8 / CHANNEL_BASE_RATE_MBPS;
+
+    self->frames_.fetch_add(1, std::memory_order_relaxed);
+    self->airtime_us_.fetch_add(airtime_us, std::memory_order_relaxed);
+    self->rssi_sum_.fetch_add(pkt->rx_ctrl.rssi, std::memory_order_relaxed);
+    self->noise_sum_.fetch_add(pkt->rx_ctrl.noise_floor, std::memory_order_relaxed);
+}
+
+void ChannelManager::start_listening() {
+    frames_ = 0;
+    airtime_us_ = 0;
+    rssi_sum_ = 0;
+    noise_sum_ = 0;
+    listener_ = this;
+
+    wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_ALL};
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(promiscuous_cb);
+    esp_wifi_set_promiscuous(true);
+}
+
+void ChannelManager::stop_listening(channel_survey_result_t* result, uint32_t elapsed_us) {
+    esp_wifi_set_promiscuous(false);
+    listener_ = nullptr;
+
+    uint32_t frames = frames_.load();
+    result->frames = frames;
+    result->airtime_percent = elapsed_us > 0 ?
+        std::min(100.0f, airtime_us_.load() * 100.0f / elapsed_us) : 0.0f;
+    if (frames > 0) {
+        result->mean_rssi_dbm = (int8_t)(rssi_sum_.load() / (int32_t)frames);
+        result->noise_floor_dbm = (int8_t)(noise_sum_.load() / (int32_t)frames);
+    }
+}
+
+void ChannelManager::score(channel_survey_result_t* result) {
+    float score = result->airtime_percent + result->loss_percent * CHANNEL_SCORE_LOSS_WEIGHT;
+    if (result->noise_floor_dbm != 0 && result->noise_floor_dbm > CHANNEL_SCORE_NOISE_REFERENCE_DBM) {
+        score += result->noise_floor_dbm - CHANNEL_SCORE_NOISE_REFERENCE_DBM;
+    }
+    result->score = score;
+}
+
+// Probe outcomes come from the per-peer delivery counters, so they include manager retries
+void ChannelManager::dwell(uint8_t channel, uint64_t until_us, const std::vector<esp_now_peer_info_t>& peers,
+                           channel_survey_result_t* result) {
+    std::vector<std::pair<uint32_t, uint32_t>> before;
+    for (const auto& peer : peers) {
+        esp_now_peer_info_t info = {};
+        manager_.get_peer_info(peer.mac_addr, &info);
+        before.emplace_back(info.packets_sent, info.packets_lost);
+    }
+
+    uint64_t listen_start_us = esp_timer_get_time();
+    start_listening();
+
+    // Peers land within the sync error plus a hop; leave room at both ends
+    uint64_t guard_us = CHANNEL_SURVEY_GUARD_MS * 1000ULL;
+    TimeSync::sleep_until_us(listen_start_us + guard_us);
+
+    uint8_t probe[CHANNEL_PROBE_LEN];
+    memset(probe, 0x5A, sizeof(probe));
+    size_t next = 0;
+    while (!peers.empty() && (uint64_t)esp_timer_get_time() + guard_us < until_us) {
+        if (manager_.send_message(peers[next].mac_addr, ESP_NOW_MSG_TYPE_CHANNEL_PROBE,
+                                  probe, sizeof(probe), 0) == ESP_OK) {
+            result->probes_sent++;
+        }
+        next = (next + 1) % peers.size();
+        vTaskDelay(std::max<TickType_t>(pdMS_TO_TICKS(CHANNEL_PROBE_INTERVAL_MS), 1));
+    }
+
+    TimeSync::sleep_until_us(until_us);
+    stop_listening(result, (uint32_t)(esp_timer_get_time() - listen_start_us));
+
+    for (size_t i = 0; i < peers.size(); i++) {
+        esp_now_peer_info_t info = {};
+        if (manager_.get_peer_info(peers[i].mac_addr, &info) == ESP_OK) {
+            result->probes_delivered += info.packets_sent - before[i].first;
+            result->probes_lost += info.packets_lost - before[i].second;
+        }
+    }
+
+    uint32_t outcomes = result->probes_delivered + result->probes_lost;
+    result->loss_percent = outcomes > 0 ? result->probes_lost * 100.0f / outcomes : 0.0f;
+    score(result);
+}
+
+std::vector<esp_now_peer_info_t> ChannelManager::synced_peers(bool sync_missing) {
+    TimeSync& time_sync = manager_.get_time_sync();
+    std::vector<esp_now_peer_info_t> synced;
+
+    for (const auto& peer : manager_.get_peers()) {
+        if (!peer.is_active) continue;
+        if (time_sync.is_synced(peer.mac_addr) ||
+            (sync_missing && time_sync.sync_peer(peer.mac_addr) == ESP_OK)) {
+            synced.push_back(peer);
+        }
+    }
+    return synced;
+}
+
+esp_err_t ChannelManager::survey_local(const uint8_t* channels, size_t count, uint32_t dwell_ms,
+                                       std::vector<channel_survey_result_t>& results) {
+    if (!run_mutex_ || count == 0) {
+        return !run_mutex_ ? ESP_ERR_INVALID_STATE : ESP_ERR_INVALID_ARG;
+    }
+    if (xSemaphoreTake(run_mutex_, 0) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t home = manager_.get_channel();
+    results.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        channel_survey_result_t result = {};
+        result.channel = channels[i];
+        result.dwell_ms = dwell_ms;
+        if (manager_.set_channel(channels[i]) == ESP_OK) {
+            dwell(channels[i], esp_timer_get_time() + dwell_ms * 1000ULL, {}, &result);
+        }
+        results.push_back(result);
+    }
+
+    manager_.set_channel(home);
+    xSemaphoreGive(run_mutex_);
+    return ESP_OK;
+}
+
+esp_err_t ChannelManager::survey_mesh(const uint8_t* channels, size_t count, uint32_t dwell_ms,
+                                      std::vector<channel_survey_result_t>& results) {
+    if (!run_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    count = std::min<size_t>(count, ESP_NOW_CHANNEL_SURVEY_MAX);
+    if (count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dwell_ms = std::max<uint32_t>(dwell_ms, 4 * CHANNEL_SURVEY_GUARD_MS);
+
+    if (xSemaphoreTake(run_mutex_, 0) != pdTRUE) {
+        ESP_LOGW(CHANNEL_MANAGER_TAG, "Survey or switch already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TimeSync& time_sync = manager_.get_time_sync();
+    std::vector<esp_now_peer_info_t> peers = synced_peers(true);
+    uint8_t home = manager_.get_channel();
+
+    esp_now_channel_survey_t survey = {};
+    if (next_id_ == 0) next_id_++;
+    survey.survey_id = next_id_++;
+    survey.dwell_ms = dwell_ms;
+    survey.channel_count = count;
+    memcpy(survey.channels, channels, count);
+
+    // Only peers that were handed the schedule follow it; probing the rest on every
+    // channel would only feed their loss counters and rate adaptation
+    uint64_t start_at_us = esp_timer_get_time() + CHANNEL_SURVEY_LEAD_MS * 1000ULL;
+    for (auto it = peers.begin(); it != peers.end();) {
+        uint64_t peer_start_us;
+        bool scheduled = time_sync.local_to_peer(it->mac_addr, start_at_us, &peer_start_us) == ESP_OK;
+        if (scheduled) {
+            survey.start_at_us = peer_start_us;
+            scheduled = manager_.send_message(it->mac_addr, ESP_NOW_MSG_TYPE_CHANNEL_SURVEY,
+                                              (const uint8_t*)&survey, sizeof(survey)) == ESP_OK;
+        }
+        it = scheduled ? it + 1 : peers.erase(it);
+    }
+
+    ESP_LOGI(CHANNEL_MANAGER_TAG, "Surveying %zu channels (%lu ms each) with %zu peers",
+             count, dwell_ms, peers.size());
+
+    results.clear();
+    for (size_t i = 0; i < count; i++) {
+        uint64_t slot_start_us = start_at_us + i * dwell_ms * 1000ULL;
+        channel_survey_result_t result = {};
+        result.channel = channels[i];
+        result.dwell_ms = dwell_ms;
+
+        TimeSync::sleep_until_us(slot_start_us);
+        if (manager_.set_channel(channels[i]) == ESP_OK) {
+            dwell(channels[i], slot_start_us + dwell_ms * 1000ULL, peers, &result);
+        }
+        results.push_back(result);
+    }
+
+    TimeSync::sleep_until_us(start_at_us + count * dwell_ms * 1000ULL);
+    manager_.set_channel(home);
+
+    xSemaphoreGive(run_mutex_);
+    return ESP_OK;
+}
+
+esp_err_t ChannelManager::switch_mesh(uint8_t channel, uint32_t lead_ms) {
+    if (!run_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTake(run_mutex_, 0) != pdTRUE) {
+        ESP_LOGW(CHANNEL_MANAGER_TAG, "Survey or switch already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TimeSync& time_sync = manager_.get_time_sync();
+    std::vector<esp_now_peer_info_t> peers;
+    for (const auto& peer : manager_.get_peers()) {
+        if (peer.is_active) {
+            peers.push_back(peer);
+        }
+    }
+
+    esp_now_channel_switch_t request = {};
+    if (next_id_ == 0) next_id_++;
+    request.switch_id = next_id_++;
+    request.channel = channel;
+
+    awaiting_switch_id_ = request.switch_id;
+    acks_received_ = 0;
+    xSemaphoreTake(ack_signal_, 0);
+
+    uint64_t switch_at_us = esp_timer_get_time() + lead_ms * 1000ULL;
+    for (const auto& peer : peers) {
+        uint64_t peer_switch_us = 0;
+        if (time_sync.local_to_peer(peer.mac_addr, switch_at_us, &peer_switch_us) != ESP_OK) {
+            peer_switch_us = 0;
+        }
+        request.switch_at_us = peer_switch_us;
+        manager_.send_message(peer.mac_addr, ESP_NOW_MSG_TYPE_CHANNEL_SWITCH,
+                              (const uint8_t*)&request, sizeof(request));
+    }
+
+    TimeSync::sleep_until_us(switch_at_us);
+    esp_err_t ret = manager_.set_channel(channel);
+
+    uint64_t deadline_us = esp_timer_get_time() + CHANNEL_SWITCH_ACK_TIMEOUT_MS * 1000ULL;
+    while (acks_received_.load() < peers.size()) {
+        uint64_t now_us = esp_timer_get_time();
+        if (now_us >= deadline_us) {
+            break;
+        }
+        xSemaphoreTake(ack_signal_, std::max<TickType_t>(pdMS_TO_TICKS((deadline_us - now_us) / 1000), 1));
+    }
+    awaiting_switch_id_ = 0;
+
+    uint32_t acks = acks_received_.load();
+    ESP_LOGI(CHANNEL_MANAGER_TAG, "Mesh moved to channel %u: %lu of %zu peers confirmed",
+             channel, acks, peers.size());
+
+    xSemaphoreGive(run_mutex_);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return acks >= peers.size() ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t ChannelManager::select_channel(const uint8_t* channels, size_t count, uint32_t dwell_ms,
+                                         uint8_t* selected) {
+    uint8_t home = manager_.get_channel();
+    if (selected) {
+        *selected = home;
+    }
+
+    std::vector<channel_survey_result_t> results;
+    esp_err_t ret = survey_mesh(channels, count, dwell_ms, results);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    print_survey(results);
+
+    const channel_survey_result_t* best = nullptr;
+    const channel_survey_result_t* current = nullptr;
+    for (const auto& result : results) {
+        if (!best || result.score < best->score) {
+            best = &result;
+        }
+        if (result.channel == home) {
+            current = &result;
+        }
+    }
+
+    if (!best || best->channel == home ||
+        (current && best->score + CHANNEL_SWITCH_MIN_GAIN >= current->score)) {
+        ESP_LOGI(CHANNEL_MANAGER_TAG, "Staying on channel %u", home);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(CHANNEL_MANAGER_TAG, "Switching from channel %u (score %.1f) to %u (score %.1f)",
+             home, current ? current->score : 0.0f, best->channel, best->score);
+    ret = switch_mesh(best->channel);
+    if (selected) {
+        *selected = manager_.get_channel();
+    }
+    return ret;
+}
+
+size_t ChannelManager::default_candidates(uint8_t* channels, size_t capacity) const {
+    size_t count = 0;
+    bool has_home = false;
+    uint8_t home = manager_.get_channel();
+
+    for (uint8_t channel : DEFAULT_CANDIDATES) {
+        if (count >= capacity) break;
+        channels[count++] = channel;
+        has_home |= channel == home;
+    }
+
+    if (!has_home && count > 0) {
+        if (count < capacity) {
+            count++;
+        }
+        channels[count - 1] = home;
+    }
+    return count;
+}
+
+void ChannelManager::print_survey(const std::vector<channel_survey_result_t>& results) {
+    ESP_LOGI(CHANNEL_MANAGER_TAG, "Channel  Frames  Airtime%%  Noise  Probes  Loss%%   Score");
+    for (const auto& result : results) {
+        ESP_LOGI(CHANNEL_MANAGER_TAG, "%7u  %6lu  %8.1f  %5d  %6lu  %5.1f  %6.1f",
+                 result.channel, result.frames, result.airtime_percent, result.noise_floor_dbm,
+                 result.probes_sent, result.loss_percent, result.score);
+    }
+}
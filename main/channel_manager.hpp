@@ -0,0 +1,126 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "esp_now_protocol.hpp"
+#include "peer_table.hpp"
+
+#define CHANNEL_MANAGER_TAG "CHANNEL_MGR"
+#define CHANNEL_SURVEY_DEFAULT_DWELL_MS 250
+#define CHANNEL_SURVEY_LEAD_MS 100           // Between the last SURVEY message and the first hop
+#define CHANNEL_SURVEY_GUARD_MS 10           // Quiet time at both ends of a dwell
+#define CHANNEL_PROBE_INTERVAL_MS 4          // Between unicast probes, round-robin over peers
+#define CHANNEL_PROBE_LEN 32
+#define CHANNEL_SWITCH_LEAD_MS 200
+#define CHANNEL_SWITCH_ACK_TIMEOUT_MS 500
+#define CHANNEL_SWITCH_MIN_GAIN 10.0f        // Score improvement needed to move the mesh
+#define CHANNEL_SCORE_LOSS_WEIGHT 2.0f       // Score per percent of probe loss
+#define CHANNEL_SCORE_NOISE_REFERENCE_DBM -92 // Noise floor above this costs a point per dB
+#define CHANNEL_BASE_RATE_MBPS 6             // Airtime of foreign frames is costed at this rate
+#define CHANNEL_PREAMBLE_US 20
+#define CHANNEL_MAX_SCHEDULE_AHEAD_MS 10000 // Hops further out than this are treated as bogus
+#define CHANNEL_HOP_QUEUE_LEN (ESP_NOW_CHANNEL_SURVEY_MAX + 2)
+#define CHANNEL_TASK_STACK_SIZE 3072
+#define CHANNEL_TASK_PRIORITY 6
+
+class ESPNowManager;
+
+typedef struct {
+    uint8_t channel;
+    uint32_t dwell_ms;
+    uint32_t frames;             // Foreign frames heard in promiscuous mode
+    float airtime_percent;       // Upper bound: every frame costed at CHANNEL_BASE_RATE_MBPS
+    int8_t noise_floor_dbm;      // 0 when no frame was heard
+    int8_t mean_rssi_dbm;
+    uint32_t probes_sent;        // Unicast probes to surveying peers
+    uint32_t probes_delivered;
+    uint32_t probes_lost;
+    float loss_percent;          // Of probes with an outcome; 0 when no peer took part
+    float score;                 // Lower is better
+} channel_survey_result_t;
+
+// Channel selection for the whole mesh. A survey dwells on each candidate in turn while
+// listening promiscuously for foreign traffic; in a mesh survey every time-synced peer hops
+// on the same schedule and the coordinator probes each of them, so loss is measured on the
+// candidate itself. A coordinated switch moves every peer at one instant (converted into
+// each peer's clock), and peers confirm from the new channel.
+class ChannelManager {
+private:
+    typedef struct {
+        uint8_t channel;
+        uint64_t at_us;
+        bool acknowledge;            // Final hop of a switch: confirm to the coordinator
+        uint16_t switch_id;
+        uint8_t coordinator_mac[6];
+    } hop_t;
+
+    ESPNowManager& manager_;
+    QueueHandle_t hop_queue_;
+    TaskHandle_t hop_task_handle_;
+    SemaphoreHandle_t run_mutex_;
+    SemaphoreHandle_t ack_signal_;
+
+    uint16_t next_id_;
+    uint16_t last_survey_id_;
+    uint16_t last_switch_id_;
+    std::atomic<uint16_t> awaiting_switch_id_;
+    std::atomic<uint32_t> acks_received_;
+
+    // Promiscuous counters, written from the Wi-Fi task while listening
+    std::atomic<uint32_t> frames_;
+    std::atomic<uint32_t> airtime_us_;
+    std::atomic<int32_t> rssi_sum_;
+    std::atomic<int32_t> noise_sum_;
+    static std::atomic<ChannelManager*> listener_;
+
+    static void hop_task(void* parameter);
+    static void promiscuous_cb(void* buf, wifi_promiscuous_pkt_type_t type);
+
+    void start_listening();
+    void stop_listening(channel_survey_result_t* result, uint32_t elapsed_us);
+    std::vector<esp_now_peer_info_t> synced_peers(bool sync_missing);
+    void dwell(uint8_t channel, uint64_t until_us, const std::vector<esp_now_peer_info_t>& peers,
+               channel_survey_result_t* result);
+    static void score(channel_survey_result_t* result);
+
+public:
+    explicit ChannelManager(ESPNowManager& manager);
+    ~ChannelManager();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Called from the receive task
+    void handle_survey(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_switch(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_switch_ack(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    // This node only; peers are unreachable on other candidates while it runs
+    esp_err_t survey_local(const uint8_t* channels, size_t count, uint32_t dwell_ms,
+                           std::vector<channel_survey_result_t>& results);
+
+    // Coordinator: synced peers hop along and are probed on every candidate
+    esp_err_t survey_mesh(const uint8_t* channels, size_t count, uint32_t dwell_ms,
+                          std::vector<channel_survey_result_t>& results);
+
+    // Coordinator: moves every active peer and then this node; ESP_ERR_TIMEOUT if some
+    // peer did not confirm from the new channel
+    esp_err_t switch_mesh(uint8_t channel, uint32_t lead_ms = CHANNEL_SWITCH_LEAD_MS);
+
+    // Mesh survey, then a switch when the best candidate beats the current channel by
+    // CHANNEL_SWITCH_MIN_GAIN
+    esp_err_t select_channel(const uint8_t* channels, size_t count, uint32_t dwell_ms, uint8_t* selected);
+
+    // Non-DFS candidates in both bands, current channel included
+    size_t default_candidates(uint8_t* channels, size_t capacity) const;
+    static void print_survey(const std::vector<channel_survey_result_t>& results);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+
+#define DELEGATE_STORAGE_SIZE (3 * sizeof(void*))  // Room for a lambda capturing up to three pointers
+
+template <typename Signature>
+class Delegate;
+
+// Fixed-size replacement for std::function on the hot paths. The callable is stored
+// inline, so binding or copying a delegate never allocates. Accepts function pointers
+// and lambdas that are trivially copyable and fit DELEGATE_STORAGE_SIZE (captures of
+// pointers and small values); larger captures fail to compile instead of going to the heap.
+template <typename R, typename... Args>
+class Delegate<R(Args...)> {
+private:
+    typedef R (*invoker_t)(const void* storage, Args... args);
+
+    alignas(void*) unsigned char storage_[DELEGATE_STORAGE_SIZE];
+    invoker_t invoke_;
+
+    template <typename Fn>
+    static R invoke_callable(const void* storage, Args... args) {
+        return (*static_cast<const Fn*>(storage))(args...);
+    }
+
+public:
+    Delegate() : storage_{}, invoke_(nullptr) {}
+    Delegate(std::nullptr_t) : storage_{}, invoke_(nullptr) {}
+
+    template <typename Fn,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, Delegate>::value>::type>
+    Delegate(Fn fn) : storage_{}, invoke_(&invoke_callable<Fn>) {
+        static_assert(sizeof(Fn) <= DELEGATE_STORAGE_SIZE, "Callable too large for Delegate");
+        static_assert(alignof(Fn) <= alignof(void*), "Callable alignment too large for Delegate");
+        static_assert(std::is_trivially_copyable<Fn>::value && std::is_trivially_destructible<Fn>::value,
+                      "Delegate only stores trivially copyable callables");
+        new (storage_) Fn(fn);
+    }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+    R operator()(Args... args) const {
+        return invoke_(storage_, args...);
+    }
+};
@@ -1,14 +1,49 @@
 #include "esp_now_manager.hpp"
+#include <esp_random.h>
+#include <algorithm>
+#include <string>
 
 static ESPNowManager* esp_now_manager_instance = nullptr;
 
+typedef struct {
+    uint8_t mac_addr[6];
+    esp_now_send_status_t status;
+    uint64_t timestamp_us;
+} tx_completion_t;
+
+#define ESP_NOW_TX_DONE_QUEUE_LEN (ESP_NOW_TX_MAX_SLOTS + ESP_NOW_MESH_MAX_FORWARDS)  // One per slot in flight
+#define ESP_NOW_TX_IN_FLIGHT_TIMEOUT_MS 500  // A frame with no completion by then has failed
+#define DISCOVERY_DONE_BIT (1 << 0)  // Set whenever no discovery run is active
+
 ESPNowManager::ESPNowManager()
-    : initialized_(false), discovery_active_(false), sequence_counter_(0),
-      receive_queue_(nullptr), send_queue_(nullptr), peers_mutex_(nullptr),
+    : initialized_(false), discovery_active_(false), channel_(ESP_NOW_CHANNEL_5GHZ),
+      default_rate_mode_(ESP_NOW_RATE_MODE_AUTO), sequence_counter_(0),
+      local_espnow_version_(1), large_frames_enabled_(true), driver_peer_count_(0),
+      expiry_config_(default_peer_expiry_config()), expiry_task_handle_(nullptr),
+      discovery_requests_sent_(0), session_start_us_(0),
+      tx_order_counter_(0), tx_in_flight_(0), flow_config_(default_flow_control_config()),
+      tx_queue_config_(default_tx_queue_config()), coalesce_config_(default_coalescing_config()),
+      receive_queue_(nullptr), send_queues_{nullptr, nullptr}, tx_done_queue_(nullptr),
+      forward_queue_(nullptr), forwards_outstanding_(0),
+      send_queue_set_(nullptr), peers_mutex_(nullptr),
       receive_task_handle_(nullptr), send_task_handle_(nullptr),
-      discovery_task_handle_(nullptr) {
-    memset(&statistics_, 0, sizeof(statistics_));
+      discovery_task_handle_(nullptr), discovery_events_(nullptr),
+      discovery_config_(default_discovery_config()), discovery_duration_ms_(0),
+      peer_set_generation_(0), first_new_peer_us_(0), rtt_engine_(*this), reliable_channel_(*this),
+      bulk_transfer_(*this), time_sync_(*this),
+      channel_manager_(*this), key_manager_(*this), message_bus_(*this), mesh_router_(*this), group_manager_(*this),
+      power_manager_(*this),
+      security_config_(default_security_config()),
+      encrypted_peer_count_(0) {
+    memset(&last_snapshot_, 0, sizeof(last_snapshot_));
     memset(local_mac_, 0, sizeof(local_mac_));
+    memset(tx_slots_, 0, sizeof(tx_slots_));
+    memset(tx_late_, 0, sizeof(tx_late_));
+    for (auto& rejected : tx_rejected_) {
+        rejected.store(0);
+    }
+    memset(coalesce_batches_, 0, sizeof(coalesce_batches_));
+    reset_callback_timing();
 }
 
 ESPNowManager::~ESPNowManager() {
@@ -72,6 +107,7 @@ esp_err_t ESPNowManager::initialize(uint8_t channel) {
         ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to set WiFi channel: %s", esp_err_to_name(ret));
         return ret;
     }
+    channel_ = channel;
 
     ret = esp_now_init();
     if (ret != ESP_OK) {
@@ -79,6 +115,12 @@ esp_err_t ESPNowManager::initialize(uint8_t channel) {
         return ret;
     }
 
+    ret = esp_now_get_version(&local_espnow_version_);
+    if (ret != ESP_OK) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Failed to get ESP-NOW version, assuming v1: %s", esp_err_to_name(ret));
+        local_espnow_version_ = 1;
+    }
+
     ret = esp_now_register_send_cb(esp_now_send_cb);
     if (ret != ESP_OK) {
         ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to register send callback: %s", esp_err_to_name(ret));
@@ -97,22 +139,125 @@ esp_err_t ESPNowManager::initialize(uint8_t channel) {
         return ret;
     }
 
-    receive_queue_ = xQueueCreate(20, sizeof(esp_now_message_t) + 6);
-    send_queue_ = xQueueCreate(20, sizeof(esp_now_message_t) + 6);
+    if (security_config_.enabled) {
+        ret = esp_now_set_pmk(security_config_.pmk);
+        if (ret != ESP_OK) {
+            ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to set PMK: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    ret = rx_pool_.initialize(ESP_NOW_RX_POOL_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to create receive buffer pool");
+        return ret;
+    }
+
+    ret = tx_pools_[ESP_NOW_TX_CLASS_CONTROL].initialize(tx_queue_config_.control_depth);
+    if (ret == ESP_OK) {
+        ret = tx_pools_[ESP_NOW_TX_CLASS_BULK].initialize(tx_queue_config_.bulk_depth);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to create send buffer pools");
+        return ret;
+    }
+    memset(tx_slots_, 0, sizeof(tx_slots_));
+    memset(tx_late_, 0, sizeof(tx_late_));
+    tx_in_flight_ = 0;
+
+    ret = rtt_engine_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = reliable_channel_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = bulk_transfer_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = time_sync_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = channel_manager_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = message_bus_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = mesh_router_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = group_manager_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = power_manager_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = peers_.initialize(ESP_NOW_MAX_PEERS);
+    if (ret == ESP_OK) {
+        ret = expiry_queue_.initialize(ESP_NOW_MAX_PEERS);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    driver_peer_count_ = 0;
+
+    receive_queue_ = xQueueCreate(ESP_NOW_RX_POOL_SIZE, sizeof(esp_now_buffer_t*));
+    send_queues_[ESP_NOW_TX_CLASS_CONTROL] = xQueueCreate(tx_queue_config_.control_depth, sizeof(esp_now_buffer_t*));
+    send_queues_[ESP_NOW_TX_CLASS_BULK] = xQueueCreate(tx_queue_config_.bulk_depth, sizeof(esp_now_buffer_t*));
+    tx_done_queue_ = xQueueCreate(ESP_NOW_TX_DONE_QUEUE_LEN, sizeof(tx_completion_t));
+    forward_queue_ = xQueueCreate(ESP_NOW_MESH_MAX_FORWARDS, sizeof(esp_now_buffer_t*));
+    send_queue_set_ = xQueueCreateSet(tx_queue_config_.control_depth + tx_queue_config_.bulk_depth +
+                                      ESP_NOW_TX_DONE_QUEUE_LEN + ESP_NOW_MESH_MAX_FORWARDS);
     peers_mutex_ = xSemaphoreCreateMutex();
+    discovery_events_ = xEventGroupCreate();
 
-    if (!receive_queue_ || !send_queue_ || !peers_mutex_) {
+    if (!receive_queue_ || !send_queues_[ESP_NOW_TX_CLASS_CONTROL] || !send_queues_[ESP_NOW_TX_CLASS_BULK] ||
+        !tx_done_queue_ || !forward_queue_ || !send_queue_set_ || !peers_mutex_ || !discovery_events_) {
         ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to create queues or mutex");
         return ESP_ERR_NO_MEM;
     }
 
-    xTaskCreate(receive_task, "esp_now_recv", 4096, this, 5, &receive_task_handle_);
-    xTaskCreate(send_task, "esp_now_send", 4096, this, 5, &send_task_handle_);
+    // Before the send and receive tasks, which sign and verify with its contexts
+    ret = key_manager_.initialize(security_config_);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    encrypted_peer_count_ = 0;
+
+    xEventGroupSetBits(discovery_events_, DISCOVERY_DONE_BIT);
+    xQueueAddToSet(send_queues_[ESP_NOW_TX_CLASS_CONTROL], send_queue_set_);
+    xQueueAddToSet(send_queues_[ESP_NOW_TX_CLASS_BULK], send_queue_set_);
+    xQueueAddToSet(tx_done_queue_, send_queue_set_);
+    xQueueAddToSet(forward_queue_, send_queue_set_);
+    forwards_outstanding_ = 0;
 
-    statistics_.session_start_time_us = get_timestamp_us();
+    xTaskCreate(receive_task, "esp_now_recv", 6144, this, 5, &receive_task_handle_);
+    xTaskCreate(send_task, "esp_now_send", 6144, this, 5, &send_task_handle_);
+    xTaskCreate(expiry_task, "esp_now_expiry", 3072, this, 3, &expiry_task_handle_);
+
+    reset_statistics();
     initialized_ = true;
 
-    ESP_LOGI(ESP_NOW_MANAGER_TAG, "ESP-NOW Manager initialized successfully");
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "ESP-NOW Manager initialized successfully (ESP-NOW v%lu, max frame %u bytes)",
+             local_espnow_version_, local_max_frame_len());
     ESP_LOGI(ESP_NOW_MANAGER_TAG, "Local MAC: %02x:%02x:%02x:%02x:%02x:%02x",
              local_mac_[0], local_mac_[1], local_mac_[2],
              local_mac_[3], local_mac_[4], local_mac_[5]);
@@ -126,6 +271,8 @@ esp_err_t ESPNowManager::deinitialize() {
     }
 
     stop_discovery();
+    time_sync_.stop_periodic();
+    channel_manager_.deinitialize();
 
     if (receive_task_handle_) {
         vTaskDelete(receive_task_handle_);
@@ -137,14 +284,61 @@ esp_err_t ESPNowManager::deinitialize() {
         send_task_handle_ = nullptr;
     }
 
+    if (expiry_task_handle_) {
+        vTaskDelete(expiry_task_handle_);
+        expiry_task_handle_ = nullptr;
+    }
+
     if (receive_queue_) {
         vQueueDelete(receive_queue_);
         receive_queue_ = nullptr;
     }
 
-    if (send_queue_) {
-        vQueueDelete(send_queue_);
-        send_queue_ = nullptr;
+    // Queued subscribers hand their receive buffers back before the pool goes
+    message_bus_.deinitialize();
+    mesh_router_.deinitialize();
+    group_manager_.deinitialize();
+    power_manager_.deinitialize();
+    rx_pool_.deinitialize();
+    rtt_engine_.deinitialize();
+    reliable_channel_.deinitialize();
+    bulk_transfer_.deinitialize();
+    time_sync_.deinitialize();
+    key_manager_.deinitialize();
+
+    if (send_queue_set_) {
+        for (auto queue : send_queues_) {
+            xQueueRemoveFromSet(queue, send_queue_set_);
+        }
+        xQueueRemoveFromSet(tx_done_queue_, send_queue_set_);
+        xQueueRemoveFromSet(forward_queue_, send_queue_set_);
+        vQueueDelete(send_queue_set_);
+        send_queue_set_ = nullptr;
+    }
+
+    if (forward_queue_) {
+        vQueueDelete(forward_queue_);
+        forward_queue_ = nullptr;
+    }
+
+    for (auto& queue : send_queues_) {
+        if (queue) {
+            vQueueDelete(queue);
+            queue = nullptr;
+        }
+    }
+
+    memset(tx_slots_, 0, sizeof(tx_slots_));
+    memset(tx_late_, 0, sizeof(tx_late_));
+    memset(coalesce_batches_, 0, sizeof(coalesce_batches_));
+    tx_in_flight_ = 0;
+    for (auto& pool : tx_pools_) {
+        pool.deinitialize();
+    }
+
+    if (tx_done_queue_) {
+        vQueueDelete(tx_done_queue_);
+        tx_done_queue_ = nullptr;
     }
 
     if (peers_mutex_) {
@@ -152,370 +346,1994 @@ esp_err_t ESPNowManager::deinitialize() {
         peers_mutex_ = nullptr;
     }
 
+    if (discovery_events_) {
+        vEventGroupDelete(discovery_events_);
+        discovery_events_ = nullptr;
+    }
+
     esp_now_deinit();
     esp_wifi_stop();
     esp_wifi_deinit();
 
-    peers_.clear();
+    peers_.deinitialize();
+    expiry_queue_.deinitialize();
+    driver_peer_count_ = 0;
+    encrypted_peer_count_ = 0;
     initialized_ = false;
 
     ESP_LOGI(ESP_NOW_MANAGER_TAG, "ESP-NOW Manager deinitialized");
     return ESP_OK;
 }
 
+// Runs on the Wi-Fi task: only hand the completion over to the send task
 void ESPNowManager::esp_now_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status) {
     ESPNowManager& manager = get_instance();
-    if (manager.send_callback_) {
-        manager.send_callback_(mac_addr, status);
-    }
-
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        manager.statistics_.total_packets_sent++;
-        manager.update_peer_stats(mac_addr, false, false);
-    } else {
-        manager.statistics_.total_packets_lost++;
-        manager.update_peer_stats(mac_addr, false, true);
-    }
+    uint64_t start_us = manager.get_timestamp_us();
+
+    tx_completion_t completion;
+    memcpy(completion.mac_addr, mac_addr, 6);
+    completion.status = status;
+    completion.timestamp_us = start_us;
+
+    bool queued = xQueueSend(manager.tx_done_queue_, &completion, 0) == pdPASS;
+    uint16_t depth = uxQueueMessagesWaiting(manager.tx_done_queue_);
+    manager.driver_stats_.update([&](driver_counters_t& stats) {
+        stats.tx_done_dropped += queued ? 0 : 1;
+        stats.tx_done_queue_high_water = std::max(stats.tx_done_queue_high_water, depth);
+    });
+
+    uint64_t end_us = manager.get_timestamp_us();
+    manager.tx_callback_timer_.record(start_us, end_us);
+    manager.stage_histograms_[ESP_NOW_STAGE_TX_DRIVER_CALLBACK].record(end_us - start_us);
 }
 
+// Runs on the Wi-Fi task: stamp, copy once into a pooled buffer and enqueue.
+// Validation and peer accounting happen in receive_task.
 void ESPNowManager::esp_now_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
     ESPNowManager& manager = get_instance();
+    uint64_t start_us = manager.get_timestamp_us();
 
-    if (len < sizeof(esp_now_message_t)) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Received message too short: %d bytes", len);
+    if (len < ESP_NOW_MESSAGE_HEADER_LEN || len > (int)sizeof(esp_now_message_t)) {
+        manager.driver_stats_.update([](driver_counters_t& stats) { stats.rx_dropped_invalid_size++; });
         return;
     }
 
-    esp_now_message_t* msg = (esp_now_message_t*)data;
+    // Group frames for groups we are not in never take a buffer or a queue slot
+    uint8_t msg_type = data[offsetof(esp_now_message_t, msg_type)];
+    if ((msg_type == ESP_NOW_MSG_TYPE_GROUP_DATA || msg_type == ESP_NOW_MSG_TYPE_GROUP_SYNC) &&
+        len >= (int)(ESP_NOW_MESSAGE_HEADER_LEN + sizeof(uint16_t))) {
+        uint16_t group_id;
+        memcpy(&group_id, data + offsetof(esp_now_message_t, payload), sizeof(group_id));
+        if (!manager.group_manager_.is_member(group_id)) {
+            manager.group_manager_.count_filtered();
+            return;
+        }
+    }
 
-    uint32_t calculated_crc = esp_crc32_le(0, data, len - sizeof(uint32_t));
-    if (calculated_crc != msg->crc32) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "CRC mismatch in received message");
+    esp_now_buffer_t* buffer = manager.rx_pool_.acquire(0);
+    if (!buffer) {
+        manager.driver_stats_.update([](driver_counters_t& stats) { stats.rx_dropped_no_buffer++; });
         return;
     }
 
-    manager.statistics_.total_packets_received++;
-    manager.statistics_.total_bytes_received += len;
-    manager.update_peer_stats(recv_info->src_addr, true, false);
+    memcpy(buffer->mac_addr, recv_info->src_addr, 6);
+    if (recv_info->rx_ctrl) {
+        buffer->rssi = recv_info->rx_ctrl->rssi;
+        buffer->rx_rate = recv_info->rx_ctrl->rate;
+        buffer->rx_channel = recv_info->rx_ctrl->channel;
+    } else {
+        buffer->rssi = 0;
+        buffer->rx_rate = 0;
+        buffer->rx_channel = 0;
+    }
+    static const uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    buffer->rx_broadcast = recv_info->des_addr && memcmp(recv_info->des_addr, broadcast_addr, 6) == 0;
+    buffer->rx_hops = 0;
+    buffer->frame_len = len;
+    buffer->rx_timestamp_us = start_us;
+    memcpy(&buffer->msg, data, len);
+
+    bool queued = xQueueSend(manager.receive_queue_, &buffer, 0) == pdPASS;
+    if (!queued) {
+        manager.rx_pool_.release(buffer);
+    }
+    uint16_t depth = uxQueueMessagesWaiting(manager.receive_queue_);
+    manager.driver_stats_.update([&](driver_counters_t& stats) {
+        stats.rx_dropped_queue_full += queued ? 0 : 1;
+        stats.rx_queue_high_water = std::max(stats.rx_queue_high_water, depth);
+    });
+
+    uint64_t end_us = manager.get_timestamp_us();
+    manager.rx_callback_timer_.record(start_us, end_us);
+    manager.stage_histograms_[ESP_NOW_STAGE_RX_DRIVER_CALLBACK].record(end_us - start_us);
+}
 
-    typedef struct {
-        uint8_t mac_addr[6];
-        esp_now_message_t msg;
-    } queued_message_t;
+// Runs before validation. With security enabled a frame must carry a valid tag (broadcasts
+// under the group key, AUTH peers under their LMK) unless its peer's mode needs none.
+// A valid tag is stripped; false drops the frame.
+bool ESPNowManager::authenticate_received(esp_now_buffer_t *buffer) {
+    if (!key_manager_.is_enabled()) {
+        return true;
+    }
 
-    queued_message_t queued_msg;
-    memcpy(queued_msg.mac_addr, recv_info->src_addr, 6);
-    memcpy(&queued_msg.msg, msg, sizeof(esp_now_message_t));
+    const esp_now_message_t* msg = &buffer->msg;
+    bool tagged = buffer->frame_len == ESP_NOW_MESSAGE_HEADER_LEN + msg->payload_length + ESP_NOW_AUTH_TAG_LEN;
+    size_t frame_len = tagged ? buffer->frame_len - ESP_NOW_AUTH_TAG_LEN : buffer->frame_len;
+    bool accepted = false;
+
+    if (buffer->rx_broadcast) {
+        accepted = tagged && key_manager_.verify(key_manager_.group_key(), (const uint8_t*)msg, frame_len);
+    } else if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) == pdTRUE) {
+        esp_now_peer_info_t* peer = find_peer(buffer->mac_addr);
+        if (peer && peer->security.keyed) {
+            // ENCRYPTED frames already passed the driver's CCMP check
+            accepted = tagged ? key_manager_.verify(peer->security.lmk, (const uint8_t*)msg, frame_len)
+                              : peer->security.mode != ESP_NOW_LINK_AUTH;
+            if (accepted) {
+                peer->security.frames++;
+            } else {
+                peer->security.auth_failures++;
+            }
+        } else if (tagged && !peer && security_config_.derive_peer_keys) {
+            // A discovery response can arrive before the sender is in the table
+            uint8_t lmk[ESP_NOW_KEY_LEN];
+            key_manager_.derive_lmk(local_mac_, buffer->mac_addr, lmk);
+            accepted = key_manager_.verify(lmk, (const uint8_t*)msg, frame_len);
+        } else if (!tagged) {
+            accepted = !security_config_.require_secure ||
+                       msg->msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST ||
+                       msg->msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE;
+        }
+        xSemaphoreGive(peers_mutex_);
+    }
 
-    if (xQueueSend(manager.receive_queue_, &queued_msg, 0) != pdPASS) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Receive queue full, dropping message");
+    if (!accepted) {
+        ESP_LOGD(ESP_NOW_MANAGER_TAG, "Dropped unauthenticated frame (type 0x%02x) from %02x:%02x:%02x:%02x:%02x:%02x",
+                 msg->msg_type, buffer->mac_addr[0], buffer->mac_addr[1], buffer->mac_addr[2],
+                 buffer->mac_addr[3], buffer->mac_addr[4], buffer->mac_addr[5]);
+        receive_stats_.update([](receive_counters_t& stats) { stats.auth_failures++; });
+        return false;
     }
-}
 
-void ESPNowManager::receive_task(void *parameter) {
-    ESPNowManager* manager = (ESPNowManager*)parameter;
+    buffer->frame_len = frame_len;
+    return true;
+}
 
-    typedef struct {
-        uint8_t mac_addr[6];
-        esp_now_message_t msg;
-    } queued_message_t;
+bool ESPNowManager::validate_received_message(const esp_now_buffer_t *buffer) {
+    const esp_now_message_t* msg = &buffer->msg;
 
-    queued_message_t received_msg;
+    if (ESP_NOW_MESSAGE_HEADER_LEN + msg->payload_length != buffer->frame_len) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Payload length %u does not match frame size %u",
+                 msg->payload_length, buffer->frame_len);
+        receive_stats_.update([](receive_counters_t& stats) { stats.length_errors++; });
+        return false;
+    }
 
-    while (true) {
-        if (xQueueReceive(manager->receive_queue_, &received_msg, portMAX_DELAY) == pdPASS) {
+    if (esp_now_message_crc(msg) != msg->crc32) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "CRC mismatch in received message");
+        receive_stats_.update([](receive_counters_t& stats) { stats.crc_errors++; });
+        return false;
+    }
 
-            if (received_msg.msg.msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST) {
-                ESP_LOGD(ESP_NOW_MANAGER_TAG, "Received discovery request from %02x:%02x:%02x:%02x:%02x:%02x",
-                         received_msg.mac_addr[0], received_msg.mac_addr[1], received_msg.mac_addr[2],
-                         received_msg.mac_addr[3], received_msg.mac_addr[4], received_msg.mac_addr[5]);
+    return true;
+}
 
-                manager->add_peer_internal(received_msg.mac_addr);
+void ESPNowManager::receive_task(void *parameter) {
+    ESPNowManager* manager = (ESPNowManager*)parameter;
 
-                uint8_t response_data[6];
-                memcpy(response_data, manager->local_mac_, 6);
-                manager->send_message(received_msg.mac_addr, ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE,
-                                     response_data, 6);
+    esp_now_buffer_t* buffer = nullptr;
+    uint32_t reported_drops = 0;
 
-                if (manager->peer_discovered_callback_) {
-                    esp_now_peer_info_t* peer = manager->find_peer(received_msg.mac_addr);
-                    if (peer) {
-                        manager->peer_discovered_callback_(peer);
-                    }
-                }
+    while (true) {
+        if (xQueueReceive(manager->receive_queue_, &buffer, portMAX_DELAY) == pdPASS) {
+            const uint8_t* mac_addr = buffer->mac_addr;
+            const esp_now_message_t* msg = &buffer->msg;
+            uint64_t dequeued_us = manager->get_timestamp_us();
+            manager->stage_histograms_[ESP_NOW_STAGE_RX_QUEUE_WAIT].record(dequeued_us - buffer->rx_timestamp_us);
+
+            driver_counters_t driver = manager->driver_stats_.read();
+            uint32_t dropped = driver.rx_dropped_invalid_size + driver.rx_dropped_no_buffer +
+                               driver.rx_dropped_queue_full;
+            if (dropped != reported_drops) {
+                ESP_LOGW(ESP_NOW_MANAGER_TAG, "Receive callback dropped %lu frames (invalid size or no free buffer)",
+                         dropped - reported_drops);
+                reported_drops = dropped;
             }
-            else if (received_msg.msg.msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE) {
-                ESP_LOGD(ESP_NOW_MANAGER_TAG, "Received discovery response from %02x:%02x:%02x:%02x:%02x:%02x",
-                         received_msg.mac_addr[0], received_msg.mac_addr[1], received_msg.mac_addr[2],
-                         received_msg.mac_addr[3], received_msg.mac_addr[4], received_msg.mac_addr[5]);
-
-                manager->add_peer_internal(received_msg.mac_addr);
-                manager->statistics_.discovery_responses_received++;
-
-                if (manager->peer_discovered_callback_) {
-                    esp_now_peer_info_t* peer = manager->find_peer(received_msg.mac_addr);
-                    if (peer) {
-                        manager->peer_discovered_callback_(peer);
-                    }
-                }
+
+            if (!manager->authenticate_received(buffer) || !manager->validate_received_message(buffer)) {
+                manager->rx_pool_.release(buffer);
+                continue;
             }
-            else if (received_msg.msg.msg_type == ESP_NOW_MSG_TYPE_PING) {
-                ESP_LOGD(ESP_NOW_MANAGER_TAG, "Received ping, sending pong");
-                manager->send_message(received_msg.mac_addr, ESP_NOW_MSG_TYPE_PONG,
-                                     (uint8_t*)&received_msg.msg.sequence_number, sizeof(uint32_t));
+
+            manager->receive_stats_.update([&](receive_counters_t& stats) {
+                stats.packets_received++;
+                stats.bytes_received += buffer->frame_len;
+            });
+
+            // Register discovering peers first so their first frame's RSSI is recorded
+            if (msg->msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST ||
+                msg->msg_type == ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE) {
+                manager->add_peer_internal(mac_addr);
             }
+            manager->record_peer_rx(buffer);
 
-            if (manager->receive_callback_) {
-                manager->receive_callback_(received_msg.mac_addr, &received_msg.msg);
+            uint64_t dispatch_start_us = manager->get_timestamp_us();
+            if (msg->msg_type == ESP_NOW_MSG_TYPE_BATCH) {
+                manager->unpack_batch(buffer);
+            } else {
+                manager->dispatch_message(buffer);
             }
+            manager->stage_histograms_[ESP_NOW_STAGE_RX_DISPATCH].record(
+                manager->get_timestamp_us() - dispatch_start_us);
+
+            manager->rx_pool_.release(buffer);
         }
     }
 }
 
-void ESPNowManager::send_task(void *parameter) {
-    ESPNowManager* manager = (ESPNowManager*)parameter;
+void ESPNowManager::handle_discovery_request(const esp_now_buffer_t *buffer) {
+    const uint8_t* mac_addr = buffer->mac_addr;
+    ESP_LOGD(ESP_NOW_MANAGER_TAG, "Received discovery request from %02x:%02x:%02x:%02x:%02x:%02x",
+             mac_addr[0], mac_addr[1], mac_addr[2],
+             mac_addr[3], mac_addr[4], mac_addr[5]);
 
-    typedef struct {
-        uint8_t mac_addr[6];
-        esp_now_message_t msg;
-    } queued_message_t;
+    update_peer_capabilities(mac_addr, &buffer->msg);
+    learn_mesh_routes(buffer);
 
-    queued_message_t send_msg;
+    uint8_t response[ESP_NOW_MAX_PAYLOAD_LEN];
+    send_message(mac_addr, ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE, response, build_discovery_payload(response));
+    notify_peer_discovered(mac_addr);
+}
 
-    while (true) {
-        if (xQueueReceive(manager->send_queue_, &send_msg, portMAX_DELAY) == pdPASS) {
-            esp_err_t result = esp_now_send(send_msg.mac_addr, (uint8_t*)&send_msg.msg,
-                                           sizeof(esp_now_message_t));
-            if (result != ESP_OK) {
-                ESP_LOGW(ESP_NOW_MANAGER_TAG, "Failed to send message: %s", esp_err_to_name(result));
-            } else {
-                manager->statistics_.total_bytes_sent += sizeof(esp_now_message_t);
-            }
-        }
-    }
+void ESPNowManager::handle_discovery_response(const esp_now_buffer_t *buffer) {
+    const uint8_t* mac_addr = buffer->mac_addr;
+    ESP_LOGD(ESP_NOW_MANAGER_TAG, "Received discovery response from %02x:%02x:%02x:%02x:%02x:%02x",
+             mac_addr[0], mac_addr[1], mac_addr[2],
+             mac_addr[3], mac_addr[4], mac_addr[5]);
+
+    update_peer_capabilities(mac_addr, &buffer->msg);
+    learn_mesh_routes(buffer);
+    receive_stats_.update([](receive_counters_t& stats) { stats.discovery_responses_received++; });
+    notify_peer_discovered(mac_addr);
 }
 
-void ESPNowManager::discovery_task(void *parameter) {
-    ESPNowManager* manager = (ESPNowManager*)parameter;
+// The advert follows the capabilities; the link is judged by the smoothed RSSI
+void ESPNowManager::learn_mesh_routes(const esp_now_buffer_t *buffer) {
+    const esp_now_message_t* msg = &buffer->msg;
+    if (msg->payload_length < sizeof(esp_now_discovery_payload_t)) {
+        return;
+    }
 
-    while (manager->discovery_active_) {
-        manager->send_discovery_request();
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Send discovery request every second
+    int8_t rssi = buffer->rssi;
+    esp_now_peer_info_t peer;
+    if (get_peer_info(buffer->mac_addr, &peer) == ESP_OK && peer.rssi_samples > 0) {
+        rssi = peer.rssi;
     }
+    mesh_router_.handle_advert(buffer->mac_addr, msg->payload + sizeof(esp_now_discovery_payload_t),
+                               msg->payload_length - sizeof(esp_now_discovery_payload_t), rssi);
+}
 
-    manager->discovery_task_handle_ = nullptr;
-    vTaskDelete(nullptr);
+void ESPNowManager::notify_peer_discovered(const uint8_t *mac_addr) {
+    esp_now_peer_info_t peer;
+    if (peer_discovered_callback_ && get_peer_info(mac_addr, &peer) == ESP_OK) {
+        peer_discovered_callback_(&peer);
+    }
 }
 
-esp_err_t ESPNowManager::start_discovery(uint32_t duration_ms) {
-    if (!initialized_) {
-        return ESP_ERR_INVALID_STATE;
+// Built at compile time: one indexed load per frame instead of a chain of comparisons.
+// constexpr makes the compiler reject any entry that would need a run-time initializer.
+constexpr ESPNowManager::rx_handler_table_t ESPNowManager::rx_handler_table_ = []() constexpr {
+    rx_handler_table_t table = {};
+    table.handlers[ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.handle_discovery_request(b);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.handle_discovery_response(b);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_PING] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.send_message(b->mac_addr, ESP_NOW_MSG_TYPE_PONG, b->msg.payload, b->msg.payload_length);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_PONG] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.rtt_engine_.handle_pong(&b->msg, b->rx_timestamp_us);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_RELIABLE_DATA] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.reliable_channel_.handle_data(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_RELIABLE_ACK] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.reliable_channel_.handle_ack(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_BULK_DATA] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.bulk_transfer_.handle_fragment(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_BULK_POLL] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.bulk_transfer_.handle_poll(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_BULK_STATUS] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.bulk_transfer_.handle_status(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_TIME_REQUEST] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.time_sync_.handle_request(b->mac_addr, &b->msg, b->rx_timestamp_us);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_TIME_RESPONSE] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.time_sync_.handle_response(b->mac_addr, &b->msg, b->rx_timestamp_us);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_CHANNEL_SURVEY] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.channel_manager_.handle_survey(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_CHANNEL_SWITCH] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.channel_manager_.handle_switch(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_CHANNEL_SWITCH_ACK] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.channel_manager_.handle_switch_ack(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_KEY_SLOT_REQUEST] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.key_manager_.handle_slot_request(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_KEY_SLOT_RESPONSE] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.key_manager_.handle_slot_response(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_POWER_WAKE] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.power_manager_.handle_wake(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_GROUP_SYNC] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.group_manager_.handle_sync(b->mac_addr, &b->msg);
+    };
+    table.handlers[ESP_NOW_MSG_TYPE_GROUP_NACK] = [](ESPNowManager& m, const esp_now_buffer_t* b) {
+        m.group_manager_.handle_nack(b->mac_addr, &b->msg);
+    };
+    return table;
+}();
+
+void ESPNowManager::dispatch_message(esp_now_buffer_t *buffer) {
+    // Relayed frames stop here; frames for this node continue as their inner message
+    if (buffer->msg.msg_type == ESP_NOW_MSG_TYPE_MESH_DATA && !mesh_router_.route(buffer)) {
+        return;
+    }
+    if (buffer->msg.msg_type == ESP_NOW_MSG_TYPE_GROUP_DATA && !group_manager_.accept(buffer)) {
+        return;
     }
 
-    if (discovery_active_) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Discovery already active");
-        return ESP_OK;
+    rx_handler_t handler = rx_handler_table_.handlers[buffer->msg.msg_type];
+    if (handler) {
+        handler(*this, buffer);
     }
 
-    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Starting device discovery for %lu ms", duration_ms);
+    message_bus_.publish(buffer);
+    if (receive_callback_) {
+        receive_callback_(buffer->mac_addr, &buffer->msg);
+    }
+}
 
-    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
-    esp_now_peer_info_t broadcast_peer = {};
-    memcpy(broadcast_peer.peer_addr, broadcast_addr, 6);
-    broadcast_peer.channel = ESP_NOW_CHANNEL_5GHZ;
-    broadcast_peer.encrypt = false;
+// Delivers each record of a BATCH frame as its own message. Records are dispatched from
+// rx_scratch_, so a batch never takes pool buffers from the driver callback; only a
+// holder that retains a record (a queued bus subscriber) gets a pool copy of it.
+void ESPNowManager::unpack_batch(const esp_now_buffer_t *buffer) {
+    const esp_now_message_t* batch = &buffer->msg;
+    size_t offset = 0;
+
+    while (offset + sizeof(esp_now_batch_record_t) <= batch->payload_length) {
+        esp_now_batch_record_t record;
+        memcpy(&record, batch->payload + offset, sizeof(record));
+        offset += sizeof(record);
+
+        // Mesh frames are never coalesced, and a forward needs a pool buffer to send from
+        if (record.length > batch->payload_length - offset || record.msg_type == ESP_NOW_MSG_TYPE_BATCH ||
+            record.msg_type == ESP_NOW_MSG_TYPE_MESH_DATA) {
+            ESP_LOGW(ESP_NOW_MANAGER_TAG, "Malformed batch record at offset %zu", offset);
+            return;
+        }
 
-    esp_err_t ret = esp_now_add_peer(&broadcast_peer);
-    if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST) {
-        ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to add broadcast peer: %s", esp_err_to_name(ret));
-        return ret;
+        esp_now_buffer_t* sub = &rx_scratch_;
+        memcpy(sub->mac_addr, buffer->mac_addr, 6);
+        sub->rssi = buffer->rssi;
+        sub->rx_rate = buffer->rx_rate;
+        sub->rx_channel = buffer->rx_channel;
+        sub->rx_broadcast = buffer->rx_broadcast;
+        sub->rx_hops = buffer->rx_hops;
+        sub->rx_timestamp_us = buffer->rx_timestamp_us;
+        sub->msg.msg_type = record.msg_type;
+        sub->msg.sequence_number = batch->sequence_number;
+        sub->msg.timestamp_us = batch->timestamp_us;
+        sub->msg.payload_length = record.length;
+        memcpy(sub->msg.payload, batch->payload + offset, record.length);
+        sub->msg.crc32 = esp_now_message_crc(&sub->msg);
+        sub->frame_len = esp_now_message_wire_len(&sub->msg);
+        offset += record.length;
+
+        dispatch_message(sub);
     }
+}
 
-    discovery_active_ = true;
-    xTaskCreate(discovery_task, "esp_now_discovery", 2048, this, 4, &discovery_task_handle_);
+void ESPNowManager::send_task(void *parameter) {
+    ESPNowManager* manager = (ESPNowManager*)parameter;
 
-    if (duration_ms > 0) {
-        // Auto-stop discovery after duration
-        vTaskDelay(pdMS_TO_TICKS(duration_ms));
-        stop_discovery();
-    }
+    esp_now_buffer_t* buffer;
+    tx_completion_t completion;
 
-    return ESP_OK;
-}
+    while (true) {
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(manager->send_queue_set_,
+                                                           manager->next_tx_wait_ticks());
 
-esp_err_t ESPNowManager::stop_discovery() {
-    if (!discovery_active_) {
-        return ESP_OK;
+        if (ready == manager->tx_done_queue_) {
+            if (xQueueReceive(manager->tx_done_queue_, &completion, 0) == pdPASS) {
+                manager->handle_send_completion(completion.mac_addr, completion.status, completion.timestamp_us);
+            }
+        } else if (ready == manager->send_queues_[ESP_NOW_TX_CLASS_BULK] || ready == manager->forward_queue_) {
+            if (xQueueReceive(ready, &buffer, 0) == pdPASS) {
+                manager->accept_tx_buffer(buffer, ESP_NOW_TX_CLASS_BULK);
+            }
+        }
+
+        // Control frames are taken as soon as any member is ready, so they never wait
+        // behind bulk frames queued earlier; the set then yields a few empty wakeups
+        while (xQueueReceive(manager->send_queues_[ESP_NOW_TX_CLASS_CONTROL], &buffer, 0) == pdPASS) {
+            manager->accept_tx_buffer(buffer, ESP_NOW_TX_CLASS_CONTROL);
+        }
+
+        manager->flush_expired_batches();
+        manager->pump_tx_slots();
     }
+}
 
-    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Stopping device discovery");
-    discovery_active_ = false;
+void ESPNowManager::accept_tx_buffer(esp_now_buffer_t *buffer, esp_now_tx_class_t tx_class) {
+    uint16_t class_depth = tx_pools_[tx_class].capacity() - tx_pools_[tx_class].available();
+    uint16_t total_depth = get_send_queue_depth();
+    send_stats_.update([&](send_counters_t& stats) {
+        stats.classes[tx_class].enqueued++;
+        stats.classes[tx_class].max_depth = std::max(stats.classes[tx_class].max_depth, class_depth);
+        stats.queue_high_water = std::max(stats.queue_high_water, total_depth);
+    });
+
+    if (coalesce_config_.enabled && tx_class == ESP_NOW_TX_CLASS_BULK) {
+        // A message that cannot fit the peer's frame as a record goes out on its own
+        if (is_coalescable(buffer) &&
+            sizeof(esp_now_batch_record_t) + buffer->msg.payload_length <= get_max_payload_len(buffer->mac_addr)) {
+            coalesce_tx_buffer(buffer);
+            return;
+        }
 
-    if (discovery_task_handle_) {
-        vTaskDelete(discovery_task_handle_);
-        discovery_task_handle_ = nullptr;
+        // Keep per-destination order: an open batch to this peer goes out first
+        for (auto& batch : coalesce_batches_) {
+            if (batch.buffer && memcmp(batch.buffer->mac_addr, buffer->mac_addr, 6) == 0) {
+                flush_batch(&batch);
+            }
+        }
     }
 
-    return ESP_OK;
+    queue_tx_buffer(buffer, tx_class);
 }
 
-esp_err_t ESPNowManager::send_discovery_request() {
-    if (!initialized_) {
-        return ESP_ERR_INVALID_STATE;
+void ESPNowManager::queue_tx_buffer(esp_now_buffer_t *buffer, esp_now_tx_class_t tx_class) {
+    for (auto& slot : tx_slots_) {
+        if (slot.state == TX_SLOT_FREE) {
+            slot.buffer = buffer;
+            slot.state = TX_SLOT_PENDING;
+            slot.attempts = 0;
+            slot.tx_class = tx_class;
+            slot.order = tx_order_counter_++;
+            slot.not_before_us = 0;
+            return;
+        }
     }
 
-    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
-    uint8_t discovery_data[6];
-    memcpy(discovery_data, local_mac_, 6);
-
-    statistics_.discovery_requests_sent++;
-    return send_message(broadcast_addr, ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST, discovery_data, 6);
+    // Unreachable: there is a slot for every tx_pools_ buffer and every forward
+    release_tx_buffer(buffer);
 }
 
-esp_err_t ESPNowManager::add_peer_internal(const uint8_t *mac_addr) {
-    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+void ESPNowManager::release_tx_buffer(esp_now_buffer_t *buffer) {
+    if (rx_pool_.owns(buffer)) {
+        forwards_outstanding_--;
+        rx_pool_.release(buffer);
+        return;
     }
 
-    esp_now_peer_info_t* existing_peer = find_peer(mac_addr);
-    if (existing_peer) {
-        existing_peer->last_seen_us = get_timestamp_us();
-        existing_peer->is_active = true;
-        xSemaphoreGive(peers_mutex_);
-        return ESP_OK;
+    if (buffer->power_held) {
+        buffer->power_held = false;
+        power_manager_.release(buffer->mac_addr);
     }
-
-    // Removed artificial peer limit - let's test natural ESP-NOW capabilities
-    if (peers_.size() >= ESP_NOW_MAX_PEERS) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Peer count (%zu) reaching test limit (%d) - monitoring performance",
-                 peers_.size(), ESP_NOW_MAX_PEERS);
-        // Continue adding peers to test actual limits
+    for (auto& pool : tx_pools_) {
+        if (pool.owns(buffer)) {
+            pool.release(buffer);
+            return;
+        }
     }
+}
 
-    esp_now_peer_info_t new_peer = {};
-    memcpy(new_peer.mac_addr, mac_addr, 6);
-    new_peer.last_seen_us = get_timestamp_us();
-    new_peer.is_active = true;
-
-    esp_now_peer_info_t esp_peer = {};
-    memcpy(esp_peer.peer_addr, mac_addr, 6);
-    esp_peer.channel = ESP_NOW_CHANNEL_5GHZ;
-    esp_peer.encrypt = false;
-
-    esp_err_t ret = esp_now_add_peer(&esp_peer);
-    if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST) {
-        xSemaphoreGive(peers_mutex_);
-        ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to add ESP-NOW peer: %s", esp_err_to_name(ret));
-        return ret;
+bool ESPNowManager::is_coalescable(const esp_now_buffer_t *buffer) const {
+    switch (buffer->msg.msg_type) {
+        case ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST:
+        case ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE:
+        case ESP_NOW_MSG_TYPE_PING:
+        case ESP_NOW_MSG_TYPE_PONG:
+        case ESP_NOW_MSG_TYPE_BATCH:
+        case ESP_NOW_MSG_TYPE_MESH_DATA:
+        case ESP_NOW_MSG_TYPE_GROUP_DATA:
+            return false;
+        default:
+            return tx_class_for((esp_now_msg_type_t)buffer->msg.msg_type) == ESP_NOW_TX_CLASS_BULK &&
+                   buffer->msg.payload_length <= coalesce_config_.max_message_len;
     }
-
-    peers_.push_back(new_peer);
-    xSemaphoreGive(peers_mutex_);
-
-    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Added peer: %02x:%02x:%02x:%02x:%02x:%02x",
-             mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-
-    return ESP_OK;
 }
 
-esp_err_t ESPNowManager::add_peer(const uint8_t *mac_addr) {
-    return add_peer_internal(mac_addr);
-}
+void ESPNowManager::coalesce_tx_buffer(esp_now_buffer_t *buffer) {
+    size_t record_len = sizeof(esp_now_batch_record_t) + buffer->msg.payload_length;
 
-esp_err_t ESPNowManager::remove_peer(const uint8_t *mac_addr) {
-    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+    coalesce_batch_t* batch = nullptr;
+    for (auto& candidate : coalesce_batches_) {
+        if (candidate.buffer && memcmp(candidate.buffer->mac_addr, buffer->mac_addr, 6) == 0) {
+            batch = &candidate;
+            break;
+        }
     }
 
-    for (auto it = peers_.begin(); it != peers_.end(); ++it) {
-        if (memcmp(it->mac_addr, mac_addr, 6) == 0) {
-            esp_now_del_peer(mac_addr);
-            peers_.erase(it);
-            xSemaphoreGive(peers_mutex_);
-            ESP_LOGI(ESP_NOW_MANAGER_TAG, "Removed peer: %02x:%02x:%02x:%02x:%02x:%02x",
-                     mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-            return ESP_OK;
+    if (batch && batch->buffer->msg.payload_length + record_len > batch->max_payload) {
+        flush_batch(batch);
+        batch = nullptr;
+    }
+
+    if (batch) {
+        esp_now_message_t* batch_msg = &batch->buffer->msg;
+        esp_now_batch_record_t record = {buffer->msg.msg_type, buffer->msg.payload_length};
+        memcpy(batch_msg->payload + batch_msg->payload_length, &record, sizeof(record));
+        memcpy(batch_msg->payload + batch_msg->payload_length + sizeof(record),
+               buffer->msg.payload, buffer->msg.payload_length);
+        batch_msg->payload_length += record_len;
+        batch->records++;
+        release_tx_buffer(buffer);
+    } else {
+        // Open a new batch, evicting the one closest to its deadline if all are in use
+        for (auto& candidate : coalesce_batches_) {
+            if (!candidate.buffer) {
+                batch = &candidate;
+                break;
+            }
+            if (!batch || candidate.deadline_us < batch->deadline_us) {
+                batch = &candidate;
+            }
         }
+        if (batch->buffer) {
+            flush_batch(batch);
+        }
+
+        // The first message becomes the batch: shift its payload behind a record header
+        esp_now_message_t* msg = &buffer->msg;
+        esp_now_batch_record_t record = {msg->msg_type, msg->payload_length};
+        memmove(msg->payload + sizeof(record), msg->payload, msg->payload_length);
+        memcpy(msg->payload, &record, sizeof(record));
+        msg->msg_type = ESP_NOW_MSG_TYPE_BATCH;
+        msg->payload_length = record_len;
+
+        batch->buffer = buffer;
+        batch->records = 1;
+        batch->max_payload = get_max_payload_len(buffer->mac_addr);
+        batch->deadline_us = get_timestamp_us() + coalesce_config_.flush_delay_us;
     }
 
-    xSemaphoreGive(peers_mutex_);
-    return ESP_ERR_NOT_FOUND;
+    if (batch->buffer && batch->buffer->msg.payload_length >= coalesce_config_.flush_threshold) {
+        flush_batch(batch);
+    }
 }
 
-bool ESPNowManager::is_peer_registered(const uint8_t *mac_addr) {
-    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return false;
+void ESPNowManager::flush_batch(coalesce_batch_t *batch) {
+    esp_now_buffer_t* buffer = batch->buffer;
+    esp_now_message_t* msg = &buffer->msg;
+
+    if (batch->records == 1) {
+        // Nothing joined it; restore the original message and save the record header
+        esp_now_batch_record_t record;
+        memcpy(&record, msg->payload, sizeof(record));
+        memmove(msg->payload, msg->payload + sizeof(record), record.length);
+        msg->msg_type = record.msg_type;
+        msg->payload_length = record.length;
+    } else {
+        send_stats_.update([&](send_counters_t& stats) {
+            stats.messages_coalesced += batch->records;
+            stats.batches_sent++;
+        });
     }
 
-    bool found = (find_peer(mac_addr) != nullptr);
-    xSemaphoreGive(peers_mutex_);
-    return found;
+    msg->crc32 = esp_now_message_crc(msg);
+    buffer->frame_len = esp_now_message_wire_len(msg);
+
+    batch->buffer = nullptr;
+    batch->records = 0;
+    queue_tx_buffer(buffer, ESP_NOW_TX_CLASS_BULK);
 }
 
-esp_now_peer_info_t* ESPNowManager::find_peer(const uint8_t *mac_addr) {
-    for (auto& peer : peers_) {
-        if (memcmp(peer.mac_addr, mac_addr, 6) == 0) {
-            return &peer;
+void ESPNowManager::flush_expired_batches() {
+    uint64_t now_us = get_timestamp_us();
+    for (auto& batch : coalesce_batches_) {
+        if (batch.buffer && batch.deadline_us <= now_us) {
+            flush_batch(&batch);
         }
     }
-    return nullptr;
 }
 
-std::vector<esp_now_peer_info_t> ESPNowManager::get_peers() {
-    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return std::vector<esp_now_peer_info_t>();
-    }
-
-    std::vector<esp_now_peer_info_t> result = peers_;
-    xSemaphoreGive(peers_mutex_);
-    return result;
+esp_now_coalescing_config_t ESPNowManager::default_coalescing_config() {
+    esp_now_coalescing_config_t config = {};
+    config.enabled = false;
+    config.flush_delay_us = 1500;
+    config.max_message_len = 64;
+    config.flush_threshold = ESP_NOW_MAX_PAYLOAD_LEN - sizeof(esp_now_batch_record_t) - 8;
+    return config;
 }
 
-size_t ESPNowManager::get_peer_count() {
-    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return 0;
-    }
+void ESPNowManager::set_coalescing_config(const esp_now_coalescing_config_t& config) {
+    // The first message is shifted behind a record header inside its own payload
+    const uint16_t max_record_payload = ESP_NOW_MAX_PAYLOAD_LEN_V2 - sizeof(esp_now_batch_record_t);
+    coalesce_config_ = config;
+    coalesce_config_.max_message_len = std::min(config.max_message_len, max_record_payload);
+    coalesce_config_.flush_threshold = std::min(config.flush_threshold, max_record_payload);
+}
 
-    size_t count = peers_.size();
-    xSemaphoreGive(peers_mutex_);
-    return count;
+esp_now_coalescing_config_t ESPNowManager::get_coalescing_config() const {
+    return coalesce_config_;
 }
 
-esp_err_t ESPNowManager::send_message(const uint8_t *mac_addr, esp_now_msg_type_t msg_type,
-                                     const uint8_t *data, size_t len) {
-    if (!initialized_) {
-        return ESP_ERR_INVALID_STATE;
+// Control frames may use control_reserve credits beyond the configured windows
+bool ESPNowManager::has_tx_credit(esp_now_tx_class_t tx_class, size_t in_flight, size_t limit) const {
+    if (tx_class == ESP_NOW_TX_CLASS_CONTROL) {
+        limit += tx_queue_config_.control_reserve;
     }
+    return in_flight < limit;
+}
 
-    if (len > sizeof(((esp_now_message_t*)0)->payload)) {
-        return ESP_ERR_INVALID_SIZE;
+// Sends pending frames, control class first and oldest first within a class, while
+// there is credit for their destination
+void ESPNowManager::pump_tx_slots() {
+    // A lost completion must not hold its slot and credit forever
+    uint64_t stale_now_us = get_timestamp_us();
+    uint64_t stale_us = stale_now_us - (uint64_t)ESP_NOW_TX_IN_FLIGHT_TIMEOUT_MS * 1000;
+    for (auto& slot : tx_slots_) {
+        if (slot.state == TX_SLOT_IN_FLIGHT && (int64_t)(slot.sent_us - stale_us) < 0) {
+            const uint8_t* mac = slot.buffer->mac_addr;
+            ESP_LOGW(ESP_NOW_MANAGER_TAG, "No send completion for %02x:%02x:%02x:%02x:%02x:%02x, dropping the frame",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            tx_in_flight_--;
+            note_tx_timeout(mac, stale_now_us);
+            finish_tx_slot(&slot, ESP_NOW_SEND_FAIL);
+        }
     }
 
-    typedef struct {
-        uint8_t mac_addr[6];
-        esp_now_message_t msg;
-    } queued_message_t;
+    while (has_tx_credit(ESP_NOW_TX_CLASS_CONTROL, tx_in_flight_, flow_config_.max_in_flight)) {
+        uint64_t now_us = get_timestamp_us();
+        tx_slot_t* next = nullptr;
 
-    queued_message_t send_msg;
-    memcpy(send_msg.mac_addr, mac_addr, 6);
+        for (auto& slot : tx_slots_) {
+            if (slot.state != TX_SLOT_PENDING || slot.not_before_us > now_us ||
+                !has_tx_credit(slot.tx_class, tx_in_flight_, flow_config_.max_in_flight)) {
+                continue;
+            }
+            if (next && (slot.tx_class > next->tx_class ||
+                         (slot.tx_class == next->tx_class && (int32_t)(slot.order - next->order) >= 0))) {
+                continue;
+            }
 
-    send_msg.msg.msg_type = msg_type;
-    send_msg.msg.sequence_number = sequence_counter_++;
-    send_msg.msg.timestamp_us = get_timestamp_us();
-    send_msg.msg.payload_length = len;
+            size_t peer_in_flight = 0;
+            for (const auto& other : tx_slots_) {
+                if (other.state == TX_SLOT_IN_FLIGHT &&
+                    memcmp(other.buffer->mac_addr, slot.buffer->mac_addr, 6) == 0) {
+                    peer_in_flight++;
+                }
+            }
+            if (has_tx_credit(slot.tx_class, peer_in_flight, flow_config_.peer_window)) {
+                next = &slot;
+            }
+        }
+
+        if (!next) {
+            return;
+        }
+
+        esp_now_buffer_t* buffer = next->buffer;
+
+        // A sleeping peer hears nothing before its next wake window
+        uint64_t deliver_us = power_manager_.next_delivery_us(buffer->mac_addr, now_us);
+        if (deliver_us > now_us) {
+            next->not_before_us = deliver_us;
+            continue;
+        }
+
+        bool sign = false;
+        uint8_t sign_key[ESP_NOW_KEY_LEN];
+        ensure_driver_peer(buffer->mac_addr, &sign, sign_key);
+
+        // The tag goes behind the frame on every attempt; frame_len stays untagged
+        size_t send_len = buffer->frame_len;
+        if (sign) {
+            if (send_len + ESP_NOW_AUTH_TAG_LEN > sizeof(esp_now_message_t)) {
+                ESP_LOGW(ESP_NOW_MANAGER_TAG, "Frame too large for an authentication tag");
+                finish_tx_slot(next, ESP_NOW_SEND_FAIL);
+                continue;
+            }
+            key_manager_.sign(sign_key, (uint8_t*)&buffer->msg, send_len);
+            send_len += ESP_NOW_AUTH_TAG_LEN;
+        }
+
+        esp_err_t result = esp_now_send(buffer->mac_addr, (uint8_t*)&buffer->msg, send_len);
+        if (result == ESP_OK) {
+            bool first_attempt = next->attempts == 0;
+            uint32_t delay_us = (uint32_t)(now_us - buffer->msg.timestamp_us);
+            send_stats_.update([&](send_counters_t& stats) {
+                stats.bytes_sent += send_len;
+                if (first_attempt) {
+                    esp_now_tx_class_stats_t& class_stats = stats.classes[next->tx_class];
+                    class_stats.dispatched++;
+                    class_stats.queue_delay_total_us += delay_us;
+                    class_stats.queue_delay_max_us = std::max(class_stats.queue_delay_max_us, delay_us);
+                }
+            });
+            if (first_attempt) {
+                stage_histograms_[ESP_NOW_STAGE_TX_QUEUE_WAIT].record(delay_us);
+            }
+            next->state = TX_SLOT_IN_FLIGHT;
+            next->sent_us = get_timestamp_us();
+            next->attempts++;
+            tx_in_flight_++;
+        } else if (result == ESP_ERR_ESPNOW_NO_MEM) {
+            // Driver buffers are full; try again after the next completion or tick
+            next->not_before_us = now_us + 1000;
+            return;
+        } else {
+            ESP_LOGW(ESP_NOW_MANAGER_TAG, "Failed to send message: %s", esp_err_to_name(result));
+            finish_tx_slot(next, ESP_NOW_SEND_FAIL);
+        }
+    }
+}
+
+TickType_t ESPNowManager::next_tx_wait_ticks() {
+    uint64_t deadline_us = UINT64_MAX;
+
+    // Frames waiting only for credit are woken by their completion, or by its timeout
+    for (const auto& slot : tx_slots_) {
+        if (slot.state == TX_SLOT_PENDING && slot.not_before_us < deadline_us &&
+            has_tx_credit(slot.tx_class, tx_in_flight_, flow_config_.max_in_flight)) {
+            deadline_us = slot.not_before_us;
+        } else if (slot.state == TX_SLOT_IN_FLIGHT) {
+            deadline_us = std::min<uint64_t>(deadline_us,
+                                             slot.sent_us + (uint64_t)ESP_NOW_TX_IN_FLIGHT_TIMEOUT_MS * 1000);
+        }
+    }
+
+    for (const auto& batch : coalesce_batches_) {
+        if (batch.buffer && batch.deadline_us < deadline_us) {
+            deadline_us = batch.deadline_us;
+        }
+    }
+
+    if (deadline_us == UINT64_MAX) {
+        return portMAX_DELAY;
+    }
+
+    uint64_t now_us = get_timestamp_us();
+    if (deadline_us <= now_us) {
+        return 1;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
+}
+
+void ESPNowManager::handle_send_completion(const uint8_t *mac_addr, esp_now_send_status_t status,
+                                           uint64_t completed_us) {
+    // The driver reports frames in submission order, so the oldest in-flight frame
+    // to this destination is the one being completed, unless a timed-out one came first
+    if (take_late_completion(mac_addr, completed_us)) {
+        return;
+    }
+
+    tx_slot_t* slot = nullptr;
+    for (auto& candidate : tx_slots_) {
+        if (candidate.state == TX_SLOT_IN_FLIGHT &&
+            memcmp(candidate.buffer->mac_addr, mac_addr, 6) == 0 &&
+            (!slot || (int32_t)(candidate.order - slot->order) < 0)) {
+            slot = &candidate;
+        }
+    }
+
+    if (!slot) {
+        record_send_outcome(mac_addr, status);
+        return;
+    }
+
+    tx_in_flight_--;
+    stage_histograms_[ESP_NOW_STAGE_TX_DRIVER_COMPLETION].record(completed_us - slot->sent_us);
+
+    static const uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    bool is_broadcast = memcmp(mac_addr, broadcast_addr, 6) == 0;
+    if (!is_broadcast) {
+        adapt_peer_rate(mac_addr, status == ESP_NOW_SEND_SUCCESS);
+    }
+
+    if (status != ESP_NOW_SEND_SUCCESS && !is_broadcast && slot->attempts <= flow_config_.max_retries) {
+        slot->state = TX_SLOT_PENDING;
+        slot->not_before_us = get_timestamp_us() +
+                              ((uint64_t)flow_config_.retry_backoff_ms * 1000 << (slot->attempts - 1));
+        send_stats_.update([](send_counters_t& stats) { stats.retries++; });
+        return;
+    }
+
+    finish_tx_slot(slot, status);
+}
+
+void ESPNowManager::finish_tx_slot(tx_slot_t *slot, esp_now_send_status_t status) {
+    esp_now_buffer_t* buffer = slot->buffer;
+    slot->state = TX_SLOT_FREE;
+    slot->buffer = nullptr;
+
+    record_send_outcome(buffer->mac_addr, status);
+    release_tx_buffer(buffer);
+}
+
+// Send task: the timed-out frame's completion, if it comes at all, comes within another timeout
+void ESPNowManager::note_tx_timeout(const uint8_t *mac_addr, uint64_t now_us) {
+    tx_late_t* entry = nullptr;
+    for (auto& candidate : tx_late_) {
+        bool live = candidate.count > 0 && candidate.expires_us > now_us;
+        if (live && memcmp(candidate.mac_addr, mac_addr, 6) == 0) {
+            entry = &candidate;
+            break;
+        }
+        if (!live && !entry) {
+            entry = &candidate;
+        }
+    }
+    if (!entry) {
+        return;
+    }
+
+    if (entry->count == 0 || entry->expires_us <= now_us || memcmp(entry->mac_addr, mac_addr, 6) != 0) {
+        memcpy(entry->mac_addr, mac_addr, 6);
+        entry->count = 0;
+    }
+    entry->count++;
+    entry->expires_us = now_us + (uint64_t)ESP_NOW_TX_IN_FLIGHT_TIMEOUT_MS * 1000;
+}
+
+bool ESPNowManager::take_late_completion(const uint8_t *mac_addr, uint64_t now_us) {
+    for (auto& entry : tx_late_) {
+        if (entry.count > 0 && entry.expires_us > now_us && memcmp(entry.mac_addr, mac_addr, 6) == 0) {
+            entry.count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ESPNowManager::record_send_outcome(const uint8_t *mac_addr, esp_now_send_status_t status) {
+    bool success = status == ESP_NOW_SEND_SUCCESS;
+    send_stats_.update([&](send_counters_t& stats) {
+        stats.packets_sent += success ? 1 : 0;
+        stats.packets_lost += success ? 0 : 1;
+    });
+    update_peer_stats(mac_addr, false, !success);
+
+    if (send_callback_) {
+        send_callback_(mac_addr, status);
+    }
+}
+
+esp_now_flow_control_config_t ESPNowManager::default_flow_control_config() {
+    esp_now_flow_control_config_t config = {};
+    config.peer_window = 4;
+    config.max_in_flight = 8;
+    config.max_retries = 3;
+    config.retry_backoff_ms = 2;
+    return config;
+}
+
+// Read by the send task without locking; apply before traffic starts. The windows are
+// capped at the slots that can be in flight, which the completion queue is sized for.
+void ESPNowManager::set_flow_control_config(const esp_now_flow_control_config_t& config) {
+    flow_config_ = config;
+    flow_config_.peer_window = std::clamp<uint8_t>(config.peer_window, 1, ESP_NOW_TX_DONE_QUEUE_LEN);
+    flow_config_.max_in_flight = std::clamp<uint8_t>(config.max_in_flight, 1, ESP_NOW_TX_DONE_QUEUE_LEN);
+}
+
+esp_now_flow_control_config_t ESPNowManager::get_flow_control_config() const {
+    return flow_config_;
+}
+
+size_t ESPNowManager::get_send_queue_depth() const {
+    size_t depth = 0;
+    for (const auto& pool : tx_pools_) {
+        depth += pool.capacity() - pool.available();
+    }
+    return depth;
+}
+
+bool ESPNowManager::is_send_backpressured(esp_now_tx_class_t tx_class) const {
+    return initialized_ && tx_pools_[tx_class].available() == 0;
+}
+
+esp_now_tx_queue_config_t ESPNowManager::default_tx_queue_config() {
+    esp_now_tx_queue_config_t config = {};
+    config.control_depth = 8;
+    config.bulk_depth = 24;
+    config.control_reserve = 1;
+    return config;
+}
+
+esp_err_t ESPNowManager::set_tx_queue_config(const esp_now_tx_queue_config_t& config) {
+    if (initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.control_depth == 0 || config.bulk_depth == 0 ||
+        config.control_depth + config.bulk_depth > ESP_NOW_TX_MAX_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tx_queue_config_ = config;
+    return ESP_OK;
+}
+
+esp_now_tx_queue_config_t ESPNowManager::get_tx_queue_config() const {
+    return tx_queue_config_;
+}
+
+esp_now_security_config_t ESPNowManager::default_security_config() {
+    esp_now_security_config_t config = {};
+    config.enabled = false;
+    config.max_encrypted_peers = ESP_NOW_MAX_ENCRYPT_PEER_NUM;
+    config.derive_peer_keys = true;
+    config.auth_fallback = true;
+    config.require_secure = true;
+    config.auto_rebalance = true;
+    return config;
+}
+
+esp_err_t ESPNowManager::set_security_config(const esp_now_security_config_t& config) {
+    if (initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.max_encrypted_peers > ESP_NOW_MAX_ENCRYPT_PEER_NUM) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    security_config_ = config;
+    return ESP_OK;
+}
+
+esp_now_security_config_t ESPNowManager::get_security_config() const {
+    return security_config_;
+}
+
+esp_now_tx_class_t ESPNowManager::tx_class_for(esp_now_msg_type_t msg_type) {
+    switch (msg_type) {
+        case ESP_NOW_MSG_TYPE_DATA:
+        case ESP_NOW_MSG_TYPE_BATCH:
+        case ESP_NOW_MSG_TYPE_TEST_DATA:
+        case ESP_NOW_MSG_TYPE_RELIABLE_DATA:
+        case ESP_NOW_MSG_TYPE_BULK_DATA:
+        case ESP_NOW_MSG_TYPE_MESH_DATA:
+        case ESP_NOW_MSG_TYPE_GROUP_DATA:
+            return ESP_NOW_TX_CLASS_BULK;
+        default:
+            return ESP_NOW_TX_CLASS_CONTROL;
+    }
+}
+
+esp_now_tx_class_stats_t ESPNowManager::get_tx_class_stats(esp_now_tx_class_t tx_class) const {
+    esp_now_tx_class_stats_t stats = send_stats_.read().classes[tx_class];
+    stats.rejected = tx_rejected_[tx_class].load(std::memory_order_relaxed);
+    stats.depth = tx_pools_[tx_class].capacity() - tx_pools_[tx_class].available();
+    stats.queue_delay_avg_us = stats.dispatched > 0 ? stats.queue_delay_total_us / stats.dispatched : 0;
+    return stats;
+}
+
+void ESPNowManager::discovery_task(void *parameter) {
+    ESPNowManager* manager = (ESPNowManager*)parameter;
+
+    esp_now_discovery_result_t result = manager->run_discovery();
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Discovery %s after %lu ms: %lu beacons, %lu new peers, %lu total",
+             result.cancelled ? "stopped" : "completed", result.duration_ms, result.beacons_sent,
+             result.peers_added, result.total_peers);
+
+    if (manager->discovery_complete_callback_) {
+        manager->discovery_complete_callback_(result);
+    }
+
+    // The handle is cleared first: start_discovery() creates no new task, and so assigns
+    // no new handle, until the bit is set
+    manager->discovery_task_handle_ = nullptr;
+    xEventGroupSetBits(manager->discovery_events_, DISCOVERY_DONE_BIT);
+    vTaskDelete(nullptr);
+}
+
+esp_now_discovery_result_t ESPNowManager::run_discovery() {
+    esp_now_discovery_result_t result = {};
+    uint64_t start_us = get_timestamp_us();
+    uint64_t deadline_us = discovery_duration_ms_ > 0 ? start_us + discovery_duration_ms_ * 1000ULL : 0;
+    size_t initial_peers = get_peer_count();
+    uint32_t generation = peer_set_generation_.load();
+    uint32_t interval_ms = discovery_config_.min_interval_ms;
+    first_new_peer_us_ = 0;
+
+    while (discovery_active_) {
+        if (send_discovery_request() == ESP_OK) {
+            result.beacons_sent++;
+        }
+
+        uint32_t wait_ms = jittered_interval_ms(interval_ms);
+        if (deadline_us) {
+            uint64_t now_us = get_timestamp_us();
+            if (now_us >= deadline_us) {
+                break;
+            }
+            wait_ms = std::min<uint64_t>(wait_ms, (deadline_us - now_us + 999) / 1000);
+        }
+
+        // stop_discovery() notifies the task so it never sleeps through a cancel
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+
+        if (deadline_us && get_timestamp_us() >= deadline_us) {
+            break;
+        }
+
+        // Stay fast while peers come and go or none are known, otherwise back off
+        uint32_t current = peer_set_generation_.load();
+        if (current != generation || get_peer_count() == 0) {
+            interval_ms = discovery_config_.min_interval_ms;
+        } else {
+            interval_ms = std::min(interval_ms * 2, discovery_config_.max_interval_ms);
+        }
+        generation = current;
+    }
+
+    result.cancelled = !discovery_active_.exchange(false);
+    result.duration_ms = (get_timestamp_us() - start_us) / 1000;
+    result.total_peers = get_peer_count();
+    result.peers_added = result.total_peers > initial_peers ? result.total_peers - initial_peers : 0;
+    uint64_t first_us = first_new_peer_us_.load();
+    result.first_peer_ms = first_us > start_us ? (first_us - start_us) / 1000 : 0;
+    return result;
+}
+
+uint32_t ESPNowManager::jittered_interval_ms(uint32_t interval_ms) const {
+    uint32_t spread = interval_ms * discovery_config_.jitter_percent / 100;
+    if (spread == 0) {
+        return std::max<uint32_t>(interval_ms, 1);
+    }
+    return std::max<uint32_t>(interval_ms - spread + esp_random() % (2 * spread + 1), 1);
+}
+
+esp_err_t ESPNowManager::start_discovery(uint32_t duration_ms) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TaskHandle_t previous = discovery_task_handle_;
+    if (previous && xTaskGetCurrentTaskHandle() == previous) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (previous) {
+        ESP_LOGI(ESP_NOW_MANAGER_TAG, "Restarting active discovery");
+        stop_discovery();
+    }
+    // Also covers a run that cleared its handle but has not signalled completion yet
+    if (wait_for_discovery(pdMS_TO_TICKS(1000)) != ESP_OK) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Previous discovery run did not finish");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Starting device discovery (%s)",
+             duration_ms > 0 ? (std::to_string(duration_ms) + " ms").c_str() : "continuous");
+
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    esp_now_peer_info_t broadcast_peer = {};
+    memcpy(broadcast_peer.peer_addr, broadcast_addr, 6);
+    broadcast_peer.channel = channel_;
+    broadcast_peer.encrypt = false;
+
+    esp_err_t ret = esp_now_add_peer(&broadcast_peer);
+    if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST) {
+        ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to add broadcast peer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    discovery_duration_ms_ = duration_ms;
+    discovery_active_ = true;
+    xEventGroupClearBits(discovery_events_, DISCOVERY_DONE_BIT);
+
+    if (xTaskCreate(discovery_task, "esp_now_discovery", 4096, this, 4, &discovery_task_handle_) != pdPASS) {
+        discovery_active_ = false;
+        discovery_task_handle_ = nullptr;
+        xEventGroupSetBits(discovery_events_, DISCOVERY_DONE_BIT);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ESPNowManager::stop_discovery() {
+    TaskHandle_t task = discovery_task_handle_;
+    if (!task || !discovery_active_.exchange(false)) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Stopping device discovery");
+    xTaskNotifyGive(task);
+
+    // The completion callback may call back in here from the discovery task itself
+    if (xTaskGetCurrentTaskHandle() != task) {
+        wait_for_discovery(pdMS_TO_TICKS(1000));
+    }
+
+    return ESP_OK;
+}
+
+bool ESPNowManager::is_discovery_active() const {
+    return discovery_active_;
+}
+
+esp_err_t ESPNowManager::wait_for_discovery(TickType_t timeout_ticks) {
+    if (!discovery_events_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(discovery_events_, DISCOVERY_DONE_BIT, pdFALSE, pdTRUE, timeout_ticks);
+    return (bits & DISCOVERY_DONE_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_now_discovery_config_t ESPNowManager::default_discovery_config() {
+    esp_now_discovery_config_t config;
+    config.min_interval_ms = 250;
+    config.max_interval_ms = 32000;
+    config.jitter_percent = 25;
+    return config;
+}
+
+void ESPNowManager::set_discovery_config(const esp_now_discovery_config_t& config) {
+    discovery_config_ = config;
+    discovery_config_.min_interval_ms = std::max<uint32_t>(config.min_interval_ms, 10);
+    discovery_config_.max_interval_ms = std::max(config.max_interval_ms, discovery_config_.min_interval_ms);
+}
+
+esp_now_discovery_config_t ESPNowManager::get_discovery_config() const {
+    return discovery_config_;
+}
+
+esp_err_t ESPNowManager::send_discovery_request() {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    uint8_t request[ESP_NOW_MAX_PAYLOAD_LEN];
+
+    discovery_requests_sent_.fetch_add(1, std::memory_order_relaxed);
+    return send_message(broadcast_addr, ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST, request,
+                        build_discovery_payload(request));
+}
+
+// Capabilities, then the mesh advert when forwarding is enabled; fits a (tagged) v1 frame
+size_t ESPNowManager::build_discovery_payload(uint8_t *payload) {
+    esp_now_discovery_payload_t caps;
+    memcpy(caps.mac_addr, local_mac_, 6);
+    caps.espnow_version = large_frames_enabled_ ? (uint8_t)local_espnow_version_ : 1;
+    caps.max_frame_len = local_max_frame_len();
+    memcpy(payload, &caps, sizeof(caps));
+
+    return sizeof(caps) + mesh_router_.write_advert(payload + sizeof(caps), get_max_payload_len(nullptr) - sizeof(caps));
+}
+
+uint16_t ESPNowManager::local_max_frame_len() const {
+    if (large_frames_enabled_ && local_espnow_version_ >= 2) {
+        return ESP_NOW_MAX_DATA_LEN_V2;
+    }
+    return ESP_NOW_MAX_DATA_LEN;
+}
+
+void ESPNowManager::update_peer_capabilities(const uint8_t *mac_addr, const esp_now_message_t *msg) {
+    uint8_t remote_version = 1;
+    uint16_t remote_max_frame = ESP_NOW_MAX_DATA_LEN;
+
+    // Legacy peers only send their MAC; anything beyond it is the capability extension
+    if (msg->payload_length >= sizeof(esp_now_discovery_payload_t)) {
+        const esp_now_discovery_payload_t* caps = (const esp_now_discovery_payload_t*)msg->payload;
+        remote_version = caps->espnow_version;
+        remote_max_frame = caps->max_frame_len;
+    }
+
+    uint16_t frame_len = std::min(local_max_frame_len(), remote_max_frame);
+    if (remote_version < 2 || frame_len < ESP_NOW_MAX_DATA_LEN) {
+        frame_len = ESP_NOW_MAX_DATA_LEN;
+    }
+    frame_len = std::min<uint16_t>(frame_len, ESP_NOW_MAX_DATA_LEN_V2);
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (peer) {
+        uint16_t max_payload = frame_len - ESP_NOW_MESSAGE_HEADER_LEN;
+        if (peer->max_payload_len != max_payload) {
+            ESP_LOGI(ESP_NOW_MANAGER_TAG, "Peer %02x:%02x:%02x:%02x:%02x:%02x negotiated ESP-NOW v%u, max payload %u bytes",
+                     mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5],
+                     frame_len > ESP_NOW_MAX_DATA_LEN ? 2 : 1, max_payload);
+        }
+        peer->espnow_version = frame_len > ESP_NOW_MAX_DATA_LEN ? 2 : 1;
+        peer->max_payload_len = max_payload;
+    }
+
+    xSemaphoreGive(peers_mutex_);
+}
+
+void ESPNowManager::set_large_frames_enabled(bool enabled) {
+    large_frames_enabled_ = enabled;
+}
+
+bool ESPNowManager::is_large_frames_enabled() const {
+    return large_frames_enabled_ && local_espnow_version_ >= 2;
+}
+
+size_t ESPNowManager::get_max_payload_len(const uint8_t *mac_addr) {
+    // With security on, the authentication tag goes behind the payload in the same frame
+    size_t tag_len = key_manager_.is_enabled() ? ESP_NOW_AUTH_TAG_LEN : 0;
+
+    static const uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    if (!mac_addr || memcmp(mac_addr, broadcast_addr, 6) == 0) {
+        // Broadcasts may reach legacy nodes, so they are always limited to v1 frames
+        return ESP_NOW_MAX_PAYLOAD_LEN - tag_len;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_NOW_MAX_PAYLOAD_LEN - tag_len;
+    }
+
+    size_t max_payload = ESP_NOW_MAX_PAYLOAD_LEN;
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (peer && peer->max_payload_len > 0 && is_large_frames_enabled()) {
+        max_payload = peer->max_payload_len;
+    }
+
+    xSemaphoreGive(peers_mutex_);
+    return max_payload - tag_len;
+}
+
+esp_err_t ESPNowManager::add_peer_internal(const uint8_t *mac_addr) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* existing_peer = find_peer(mac_addr);
+    if (existing_peer) {
+        existing_peer->last_seen_us = get_timestamp_us();
+        existing_peer->is_active = true;
+        xSemaphoreGive(peers_mutex_);
+        return ESP_OK;
+    }
+
+    int slot = -1;
+    esp_now_peer_info_t* new_peer = peers_.insert(mac_addr, &slot);
+    if (!new_peer) {
+        xSemaphoreGive(peers_mutex_);
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Peer table full (%d peers), ignoring %02x:%02x:%02x:%02x:%02x:%02x",
+                 ESP_NOW_MAX_PEERS, mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+        return ESP_ERR_NO_MEM;
+    }
+
+    new_peer->last_seen_us = get_timestamp_us();
+    new_peer->is_active = true;
+    new_peer->espnow_version = 1;
+    new_peer->max_payload_len = ESP_NOW_MAX_PAYLOAD_LEN;
+    RateController::reset(new_peer->rate, default_rate_mode_);
+    if (key_manager_.is_enabled() && security_config_.derive_peer_keys) {
+        key_peer(new_peer, nullptr);
+    }
+
+    // Peers beyond the driver's limit get a driver slot on demand when we send to them
+    if (driver_peer_count_ < ESP_NOW_MAX_DRIVER_PEERS) {
+        esp_err_t ret = register_driver_peer(new_peer);
+        if (ret != ESP_OK) {
+            peers_.remove(mac_addr);
+            xSemaphoreGive(peers_mutex_);
+            ESP_LOGE(ESP_NOW_MANAGER_TAG, "Failed to add ESP-NOW peer: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    expiry_queue_.schedule(slot, peer_deadline_us(new_peer));
+
+    size_t peer_count = peers_.size();
+    peer_set_generation_++;
+    uint64_t expected = 0;
+    if (discovery_active_) {
+        first_new_peer_us_.compare_exchange_strong(expected, new_peer->last_seen_us);
+    }
+    xSemaphoreGive(peers_mutex_);
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Added peer: %02x:%02x:%02x:%02x:%02x:%02x (%zu peers)",
+             mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5], peer_count);
+
+    return ESP_OK;
+}
+
+// Caller holds peers_mutex_
+esp_err_t ESPNowManager::register_driver_peer(esp_now_peer_info_t* peer) {
+    esp_now_peer_info_t esp_peer = {};
+    memcpy(esp_peer.peer_addr, peer->mac_addr, 6);
+    esp_peer.channel = peer->channel ? peer->channel : channel_;
+    esp_peer.encrypt = peer->security.mode == ESP_NOW_LINK_ENCRYPTED;
+    if (esp_peer.encrypt) {
+        memcpy(esp_peer.lmk, peer->security.lmk, ESP_NOW_KEY_LEN);
+    }
+
+    esp_err_t ret = esp_now_add_peer(&esp_peer);
+    if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST) {
+        return ret;
+    }
+
+    peer->driver_registered = true;
+    peer->driver_last_used_us = get_timestamp_us();
+    driver_peer_count_++;
+
+    // The driver forgets the rate with the registration
+    peer->rate.applied = false;
+    apply_peer_rate(peer);
+    return ESP_OK;
+}
+
+// Caller holds peers_mutex_
+void ESPNowManager::apply_peer_rate(esp_now_peer_info_t* peer) {
+    if (!peer->driver_registered || peer->rate.applied) {
+        return;
+    }
+
+    esp_now_rate_config_t config;
+    if (!RateController::rate_config(peer->rate, &config)) {
+        peer->rate.applied = true;
+        return;
+    }
+
+    esp_err_t ret = esp_now_set_peer_rate_config(peer->mac_addr, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Failed to set rate for %02x:%02x:%02x:%02x:%02x:%02x: %s",
+                 peer->mac_addr[0], peer->mac_addr[1], peer->mac_addr[2],
+                 peer->mac_addr[3], peer->mac_addr[4], peer->mac_addr[5], esp_err_to_name(ret));
+        return;
+    }
+
+    peer->rate.applied = true;
+    if (peer->rate.mode == ESP_NOW_RATE_MODE_AUTO) {
+        ESP_LOGD(ESP_NOW_MANAGER_TAG, "Peer %02x:%02x:%02x:%02x:%02x:%02x now at %s (%.1f Mbps, RSSI %d)",
+                 peer->mac_addr[0], peer->mac_addr[1], peer->mac_addr[2],
+                 peer->mac_addr[3], peer->mac_addr[4], peer->mac_addr[5],
+                 RateController::step_name(peer->rate.step), RateController::step_mbps(peer->rate.step),
+                 peer->rssi);
+    }
+}
+
+// Every unicast attempt, retries included, feeds the peer's rate controller
+void ESPNowManager::adapt_peer_rate(const uint8_t *mac_addr, bool success) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (peer && RateController::on_tx_result(peer->rate, success, peer->rssi, peer->rssi_samples)) {
+        apply_peer_rate(peer);
+    }
+
+    xSemaphoreGive(peers_mutex_);
+}
+
+esp_err_t ESPNowManager::set_peer_rate(const uint8_t *mac_addr, esp_now_rate_mode_t mode,
+                                       const esp_now_rate_config_t *config) {
+    if (mode == ESP_NOW_RATE_MODE_FIXED && !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (!peer) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    bool was_default = peer->rate.mode == ESP_NOW_RATE_MODE_DEFAULT;
+    if (config) {
+        peer->rate.fixed = *config;
+    }
+    RateController::reset(peer->rate, mode);
+    if (mode == ESP_NOW_RATE_MODE_AUTO && peer->rssi_samples > 0) {
+        peer->rate.step = RateController::rssi_ceiling(peer->rssi);
+    }
+
+    // There is no call to restore the driver default; a fresh registration does that
+    esp_err_t ret = ESP_OK;
+    if (mode == ESP_NOW_RATE_MODE_DEFAULT && !was_default && peer->driver_registered) {
+        esp_now_del_peer(peer->mac_addr);
+        peer->driver_registered = false;
+        driver_peer_count_--;
+        ret = register_driver_peer(peer);
+    } else {
+        apply_peer_rate(peer);
+        ret = peer->rate.applied || !peer->driver_registered ? ESP_OK : ESP_FAIL;
+    }
+
+    xSemaphoreGive(peers_mutex_);
+    return ret;
+}
+
+void ESPNowManager::set_default_rate_mode(esp_now_rate_mode_t mode) {
+    default_rate_mode_ = mode == ESP_NOW_RATE_MODE_FIXED ? ESP_NOW_RATE_MODE_AUTO : mode;
+}
+
+esp_now_rate_mode_t ESPNowManager::get_default_rate_mode() const {
+    return default_rate_mode_;
+}
+
+uint8_t ESPNowManager::get_channel() const {
+    return channel_;
+}
+
+// Caller holds peers_mutex_ (or owns the broadcast registration). The driver replaces
+// the whole registration, so channel and key always go together.
+esp_err_t ESPNowManager::update_driver_peer(const uint8_t *mac_addr, uint8_t channel,
+                                            const esp_now_peer_security_t *security) {
+    esp_now_peer_info_t esp_peer = {};
+    memcpy(esp_peer.peer_addr, mac_addr, 6);
+    esp_peer.channel = channel;
+    esp_peer.encrypt = security && security->mode == ESP_NOW_LINK_ENCRYPTED;
+    if (esp_peer.encrypt) {
+        memcpy(esp_peer.lmk, security->lmk, ESP_NOW_KEY_LEN);
+    }
+    return esp_now_mod_peer(&esp_peer);
+}
+
+esp_err_t ESPNowManager::set_channel(uint8_t channel) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (ret != ESP_OK) {
+        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Failed to set channel %u: %s", channel, esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        channel_ = channel;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    channel_ = channel;
+    static const uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    if (esp_now_is_peer_exist(broadcast_addr)) {
+        update_driver_peer(broadcast_addr, channel, nullptr);
+    }
+    peers_.for_each([this, channel](esp_now_peer_info_t& peer) {
+        if (peer.driver_registered && peer.channel == 0) {
+            update_driver_peer(peer.mac_addr, channel, &peer.security);
+        }
+    });
+    xSemaphoreGive(peers_mutex_);
+
+    ESP_LOGD(ESP_NOW_MANAGER_TAG, "Channel set to %u", channel);
+    return ESP_OK;
+}
+
+esp_err_t ESPNowManager::set_peer_channel(const uint8_t *mac_addr, uint8_t channel) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (!peer) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    peer->channel = channel;
+    esp_err_t ret = ESP_OK;
+    if (peer->driver_registered) {
+        ret = update_driver_peer(mac_addr, channel ? channel : channel_, &peer->security);
+    }
+    xSemaphoreGive(peers_mutex_);
+    return ret;
+}
+
+// Caller holds peers_mutex_. nullptr derives the key; new keys start in the fallback mode.
+void ESPNowManager::key_peer(esp_now_peer_info_t* peer, const uint8_t *lmk) {
+    if (lmk) {
+        memcpy(peer->security.lmk, lmk, ESP_NOW_KEY_LEN);
+    } else {
+        key_manager_.derive_lmk(local_mac_, peer->mac_addr, peer->security.lmk);
+    }
+
+    if (!peer->security.keyed) {
+        peer->security.keyed = true;
+        peer->security.mode = key_manager_.fallback_mode();
+        peer->security.mode_since_us = get_timestamp_us();
+    }
+}
+
+esp_err_t ESPNowManager::set_peer_key(const uint8_t *mac_addr, const uint8_t *lmk) {
+    if (!key_manager_.is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (!peer) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (lmk || security_config_.derive_peer_keys) {
+        key_peer(peer, lmk);
+    } else {
+        if (peer->security.mode == ESP_NOW_LINK_ENCRYPTED) {
+            encrypted_peer_count_--;
+        }
+        peer->security.keyed = false;
+        peer->security.mode = ESP_NOW_LINK_PLAINTEXT;
+        memset(peer->security.lmk, 0, ESP_NOW_KEY_LEN);
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (peer->driver_registered) {
+        ret = update_driver_peer(mac_addr, peer->channel ? peer->channel : channel_, &peer->security);
+    }
+    xSemaphoreGive(peers_mutex_);
+    return ret;
+}
+
+esp_err_t ESPNowManager::set_peer_link_mode(const uint8_t *mac_addr, esp_now_link_mode_t mode) {
+    if (!key_manager_.is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (!peer || !peer->security.keyed) {
+        xSemaphoreGive(peers_mutex_);
+        return peer ? ESP_ERR_INVALID_ARG : ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t previous = peer->security.mode;
+    if (previous == mode) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_OK;
+    }
+    if (mode == ESP_NOW_LINK_ENCRYPTED && encrypted_peer_count_ >= security_config_.max_encrypted_peers) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NO_MEM;
+    }
+
+    peer->security.mode = mode;
+    peer->security.mode_since_us = get_timestamp_us();
+    if (mode == ESP_NOW_LINK_ENCRYPTED) {
+        encrypted_peer_count_++;
+        peer->security.promotions++;
+    } else if (previous == ESP_NOW_LINK_ENCRYPTED) {
+        encrypted_peer_count_--;
+        peer->security.demotions++;
+    }
+
+    // Fall back to a fresh registration if the driver refuses to change the key in place
+    esp_err_t ret = ESP_OK;
+    if (peer->driver_registered &&
+        update_driver_peer(mac_addr, peer->channel ? peer->channel : channel_, &peer->security) != ESP_OK) {
+        esp_now_del_peer(mac_addr);
+        peer->driver_registered = false;
+        driver_peer_count_--;
+        ret = register_driver_peer(peer);
+    }
+    xSemaphoreGive(peers_mutex_);
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Peer %02x:%02x:%02x:%02x:%02x:%02x link mode %s -> %s",
+             mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5],
+             KeyManager::link_mode_name(previous), KeyManager::link_mode_name(mode));
+    return ret;
+}
+
+size_t ESPNowManager::get_encrypted_peer_count() {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return security_config_.max_encrypted_peers;
+    }
+    size_t count = encrypted_peer_count_;
+    xSemaphoreGive(peers_mutex_);
+    return count;
+}
+
+// Makes sure a unicast destination holds a driver slot, evicting the least
+// recently used registration when the driver is full. sign and sign_key report
+// whether the frame needs a tag, and under which key.
+esp_err_t ESPNowManager::ensure_driver_peer(const uint8_t *mac_addr, bool *sign, uint8_t *sign_key) {
+    static const uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    if (memcmp(mac_addr, broadcast_addr, 6) == 0) {
+        if (sign && key_manager_.is_enabled()) {
+            *sign = true;
+            memcpy(sign_key, key_manager_.group_key(), ESP_NOW_KEY_LEN);
+        }
+        return ESP_OK;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (!peer) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (peer->security.keyed) {
+        peer->security.frames++;
+        if (sign && peer->security.mode == ESP_NOW_LINK_AUTH) {
+            *sign = true;
+            memcpy(sign_key, peer->security.lmk, ESP_NOW_KEY_LEN);
+        }
+    }
+
+    if (peer->driver_registered) {
+        peer->driver_last_used_us = get_timestamp_us();
+        xSemaphoreGive(peers_mutex_);
+        return ESP_OK;
+    }
+
+    if (driver_peer_count_ >= ESP_NOW_MAX_DRIVER_PEERS) {
+        esp_now_peer_info_t* victim = nullptr;
+        peers_.for_each([&victim](esp_now_peer_info_t& candidate) {
+            if (candidate.driver_registered &&
+                (!victim || candidate.driver_last_used_us < victim->driver_last_used_us)) {
+                victim = &candidate;
+            }
+        });
+
+        if (victim) {
+            esp_now_del_peer(victim->mac_addr);
+            victim->driver_registered = false;
+            driver_peer_count_--;
+            ESP_LOGD(ESP_NOW_MANAGER_TAG, "Evicted driver peer %02x:%02x:%02x:%02x:%02x:%02x",
+                     victim->mac_addr[0], victim->mac_addr[1], victim->mac_addr[2],
+                     victim->mac_addr[3], victim->mac_addr[4], victim->mac_addr[5]);
+        }
+    }
+
+    esp_err_t ret = register_driver_peer(peer);
+    xSemaphoreGive(peers_mutex_);
+    return ret;
+}
+
+esp_err_t ESPNowManager::add_peer(const uint8_t *mac_addr, const uint8_t *lmk) {
+    if (lmk && !key_manager_.is_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = add_peer_internal(mac_addr);
+    if (ret == ESP_OK && lmk) {
+        ret = set_peer_key(mac_addr, lmk);
+    }
+    return ret;
+}
+
+esp_err_t ESPNowManager::remove_peer(const uint8_t *mac_addr) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
 
-    if (data && len > 0) {
-        memcpy(send_msg.msg.payload, data, len);
+    int slot = peers_.find_slot(mac_addr);
+    if (slot < 0) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    remove_peer_slot(slot);
+    xSemaphoreGive(peers_mutex_);
+
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Removed peer: %02x:%02x:%02x:%02x:%02x:%02x",
+             mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+    return ESP_OK;
+}
+
+// Caller holds peers_mutex_
+void ESPNowManager::remove_peer_slot(int slot) {
+    esp_now_peer_info_t* peer = peers_.at(slot);
+    if (!peer) {
+        return;
+    }
+
+    uint8_t mac_addr[6];
+    memcpy(mac_addr, peer->mac_addr, 6);
+    if (peer->driver_registered) {
+        esp_now_del_peer(mac_addr);
+        driver_peer_count_--;
+    }
+    if (peer->security.mode == ESP_NOW_LINK_ENCRYPTED) {
+        encrypted_peer_count_--;
+    }
+    expiry_queue_.remove(slot);
+    peers_.remove(mac_addr);
+    peer_set_generation_++;
+    mesh_router_.on_neighbor_lost(mac_addr);
+    time_sync_.forget_peer(mac_addr);
+}
+
+// Caller holds peers_mutex_
+uint64_t ESPNowManager::peer_deadline_us(const esp_now_peer_info_t* peer) const {
+    uint32_t timeout_ms = peer->timeout_ms ? peer->timeout_ms : expiry_config_.timeout_ms;
+    return peer->last_seen_us + (uint64_t)timeout_ms * 1000;
+}
+
+esp_err_t ESPNowManager::set_peer_timeout(const uint8_t *mac_addr, uint32_t timeout_ms) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    int slot = peers_.find_slot(mac_addr);
+    if (slot < 0) {
+        xSemaphoreGive(peers_mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_now_peer_info_t* peer = peers_.at(slot);
+    peer->timeout_ms = timeout_ms;
+    expiry_queue_.schedule(slot, peer_deadline_us(peer));
+    xSemaphoreGive(peers_mutex_);
+
+    // The deadline may now come before the one the expiry task sleeps towards
+    xTaskNotifyGive(expiry_task_handle_);
+    return ESP_OK;
+}
+
+esp_now_peer_expiry_config_t ESPNowManager::default_peer_expiry_config() {
+    esp_now_peer_expiry_config_t config = {};
+    config.enabled = true;
+    config.timeout_ms = ESP_NOW_PEER_TIMEOUT_DEFAULT_MS;
+    return config;
+}
+
+void ESPNowManager::set_peer_expiry_config(const esp_now_peer_expiry_config_t& config) {
+    if (!initialized_) {
+        expiry_config_ = config;
+        return;
+    }
+    if (xSemaphoreTake(peers_mutex_, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    expiry_config_ = config;
+    // A shorter timeout makes the queued deadlines late, so requeue every peer
+    for (size_t slot = 0; slot < peers_.slot_count(); slot++) {
+        esp_now_peer_info_t* peer = peers_.at(slot);
+        if (peer) {
+            expiry_queue_.schedule(slot, peer_deadline_us(peer));
+        }
+    }
+    xSemaphoreGive(peers_mutex_);
+    xTaskNotifyGive(expiry_task_handle_);
+}
+
+esp_now_peer_expiry_config_t ESPNowManager::get_peer_expiry_config() const {
+    return expiry_config_;
+}
+
+// Removes every peer past its deadline in one locked pass. Queued deadlines only go
+// stale towards the past (traffic moves last_seen_us forward), so a head that comes
+// due is checked against the peer and moved instead of expired when it was heard since.
+TickType_t ESPNowManager::expire_peers(std::vector<esp_now_peer_info_t>& lost) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return pdMS_TO_TICKS(100);
+    }
+
+    if (!expiry_config_.enabled) {
+        xSemaphoreGive(peers_mutex_);
+        return portMAX_DELAY;
+    }
+
+    uint64_t now_us = get_timestamp_us();
+    while (!expiry_queue_.empty() && expiry_queue_.next_deadline_us() <= now_us) {
+        size_t slot = expiry_queue_.next_slot();
+        esp_now_peer_info_t* peer = peers_.at(slot);
+        if (!peer) {
+            expiry_queue_.remove(slot);
+            continue;
+        }
+
+        uint64_t deadline_us = peer_deadline_us(peer);
+        if (deadline_us > now_us) {
+            expiry_queue_.schedule(slot, deadline_us);
+            continue;
+        }
+
+        lost.push_back(*peer);
+        remove_peer_slot(slot);
+    }
+
+    TickType_t wait = portMAX_DELAY;
+    if (!expiry_queue_.empty()) {
+        uint64_t wait_us = expiry_queue_.next_deadline_us() - now_us;
+        wait = std::max<TickType_t>(pdMS_TO_TICKS((wait_us + 999) / 1000), 1);
+    }
+    xSemaphoreGive(peers_mutex_);
+    return wait;
+}
+
+void ESPNowManager::expiry_task(void *parameter) {
+    ESPNowManager* manager = static_cast<ESPNowManager*>(parameter);
+    std::vector<esp_now_peer_info_t> lost;
+
+    while (true) {
+        TickType_t wait = manager->expire_peers(lost);
+        uint64_t now_us = manager->get_timestamp_us();
+
+        for (const auto& peer : lost) {
+            ESP_LOGI(ESP_NOW_MANAGER_TAG, "Peer lost: %02x:%02x:%02x:%02x:%02x:%02x (last seen %.1f s ago)",
+                     peer.mac_addr[0], peer.mac_addr[1], peer.mac_addr[2],
+                     peer.mac_addr[3], peer.mac_addr[4], peer.mac_addr[5],
+                     (now_us - peer.last_seen_us) / 1000000.0f);
+            if (manager->peer_lost_callback_) {
+                manager->peer_lost_callback_(&peer);
+            }
+        }
+        lost.clear();
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+bool ESPNowManager::is_peer_registered(const uint8_t *mac_addr) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return false;
+    }
+
+    bool found = (find_peer(mac_addr) != nullptr);
+    xSemaphoreGive(peers_mutex_);
+    return found;
+}
+
+esp_now_peer_info_t* ESPNowManager::find_peer(const uint8_t *mac_addr) {
+    return peers_.find(mac_addr);
+}
+
+std::vector<esp_now_peer_info_t> ESPNowManager::get_peers() {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return std::vector<esp_now_peer_info_t>();
+    }
+
+    std::vector<esp_now_peer_info_t> result;
+    result.reserve(peers_.size());
+    peers_.for_each([&result](const esp_now_peer_info_t& peer) {
+        result.push_back(peer);
+    });
+    xSemaphoreGive(peers_mutex_);
+    return result;
+}
+
+esp_err_t ESPNowManager::get_peer_info(const uint8_t *mac_addr, esp_now_peer_info_t *info) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(mac_addr);
+    if (peer && info) {
+        *info = *peer;
+    }
+
+    xSemaphoreGive(peers_mutex_);
+    return peer ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+std::vector<esp_now_peer_info_t> ESPNowManager::get_peers_by_rssi(int8_t min_rssi) {
+    std::vector<esp_now_peer_info_t> result;
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return result;
+    }
+
+    peers_.for_each([&result, min_rssi](const esp_now_peer_info_t& peer) {
+        if (peer.rssi_samples > 0 && peer.rssi >= min_rssi) {
+            result.push_back(peer);
+        }
+    });
+    xSemaphoreGive(peers_mutex_);
+
+    std::sort(result.begin(), result.end(),
+              [](const esp_now_peer_info_t& a, const esp_now_peer_info_t& b) {
+                  return a.rssi_ewma_q4 > b.rssi_ewma_q4;
+              });
+    return result;
+}
+
+esp_now_peer_info_t* ESPNowManager::get_strongest_peer() {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return nullptr;
+    }
+
+    esp_now_peer_info_t* strongest = nullptr;
+    peers_.for_each([&strongest](esp_now_peer_info_t& peer) {
+        if (peer.rssi_samples > 0 && (!strongest || peer.rssi_ewma_q4 > strongest->rssi_ewma_q4)) {
+            strongest = &peer;
+        }
+    });
+
+    xSemaphoreGive(peers_mutex_);
+    return strongest;
+}
+
+size_t ESPNowManager::get_peer_count() {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return 0;
+    }
+
+    size_t count = peers_.size();
+    xSemaphoreGive(peers_mutex_);
+    return count;
+}
+
+esp_err_t ESPNowManager::send_message(const uint8_t *mac_addr, esp_now_msg_type_t msg_type,
+                                     const uint8_t *data, size_t len, TickType_t wait_ticks) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    send_msg.msg.crc32 = esp_crc32_le(0, (uint8_t*)&send_msg.msg,
-                                     sizeof(esp_now_message_t) - sizeof(uint32_t));
+    if (len > get_max_payload_len(mac_addr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_now_tx_class_t tx_class = tx_class_for(msg_type);
+
+    // Frames to a sleeping peer wait for its window in the shared pool; past its budget
+    // only this sender is held back, and sends to awake peers keep their buffers
+    bool power_held = false;
+    TickType_t start_ticks = xTaskGetTickCount();
+    while (!power_manager_.admit(mac_addr, &power_held)) {
+        TickType_t waited = xTaskGetTickCount() - start_ticks;
+        if (waited >= wait_ticks) {
+            tx_rejected_[tx_class].fetch_add(1, std::memory_order_relaxed);
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(std::min<TickType_t>(std::max<TickType_t>(pdMS_TO_TICKS(ESP_NOW_POWER_ADMIT_POLL_MS), 1),
+                                        wait_ticks - waited));
+    }
+    if (power_held && wait_ticks != portMAX_DELAY) {
+        TickType_t waited = xTaskGetTickCount() - start_ticks;
+        wait_ticks = waited < wait_ticks ? wait_ticks - waited : 0;
+    }
 
-    if (xQueueSend(send_queue_, &send_msg, pdMS_TO_TICKS(1000)) != pdPASS) {
-        ESP_LOGW(ESP_NOW_MANAGER_TAG, "Send queue full");
+    esp_now_buffer_t* buffer = tx_pools_[tx_class].acquire(wait_ticks);
+    if (!buffer) {
+        ESP_LOGD(ESP_NOW_MANAGER_TAG, "Send queue full (class %d)", tx_class);
+        tx_rejected_[tx_class].fetch_add(1, std::memory_order_relaxed);
+        if (power_held) {
+            power_manager_.release(mac_addr);
+        }
         return ESP_ERR_TIMEOUT;
     }
 
+    memcpy(buffer->mac_addr, mac_addr, 6);
+    buffer->power_held = power_held;
+
+    esp_now_message_t* msg = &buffer->msg;
+    msg->msg_type = msg_type;
+    msg->sequence_number = sequence_counter_++;
+    msg->timestamp_us = get_timestamp_us();
+    msg->payload_length = len;
+
+    if (data && len > 0) {
+        memcpy(msg->payload, data, len);
+    }
+
+    msg->crc32 = esp_now_message_crc(msg);
+    buffer->frame_len = esp_now_message_wire_len(msg);
+
+    // Cannot fail: each queue is as deep as its pool
+    xQueueSend(send_queues_[tx_class], &buffer, 0);
     return ESP_OK;
 }
 
@@ -525,8 +2343,71 @@ esp_err_t ESPNowManager::send_broadcast(esp_now_msg_type_t msg_type, const uint8
 }
 
 esp_err_t ESPNowManager::send_ping(const uint8_t *mac_addr) {
-    uint32_t ping_id = sequence_counter_;
-    return send_message(mac_addr, ESP_NOW_MSG_TYPE_PING, (uint8_t*)&ping_id, sizeof(ping_id));
+    return rtt_engine_.send_ping(mac_addr, sizeof(esp_now_ping_payload_t));
+}
+
+RttEngine& ESPNowManager::get_rtt_engine() {
+    return rtt_engine_;
+}
+
+ReliableChannel& ESPNowManager::get_reliable_channel() {
+    return reliable_channel_;
+}
+
+esp_err_t ESPNowManager::send_bulk(const uint8_t *mac_addr, const uint8_t *data, size_t len,
+                                   bulk_progress_callback_t on_progress, bulk_progress_t *result) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return bulk_transfer_.send(mac_addr, data, len, on_progress, result);
+}
+
+BulkTransfer& ESPNowManager::get_bulk_transfer() {
+    return bulk_transfer_;
+}
+
+TimeSync& ESPNowManager::get_time_sync() {
+    return time_sync_;
+}
+
+ChannelManager& ESPNowManager::get_channel_manager() {
+    return channel_manager_;
+}
+
+KeyManager& ESPNowManager::get_key_manager() {
+    return key_manager_;
+}
+
+MessageBus& ESPNowManager::get_message_bus() {
+    return message_bus_;
+}
+
+MeshRouter& ESPNowManager::get_mesh_router() {
+    return mesh_router_;
+}
+
+esp_err_t ESPNowManager::join_group(uint16_t group_id) {
+    return group_manager_.join(group_id);
+}
+
+esp_err_t ESPNowManager::leave_group(uint16_t group_id) {
+    return group_manager_.leave(group_id);
+}
+
+esp_err_t ESPNowManager::send_to_group(uint16_t group_id, esp_now_msg_type_t msg_type, const uint8_t *data,
+                                       size_t len, bool reliable) {
+    if (!initialized_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return group_manager_.send(group_id, msg_type, data, len, reliable);
+}
+
+GroupManager& ESPNowManager::get_group_manager() {
+    return group_manager_;
+}
+
+PowerManager& ESPNowManager::get_power_manager() {
+    return power_manager_;
 }
 
 const uint8_t* ESPNowManager::get_local_mac() {
@@ -534,12 +2415,161 @@ const uint8_t* ESPNowManager::get_local_mac() {
 }
 
 esp_now_statistics_t ESPNowManager::get_statistics() {
-    return statistics_;
+    driver_counters_t driver = driver_stats_.read();
+    receive_counters_t rx = receive_stats_.read();
+    send_counters_t tx = send_stats_.read();
+
+    esp_now_statistics_t stats = {};
+    stats.total_packets_sent = tx.packets_sent;
+    stats.total_packets_received = rx.packets_received;
+    stats.total_packets_lost = tx.packets_lost;
+    stats.discovery_requests_sent = discovery_requests_sent_.load(std::memory_order_relaxed);
+    stats.discovery_responses_received = rx.discovery_responses_received;
+    stats.total_retries = tx.retries;
+    stats.messages_coalesced = tx.messages_coalesced;
+    stats.batches_sent = tx.batches_sent;
+    stats.total_bytes_sent = tx.bytes_sent;
+    stats.total_bytes_received = rx.bytes_received;
+
+    stats.rx_dropped_invalid_size = driver.rx_dropped_invalid_size;
+    stats.rx_dropped_no_buffer = driver.rx_dropped_no_buffer + rx.batch_records_dropped;
+    stats.rx_dropped_queue_full = driver.rx_dropped_queue_full;
+    stats.rx_crc_errors = rx.crc_errors;
+    stats.rx_length_errors = rx.length_errors;
+    stats.rx_auth_failures = rx.auth_failures;
+    for (const auto& rejected : tx_rejected_) {
+        stats.tx_queue_timeouts += rejected.load(std::memory_order_relaxed);
+    }
+    stats.tx_done_dropped = driver.tx_done_dropped;
+
+    stats.rx_queue_high_water = driver.rx_queue_high_water;
+    stats.tx_queue_high_water = tx.queue_high_water;
+    stats.tx_done_queue_high_water = driver.tx_done_queue_high_water;
+    stats.rx_callback = rx_callback_timer_.snapshot();
+    stats.tx_callback = tx_callback_timer_.snapshot();
+
+    stats.session_start_time_us = session_start_us_.load(std::memory_order_relaxed);
+    stats.snapshot_time_us = get_timestamp_us();
+    return stats;
+}
+
+esp_now_statistics_t ESPNowManager::get_statistics_delta() {
+    esp_now_statistics_t current = get_statistics();
+    esp_now_statistics_t delta = statistics_delta(current, last_snapshot_);
+    last_snapshot_ = current;
+    return delta;
 }
 
+// Counters are differenced (unsigned, so wraparound is harmless); gauges and maxima
+// are taken from current. session_start_time_us becomes the start of the interval.
+esp_now_statistics_t ESPNowManager::statistics_delta(const esp_now_statistics_t& current,
+                                                     const esp_now_statistics_t& previous) {
+    esp_now_statistics_t delta = current;
+    delta.total_packets_sent -= previous.total_packets_sent;
+    delta.total_packets_received -= previous.total_packets_received;
+    delta.total_packets_lost -= previous.total_packets_lost;
+    delta.discovery_requests_sent -= previous.discovery_requests_sent;
+    delta.discovery_responses_received -= previous.discovery_responses_received;
+    delta.total_retries -= previous.total_retries;
+    delta.messages_coalesced -= previous.messages_coalesced;
+    delta.batches_sent -= previous.batches_sent;
+    delta.total_bytes_sent -= previous.total_bytes_sent;
+    delta.total_bytes_received -= previous.total_bytes_received;
+    delta.rx_dropped_invalid_size -= previous.rx_dropped_invalid_size;
+    delta.rx_dropped_no_buffer -= previous.rx_dropped_no_buffer;
+    delta.rx_dropped_queue_full -= previous.rx_dropped_queue_full;
+    delta.rx_crc_errors -= previous.rx_crc_errors;
+    delta.rx_length_errors -= previous.rx_length_errors;
+    delta.rx_auth_failures -= previous.rx_auth_failures;
+    delta.tx_queue_timeouts -= previous.tx_queue_timeouts;
+    delta.tx_done_dropped -= previous.tx_done_dropped;
+    delta.rx_callback.invocations -= previous.rx_callback.invocations;
+    delta.rx_callback.total_us -= previous.rx_callback.total_us;
+    delta.tx_callback.invocations -= previous.tx_callback.invocations;
+    delta.tx_callback.total_us -= previous.tx_callback.total_us;
+
+    if (previous.snapshot_time_us >= current.session_start_time_us) {
+        delta.session_start_time_us = previous.snapshot_time_us;
+    }
+    return delta;
+}
+
+// Each writer zeroes its own shard on its next update, so nothing races the reset
 void ESPNowManager::reset_statistics() {
-    memset(&statistics_, 0, sizeof(statistics_));
-    statistics_.session_start_time_us = get_timestamp_us();
+    driver_stats_.request_reset();
+    receive_stats_.request_reset();
+    send_stats_.request_reset();
+    discovery_requests_sent_.store(0, std::memory_order_relaxed);
+    for (auto& rejected : tx_rejected_) {
+        rejected.store(0, std::memory_order_relaxed);
+    }
+    memset(&last_snapshot_, 0, sizeof(last_snapshot_));
+    session_start_us_.store(get_timestamp_us(), std::memory_order_relaxed);
+}
+
+void ESPNowManager::callback_timer_t::record(uint64_t start_us, uint64_t end_us) {
+    uint32_t elapsed_us = (uint32_t)(end_us - start_us);
+    invocations.fetch_add(1, std::memory_order_relaxed);
+    total_us.fetch_add(elapsed_us, std::memory_order_relaxed);
+    if (elapsed_us > max_us.load(std::memory_order_relaxed)) {
+        max_us.store(elapsed_us, std::memory_order_relaxed);
+    }
+}
+
+esp_now_callback_timing_t ESPNowManager::callback_timer_t::snapshot() const {
+    esp_now_callback_timing_t timing;
+    timing.invocations = invocations.load(std::memory_order_relaxed);
+    timing.total_us = total_us.load(std::memory_order_relaxed);
+    timing.max_us = max_us.load(std::memory_order_relaxed);
+    return timing;
+}
+
+void ESPNowManager::callback_timer_t::reset() {
+    invocations.store(0, std::memory_order_relaxed);
+    total_us.store(0, std::memory_order_relaxed);
+    max_us.store(0, std::memory_order_relaxed);
+}
+
+esp_now_callback_timing_t ESPNowManager::get_receive_callback_timing() const {
+    return rx_callback_timer_.snapshot();
+}
+
+esp_now_callback_timing_t ESPNowManager::get_send_callback_timing() const {
+    return tx_callback_timer_.snapshot();
+}
+
+void ESPNowManager::reset_callback_timing() {
+    rx_callback_timer_.reset();
+    tx_callback_timer_.reset();
+}
+
+const LatencyHistogram& ESPNowManager::get_latency_histogram(esp_now_latency_stage_t stage) const {
+    return stage_histograms_[stage];
+}
+
+void ESPNowManager::reset_latency_histograms() {
+    for (auto& histogram : stage_histograms_) {
+        histogram.reset();
+    }
+}
+
+void ESPNowManager::print_latency_histograms() const {
+    ESP_LOGI(ESP_NOW_MANAGER_TAG, "Hot-path latency by stage:");
+    for (int stage = 0; stage < ESP_NOW_STAGE_COUNT; stage++) {
+        stage_histograms_[stage].print(ESP_NOW_MANAGER_TAG, latency_stage_name((esp_now_latency_stage_t)stage));
+    }
+}
+
+const char* ESPNowManager::latency_stage_name(esp_now_latency_stage_t stage) {
+    switch (stage) {
+        case ESP_NOW_STAGE_TX_QUEUE_WAIT: return "tx_queue_wait";
+        case ESP_NOW_STAGE_TX_DRIVER_COMPLETION: return "tx_driver_completion";
+        case ESP_NOW_STAGE_RX_QUEUE_WAIT: return "rx_queue_wait";
+        case ESP_NOW_STAGE_RX_DISPATCH: return "rx_dispatch";
+        case ESP_NOW_STAGE_RX_DRIVER_CALLBACK: return "rx_driver_callback";
+        case ESP_NOW_STAGE_TX_DRIVER_CALLBACK: return "tx_driver_callback";
+        default: return "unknown";
+    }
 }
 
 uint64_t ESPNowManager::get_timestamp_us() {
@@ -566,6 +2596,105 @@ void ESPNowManager::update_peer_stats(const uint8_t *mac_addr, bool is_received,
     xSemaphoreGive(peers_mutex_);
 }
 
+void ESPNowManager::record_peer_rx(const esp_now_buffer_t *buffer) {
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+
+    esp_now_peer_info_t* peer = find_peer(buffer->mac_addr);
+    if (peer) {
+        peer->packets_received++;
+        peer->last_seen_us = buffer->rx_timestamp_us;
+        peer->last_rx_rate = buffer->rx_rate;
+        peer->last_rx_channel = buffer->rx_channel;
+        if (buffer->rssi != 0) {
+            update_peer_rssi(peer, buffer->rssi);
+            if (RateController::on_rssi(peer->rate, peer->rssi, peer->rssi_samples)) {
+                apply_peer_rate(peer);
+            }
+        }
+    }
+
+    xSemaphoreGive(peers_mutex_);
+}
+
+// Caller holds peers_mutex_. EWMA with alpha = 1/8, kept in 1/16 dB fixed point.
+void ESPNowManager::update_peer_rssi(esp_now_peer_info_t* peer, int8_t rssi) {
+    if (peer->rssi_samples == 0) {
+        peer->rssi_ewma_q4 = rssi * 16;
+        peer->rssi_min = rssi;
+        peer->rssi_max = rssi;
+    } else {
+        peer->rssi_ewma_q4 += (rssi * 16 - peer->rssi_ewma_q4) / 8;
+        peer->rssi_min = std::min(peer->rssi_min, rssi);
+        peer->rssi_max = std::max(peer->rssi_max, rssi);
+    }
+
+    peer->rssi_samples++;
+    peer->rssi_last = rssi;
+    peer->rssi = (int8_t)((peer->rssi_ewma_q4 + (peer->rssi_ewma_q4 < 0 ? -8 : 8)) / 16);
+}
+
+const esp_now_message_t* ESPNowManager::retain_message(const esp_now_message_t* msg) {
+    esp_now_buffer_t* buffer = rx_pool_.from_message(msg);
+    if (!buffer && msg == &rx_scratch_.msg) {
+        buffer = &rx_scratch_;
+    }
+    if (!buffer) {
+        return nullptr;
+    }
+
+    buffer = retain_buffer(buffer);
+    return buffer ? &buffer->msg : nullptr;
+}
+
+esp_now_buffer_t* ESPNowManager::retain_buffer(esp_now_buffer_t* buffer) {
+    if (buffer != &rx_scratch_) {
+        rx_pool_.retain(buffer);
+        return buffer;
+    }
+
+    esp_now_buffer_t* copy = rx_pool_.acquire(0);
+    if (!copy) {
+        receive_stats_.update([](receive_counters_t& stats) { stats.batch_records_dropped++; });
+        return nullptr;
+    }
+    memcpy(copy->mac_addr, buffer->mac_addr, 6);
+    copy->rssi = buffer->rssi;
+    copy->rx_rate = buffer->rx_rate;
+    copy->rx_channel = buffer->rx_channel;
+    copy->rx_broadcast = buffer->rx_broadcast;
+    copy->rx_hops = buffer->rx_hops;
+    copy->rx_timestamp_us = buffer->rx_timestamp_us;
+    copy->frame_len = buffer->frame_len;
+    memcpy(&copy->msg, &buffer->msg, buffer->frame_len);
+    return copy;
+}
+
+void ESPNowManager::release_message(const esp_now_message_t* msg) {
+    rx_pool_.release(rx_pool_.from_message(msg));
+}
+
+// The send task treats the buffer as a bulk frame and hands it back through release_tx_buffer()
+esp_err_t ESPNowManager::forward_buffer(esp_now_buffer_t* buffer, const uint8_t* next_hop) {
+    if (forwards_outstanding_.fetch_add(1) >= ESP_NOW_MESH_MAX_FORWARDS) {
+        forwards_outstanding_--;
+        return ESP_ERR_NO_MEM;
+    }
+
+    rx_pool_.retain(buffer);
+    memcpy(buffer->mac_addr, next_hop, 6);
+    esp_now_message_t* msg = &buffer->msg;
+    msg->sequence_number = sequence_counter_++;
+    msg->timestamp_us = get_timestamp_us();
+    msg->crc32 = esp_now_message_crc(msg);
+    buffer->frame_len = esp_now_message_wire_len(msg);
+
+    // Cannot fail: the queue is as deep as the forward budget
+    xQueueSend(forward_queue_, &buffer, 0);
+    return ESP_OK;
+}
+
 void ESPNowManager::set_receive_callback(esp_now_receive_callback_t callback) {
     receive_callback_ = callback;
 }
@@ -576,4 +2705,12 @@ void ESPNowManager::set_send_callback(esp_now_send_callback_t callback) {
 
 void ESPNowManager::set_peer_discovered_callback(esp_now_peer_discovered_callback_t callback) {
     peer_discovered_callback_ = callback;
+}
+
+void ESPNowManager::set_peer_lost_callback(esp_now_peer_lost_callback_t callback) {
+    peer_lost_callback_ = callback;
+}
+
+void ESPNowManager::set_discovery_complete_callback(esp_now_discovery_complete_callback_t callback) {
+    discovery_complete_callback_ = callback;
 }
\ No newline at end of file
@@ -9,46 +9,47 @@
 #include <freertos/task.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include <freertos/event_groups.h>
 #include <string.h>
+#include <stddef.h>
 #include <vector>
 #include <functional>
 #include <chrono>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+#include "message_pool.hpp"
+#include "peer_table.hpp"
+#include "peer_expiry.hpp"
+#include "rtt_engine.hpp"
+#include "reliable_channel.hpp"
+#include "bulk_transfer.hpp"
+#include "time_sync.hpp"
+#include "channel_manager.hpp"
+#include "key_manager.hpp"
+#include "message_bus.hpp"
+#include "mesh_router.hpp"
+#include "group_manager.hpp"
+#include "power_manager.hpp"
+#include "stats_shard.hpp"
+#include "delegate.hpp"
+#include "latency_histogram.hpp"
 
 #define ESP_NOW_MANAGER_TAG "ESP_NOW_MGR"
-#define ESP_NOW_MAX_PEERS 20  // Increased for testing - will measure actual limits
+#define ESP_NOW_MAX_PEERS 64  // Peer table capacity; may exceed what the driver can hold
+#define ESP_NOW_MAX_DRIVER_PEERS (ESP_NOW_MAX_TOTAL_PEER_NUM - 1)  // One driver slot is the broadcast peer
 #define ESP_NOW_BROADCAST_ADDR {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
 #define ESP_NOW_CHANNEL_5GHZ 36
-#define ESP_NOW_MAX_DATA_LEN 250
-
-typedef enum {
-    ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST = 0x01,
-    ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE = 0x02,
-    ESP_NOW_MSG_TYPE_PING = 0x10,
-    ESP_NOW_MSG_TYPE_PONG = 0x11,
-    ESP_NOW_MSG_TYPE_DATA = 0x20,
-    ESP_NOW_MSG_TYPE_TEST_START = 0x30,
-    ESP_NOW_MSG_TYPE_TEST_STOP = 0x31,
-    ESP_NOW_MSG_TYPE_TEST_DATA = 0x32,
-} esp_now_msg_type_t;
-
-typedef struct {
-    uint8_t msg_type;
-    uint32_t sequence_number;
-    uint64_t timestamp_us;
-    uint16_t payload_length;
-    uint32_t crc32;
-    uint8_t payload[ESP_NOW_MAX_DATA_LEN - 16];
-} __attribute__((packed)) esp_now_message_t;
+#define ESP_NOW_RX_POOL_SIZE 16  // Preallocated receive buffers (also the receive queue depth)
+#define ESP_NOW_TX_MAX_SLOTS 32  // Upper bound on control_depth + bulk_depth
+#define ESP_NOW_COALESCE_MAX_OPEN 4  // Destinations with a batch being filled at once
+#define ESP_NOW_PEER_TIMEOUT_DEFAULT_MS 60000
 
+// Time spent inside the ESP-NOW driver callbacks (Wi-Fi task context)
 typedef struct {
-    uint8_t mac_addr[6];
-    int8_t rssi;
-    uint64_t last_seen_us;
-    uint32_t packets_sent;
-    uint32_t packets_received;
-    uint32_t packets_lost;
-    bool is_active;
-} esp_now_peer_info_t;
+    uint32_t invocations;
+    uint32_t total_us;
+    uint32_t max_us;
+} esp_now_callback_timing_t;
 
 typedef struct {
     uint32_t total_packets_sent;
@@ -56,35 +57,277 @@ typedef struct {
     uint32_t total_packets_lost;
     uint32_t discovery_requests_sent;
     uint32_t discovery_responses_received;
+    uint32_t total_retries;
+    uint32_t messages_coalesced;  // Messages sent inside BATCH frames
+    uint32_t batches_sent;
     uint64_t total_bytes_sent;
     uint64_t total_bytes_received;
+
+    // Drop reasons
+    uint32_t rx_dropped_invalid_size;   // Frame shorter than a header or longer than a message
+    uint32_t rx_dropped_no_buffer;      // Receive pool exhausted (frames and unpacked batch records)
+    uint32_t rx_dropped_queue_full;
+    uint32_t rx_crc_errors;
+    uint32_t rx_length_errors;          // Header payload length disagrees with the frame size
+    uint32_t rx_auth_failures;          // Missing or bad tag, or plaintext from a peer without a key
+    uint32_t tx_queue_timeouts;         // send_message gave up waiting for a buffer
+    uint32_t tx_done_dropped;           // Send completions lost to a full completion queue
+
+    // High-water marks and maxima since the last reset; not differenced by deltas
+    uint16_t rx_queue_high_water;
+    uint16_t tx_queue_high_water;       // Frames queued or in flight, both classes
+    uint16_t tx_done_queue_high_water;
+
+    esp_now_callback_timing_t rx_callback;
+    esp_now_callback_timing_t tx_callback;
+
     uint64_t session_start_time_us;
+    uint64_t snapshot_time_us;
 } esp_now_statistics_t;
 
-typedef std::function<void(const uint8_t*, const esp_now_message_t*)> esp_now_receive_callback_t;
-typedef std::function<void(const uint8_t*, esp_now_send_status_t)> esp_now_send_callback_t;
-typedef std::function<void(const esp_now_peer_info_t*)> esp_now_peer_discovered_callback_t;
+// Windowed sender. A frame holds its credit from esp_now_send() until esp_now_send_cb
+// reports it; failed unicast frames are retried after retry_backoff_ms << (attempt - 1).
+typedef struct {
+    uint8_t peer_window;         // Frames in flight per destination
+    uint8_t max_in_flight;       // Frames in flight across all destinations
+    uint8_t max_retries;
+    uint16_t retry_backoff_ms;
+} esp_now_flow_control_config_t;
+
+// Send traffic classes. Control frames (discovery, ping/pong, acknowledgements and
+// transfer status) are always dispatched ahead of bulk payload frames.
+typedef enum {
+    ESP_NOW_TX_CLASS_CONTROL = 0,
+    ESP_NOW_TX_CLASS_BULK,
+    ESP_NOW_TX_CLASS_COUNT,
+} esp_now_tx_class_t;
+
+// Buffers per class: send_message blocks when its class is exhausted, so a full bulk
+// queue never delays control traffic. control_reserve extra in-flight credits (global
+// and per peer) are usable only by control frames. Applied at initialize().
+typedef struct {
+    uint8_t control_depth;
+    uint8_t bulk_depth;
+    uint8_t control_reserve;
+} esp_now_tx_queue_config_t;
+
+// Peers not heard from for timeout_ms are removed at their deadline, and the peer lost
+// callback runs on the expiry task. Peers can override the timeout with set_peer_timeout().
+typedef struct {
+    bool enabled;
+    uint32_t timeout_ms;
+} esp_now_peer_expiry_config_t;
+
+// Queue delay is measured from send_message() to the first esp_now_send() of the frame
+typedef struct {
+    uint32_t enqueued;
+    uint32_t dispatched;
+    uint32_t rejected;           // send_message timed out waiting for a buffer
+    uint16_t depth;              // Frames currently queued or in flight
+    uint16_t max_depth;
+    uint32_t queue_delay_avg_us;
+    uint32_t queue_delay_max_us;
+    uint64_t queue_delay_total_us;
+} esp_now_tx_class_stats_t;
+
+// Hot-path stages with a latency histogram each (microseconds). Each is recorded by a
+// single context: the send task, the receive task or the Wi-Fi task (driver callbacks).
+typedef enum {
+    ESP_NOW_STAGE_TX_QUEUE_WAIT = 0,     // send_message() to first esp_now_send()
+    ESP_NOW_STAGE_TX_DRIVER_COMPLETION,  // esp_now_send() to esp_now_send_cb, per attempt
+    ESP_NOW_STAGE_RX_QUEUE_WAIT,         // esp_now_recv_cb to receive_task dequeue
+    ESP_NOW_STAGE_RX_DISPATCH,           // Internal handlers plus the receive callback
+    ESP_NOW_STAGE_RX_DRIVER_CALLBACK,    // Time inside esp_now_recv_cb
+    ESP_NOW_STAGE_TX_DRIVER_CALLBACK,    // Time inside esp_now_send_cb
+    ESP_NOW_STAGE_COUNT,
+} esp_now_latency_stage_t;
+
+// Adaptive discovery: beacons every min_interval_ms while the peer set is empty or
+// changing, backing off by 2x per quiet round up to max_interval_ms. Each wait is
+// randomized by +/- jitter_percent so nodes that boot together drift apart.
+typedef struct {
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;
+    uint8_t jitter_percent;
+} esp_now_discovery_config_t;
+
+// Opt-in coalescing of small messages to the same destination into one BATCH
+// frame. A batch is sent once it reaches flush_threshold payload bytes, when no
+// further record fits, or flush_delay_us after its first message (rounded up to
+// the next RTOS tick).
+typedef struct {
+    bool enabled;
+    uint32_t flush_delay_us;
+    uint16_t max_message_len;    // Larger messages bypass coalescing
+    uint16_t flush_threshold;
+} esp_now_coalescing_config_t;
+
+typedef struct {
+    uint32_t duration_ms;
+    uint32_t beacons_sent;
+    uint32_t peers_added;        // New peers registered during this run
+    uint32_t total_peers;
+    uint32_t first_peer_ms;      // Time to the first new peer, 0 if none
+    bool cancelled;              // Ended by stop_discovery() rather than its duration
+} esp_now_discovery_result_t;
+
+// Delegates store the callable inline: setting or invoking a callback never allocates
+typedef Delegate<void(const uint8_t*, const esp_now_message_t*)> esp_now_receive_callback_t;
+typedef Delegate<void(const uint8_t*, esp_now_send_status_t)> esp_now_send_callback_t;
+typedef Delegate<void(const esp_now_peer_info_t*)> esp_now_peer_discovered_callback_t;
+typedef Delegate<void(const esp_now_peer_info_t*)> esp_now_peer_lost_callback_t;
+typedef Delegate<void(const esp_now_discovery_result_t&)> esp_now_discovery_complete_callback_t;
 
 class ESPNowManager {
 private:
+    // Single writer (the Wi-Fi task), read from any task
+    struct callback_timer_t {
+        std::atomic<uint32_t> invocations;
+        std::atomic<uint32_t> total_us;
+        std::atomic<uint32_t> max_us;
+
+        void record(uint64_t start_us, uint64_t end_us);
+        esp_now_callback_timing_t snapshot() const;
+        void reset();
+    };
+
+    // Statistics are sharded by writer context so increments need no locking;
+    // see StatsShard for how readers get a consistent copy
+    struct driver_counters_t {       // Wi-Fi task (driver callbacks)
+        uint32_t rx_dropped_invalid_size;
+        uint32_t rx_dropped_no_buffer;
+        uint32_t rx_dropped_queue_full;
+        uint32_t tx_done_dropped;
+        uint16_t rx_queue_high_water;
+        uint16_t tx_done_queue_high_water;
+    };
+
+    struct receive_counters_t {      // receive_task
+        uint32_t packets_received;
+        uint32_t discovery_responses_received;
+        uint32_t crc_errors;
+        uint32_t length_errors;
+        uint32_t auth_failures;
+        uint32_t batch_records_dropped;  // A holder wanted a copy and the pool was empty
+        uint64_t bytes_received;
+    };
+
+    struct send_counters_t {         // send_task
+        uint32_t packets_sent;
+        uint32_t packets_lost;
+        uint32_t retries;
+        uint32_t messages_coalesced;
+        uint32_t batches_sent;
+        uint16_t queue_high_water;
+        uint64_t bytes_sent;
+        esp_now_tx_class_stats_t classes[ESP_NOW_TX_CLASS_COUNT];
+    };
+
+    enum tx_slot_state_t : uint8_t {
+        TX_SLOT_FREE,
+        TX_SLOT_PENDING,         // Waiting for credit or for its retry time
+        TX_SLOT_IN_FLIGHT,
+    };
+
+    // A batch frame being filled by the send task; buffer is the first message, rewritten in place
+    struct coalesce_batch_t {
+        esp_now_buffer_t* buffer;
+        uint16_t max_payload;
+        uint16_t records;
+        uint64_t deadline_us;
+    };
+
+    // Send task bookkeeping for one tx_pools_ buffer
+    struct tx_slot_t {
+        esp_now_buffer_t* buffer;
+        tx_slot_state_t state;
+        uint8_t attempts;
+        esp_now_tx_class_t tx_class;
+        uint32_t order;          // Submission order, keeps per-peer FIFO across retries
+        uint64_t not_before_us;
+        uint64_t sent_us;        // Last esp_now_send() of this frame
+    };
+
+    // Frames to mac_addr the send task timed out; their completions, should they still
+    // arrive, are discarded instead of being matched to the next frame in flight
+    struct tx_late_t {
+        uint8_t mac_addr[6];
+        uint8_t count;
+        uint64_t expires_us;
+    };
+
     bool initialized_;
-    bool discovery_active_;
+    std::atomic<bool> discovery_active_;
     uint8_t local_mac_[6];
+    uint8_t channel_;                            // Set by initialize(); every driver peer uses it
+    esp_now_rate_mode_t default_rate_mode_;      // Applied to peers as they are added
     uint32_t sequence_counter_;
+    uint32_t local_espnow_version_;
+    bool large_frames_enabled_;
+
+    PeerTable peers_;
+    size_t driver_peer_count_;
+    PeerExpiryQueue expiry_queue_;      // Deadlines by peer slot, may be early but never late
+    esp_now_peer_expiry_config_t expiry_config_;
+    TaskHandle_t expiry_task_handle_;
 
-    std::vector<esp_now_peer_info_t> peers_;
-    esp_now_statistics_t statistics_;
+    StatsShard<driver_counters_t> driver_stats_;
+    StatsShard<receive_counters_t> receive_stats_;
+    StatsShard<send_counters_t> send_stats_;
+    std::atomic<uint32_t> discovery_requests_sent_;  // Any task may send a request
+    std::atomic<uint64_t> session_start_us_;
+    esp_now_statistics_t last_snapshot_;
 
-    QueueHandle_t receive_queue_;
-    QueueHandle_t send_queue_;
+    MessagePool rx_pool_;
+    esp_now_buffer_t rx_scratch_;    // Receive task: batch records are dispatched from here
+    MessagePool tx_pools_[ESP_NOW_TX_CLASS_COUNT];
+    tx_slot_t tx_slots_[ESP_NOW_TX_MAX_SLOTS + ESP_NOW_MESH_MAX_FORWARDS];
+    tx_late_t tx_late_[ESP_NOW_TX_MAX_SLOTS + ESP_NOW_MESH_MAX_FORWARDS];
+    uint32_t tx_order_counter_;
+    size_t tx_in_flight_;
+    esp_now_flow_control_config_t flow_config_;
+    esp_now_tx_queue_config_t tx_queue_config_;
+    std::atomic<uint32_t> tx_rejected_[ESP_NOW_TX_CLASS_COUNT];  // Written by any sending task
+    coalesce_batch_t coalesce_batches_[ESP_NOW_COALESCE_MAX_OPEN];
+    esp_now_coalescing_config_t coalesce_config_;
+    QueueHandle_t receive_queue_;  // esp_now_buffer_t* from rx_pool_
+    QueueHandle_t send_queues_[ESP_NOW_TX_CLASS_COUNT];  // esp_now_buffer_t* from tx_pools_
+    QueueHandle_t tx_done_queue_;  // Send completions posted by esp_now_send_cb
+    QueueHandle_t forward_queue_;  // esp_now_buffer_t* from rx_pool_, relayed by the mesh router
+    std::atomic<uint32_t> forwards_outstanding_;
+    QueueSetHandle_t send_queue_set_;
     SemaphoreHandle_t peers_mutex_;
+
+    callback_timer_t rx_callback_timer_;
+    callback_timer_t tx_callback_timer_;
+    LatencyHistogram stage_histograms_[ESP_NOW_STAGE_COUNT];
     TaskHandle_t receive_task_handle_;
     TaskHandle_t send_task_handle_;
     TaskHandle_t discovery_task_handle_;
+    EventGroupHandle_t discovery_events_;
+    esp_now_discovery_config_t discovery_config_;
+    uint32_t discovery_duration_ms_;
+    std::atomic<uint32_t> peer_set_generation_;  // Bumped whenever a peer is added or removed
+    std::atomic<uint64_t> first_new_peer_us_;
+
+    RttEngine rtt_engine_;
+    ReliableChannel reliable_channel_;
+    BulkTransfer bulk_transfer_;
+    TimeSync time_sync_;
+    ChannelManager channel_manager_;
+    KeyManager key_manager_;
+    MessageBus message_bus_;
+    MeshRouter mesh_router_;
+    GroupManager group_manager_;
+    PowerManager power_manager_;
+    esp_now_security_config_t security_config_;
+    size_t encrypted_peer_count_;       // Peers in ESP_NOW_LINK_ENCRYPTED, registered or not
 
     esp_now_receive_callback_t receive_callback_;
     esp_now_send_callback_t send_callback_;
     esp_now_peer_discovered_callback_t peer_discovered_callback_;
+    esp_now_peer_lost_callback_t peer_lost_callback_;
+    esp_now_discovery_complete_callback_t discovery_complete_callback_;
 
     static void esp_now_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status);
     static void esp_now_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len);
@@ -92,11 +335,58 @@ private:
     static void receive_task(void *parameter);
     static void send_task(void *parameter);
     static void discovery_task(void *parameter);
+    static void expiry_task(void *parameter);
+
+    // Internal handlers by message type; types without one only reach the receive callback
+    typedef void (*rx_handler_t)(ESPNowManager& manager, const esp_now_buffer_t* buffer);
+    typedef struct {
+        rx_handler_t handlers[256];
+    } rx_handler_table_t;
+    static const rx_handler_table_t rx_handler_table_;  // Defined constexpr, once the class is complete
+    void handle_discovery_request(const esp_now_buffer_t *buffer);
+    void handle_discovery_response(const esp_now_buffer_t *buffer);
+    void learn_mesh_routes(const esp_now_buffer_t *buffer);
+    void notify_peer_discovered(const uint8_t *mac_addr);
+    TickType_t expire_peers(std::vector<esp_now_peer_info_t>& lost);
+    uint64_t peer_deadline_us(const esp_now_peer_info_t* peer) const;
+    void remove_peer_slot(int slot);
+    esp_now_discovery_result_t run_discovery();
+    uint32_t jittered_interval_ms(uint32_t interval_ms) const;
 
     esp_err_t add_peer_internal(const uint8_t *mac_addr);
+    void update_peer_capabilities(const uint8_t *mac_addr, const esp_now_message_t *msg);
+    size_t build_discovery_payload(uint8_t *payload);
+    uint16_t local_max_frame_len() const;
     esp_now_peer_info_t* find_peer(const uint8_t *mac_addr);
+    esp_err_t register_driver_peer(esp_now_peer_info_t* peer);
+    void apply_peer_rate(esp_now_peer_info_t* peer);
+    esp_err_t update_driver_peer(const uint8_t *mac_addr, uint8_t channel,
+                                 const esp_now_peer_security_t *security);
+    void adapt_peer_rate(const uint8_t *mac_addr, bool success);
+    esp_err_t ensure_driver_peer(const uint8_t *mac_addr, bool *sign = nullptr, uint8_t *sign_key = nullptr);
+    void key_peer(esp_now_peer_info_t* peer, const uint8_t *lmk);
+    bool authenticate_received(esp_now_buffer_t *buffer);
     uint64_t get_timestamp_us();
+    bool validate_received_message(const esp_now_buffer_t *buffer);
+    void handle_send_completion(const uint8_t *mac_addr, esp_now_send_status_t status, uint64_t completed_us);
+    void accept_tx_buffer(esp_now_buffer_t *buffer, esp_now_tx_class_t tx_class);
+    void queue_tx_buffer(esp_now_buffer_t *buffer, esp_now_tx_class_t tx_class);
+    void release_tx_buffer(esp_now_buffer_t *buffer);
+    bool has_tx_credit(esp_now_tx_class_t tx_class, size_t in_flight, size_t limit) const;
+    bool is_coalescable(const esp_now_buffer_t *buffer) const;
+    void coalesce_tx_buffer(esp_now_buffer_t *buffer);
+    void flush_batch(coalesce_batch_t *batch);
+    void flush_expired_batches();
+    void dispatch_message(esp_now_buffer_t *buffer);
+    void unpack_batch(const esp_now_buffer_t *buffer);
+    void pump_tx_slots();
+    void finish_tx_slot(tx_slot_t *slot, esp_now_send_status_t status);
+    void note_tx_timeout(const uint8_t *mac_addr, uint64_t now_us);
+    bool take_late_completion(const uint8_t *mac_addr, uint64_t now_us);
+    void record_send_outcome(const uint8_t *mac_addr, esp_now_send_status_t status);
+    TickType_t next_tx_wait_ticks();
     void update_peer_stats(const uint8_t *mac_addr, bool is_received, bool is_lost = false);
+    void record_peer_rx(const esp_now_buffer_t *buffer);
 
     // Core networking functions
     void update_peer_rssi(esp_now_peer_info_t* peer, int8_t rssi);
@@ -108,33 +398,183 @@ public:
     esp_err_t initialize(uint8_t channel = ESP_NOW_CHANNEL_5GHZ);
     esp_err_t deinitialize();
 
+    // Returns immediately; duration_ms = 0 runs until stop_discovery(). Starting while a
+    // run is active cancels that run and begins a new one once its task has finished;
+    // ESP_ERR_INVALID_STATE from the completion callback, which runs on that task.
     esp_err_t start_discovery(uint32_t duration_ms = 10000);
     esp_err_t stop_discovery();
+    bool is_discovery_active() const;
+    // Blocks until the current run completes; ESP_ERR_TIMEOUT if it is still running
+    esp_err_t wait_for_discovery(TickType_t timeout_ticks);
     esp_err_t send_discovery_request();
+    void set_discovery_config(const esp_now_discovery_config_t& config);
+    esp_now_discovery_config_t get_discovery_config() const;
+    static esp_now_discovery_config_t default_discovery_config();
 
-    esp_err_t add_peer(const uint8_t *mac_addr);
+    // lmk (ESP_NOW_KEY_LEN bytes) keys the peer; requires security to be enabled
+    esp_err_t add_peer(const uint8_t *mac_addr, const uint8_t *lmk = nullptr);
     esp_err_t remove_peer(const uint8_t *mac_addr);
+    // Expiry timeout of one peer; 0 restores the configured default
+    esp_err_t set_peer_timeout(const uint8_t *mac_addr, uint32_t timeout_ms);
+    void set_peer_expiry_config(const esp_now_peer_expiry_config_t& config);
+    esp_now_peer_expiry_config_t get_peer_expiry_config() const;
+    static esp_now_peer_expiry_config_t default_peer_expiry_config();
     bool is_peer_registered(const uint8_t *mac_addr);
+    esp_err_t get_peer_info(const uint8_t *mac_addr, esp_now_peer_info_t *info);
     std::vector<esp_now_peer_info_t> get_peers();
+
+    // Visits every peer under the peer lock instead of copying the table. fn must not call
+    // back into the manager; collect what it needs and act after the visit.
+    template <typename Fn>
+    esp_err_t for_each_peer(Fn&& fn, TickType_t timeout_ticks = pdMS_TO_TICKS(1000)) {
+        if (!peers_mutex_) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (xSemaphoreTake(peers_mutex_, timeout_ticks) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+        peers_.for_each([&](const esp_now_peer_info_t& peer) { fn(peer); });
+        xSemaphoreGive(peers_mutex_);
+        return ESP_OK;
+    }
     size_t get_peer_count();
 
+    // Large-frame (ESP-NOW v2) mode, negotiated per peer during discovery
+    void set_large_frames_enabled(bool enabled);
+    bool is_large_frames_enabled() const;
+    size_t get_max_payload_len(const uint8_t *mac_addr);
+
+    uint8_t get_channel() const;
+    // Retunes the radio; driver peers that follow the manager's channel move with it
+    esp_err_t set_channel(uint8_t channel);
+    // Pins a peer to a channel (0 = follow). Frames to it are not held for that channel:
+    // one sent while the radio is elsewhere fails in the driver and is dropped
+    esp_err_t set_peer_channel(const uint8_t *mac_addr, uint8_t channel);
+
+    // Must be called before initialize(); see esp_now_security_config_t
+    esp_err_t set_security_config(const esp_now_security_config_t& config);
+    esp_now_security_config_t get_security_config() const;
+    static esp_now_security_config_t default_security_config();
+    // nullptr derives the key from the PMK, or removes it when derive_peer_keys is off
+    esp_err_t set_peer_key(const uint8_t *mac_addr, const uint8_t *lmk);
+    // Local half of a mode change; KeyManager::request_link_mode() negotiates both ends
+    esp_err_t set_peer_link_mode(const uint8_t *mac_addr, esp_now_link_mode_t mode);
+    size_t get_encrypted_peer_count();
+
+    // Per-peer PHY rate. AUTO runs link adaptation from RSSI and unicast send outcomes;
+    // FIXED requires config. The default mode only affects peers added afterwards.
+    esp_err_t set_peer_rate(const uint8_t *mac_addr, esp_now_rate_mode_t mode,
+                            const esp_now_rate_config_t *config = nullptr);
+    void set_default_rate_mode(esp_now_rate_mode_t mode);
+    esp_now_rate_mode_t get_default_rate_mode() const;
+
+    // Blocks up to wait_ticks for a free tx buffer; ESP_ERR_TIMEOUT means backpressure
     esp_err_t send_message(const uint8_t *mac_addr, esp_now_msg_type_t msg_type,
-                          const uint8_t *data, size_t len);
+                          const uint8_t *data, size_t len,
+                          TickType_t wait_ticks = pdMS_TO_TICKS(1000));
     esp_err_t send_broadcast(esp_now_msg_type_t msg_type, const uint8_t *data, size_t len);
     esp_err_t send_ping(const uint8_t *mac_addr);
 
+    void set_flow_control_config(const esp_now_flow_control_config_t& config);
+    esp_now_flow_control_config_t get_flow_control_config() const;
+    static esp_now_flow_control_config_t default_flow_control_config();
+    // Read by the send task; apply before traffic starts. Pings and discovery are never coalesced.
+    void set_coalescing_config(const esp_now_coalescing_config_t& config);
+    esp_now_coalescing_config_t get_coalescing_config() const;
+    static esp_now_coalescing_config_t default_coalescing_config();
+    // Frames accepted by send_message that have not completed yet, across both classes
+    size_t get_send_queue_depth() const;
+    bool is_send_backpressured(esp_now_tx_class_t tx_class = ESP_NOW_TX_CLASS_BULK) const;
+
+    // Must be called before initialize()
+    esp_err_t set_tx_queue_config(const esp_now_tx_queue_config_t& config);
+    esp_now_tx_queue_config_t get_tx_queue_config() const;
+    static esp_now_tx_queue_config_t default_tx_queue_config();
+    static esp_now_tx_class_t tx_class_for(esp_now_msg_type_t msg_type);
+    esp_now_tx_class_stats_t get_tx_class_stats(esp_now_tx_class_t tx_class) const;
+
+    // Round-trip measurement: PONGs are matched to PINGs by ping id in the receive task
+    RttEngine& get_rtt_engine();
+
+    // Acknowledged, retransmitting delivery for payloads up to ESP_NOW_RELIABLE_MAX_PAYLOAD_LEN
+    ReliableChannel& get_reliable_channel();
+
+    // Fragmented transfer of up to BULK_MAX_TRANSFER_LEN bytes; blocks until the peer confirms
+    esp_err_t send_bulk(const uint8_t *mac_addr, const uint8_t *data, size_t len,
+                        bulk_progress_callback_t on_progress = nullptr, bulk_progress_t *result = nullptr);
+    BulkTransfer& get_bulk_transfer();
+
+    // Per-peer clock offset and drift, for one-way latency and scheduled starts
+    TimeSync& get_time_sync();
+
+    // Channel survey (busy airtime and probe loss per candidate) and coordinated switching
+    ChannelManager& get_channel_manager();
+
+    // Link mode negotiation and the encrypted slot policy for keyed peers
+    KeyManager& get_key_manager();
+    // Per-type subscriptions to received frames, next to the single receive callback
+    MessageBus& get_message_bus();
+    // Multi-hop delivery over MESH_DATA frames, with routes learned from discovery
+    MeshRouter& get_mesh_router();
+
+    // Multicast groups: one broadcast per frame, dropped in the receive callback by
+    // non-members. Received group frames arrive as their inner type from the sender.
+    esp_err_t join_group(uint16_t group_id);
+    esp_err_t leave_group(uint16_t group_id);
+    esp_err_t send_to_group(uint16_t group_id, esp_now_msg_type_t msg_type, const uint8_t *data, size_t len,
+                            bool reliable = false);
+    GroupManager& get_group_manager();
+
+    // Power profiles: radio always on, or asleep between announced wake windows. Frames
+    // to sleeping peers are held by the send task until their next window.
+    PowerManager& get_power_manager();
+
     // Network testing utilities
     esp_err_t send_test_message(const uint8_t *mac_addr, const uint8_t *data, size_t len);
+    // Peers with measured RSSI at or above min_rssi, strongest first
     std::vector<esp_now_peer_info_t> get_peers_by_rssi(int8_t min_rssi = -80);
     esp_now_peer_info_t* get_strongest_peer();
 
     const uint8_t* get_local_mac();
+    // Consistent per writer context; safe to call from any task
     esp_now_statistics_t get_statistics();
+    // Change since the previous call (or reset); meant for a single periodic scraper
+    esp_now_statistics_t get_statistics_delta();
+    static esp_now_statistics_t statistics_delta(const esp_now_statistics_t& current,
+                                                 const esp_now_statistics_t& previous);
     void reset_statistics();
 
+    // Driver callback cost; the callbacks only timestamp, copy and enqueue
+    esp_now_callback_timing_t get_receive_callback_timing() const;
+    esp_now_callback_timing_t get_send_callback_timing() const;
+    void reset_callback_timing();
+
+    const LatencyHistogram& get_latency_histogram(esp_now_latency_stage_t stage) const;
+    void reset_latency_histograms();
+    void print_latency_histograms() const;
+    static const char* latency_stage_name(esp_now_latency_stage_t stage);
+
+    // The message passed to the receive callback is borrowed from the receive pool and
+    // is only valid until the callback returns, unless retained. Every successful
+    // retain_message() must be paired with release_message().
+    const esp_now_message_t* retain_message(const esp_now_message_t* msg);
+    void release_message(const esp_now_message_t* msg);
+    // Receive task: retain_message() for a buffer being dispatched. Returns the buffer
+    // itself, or a pool copy when it is the batch scratch buffer; nullptr without one.
+    esp_now_buffer_t* retain_buffer(esp_now_buffer_t* buffer);
+    // Receive task: sends a received buffer on to next_hop without copying it.
+    // ESP_ERR_NO_MEM while ESP_NOW_MESH_MAX_FORWARDS buffers are already being forwarded.
+    esp_err_t forward_buffer(esp_now_buffer_t* buffer, const uint8_t* next_hop);
+
     void set_receive_callback(esp_now_receive_callback_t callback);
+    // Invoked from the send task with the final outcome of a frame, after any retries;
+    // once per BATCH frame rather than per coalesced message
     void set_send_callback(esp_now_send_callback_t callback);
     void set_peer_discovered_callback(esp_now_peer_discovered_callback_t callback);
+    // Runs on the expiry task after the peer has been removed
+    void set_peer_lost_callback(esp_now_peer_lost_callback_t callback);
+    // Invoked from the discovery task when a run ends
+    void set_discovery_complete_callback(esp_now_discovery_complete_callback_t callback);
 
     static ESPNowManager& get_instance();
 };
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <esp_now.h>
+#include <esp_crc.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef ESP_NOW_MAX_DATA_LEN_V2
+#define ESP_NOW_MAX_DATA_LEN_V2 1470  // ESP-NOW v2 frame limit (IDF >= 5.4)
+#endif
+
+// On-air frame: header followed by payload_length payload bytes
+#define ESP_NOW_MESSAGE_HEADER_LEN 19
+#define ESP_NOW_MAX_PAYLOAD_LEN (ESP_NOW_MAX_DATA_LEN - ESP_NOW_MESSAGE_HEADER_LEN)        // v1 peers
+#define ESP_NOW_MAX_PAYLOAD_LEN_V2 (ESP_NOW_MAX_DATA_LEN_V2 - ESP_NOW_MESSAGE_HEADER_LEN)  // v2 peers
+#define ESP_NOW_AUTH_TAG_LEN 8  // Truncated HMAC-SHA256 after the frame when security is on
+// Largest payload every v1 peer takes whether or not the frame carries a tag
+#define ESP_NOW_MAX_TAGGED_PAYLOAD_LEN (ESP_NOW_MAX_PAYLOAD_LEN - ESP_NOW_AUTH_TAG_LEN)
+
+typedef enum {
+    ESP_NOW_MSG_TYPE_DISCOVERY_REQUEST = 0x01,
+    ESP_NOW_MSG_TYPE_DISCOVERY_RESPONSE = 0x02,
+    ESP_NOW_MSG_TYPE_PING = 0x10,
+    ESP_NOW_MSG_TYPE_PONG = 0x11,
+    ESP_NOW_MSG_TYPE_TIME_REQUEST = 0x12,
+    ESP_NOW_MSG_TYPE_TIME_RESPONSE = 0x13,
+    ESP_NOW_MSG_TYPE_POWER_WAKE = 0x14,
+    ESP_NOW_MSG_TYPE_DATA = 0x20,
+    ESP_NOW_MSG_TYPE_BATCH = 0x21,
+    ESP_NOW_MSG_TYPE_MESH_DATA = 0x22,
+    ESP_NOW_MSG_TYPE_GROUP_DATA = 0x23,
+    ESP_NOW_MSG_TYPE_GROUP_SYNC = 0x24,
+    ESP_NOW_MSG_TYPE_GROUP_NACK = 0x25,
+    ESP_NOW_MSG_TYPE_TEST_START = 0x30,
+    ESP_NOW_MSG_TYPE_TEST_STOP = 0x31,
+    ESP_NOW_MSG_TYPE_TEST_DATA = 0x32,
+    ESP_NOW_MSG_TYPE_BENCH_ASSIGN = 0x33,
+    ESP_NOW_MSG_TYPE_BENCH_READY = 0x34,
+    ESP_NOW_MSG_TYPE_BENCH_ECHO = 0x35,
+    ESP_NOW_MSG_TYPE_BENCH_COLLECT = 0x36,
+    ESP_NOW_MSG_TYPE_BENCH_REPORT = 0x37,
+    ESP_NOW_MSG_TYPE_TEST_SCHEDULE = 0x38,
+    ESP_NOW_MSG_TYPE_RELIABLE_DATA = 0x40,
+    ESP_NOW_MSG_TYPE_RELIABLE_ACK = 0x41,
+    ESP_NOW_MSG_TYPE_BULK_DATA = 0x50,
+    ESP_NOW_MSG_TYPE_BULK_POLL = 0x51,
+    ESP_NOW_MSG_TYPE_BULK_STATUS = 0x52,
+    ESP_NOW_MSG_TYPE_CHANNEL_SURVEY = 0x60,
+    ESP_NOW_MSG_TYPE_CHANNEL_SWITCH = 0x61,
+    ESP_NOW_MSG_TYPE_CHANNEL_SWITCH_ACK = 0x62,
+    ESP_NOW_MSG_TYPE_CHANNEL_PROBE = 0x63,
+    ESP_NOW_MSG_TYPE_KEY_SLOT_REQUEST = 0x70,
+    ESP_NOW_MSG_TYPE_KEY_SLOT_RESPONSE = 0x71,
+    ESP_NOW_MSG_TYPE_USER_FIRST = 0x80,   // Application-defined types, never used internally
+    ESP_NOW_MSG_TYPE_USER_LAST = 0xFF,
+} esp_now_msg_type_t;
+
+typedef struct {
+    uint8_t msg_type;
+    uint32_t sequence_number;
+    uint64_t timestamp_us;
+    uint16_t payload_length;
+    uint32_t crc32;
+    uint8_t payload[ESP_NOW_MAX_PAYLOAD_LEN_V2];
+} __attribute__((packed)) esp_now_message_t;
+
+static_assert(offsetof(esp_now_message_t, payload) == ESP_NOW_MESSAGE_HEADER_LEN,
+              "ESP_NOW_MESSAGE_HEADER_LEN must match esp_now_message_t layout");
+
+// Number of bytes actually sent over the air for a message
+static inline size_t esp_now_message_wire_len(const esp_now_message_t* msg) {
+    return ESP_NOW_MESSAGE_HEADER_LEN + msg->payload_length;
+}
+
+// CRC over the header fields preceding crc32 plus the used payload bytes only
+static inline uint32_t esp_now_message_crc(const esp_now_message_t* msg) {
+    uint32_t crc = esp_crc32_le(0, (const uint8_t*)msg, offsetof(esp_now_message_t, crc32));
+    return esp_crc32_le(crc, msg->payload, msg->payload_length);
+}
+
+// Discovery request/response payload. Legacy nodes send only the 6-byte MAC,
+// which is treated as protocol version 1 with v1 frame limits.
+typedef struct {
+    uint8_t mac_addr[6];
+    uint8_t espnow_version;
+    uint16_t max_frame_len;
+} __attribute__((packed)) esp_now_discovery_payload_t;
+
+// Optional extension after esp_now_discovery_payload_t from nodes that forward: the
+// sender's route table as a distance vector. via is the sender's next hop, so a receiver
+// skips the routes that run through itself.
+#define ESP_NOW_DISCOVERY_EXT_MESH_ROUTES 0x01
+
+typedef struct {
+    uint8_t ext_type;
+    uint8_t count;               // esp_now_mesh_route_entry_t that follow
+} __attribute__((packed)) esp_now_mesh_advert_t;
+
+typedef struct {
+    uint8_t destination[6];
+    uint8_t via[6];
+    uint8_t hops;
+    uint8_t cost;                // Sum of link costs along the route
+} __attribute__((packed)) esp_now_mesh_route_entry_t;
+
+#define ESP_NOW_MESH_MAX_ADVERT_ENTRIES ((ESP_NOW_MAX_PAYLOAD_LEN - sizeof(esp_now_discovery_payload_t) - \
+                                         sizeof(esp_now_mesh_advert_t)) / sizeof(esp_now_mesh_route_entry_t))
+
+// Prefix of every MESH_DATA payload; the rest is delivered at the destination as a
+// message of inner_type from origin
+typedef struct {
+    uint8_t origin[6];
+    uint8_t destination[6];
+    uint16_t origin_seq;
+    uint8_t ttl;                 // Links left; a frame that arrives with 1 is not forwarded again
+    uint8_t hops;                // Links travelled before the current one
+    uint8_t inner_type;          // ESP_NOW_MSG_TYPE_DATA or an application type
+} __attribute__((packed)) esp_now_mesh_header_t;
+
+// Every link of a route must carry the frame, so mesh payloads keep to v1 frames
+#define ESP_NOW_MESH_MAX_PAYLOAD_LEN (ESP_NOW_MAX_TAGGED_PAYLOAD_LEN - sizeof(esp_now_mesh_header_t))
+
+// Prefix of every GROUP_DATA payload, a broadcast for the members of group_id. The
+// group ID sits at the start of the payload so non-members drop the frame in the
+// driver callback. Only reliable frames are numbered; seq is 0 otherwise.
+#define ESP_NOW_GROUP_FLAG_RELIABLE 0x01
+#define ESP_NOW_GROUP_FLAG_REPAIR 0x02   // Retransmission answering a NACK
+
+typedef struct {
+    uint16_t group_id;
+    uint16_t seq;
+    uint8_t flags;
+    uint8_t inner_type;          // ESP_NOW_MSG_TYPE_DATA or an application type
+} __attribute__((packed)) esp_now_group_header_t;
+
+#define ESP_NOW_GROUP_MAX_PAYLOAD_LEN (ESP_NOW_MAX_TAGGED_PAYLOAD_LEN - sizeof(esp_now_group_header_t))
+
+// Broadcast by the sender after its last reliable frame, so members notice a lost tail
+typedef struct {
+    uint16_t group_id;
+    uint16_t last_seq;
+} __attribute__((packed)) esp_now_group_sync_t;
+
+// Unicast from a member to the sender: bit i of missing_mask is seq highest_seq - i
+typedef struct {
+    uint16_t group_id;
+    uint16_t highest_seq;
+    uint32_t missing_mask;
+} __attribute__((packed)) esp_now_group_nack_t;
+
+// PING payload; the responder echoes the complete PING payload back in the PONG
+typedef struct {
+    uint32_t ping_id;
+    uint64_t tx_timestamp_us;
+} __attribute__((packed)) esp_now_ping_payload_t;
+
+// Four-timestamp clock exchange: t1 requester send, t2 responder receive,
+// t3 responder send, t4 requester receive (t4 is not carried on air)
+typedef struct {
+    uint32_t seq;
+    uint64_t t1_us;
+} __attribute__((packed)) esp_now_time_request_t;
+
+typedef struct {
+    uint32_t seq;
+    uint64_t t1_us;
+    uint64_t t2_us;
+    uint64_t t3_us;
+} __attribute__((packed)) esp_now_time_response_t;
+
+// Broadcast at the start of each listening window of a sleeping node; interval_ms = 0
+// announces that the radio stays on from now on
+typedef struct {
+    uint16_t interval_ms;
+    uint16_t window_ms;
+} __attribute__((packed)) esp_now_power_wake_t;
+
+// A BATCH payload is a sequence of records, each this header followed by
+// length bytes of the coalesced message's payload.
+typedef struct {
+    uint8_t msg_type;
+    uint16_t length;
+} __attribute__((packed)) esp_now_batch_record_t;
+
+// Prefix of every RELIABLE_DATA payload. window_base is the oldest sequence the
+// sender still retransmits; the receiver treats anything below it as settled.
+typedef struct {
+    uint16_t session;        // Changes when the sender restarts
+    uint32_t seq;
+    uint32_t window_base;
+} __attribute__((packed)) esp_now_reliable_header_t;
+
+// Selective ACK: every seq below cumulative_ack was received, and bit i of
+// sack_bitmap marks cumulative_ack + 1 + i as received.
+typedef struct {
+    uint16_t session;        // Echo of the data sender's session
+    uint32_t cumulative_ack;
+    uint32_t sack_bitmap;
+} __attribute__((packed)) esp_now_reliable_ack_t;
+
+#define ESP_NOW_RELIABLE_MAX_PAYLOAD_LEN (ESP_NOW_MAX_TAGGED_PAYLOAD_LEN - sizeof(esp_now_reliable_header_t))
+
+// Prefix of every BULK_DATA fragment. Every fragment but the last carries
+// fragment_size bytes, so a fragment lands at fragment_index * fragment_size.
+typedef struct {
+    uint16_t transfer_id;
+    uint16_t fragment_index;
+    uint16_t fragment_count;
+    uint16_t fragment_size;
+    uint32_t total_len;
+} __attribute__((packed)) esp_now_bulk_header_t;
+
+typedef struct {
+    uint16_t transfer_id;
+} __attribute__((packed)) esp_now_bulk_poll_t;
+
+typedef enum {
+    ESP_NOW_BULK_STATE_UNKNOWN = 0,     // Receiver has no record of the transfer
+    ESP_NOW_BULK_STATE_IN_PROGRESS = 1, // bitmap lists the fragments received so far
+    ESP_NOW_BULK_STATE_COMPLETE = 2,
+    ESP_NOW_BULK_STATE_REJECTED = 3,    // Too large or no free reassembly buffer
+} esp_now_bulk_state_t;
+
+// Receiver's answer to a POLL or to the final fragment; followed by bitmap_len bytes
+typedef struct {
+    uint16_t transfer_id;
+    uint8_t state;
+    uint16_t received_fragments;
+    uint16_t bitmap_len;
+} __attribute__((packed)) esp_now_bulk_status_t;
+
+// Mesh benchmark. The coordinator sends each node a BENCH_ASSIGN (answered with
+// BENCH_READY), broadcasts TEST_START with an esp_now_bench_start_t, and after the run
+// pulls a BENCH_REPORT from every node with BENCH_COLLECT.
+#define ESP_NOW_BENCH_ROLE_SEND 0x01
+#define ESP_NOW_BENCH_ROLE_RECEIVE 0x02
+#define ESP_NOW_BENCH_FLAG_ECHO 0x0001   // Receiver answers this TEST_DATA with a BENCH_ECHO
+
+typedef struct {
+    uint16_t run_id;
+    uint8_t roles;
+    uint8_t dst_mac[6];      // Sender only
+    uint16_t payload_len;    // TEST_DATA payload, including esp_now_bench_data_t
+    uint32_t duration_ms;
+    uint16_t echo_interval_ms;
+} __attribute__((packed)) esp_now_bench_assign_t;
+
+// Payload of BENCH_READY, BENCH_COLLECT and TEST_STOP
+typedef struct {
+    uint16_t run_id;
+} __attribute__((packed)) esp_now_bench_ref_t;
+
+// Nodes start start_delay_us after they receive the broadcast, so a single frame
+// gives every node the same reference instant
+typedef struct {
+    uint16_t run_id;
+    uint32_t start_delay_us;
+    uint32_t duration_ms;
+} __attribute__((packed)) esp_now_bench_start_t;
+
+// Prefix of every benchmark TEST_DATA payload; BENCH_ECHO returns it unchanged
+typedef struct {
+    uint16_t run_id;
+    uint16_t flags;
+    uint32_t seq;
+    uint64_t tx_timestamp_us;
+} __attribute__((packed)) esp_now_bench_data_t;
+
+typedef struct {
+    uint8_t src_mac[6];
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t max_seq;
+    uint32_t active_us;      // First to last frame of the flow
+} __attribute__((packed)) esp_now_bench_flow_report_t;
+
+// Followed by flow_count esp_now_bench_flow_report_t, one per sender heard
+typedef struct {
+    uint16_t run_id;
+    uint8_t roles;
+    uint8_t flow_count;
+    uint32_t frames_sent;
+    uint32_t send_failures;
+    uint32_t rtt_samples;
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+    uint32_t rtt_max_us;
+} __attribute__((packed)) esp_now_bench_report_t;
+
+// TEST_SCHEDULE: start instant already converted to the receiver's own clock
+typedef struct {
+    uint64_t start_at_us;
+} __attribute__((packed)) esp_now_test_schedule_t;
+
+// Channel survey and coordinated switch. Times are already in the receiver's clock.
+#define ESP_NOW_CHANNEL_SURVEY_MAX 16
+
+typedef struct {
+    uint16_t survey_id;
+    uint16_t dwell_ms;           // Per channel; the receiver returns home after the last one
+    uint64_t start_at_us;
+    uint8_t channel_count;
+    uint8_t channels[ESP_NOW_CHANNEL_SURVEY_MAX];
+} __attribute__((packed)) esp_now_channel_survey_t;
+
+typedef struct {
+    uint16_t switch_id;
+    uint8_t channel;
+    uint8_t reserved;
+    uint64_t switch_at_us;
+} __attribute__((packed)) esp_now_channel_switch_t;
+
+// Sent on the new channel once the switch is done
+typedef struct {
+    uint16_t switch_id;
+    uint8_t channel;
+} __attribute__((packed)) esp_now_channel_switch_ack_t;
+
+// Link mode negotiation between keyed peers. mode is an esp_now_link_mode_t; a request
+// for the mode already in force only confirms that the link still works.
+typedef struct {
+    uint16_t request_id;
+    uint8_t mode;
+} __attribute__((packed)) esp_now_key_slot_request_t;
+
+// mode is the responder's mode after the exchange (the requested one when accepted)
+typedef struct {
+    uint16_t request_id;
+    uint8_t mode;
+    uint8_t accepted;
+} __attribute__((packed)) esp_now_key_slot_response_t;
@@ -0,0 +1,350 @@
+#include "flash_log.hpp"
+#include <esp_crc.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+static_assert(sizeof(flash_log_sector_header_t) == 20, "sector header layout is part of the format");
+static_assert(sizeof(flash_log_record_header_t) == 12, "record header layout is part of the format");
+
+FlashLog::FlashLog()
+    : partition_(nullptr), staging_(nullptr), writer_task_handle_(nullptr), flush_done_(nullptr),
+      sector_buffer_(nullptr), sector_count_(0), boot_count_(0), current_sector_(0),
+      next_sequence_(0), fill_(0), programmed_(0), sector_open_(false), last_program_us_(0),
+      records_written_(0), records_dropped_(0), sectors_erased_(0), flash_errors_(0) {
+}
+
+FlashLog::~FlashLog() {
+    deinitialize();
+}
+
+esp_err_t FlashLog::initialize(const char* label) {
+    if (partition_) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t* partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)FLASH_LOG_PARTITION_SUBTYPE, label);
+    if (!partition) {
+        ESP_LOGW(FLASH_LOG_TAG, "No '%s' data partition; flash logging disabled", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (partition->size / FLASH_LOG_SECTOR_SIZE < 2) {
+        ESP_LOGE(FLASH_LOG_TAG, "Partition '%s' too small for a ring log", label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    partition_ = partition;
+    sector_count_ = partition->size / FLASH_LOG_SECTOR_SIZE;
+
+    uint32_t newest_sector = 0, newest_sequence = 0, newest_boot = 0;
+    bool found = scan(&newest_sector, &newest_sequence, &newest_boot) == ESP_OK;
+    boot_count_ = found ? newest_boot + 1 : 1;
+    next_sequence_ = found ? newest_sequence + 1 : 1;
+    // open_next_sector() advances first, so the new boot starts after the newest sector
+    current_sector_ = found ? newest_sector : sector_count_ - 1;
+    sector_open_ = false;
+    fill_ = 0;
+    programmed_ = 0;
+    last_program_us_ = esp_timer_get_time();
+
+    sector_buffer_ = new (std::nothrow) uint8_t[FLASH_LOG_SECTOR_SIZE];
+    staging_ = xRingbufferCreate(FLASH_LOG_STAGING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    flush_done_ = xSemaphoreCreateBinary();
+    if (!sector_buffer_ || !staging_ || !flush_done_) {
+        ESP_LOGE(FLASH_LOG_TAG, "Failed to allocate flash log buffers");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(writer_task, "flash_log", FLASH_LOG_TASK_STACK_SIZE, this,
+                    FLASH_LOG_TASK_PRIORITY, &writer_task_handle_) != pdPASS) {
+        ESP_LOGE(FLASH_LOG_TAG, "Failed to create flash log writer task");
+        writer_task_handle_ = nullptr;
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(FLASH_LOG_TAG, "Flash log on '%s': %lu sectors at 0x%lx, boot %lu%s",
+             label, sector_count_, partition->address, boot_count_, found ? "" : " (empty)");
+
+    flash_log_boot_record_t boot = {boot_count_, (uint32_t)esp_reset_reason()};
+    append(FLASH_LOG_RECORD_BOOT, &boot, sizeof(boot));
+    return ESP_OK;
+}
+
+esp_err_t FlashLog::deinitialize() {
+    if (!partition_) {
+        return ESP_OK;
+    }
+
+    if (writer_task_handle_) {
+        flush();
+        vTaskDelete(writer_task_handle_);
+        writer_task_handle_ = nullptr;
+    }
+
+    if (staging_) {
+        vRingbufferDelete(staging_);
+        staging_ = nullptr;
+    }
+
+    if (flush_done_) {
+        vSemaphoreDelete(flush_done_);
+        flush_done_ = nullptr;
+    }
+
+    delete[] sector_buffer_;
+    sector_buffer_ = nullptr;
+    partition_ = nullptr;
+    return ESP_OK;
+}
+
+bool FlashLog::is_initialized() const {
+    return writer_task_handle_ != nullptr;
+}
+
+size_t FlashLog::record_footprint(size_t payload_len) {
+    return (sizeof(flash_log_record_header_t) + payload_len + 3) & ~(size_t)3;
+}
+
+esp_err_t FlashLog::append(uint8_t type, const void* payload, size_t len) {
+    if (len > FLASH_LOG_MAX_PAYLOAD_LEN || (len > 0 && !payload)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!staging_ || !writer_task_handle_) {
+        records_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    void* slot = nullptr;
+    if (xRingbufferSendAcquire(staging_, &slot, sizeof(flash_log_record_header_t) + len, 0) != pdTRUE) {
+        records_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The CRC is left to the writer task
+    flash_log_record_header_t header = {};
+    header.length = len;
+    header.type = type;
+    header.timestamp_ms = esp_timer_get_time() / 1000;
+    memcpy(slot, &header, sizeof(header));
+    if (len > 0) {
+        memcpy((uint8_t*)slot + sizeof(header), payload, len);
+    }
+    xRingbufferSendComplete(staging_, slot);
+    return ESP_OK;
+}
+
+esp_err_t FlashLog::flush(TickType_t timeout) {
+    if (!writer_task_handle_ || !flush_done_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(flush_done_, 0);  // Drop a completion left over from a timed-out flush
+    xTaskNotifyGive(writer_task_handle_);
+    return xSemaphoreTake(flush_done_, timeout) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void FlashLog::writer_task(void* parameter) {
+    FlashLog* log = (FlashLog*)parameter;
+    const uint64_t flush_interval_us = (uint64_t)FLASH_LOG_FLUSH_INTERVAL_MS * 1000;
+
+    while (true) {
+        size_t size = 0;
+        uint8_t* item = (uint8_t*)xRingbufferReceive(log->staging_, &size, pdMS_TO_TICKS(100));
+        if (item) {
+            log->stage_record(item, size);
+            vRingbufferReturnItem(log->staging_, item);
+        }
+
+        bool flush_requested = ulTaskNotifyTake(pdTRUE, 0) > 0;
+        if (flush_requested) {
+            while ((item = (uint8_t*)xRingbufferReceive(log->staging_, &size, 0)) != nullptr) {
+                log->stage_record(item, size);
+                vRingbufferReturnItem(log->staging_, item);
+            }
+        }
+
+        if (flush_requested ||
+            (log->fill_ > log->programmed_ && esp_timer_get_time() - log->last_program_us_ >= flush_interval_us)) {
+            log->program_pending();
+        }
+
+        if (flush_requested) {
+            xSemaphoreGive(log->flush_done_);
+        }
+    }
+}
+
+void FlashLog::stage_record(uint8_t* item, size_t len) {
+    if (len < sizeof(flash_log_record_header_t)) {
+        return;
+    }
+
+    flash_log_record_header_t header;
+    memcpy(&header, item, sizeof(header));
+    size_t footprint = record_footprint(header.length);
+
+    // A sector is programmed in one pass once the next record no longer fits
+    if (!sector_open_ || fill_ + footprint > FLASH_LOG_SECTOR_SIZE) {
+        program_pending();
+        if (open_next_sector() != ESP_OK) {
+            records_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    header.crc32 = esp_crc32_le(0, (const uint8_t*)&header, offsetof(flash_log_record_header_t, crc32));
+    header.crc32 = esp_crc32_le(header.crc32, item + sizeof(header), header.length);
+    memcpy(sector_buffer_ + fill_, &header, sizeof(header));
+    memcpy(sector_buffer_ + fill_ + sizeof(header), item + sizeof(header), header.length);
+    fill_ += footprint;
+    records_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+esp_err_t FlashLog::open_next_sector() {
+    sector_open_ = false;
+    current_sector_ = (current_sector_ + 1) % sector_count_;
+
+    esp_err_t ret = esp_partition_erase_range(partition_, current_sector_ * FLASH_LOG_SECTOR_SIZE,
+                                              FLASH_LOG_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        flash_errors_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGE(FLASH_LOG_TAG, "Failed to erase sector %lu: %s", current_sector_, esp_err_to_name(ret));
+        return ret;
+    }
+    sectors_erased_.fetch_add(1, std::memory_order_relaxed);
+
+    flash_log_sector_header_t header = {};
+    header.magic = FLASH_LOG_SECTOR_MAGIC;
+    header.format_version = FLASH_LOG_FORMAT_VERSION;
+    header.sequence = next_sequence_++;
+    header.boot_count = boot_count_;
+    header.crc32 = esp_crc32_le(0, (const uint8_t*)&header, offsetof(flash_log_sector_header_t, crc32));
+
+    memset(sector_buffer_, 0xFF, FLASH_LOG_SECTOR_SIZE);
+    memcpy(sector_buffer_, &header, sizeof(header));
+    fill_ = sizeof(header);
+    programmed_ = 0;
+    sector_open_ = true;
+    return ESP_OK;
+}
+
+esp_err_t FlashLog::program_pending() {
+    last_program_us_ = esp_timer_get_time();
+    if (!sector_open_ || fill_ <= programmed_) {
+        return ESP_OK;
+    }
+
+    // Only ever programs erased bytes, so a partial sector can be topped up later
+    esp_err_t ret = esp_partition_write(partition_, current_sector_ * FLASH_LOG_SECTOR_SIZE + programmed_,
+                                        sector_buffer_ + programmed_, fill_ - programmed_);
+    if (ret != ESP_OK) {
+        flash_errors_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGE(FLASH_LOG_TAG, "Failed to write sector %lu: %s", current_sector_, esp_err_to_name(ret));
+        return ret;
+    }
+    programmed_ = fill_;
+    return ESP_OK;
+}
+
+bool FlashLog::read_sector_header(uint32_t sector, flash_log_sector_header_t* header) const {
+    if (esp_partition_read(partition_, sector * FLASH_LOG_SECTOR_SIZE, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == FLASH_LOG_SECTOR_MAGIC &&
+           header->format_version == FLASH_LOG_FORMAT_VERSION &&
+           header->crc32 == esp_crc32_le(0, (const uint8_t*)header, offsetof(flash_log_sector_header_t, crc32));
+}
+
+esp_err_t FlashLog::scan(uint32_t* newest_sector, uint32_t* newest_sequence, uint32_t* newest_boot) const {
+    bool found = false;
+    for (uint32_t sector = 0; sector < sector_count_; sector++) {
+        flash_log_sector_header_t header;
+        if (!read_sector_header(sector, &header)) {
+            continue;
+        }
+        if (!found || header.sequence > *newest_sequence) {
+            *newest_sector = sector;
+            *newest_sequence = header.sequence;
+            *newest_boot = header.boot_count;
+            found = true;
+        }
+    }
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t FlashLog::replay(const flash_log_replay_callback_t& callback) const {
+    if (!partition_ || !callback) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    struct sector_ref_t {
+        uint32_t sequence;
+        uint32_t sector;
+        uint32_t boot_count;
+    };
+    std::vector<sector_ref_t> sectors;
+    for (uint32_t sector = 0; sector < sector_count_; sector++) {
+        flash_log_sector_header_t header;
+        if (read_sector_header(sector, &header)) {
+            sectors.push_back({header.sequence, sector, header.boot_count});
+        }
+    }
+    std::sort(sectors.begin(), sectors.end(),
+              [](const sector_ref_t& a, const sector_ref_t& b) { return a.sequence < b.sequence; });
+
+    uint8_t* buffer = new (std::nothrow) uint8_t[FLASH_LOG_SECTOR_SIZE];
+    if (!buffer) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (const auto& ref : sectors) {
+        if (esp_partition_read(partition_, ref.sector * FLASH_LOG_SECTOR_SIZE, buffer,
+                               FLASH_LOG_SECTOR_SIZE) != ESP_OK) {
+            continue;
+        }
+
+        size_t offset = sizeof(flash_log_sector_header_t);
+        while (offset + sizeof(flash_log_record_header_t) <= FLASH_LOG_SECTOR_SIZE) {
+            flash_log_record_header_t header;
+            memcpy(&header, buffer + offset, sizeof(header));
+            if (header.length == 0xFFFF ||
+                offset + record_footprint(header.length) > FLASH_LOG_SECTOR_SIZE) {
+                break;
+            }
+
+            const uint8_t* payload = buffer + offset + sizeof(header);
+            uint32_t crc = esp_crc32_le(0, (const uint8_t*)&header, offsetof(flash_log_record_header_t, crc32));
+            crc = esp_crc32_le(crc, payload, header.length);
+            if (crc != header.crc32) {
+                break;  // Torn write at power loss; the rest of the sector is unusable
+            }
+
+            callback(ref.boot_count, header, payload);
+            offset += record_footprint(header.length);
+        }
+    }
+
+    delete[] buffer;
+    return ESP_OK;
+}
+
+uint32_t FlashLog::get_boot_count() const {
+    return boot_count_;
+}
+
+flash_log_stats_t FlashLog::get_stats() const {
+    flash_log_stats_t stats = {};
+    stats.records_written = records_written_.load(std::memory_order_relaxed);
+    stats.records_dropped = records_dropped_.load(std::memory_order_relaxed);
+    stats.sectors_erased = sectors_erased_.load(std::memory_order_relaxed);
+    stats.flash_errors = flash_errors_.load(std::memory_order_relaxed);
+    stats.sector_count = sector_count_;
+    stats.boot_count = boot_count_;
+    return stats;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/ringbuf.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+
+#define FLASH_LOG_TAG "FLASH_LOG"
+
+// Matches the soaklog entry in partitions.csv
+#define FLASH_LOG_PARTITION_LABEL "soaklog"
+#define FLASH_LOG_PARTITION_SUBTYPE 0x40
+
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_SECTOR_MAGIC 0x474C4E45      // "ENLG"
+#define FLASH_LOG_FORMAT_VERSION 1
+#define FLASH_LOG_MAX_PAYLOAD_LEN 256
+#define FLASH_LOG_STAGING_SIZE 4096             // RAM between append() and the writer task
+#define FLASH_LOG_FLUSH_INTERVAL_MS 60000       // Partial sectors are programmed at most this late
+#define FLASH_LOG_TASK_STACK_SIZE 3072
+#define FLASH_LOG_TASK_PRIORITY 1
+
+typedef enum {
+    FLASH_LOG_RECORD_BOOT = 0x01,
+    FLASH_LOG_RECORD_STABILITY_START = 0x10,
+    FLASH_LOG_RECORD_STABILITY_INTERVAL = 0x11,
+    FLASH_LOG_RECORD_LINK_EVENT = 0x12,
+    FLASH_LOG_RECORD_STABILITY_SUMMARY = 0x13,
+    FLASH_LOG_RECORD_STATISTICS = 0x20,         // result_statistics_record_t (result_export.hpp)
+} flash_log_record_type_t;
+
+// Each sector starts with this header; the sector with the highest sequence is the newest
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t format_version;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t boot_count;
+    uint32_t crc32;        // Over the preceding fields
+} flash_log_sector_header_t;
+
+// Records are packed back to back after the sector header, each padded to 4 bytes.
+// An erased length (0xFFFF) marks the end of the written part of a sector.
+typedef struct __attribute__((packed)) {
+    uint16_t length;       // Payload bytes
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t timestamp_ms; // Since boot
+    uint32_t crc32;        // Over the preceding fields and the payload
+} flash_log_record_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t boot_count;
+    uint32_t reset_reason; // esp_reset_reason_t
+} flash_log_boot_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t duration_hours;
+    uint8_t target_mac[6];
+    uint16_t reserved;
+} flash_log_stability_start_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t first_window;
+    uint16_t windows;
+    uint16_t windows_up;
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    float rtt_mean_ms;
+    float rtt_max_ms;
+    uint32_t connection_drops;  // Running total
+} flash_log_stability_interval_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t window;
+    uint8_t link_up;
+    uint8_t reserved[3];
+    float outage_ms;            // Set when the link comes back
+} flash_log_link_event_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t windows;
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t connection_drops;
+    uint32_t reconnection_attempts;
+    uint32_t successful_reconnections;
+    float uptime_percent;
+    float avg_packet_loss_percent;
+    float rtt_p50_ms;
+    float rtt_p99_ms;
+    float rtt_max_ms;
+    float reconnection_mean_ms;
+} flash_log_stability_summary_t;
+
+typedef struct {
+    uint32_t records_written;
+    uint32_t records_dropped;   // Staging buffer full or writer not running
+    uint32_t sectors_erased;
+    uint32_t flash_errors;
+    uint32_t sector_count;
+    uint32_t boot_count;
+} flash_log_stats_t;
+
+// Arguments: boot count of the writing run, record header, payload
+typedef std::function<void(uint32_t, const flash_log_record_header_t&, const uint8_t*)> flash_log_replay_callback_t;
+
+// Append-only ring log in a dedicated data partition. append() only copies the record into
+// a RAM ring buffer; a low-priority task assembles records into a sector image and programs
+// it when the sector fills (or after FLASH_LOG_FLUSH_INTERVAL_MS). Sectors are reused strictly
+// round-robin, so every sector sees the same number of erase cycles. Each boot continues in
+// the sector after the newest one found, so earlier runs stay readable until overwritten.
+class FlashLog {
+private:
+    const esp_partition_t* partition_;
+    RingbufHandle_t staging_;
+    TaskHandle_t writer_task_handle_;
+    SemaphoreHandle_t flush_done_;
+    uint8_t* sector_buffer_;
+
+    uint32_t sector_count_;
+    uint32_t boot_count_;
+
+    // Writer task state
+    uint32_t current_sector_;
+    uint32_t next_sequence_;
+    size_t fill_;               // Bytes assembled in sector_buffer_
+    size_t programmed_;         // Bytes of sector_buffer_ already in flash
+    bool sector_open_;
+    uint64_t last_program_us_;
+
+    std::atomic<uint32_t> records_written_;
+    std::atomic<uint32_t> records_dropped_;
+    std::atomic<uint32_t> sectors_erased_;
+    std::atomic<uint32_t> flash_errors_;
+
+    static void writer_task(void* parameter);
+    void stage_record(uint8_t* item, size_t len);
+    esp_err_t open_next_sector();
+    esp_err_t program_pending();
+    esp_err_t scan(uint32_t* newest_sector, uint32_t* newest_sequence, uint32_t* newest_boot) const;
+    bool read_sector_header(uint32_t sector, flash_log_sector_header_t* header) const;
+
+public:
+    FlashLog();
+    ~FlashLog();
+
+    esp_err_t initialize(const char* label = FLASH_LOG_PARTITION_LABEL);
+    esp_err_t deinitialize();
+    bool is_initialized() const;
+
+    // Any task; never blocks. ESP_ERR_NO_MEM when the staging buffer is full.
+    esp_err_t append(uint8_t type, const void* payload, size_t len);
+
+    // Programs everything appended so far
+    esp_err_t flush(TickType_t timeout = pdMS_TO_TICKS(2000));
+
+    // Walks every intact record, oldest first, including those of earlier boots
+    esp_err_t replay(const flash_log_replay_callback_t& callback) const;
+
+    uint32_t get_boot_count() const;
+    flash_log_stats_t get_stats() const;
+
+    static size_t record_footprint(size_t payload_len);
+};
@@ -0,0 +1,539 @@
+#include "group_manager.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_crc.h>
+#include <string.h>
+#include <algorithm>
+
+static_assert(ESP_NOW_GROUP_WINDOW <= 32, "received_mask holds the window");
+
+GroupManager::GroupManager(ESPNowManager& manager)
+    : manager_(manager), mutex_(nullptr), send_mutex_(nullptr), task_handle_(nullptr), history_next_(0),
+      sent_(0), received_(0), filtered_(0), duplicates_(0), nacks_sent_(0), nacks_received_(0),
+      repairs_sent_(0), repairs_unavailable_(0), lost_(0) {
+    for (auto& member : members_) {
+        member.store(0);
+    }
+    memset(streams_, 0, sizeof(streams_));
+    memset(sending_, 0, sizeof(sending_));
+    memset(history_, 0, sizeof(history_));
+}
+
+GroupManager::~GroupManager() {
+    deinitialize();
+}
+
+esp_err_t GroupManager::initialize() {
+    if (mutex_) {
+        return ESP_OK;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    send_mutex_ = xSemaphoreCreateMutex();
+    if (!mutex_ || !send_mutex_) {
+        ESP_LOGE(GROUP_MANAGER_TAG, "Failed to create group mutex");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(streams_, 0, sizeof(streams_));
+    memset(sending_, 0, sizeof(sending_));
+    memset(history_, 0, sizeof(history_));
+    history_next_ = 0;
+
+    if (xTaskCreate(group_task, "esp_now_group", GROUP_TASK_STACK_SIZE, this,
+                    GROUP_TASK_PRIORITY, &task_handle_) != pdPASS) {
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void GroupManager::deinitialize() {
+    if (task_handle_) {
+        vTaskDelete(task_handle_);
+        task_handle_ = nullptr;
+    }
+
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+    if (send_mutex_) {
+        vSemaphoreDelete(send_mutex_);
+        send_mutex_ = nullptr;
+    }
+}
+
+// Names map onto the 16-bit ID space; two names may collide, so pick them per deployment
+uint16_t GroupManager::group_id_for_name(const char* name) {
+    uint32_t crc = esp_crc32_le(0, (const uint8_t*)name, strlen(name));
+    uint16_t group_id = (uint16_t)(crc ^ (crc >> 16));
+    return group_id ? group_id : 1;
+}
+
+esp_err_t GroupManager::join(uint16_t group_id) {
+    if (group_id == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (is_member(group_id)) {
+        return ESP_OK;
+    }
+
+    for (auto& member : members_) {
+        uint16_t expected = 0;
+        if (member.compare_exchange_strong(expected, group_id)) {
+            ESP_LOGI(GROUP_MANAGER_TAG, "Joined group 0x%04x", group_id);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t GroupManager::leave(uint16_t group_id) {
+    if (group_id == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool found = false;
+    for (auto& member : members_) {
+        uint16_t expected = group_id;
+        found |= member.compare_exchange_strong(expected, 0);
+    }
+    if (!found) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (mutex_) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        for (auto& stream : streams_) {
+            if (stream.used && stream.group_id == group_id) {
+                stream.used = false;
+            }
+        }
+        xSemaphoreGive(mutex_);
+    }
+    ESP_LOGI(GROUP_MANAGER_TAG, "Left group 0x%04x", group_id);
+    return ESP_OK;
+}
+
+bool GroupManager::is_member(uint16_t group_id) const {
+    for (const auto& member : members_) {
+        if (member.load(std::memory_order_relaxed) == group_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Caller holds mutex_
+GroupManager::sending_t* GroupManager::find_sending(uint16_t group_id, bool create) {
+    sending_t* free_entry = nullptr;
+    for (auto& entry : sending_) {
+        if (entry.group_id == group_id) {
+            return &entry;
+        }
+        if (!free_entry && entry.group_id == 0) {
+            free_entry = &entry;
+        }
+    }
+
+    if (!create || !free_entry) {
+        return nullptr;
+    }
+    free_entry->group_id = group_id;
+    free_entry->next_seq = (uint16_t)esp_random();
+    free_entry->syncs_left = 0;
+    return free_entry;
+}
+
+esp_err_t GroupManager::send(uint16_t group_id, uint8_t inner_type, const uint8_t* data, size_t len,
+                             bool reliable, TickType_t wait_ticks) {
+    if (!mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (group_id == 0 || len > ESP_NOW_GROUP_MAX_PAYLOAD_LEN ||
+        (inner_type != ESP_NOW_MSG_TYPE_DATA && inner_type < ESP_NOW_MSG_TYPE_USER_FIRST)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t frame[ESP_NOW_MAX_PAYLOAD_LEN];
+    esp_now_group_header_t header = {group_id, 0, 0, inner_type};
+    size_t frame_len = sizeof(header) + len;
+    if (data && len > 0) {
+        memcpy(frame + sizeof(header), data, len);
+    }
+
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    if (!reliable) {
+        memcpy(frame, &header, sizeof(header));
+        esp_err_t ret = manager_.send_message(broadcast_addr, ESP_NOW_MSG_TYPE_GROUP_DATA, frame, frame_len,
+                                              wait_ticks);
+        if (ret == ESP_OK) {
+            sent_++;
+        }
+        return ret;
+    }
+
+    // The seq is only taken once the frame is queued, so a failed send leaves no gap
+    // for members to NACK; no other reliable sender can claim it meanwhile
+    if (xSemaphoreTake(send_mutex_, wait_ticks) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    sending_t* sending = find_sending(group_id, true);
+    if (!sending) {
+        xSemaphoreGive(mutex_);
+        xSemaphoreGive(send_mutex_);
+        return ESP_ERR_NO_MEM;
+    }
+
+    header.seq = sending->next_seq;
+    header.flags = ESP_NOW_GROUP_FLAG_RELIABLE;
+    memcpy(frame, &header, sizeof(header));
+
+    // Kept before sending, so a frame lost on the way out can still be repaired
+    size_t slot = history_next_;
+    history_entry_t& entry = history_[slot];
+    entry.used = true;
+    entry.group_id = group_id;
+    entry.seq = header.seq;
+    entry.len = frame_len;
+    entry.repaired_us = 0;
+    memcpy(entry.frame, frame, frame_len);
+    xSemaphoreGive(mutex_);
+
+    esp_err_t ret = manager_.send_message(broadcast_addr, ESP_NOW_MSG_TYPE_GROUP_DATA, frame, frame_len,
+                                          wait_ticks);
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    sending = find_sending(group_id, false);
+    if (ret == ESP_OK) {
+        if (sending) {
+            sending->next_seq = header.seq + 1;
+            sending->syncs_left = ESP_NOW_GROUP_SYNC_COUNT;
+            sending->sync_delay_ms = ESP_NOW_GROUP_SYNC_DELAY_MS;
+            sending->sync_at_us = esp_timer_get_time() + ESP_NOW_GROUP_SYNC_DELAY_MS * 1000ULL;
+        }
+        history_next_ = (slot + 1) % ESP_NOW_GROUP_HISTORY_SIZE;
+    } else {
+        entry.used = false;
+    }
+    xSemaphoreGive(mutex_);
+    xSemaphoreGive(send_mutex_);
+
+    if (ret == ESP_OK) {
+        sent_++;
+        xTaskNotifyGive(task_handle_);
+    }
+    return ret;
+}
+
+// Caller holds mutex_. A full table gives up the stream heard from longest ago.
+GroupManager::stream_t* GroupManager::find_stream(const uint8_t* sender, uint16_t group_id, bool create,
+                                                  uint64_t now_us) {
+    stream_t* victim = nullptr;
+    for (auto& stream : streams_) {
+        if (stream.used && stream.group_id == group_id && memcmp(stream.sender, sender, 6) == 0) {
+            if (now_us - stream.last_us > ESP_NOW_GROUP_STREAM_TIMEOUT_MS * 1000ULL) {
+                stream.used = false;
+                victim = &stream;
+                break;
+            }
+            return &stream;
+        }
+        if (!victim || (victim->used && (!stream.used || stream.last_us < victim->last_us))) {
+            victim = &stream;
+        }
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->used = true;
+    memcpy(victim->sender, sender, 6);
+    victim->group_id = group_id;
+    return victim;
+}
+
+// Caller holds mutex_
+void GroupManager::schedule_nack(stream_t* stream, uint64_t now_us) {
+    if (stream->nack_at_us == 0) {
+        // Jitter spreads the members' NACKs, so one repair often arrives before the rest send theirs
+        stream->nack_at_us = now_us + (ESP_NOW_GROUP_NACK_DELAY_MS + esp_random() % (ESP_NOW_GROUP_NACK_DELAY_MS + 1)) * 1000ULL;
+        stream->nacks = 0;
+        xTaskNotifyGive(task_handle_);
+    }
+}
+
+// Caller holds mutex_. Moves the window to seq; returns false for a duplicate. A SYNC
+// advances with arrived = false, which leaves seq itself missing.
+bool GroupManager::advance(stream_t* stream, uint16_t seq, bool arrived, uint64_t now_us) {
+    stream->last_us = now_us;
+    int16_t ahead = (int16_t)(seq - stream->highest_seq);
+
+    if (stream->valid_bits == 0 || ahead >= ESP_NOW_GROUP_WINDOW || ahead <= -ESP_NOW_GROUP_WINDOW) {
+        // First frame, or too far from the window to repair: the sender restarted or we
+        // were away; start over from here
+        stream->highest_seq = seq;
+        stream->received_mask = arrived ? 1 : 0;
+        stream->valid_bits = 1;
+        stream->nack_at_us = 0;
+        if (!arrived) {
+            schedule_nack(stream, now_us);
+        }
+        return arrived;
+    }
+
+    if (ahead > 0) {
+        // Bits pushed out of the window unrepaired are lost
+        for (int i = ESP_NOW_GROUP_WINDOW - ahead; i < stream->valid_bits; i++) {
+            if (!(stream->received_mask & (1UL << i))) {
+                lost_++;
+            }
+        }
+        stream->received_mask = (stream->received_mask << ahead) | (arrived ? 1 : 0);
+        stream->highest_seq = seq;
+        stream->valid_bits = std::min<int>(stream->valid_bits + ahead, ESP_NOW_GROUP_WINDOW);
+        if (ahead > 1 || !arrived) {
+            schedule_nack(stream, now_us);
+        }
+        return arrived;
+    }
+
+    int behind = -ahead;
+    if (!arrived || behind >= stream->valid_bits || (stream->received_mask & (1UL << behind))) {
+        return false;
+    }
+    stream->received_mask |= 1UL << behind;
+    return true;
+}
+
+bool GroupManager::accept(esp_now_buffer_t* buffer) {
+    esp_now_message_t* msg = &buffer->msg;
+    if (msg->payload_length < sizeof(esp_now_group_header_t) || !mutex_) {
+        return false;
+    }
+
+    esp_now_group_header_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+    if (!is_member(header.group_id)) {
+        filtered_++;
+        return false;
+    }
+    if (header.inner_type != ESP_NOW_MSG_TYPE_DATA && header.inner_type < ESP_NOW_MSG_TYPE_USER_FIRST) {
+        return false;
+    }
+
+    if (header.flags & ESP_NOW_GROUP_FLAG_RELIABLE) {
+        uint64_t now_us = esp_timer_get_time();
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        stream_t* stream = find_stream(buffer->mac_addr, header.group_id, true, now_us);
+        bool fresh = advance(stream, header.seq, true, now_us);
+        xSemaphoreGive(mutex_);
+        if (!fresh) {
+            duplicates_++;
+            return false;
+        }
+    }
+
+    // Unwrap in place: the buffer now carries the inner message
+    size_t inner_len = msg->payload_length - sizeof(header);
+    memmove(msg->payload, msg->payload + sizeof(header), inner_len);
+    msg->msg_type = header.inner_type;
+    msg->payload_length = inner_len;
+    msg->crc32 = esp_now_message_crc(msg);
+    buffer->frame_len = esp_now_message_wire_len(msg);
+    received_++;
+    return true;
+}
+
+void GroupManager::handle_sync(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_group_sync_t) || !mutex_) {
+        return;
+    }
+
+    esp_now_group_sync_t sync;
+    memcpy(&sync, msg->payload, sizeof(sync));
+    if (!is_member(sync.group_id)) {
+        return;
+    }
+
+    // Only streams we already follow; a member that joins late starts at the next frame
+    uint64_t now_us = esp_timer_get_time();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stream_t* stream = find_stream(mac_addr, sync.group_id, false, now_us);
+    if (stream && (int16_t)(sync.last_seq - stream->highest_seq) > 0) {
+        advance(stream, sync.last_seq, false, now_us);
+    }
+    xSemaphoreGive(mutex_);
+}
+
+void GroupManager::handle_nack(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_group_nack_t) || !mutex_) {
+        return;
+    }
+
+    esp_now_group_nack_t nack;
+    memcpy(&nack, msg->payload, sizeof(nack));
+    nacks_received_++;
+
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    uint64_t now_us = esp_timer_get_time();
+    for (int i = 0; i < ESP_NOW_GROUP_WINDOW; i++) {
+        if (!(nack.missing_mask & (1UL << i))) {
+            continue;
+        }
+
+        uint16_t seq = nack.highest_seq - i;
+        uint8_t frame[ESP_NOW_MAX_PAYLOAD_LEN];
+        size_t frame_len = 0;
+        bool available = false;
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        for (auto& entry : history_) {
+            if (entry.used && entry.group_id == nack.group_id && entry.seq == seq) {
+                available = true;
+                // Another member's NACK for the same frame was just answered
+                if (now_us - entry.repaired_us >= ESP_NOW_GROUP_REPAIR_HOLDOFF_MS * 1000ULL) {
+                    entry.repaired_us = now_us;
+                    frame_len = entry.len;
+                    memcpy(frame, entry.frame, frame_len);
+                }
+                break;
+            }
+        }
+        xSemaphoreGive(mutex_);
+
+        if (!available) {
+            repairs_unavailable_++;
+            continue;
+        }
+        if (frame_len == 0) {
+            continue;
+        }
+
+        // A repair is a broadcast: it fills the same gap at every member. The receive
+        // task must not block on a full send queue, so repairs are best effort.
+        frame[offsetof(esp_now_group_header_t, flags)] |= ESP_NOW_GROUP_FLAG_REPAIR;
+        if (manager_.send_message(broadcast_addr, ESP_NOW_MSG_TYPE_GROUP_DATA, frame, frame_len, 0) == ESP_OK) {
+            repairs_sent_++;
+        }
+    }
+}
+
+// NACKs for gaps that are still open, and SYNCs after the last reliable frame of each
+// group. Returns the wait until the next timer.
+TickType_t GroupManager::run_timers(uint64_t now_us) {
+    typedef struct {
+        uint8_t mac_addr[6];
+        esp_now_group_nack_t nack;
+    } pending_nack_t;
+
+    pending_nack_t nacks[ESP_NOW_GROUP_MAX_STREAMS];
+    esp_now_group_sync_t syncs[ESP_NOW_GROUP_MAX_SENDING];
+    size_t nack_count = 0;
+    size_t sync_count = 0;
+    uint64_t next_us = UINT64_MAX;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& stream : streams_) {
+        if (!stream.used || stream.nack_at_us == 0) {
+            continue;
+        }
+        if (stream.nack_at_us > now_us) {
+            next_us = std::min(next_us, stream.nack_at_us);
+            continue;
+        }
+
+        uint32_t valid_mask = stream.valid_bits >= 32 ? UINT32_MAX : (1UL << stream.valid_bits) - 1;
+        uint32_t missing = ~stream.received_mask & valid_mask;
+        if (missing == 0) {
+            stream.nack_at_us = 0;
+            continue;
+        }
+
+        if (stream.nacks >= ESP_NOW_GROUP_MAX_NACKS) {
+            lost_ += __builtin_popcount(missing);
+            stream.received_mask |= missing;
+            stream.nack_at_us = 0;
+            continue;
+        }
+
+        pending_nack_t& pending = nacks[nack_count++];
+        memcpy(pending.mac_addr, stream.sender, 6);
+        pending.nack.group_id = stream.group_id;
+        pending.nack.highest_seq = stream.highest_seq;
+        pending.nack.missing_mask = missing;
+        stream.nacks++;
+        stream.nack_at_us = now_us + ESP_NOW_GROUP_NACK_INTERVAL_MS * 1000ULL;
+        next_us = std::min(next_us, stream.nack_at_us);
+    }
+
+    for (auto& sending : sending_) {
+        if (sending.group_id == 0 || sending.syncs_left == 0) {
+            continue;
+        }
+        if (sending.sync_at_us > now_us) {
+            next_us = std::min(next_us, sending.sync_at_us);
+            continue;
+        }
+
+        syncs[sync_count].group_id = sending.group_id;
+        syncs[sync_count].last_seq = sending.next_seq - 1;
+        sync_count++;
+        sending.syncs_left--;
+        sending.sync_delay_ms *= 2;
+        sending.sync_at_us = now_us + sending.sync_delay_ms * 1000ULL;
+        if (sending.syncs_left > 0) {
+            next_us = std::min(next_us, sending.sync_at_us);
+        }
+    }
+    xSemaphoreGive(mutex_);
+
+    for (size_t i = 0; i < nack_count; i++) {
+        if (manager_.send_message(nacks[i].mac_addr, ESP_NOW_MSG_TYPE_GROUP_NACK,
+                                  (const uint8_t*)&nacks[i].nack, sizeof(nacks[i].nack), 0) == ESP_OK) {
+            nacks_sent_++;
+        }
+    }
+
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    for (size_t i = 0; i < sync_count; i++) {
+        manager_.send_message(broadcast_addr, ESP_NOW_MSG_TYPE_GROUP_SYNC,
+                              (const uint8_t*)&syncs[i], sizeof(syncs[i]), 0);
+    }
+
+    if (next_us == UINT64_MAX) {
+        return portMAX_DELAY;
+    }
+    uint64_t wait_us = next_us > now_us ? next_us - now_us : 0;
+    return std::max<TickType_t>(pdMS_TO_TICKS((wait_us + 999) / 1000), 1);
+}
+
+void GroupManager::group_task(void* parameter) {
+    GroupManager* groups = static_cast<GroupManager*>(parameter);
+
+    while (true) {
+        TickType_t wait = groups->run_timers(esp_timer_get_time());
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+esp_now_group_stats_t GroupManager::get_stats() const {
+    esp_now_group_stats_t stats = {};
+    stats.sent = sent_.load();
+    stats.received = received_.load();
+    stats.filtered = filtered_.load();
+    stats.duplicates = duplicates_.load();
+    stats.nacks_sent = nacks_sent_.load();
+    stats.nacks_received = nacks_received_.load();
+    stats.repairs_sent = repairs_sent_.load();
+    stats.repairs_unavailable = repairs_unavailable_.load();
+    stats.lost = lost_.load();
+    return stats;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+#include "message_pool.hpp"
+
+#define GROUP_MANAGER_TAG "GROUP_MGR"
+#define ESP_NOW_MAX_GROUPS 8                 // Joined groups, checked in the receive callback
+#define ESP_NOW_GROUP_MAX_SENDING 8          // Groups this node sends reliable frames to
+#define ESP_NOW_GROUP_MAX_STREAMS 16         // (sender, group) pairs tracked for repair
+#define ESP_NOW_GROUP_HISTORY_SIZE 16        // Reliable frames kept for retransmission, all groups
+#define ESP_NOW_GROUP_WINDOW 32              // Sequence numbers a member tracks behind the highest
+#define ESP_NOW_GROUP_NACK_DELAY_MS 5        // Before the first NACK, plus up to as much jitter
+#define ESP_NOW_GROUP_NACK_INTERVAL_MS 30    // Between NACKs for the same gap
+#define ESP_NOW_GROUP_MAX_NACKS 3            // Then the gap is counted as lost
+#define ESP_NOW_GROUP_REPAIR_HOLDOFF_MS 10   // One repair serves every member that NACKed it
+#define ESP_NOW_GROUP_SYNC_DELAY_MS 20       // After the last reliable frame; doubles per SYNC
+#define ESP_NOW_GROUP_SYNC_COUNT 2
+#define ESP_NOW_GROUP_STREAM_TIMEOUT_MS 60000
+#define GROUP_TASK_STACK_SIZE 3072
+#define GROUP_TASK_PRIORITY 3
+
+class ESPNowManager;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t received;           // Delivered to this node, repairs included
+    uint32_t filtered;           // Dropped in the receive callback: not a member
+    uint32_t duplicates;
+    uint32_t nacks_sent;
+    uint32_t nacks_received;
+    uint32_t repairs_sent;
+    uint32_t repairs_unavailable; // NACKed frames already gone from the history
+    uint32_t lost;               // Gaps given up after ESP_NOW_GROUP_MAX_NACKS
+} esp_now_group_stats_t;
+
+// Multicast over the broadcast address. A group is a 16-bit ID, optionally derived from
+// a name; a frame costs one transmission however many members there are. Membership is
+// a small lock-free set read by the receive callback, so frames for other groups never
+// take a receive buffer. Reliable frames are numbered per group: members NACK the gaps
+// they see, the sender rebroadcasts from a short history, and a SYNC after the last
+// frame exposes a lost tail. Delivery is not reordered.
+class GroupManager {
+private:
+    typedef struct {
+        bool used;
+        uint8_t sender[6];
+        uint16_t group_id;
+        uint16_t highest_seq;
+        uint32_t received_mask;  // Bit i: highest_seq - i arrived
+        uint8_t valid_bits;      // Bits of received_mask that follow the first frame heard
+        uint8_t nacks;
+        uint64_t nack_at_us;     // 0 when no gap is outstanding
+        uint64_t last_us;
+    } stream_t;
+
+    typedef struct {
+        uint16_t group_id;       // 0 when unused
+        uint16_t next_seq;
+        uint8_t syncs_left;
+        uint32_t sync_delay_ms;
+        uint64_t sync_at_us;
+    } sending_t;
+
+    typedef struct {
+        bool used;
+        uint16_t group_id;
+        uint16_t seq;
+        uint16_t len;            // Of frame, header included
+        uint64_t repaired_us;
+        uint8_t frame[ESP_NOW_MAX_PAYLOAD_LEN];
+    } history_entry_t;
+
+    ESPNowManager& manager_;
+    std::atomic<uint16_t> members_[ESP_NOW_MAX_GROUPS];  // 0 is a free entry
+    SemaphoreHandle_t mutex_;
+    SemaphoreHandle_t send_mutex_;   // Reliable senders, one at a time from seq to outcome
+    TaskHandle_t task_handle_;
+    stream_t streams_[ESP_NOW_GROUP_MAX_STREAMS];
+    sending_t sending_[ESP_NOW_GROUP_MAX_SENDING];
+    history_entry_t history_[ESP_NOW_GROUP_HISTORY_SIZE];
+    size_t history_next_;
+
+    std::atomic<uint32_t> sent_;
+    std::atomic<uint32_t> received_;
+    std::atomic<uint32_t> filtered_;
+    std::atomic<uint32_t> duplicates_;
+    std::atomic<uint32_t> nacks_sent_;
+    std::atomic<uint32_t> nacks_received_;
+    std::atomic<uint32_t> repairs_sent_;
+    std::atomic<uint32_t> repairs_unavailable_;
+    std::atomic<uint32_t> lost_;
+
+    static void group_task(void* parameter);
+    TickType_t run_timers(uint64_t now_us);
+    stream_t* find_stream(const uint8_t* sender, uint16_t group_id, bool create, uint64_t now_us);
+    bool advance(stream_t* stream, uint16_t seq, bool arrived, uint64_t now_us);
+    void schedule_nack(stream_t* stream, uint64_t now_us);
+    sending_t* find_sending(uint16_t group_id, bool create);
+
+public:
+    explicit GroupManager(ESPNowManager& manager);
+    ~GroupManager();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // ESP_ERR_NO_MEM when ESP_NOW_MAX_GROUPS are joined; 0 is not a valid group
+    esp_err_t join(uint16_t group_id);
+    esp_err_t leave(uint16_t group_id);
+    // Wi-Fi task safe: called from the receive callback for every GROUP frame
+    bool is_member(uint16_t group_id) const;
+    void count_filtered() { filtered_++; }
+    static uint16_t group_id_for_name(const char* name);
+
+    // One broadcast; the sender need not be a member. Reliable frames are repaired on
+    // NACK while they are among the last ESP_NOW_GROUP_HISTORY_SIZE sent.
+    esp_err_t send(uint16_t group_id, uint8_t inner_type, const uint8_t* data, size_t len, bool reliable,
+                   TickType_t wait_ticks = portMAX_DELAY);
+
+    // Receive task. Returns true when the frame is new for a joined group: the buffer
+    // then holds the inner message, to be dispatched.
+    bool accept(esp_now_buffer_t* buffer);
+    void handle_sync(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_nack(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    esp_now_group_stats_t get_stats() const;
+};
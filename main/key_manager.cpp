@@ -0,0 +1,458 @@
+#include "key_manager.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+
+static const char LMK_LABEL[] = "espnow-lmk";
+static const char GROUP_LABEL[] = "espnow-group";
+
+KeyManager::KeyManager(ESPNowManager& manager)
+    : manager_(manager), config_(), hmac_ready_(false), switch_queue_(nullptr),
+      switch_task_handle_(nullptr), rebalance_task_handle_(nullptr), request_mutex_(nullptr),
+      response_signal_(nullptr), next_request_id_(1), awaiting_request_id_(0), response_(),
+      pending_promotions_(0), rebalance_enabled_(false) {
+    memset(group_key_, 0, sizeof(group_key_));
+    memset(awaiting_mac_, 0, sizeof(awaiting_mac_));
+}
+
+KeyManager::~KeyManager() {
+    deinitialize();
+}
+
+esp_err_t KeyManager::initialize(const esp_now_security_config_t& config) {
+    if (hmac_ready_) {
+        return ESP_OK;
+    }
+
+    config_ = config;
+    rebalance_enabled_ = config.auto_rebalance;
+    if (!config.enabled) {
+        return ESP_OK;
+    }
+
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_init(&tx_hmac_);
+    mbedtls_md_init(&rx_hmac_);
+    if (!info || mbedtls_md_setup(&tx_hmac_, info, 1) != 0 || mbedtls_md_setup(&rx_hmac_, info, 1) != 0) {
+        ESP_LOGE(KEY_MANAGER_TAG, "Failed to set up HMAC contexts");
+        mbedtls_md_free(&tx_hmac_);
+        mbedtls_md_free(&rx_hmac_);
+        return ESP_FAIL;
+    }
+    hmac_ready_ = true;
+
+    uint8_t digest[32];
+    mbedtls_md_hmac(info, config_.pmk, ESP_NOW_KEY_LEN, (const unsigned char*)GROUP_LABEL,
+                    sizeof(GROUP_LABEL) - 1, digest);
+    memcpy(group_key_, digest, ESP_NOW_KEY_LEN);
+
+    switch_queue_ = xQueueCreate(KEY_SWITCH_QUEUE_LEN, sizeof(link_switch_t));
+    request_mutex_ = xSemaphoreCreateMutex();
+    response_signal_ = xSemaphoreCreateBinary();
+    if (!switch_queue_ || !request_mutex_ || !response_signal_) {
+        ESP_LOGE(KEY_MANAGER_TAG, "Failed to create key manager queue or semaphores");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    next_request_id_ = (uint16_t)(esp_timer_get_time() | 1);
+    activity_.reserve(ESP_NOW_MAX_PEERS);
+
+    if (xTaskCreate(switch_task, "esp_now_keysw", KEY_TASK_STACK_SIZE, this,
+                    KEY_TASK_PRIORITY + 1, &switch_task_handle_) != pdPASS) {
+        switch_task_handle_ = nullptr;
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(rebalance_task, "esp_now_keys", KEY_TASK_STACK_SIZE, this,
+                    KEY_TASK_PRIORITY, &rebalance_task_handle_) != pdPASS) {
+        rebalance_task_handle_ = nullptr;
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(KEY_MANAGER_TAG, "Peer security enabled: %u encrypted slots, %s fallback",
+             config_.max_encrypted_peers, link_mode_name(fallback_mode()));
+    return ESP_OK;
+}
+
+void KeyManager::deinitialize() {
+    // Never stop the rebalance task in the middle of an exchange
+    bool locked = request_mutex_ && xSemaphoreTake(request_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE;
+
+    if (rebalance_task_handle_) {
+        vTaskDelete(rebalance_task_handle_);
+        rebalance_task_handle_ = nullptr;
+    }
+
+    if (switch_task_handle_) {
+        vTaskDelete(switch_task_handle_);
+        switch_task_handle_ = nullptr;
+    }
+
+    if (switch_queue_) {
+        vQueueDelete(switch_queue_);
+        switch_queue_ = nullptr;
+    }
+
+    if (request_mutex_) {
+        if (locked) {
+            xSemaphoreGive(request_mutex_);
+        }
+        vSemaphoreDelete(request_mutex_);
+        request_mutex_ = nullptr;
+    }
+
+    if (response_signal_) {
+        vSemaphoreDelete(response_signal_);
+        response_signal_ = nullptr;
+    }
+
+    if (hmac_ready_) {
+        mbedtls_md_free(&tx_hmac_);
+        mbedtls_md_free(&rx_hmac_);
+        hmac_ready_ = false;
+    }
+
+    activity_.clear();
+    pending_promotions_ = 0;
+}
+
+esp_now_link_mode_t KeyManager::fallback_mode() const {
+    return config_.auth_fallback ? ESP_NOW_LINK_AUTH : ESP_NOW_LINK_PLAINTEXT;
+}
+
+void KeyManager::compute_tag(mbedtls_md_context_t* ctx, const uint8_t* key, const uint8_t* frame,
+                             size_t len, uint8_t* tag) {
+    uint8_t digest[32];
+    mbedtls_md_hmac_starts(ctx, key, ESP_NOW_KEY_LEN);
+    mbedtls_md_hmac_update(ctx, frame, len);
+    mbedtls_md_hmac_finish(ctx, digest);
+    memcpy(tag, digest, ESP_NOW_AUTH_TAG_LEN);
+}
+
+void KeyManager::sign(const uint8_t* key, uint8_t* frame, size_t len) {
+    compute_tag(&tx_hmac_, key, frame, len, frame + len);
+}
+
+bool KeyManager::verify(const uint8_t* key, const uint8_t* frame, size_t len) {
+    uint8_t expected[ESP_NOW_AUTH_TAG_LEN];
+    compute_tag(&rx_hmac_, key, frame, len, expected);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < ESP_NOW_AUTH_TAG_LEN; i++) {
+        diff |= expected[i] ^ frame[len + i];
+    }
+    return diff == 0;
+}
+
+// Both ends derive the same key: the MACs go in ascending order
+void KeyManager::derive_lmk(const uint8_t* mac_a, const uint8_t* mac_b, uint8_t* lmk) const {
+    const uint8_t* low = memcmp(mac_a, mac_b, 6) < 0 ? mac_a : mac_b;
+    const uint8_t* high = low == mac_a ? mac_b : mac_a;
+
+    uint8_t input[sizeof(LMK_LABEL) - 1 + 12];
+    memcpy(input, LMK_LABEL, sizeof(LMK_LABEL) - 1);
+    memcpy(input + sizeof(LMK_LABEL) - 1, low, 6);
+    memcpy(input + sizeof(LMK_LABEL) - 1 + 6, high, 6);
+
+    uint8_t digest[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), config_.pmk, ESP_NOW_KEY_LEN,
+                    input, sizeof(input), digest);
+    memcpy(lmk, digest, ESP_NOW_KEY_LEN);
+}
+
+void KeyManager::handle_slot_request(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!hmac_ready_ || msg->payload_length < sizeof(esp_now_key_slot_request_t)) {
+        return;
+    }
+
+    esp_now_key_slot_request_t request;
+    memcpy(&request, msg->payload, sizeof(request));
+
+    esp_now_peer_info_t peer;
+    if (manager_.get_peer_info(mac_addr, &peer) != ESP_OK || !peer.security.keyed) {
+        return;
+    }
+
+    esp_now_key_slot_response_t response = {request.request_id, peer.security.mode, 0};
+    if (request.mode == peer.security.mode) {
+        response.accepted = 1;
+    } else if (request.mode == ESP_NOW_LINK_ENCRYPTED) {
+        uint32_t used = manager_.get_encrypted_peer_count() + pending_promotions_.load();
+        response.accepted = used < config_.max_encrypted_peers;
+    } else if (request.mode == ESP_NOW_LINK_AUTH) {
+        response.accepted = 1;
+    } else if (request.mode == ESP_NOW_LINK_PLAINTEXT) {
+        response.accepted = !config_.require_secure;
+    }
+
+    // The response still goes out under the old mode; switch after it had time to leave
+    if (response.accepted && request.mode != peer.security.mode) {
+        link_switch_t change = {};
+        memcpy(change.mac_addr, mac_addr, 6);
+        change.mode = request.mode;
+        change.at_us = esp_timer_get_time() + KEY_SLOT_SWITCH_DELAY_MS * 1000ULL;
+        if (request.mode == ESP_NOW_LINK_ENCRYPTED) {
+            pending_promotions_.fetch_add(1);
+        }
+        if (xQueueSend(switch_queue_, &change, 0) == pdPASS) {
+            response.mode = request.mode;
+        } else {
+            if (request.mode == ESP_NOW_LINK_ENCRYPTED) {
+                pending_promotions_.fetch_sub(1);
+            }
+            response.accepted = 0;
+        }
+    }
+
+    manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_KEY_SLOT_RESPONSE,
+                          (const uint8_t*)&response, sizeof(response));
+}
+
+void KeyManager::handle_slot_response(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!response_signal_ || msg->payload_length < sizeof(esp_now_key_slot_response_t)) {
+        return;
+    }
+
+    esp_now_key_slot_response_t response;
+    memcpy(&response, msg->payload, sizeof(response));
+    if (response.request_id == 0 || response.request_id != awaiting_request_id_.load() ||
+        memcmp(mac_addr, awaiting_mac_, 6) != 0) {
+        return;
+    }
+
+    response_ = response;
+    awaiting_request_id_ = 0;
+    xSemaphoreGive(response_signal_);
+}
+
+esp_err_t KeyManager::request_link_mode(const uint8_t* mac_addr, esp_now_link_mode_t mode) {
+    if (!hmac_ready_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (mode == ESP_NOW_LINK_PLAINTEXT && config_.require_secure) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (xSemaphoreTake(request_mutex_, pdMS_TO_TICKS(KEY_SLOT_RESPONSE_TIMEOUT_MS * 5)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_peer_info_t peer;
+    esp_err_t ret = manager_.get_peer_info(mac_addr, &peer);
+    if (ret != ESP_OK || !peer.security.keyed) {
+        xSemaphoreGive(request_mutex_);
+        return ret != ESP_OK ? ret : ESP_ERR_INVALID_ARG;
+    }
+    if (mode == ESP_NOW_LINK_ENCRYPTED && peer.security.mode != ESP_NOW_LINK_ENCRYPTED &&
+        manager_.get_encrypted_peer_count() + pending_promotions_.load() >= config_.max_encrypted_peers) {
+        xSemaphoreGive(request_mutex_);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (next_request_id_ == 0) next_request_id_++;
+    esp_now_key_slot_request_t request = {next_request_id_++, (uint8_t)mode};
+
+    xSemaphoreTake(response_signal_, 0);
+    memcpy(awaiting_mac_, mac_addr, 6);
+    awaiting_request_id_ = request.request_id;
+
+    ret = manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_KEY_SLOT_REQUEST,
+                                (const uint8_t*)&request, sizeof(request));
+    if (ret == ESP_OK &&
+        xSemaphoreTake(response_signal_, pdMS_TO_TICKS(KEY_SLOT_RESPONSE_TIMEOUT_MS)) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+    }
+    awaiting_request_id_ = 0;
+
+    if (ret == ESP_OK) {
+        if (response_.accepted) {
+            ret = manager_.set_peer_link_mode(mac_addr, mode);
+        } else {
+            // A refused request reports the peer's mode; follow it unless that needs a slot
+            if (response_.mode != peer.security.mode && response_.mode != ESP_NOW_LINK_ENCRYPTED) {
+                manager_.set_peer_link_mode(mac_addr, (esp_now_link_mode_t)response_.mode);
+            }
+            ret = ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    xSemaphoreGive(request_mutex_);
+    return ret;
+}
+
+void KeyManager::set_auto_rebalance(bool enabled) {
+    rebalance_enabled_ = enabled;
+}
+
+void KeyManager::switch_task(void* parameter) {
+    KeyManager* keys = static_cast<KeyManager*>(parameter);
+    link_switch_t change;
+
+    while (true) {
+        if (xQueueReceive(keys->switch_queue_, &change, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+
+        uint64_t now_us = esp_timer_get_time();
+        if (change.at_us > now_us) {
+            vTaskDelay(std::max<TickType_t>(pdMS_TO_TICKS((change.at_us - now_us) / 1000), 1));
+        }
+
+        keys->manager_.set_peer_link_mode(change.mac_addr, (esp_now_link_mode_t)change.mode);
+        if (change.mode == ESP_NOW_LINK_ENCRYPTED) {
+            keys->pending_promotions_.fetch_sub(1);
+        }
+    }
+}
+
+void KeyManager::rebalance_task(void* parameter) {
+    KeyManager* keys = static_cast<KeyManager*>(parameter);
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(KEY_REBALANCE_INTERVAL_MS));
+        keys->update_activity(esp_timer_get_time());
+        if (keys->rebalance_enabled_) {
+            keys->rebalance();
+        }
+    }
+}
+
+KeyManager::activity_t* KeyManager::find_activity(const uint8_t* mac_addr) {
+    for (auto& entry : activity_) {
+        if (memcmp(entry.mac_addr, mac_addr, 6) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Frame rate per keyed peer, halved every interval without traffic. Updated in place
+// within the reserved capacity, so a round does not allocate.
+void KeyManager::update_activity(uint64_t now_us) {
+    for (auto& entry : activity_) {
+        entry.present = false;
+    }
+
+    manager_.for_each_peer([&](const esp_now_peer_info_t& peer) {
+        if (!peer.security.keyed) return;
+
+        activity_t* entry = find_activity(peer.mac_addr);
+        if (entry) {
+            uint32_t delta = peer.security.frames - entry->frames;
+            entry->rate = entry->rate * 0.5f + delta * 0.5f;
+            if (delta > 0) {
+                entry->last_active_us = now_us;
+            }
+        } else {
+            if (activity_.size() == activity_.capacity()) return;
+            activity_.push_back(activity_t());
+            entry = &activity_.back();
+            memcpy(entry->mac_addr, peer.mac_addr, 6);
+            entry->rate = 0.0f;
+            entry->last_active_us = now_us;
+        }
+        entry->frames = peer.security.frames;
+        entry->mode = peer.security.mode;
+        entry->last_seen_us = peer.last_seen_us;
+        entry->present = true;
+    });
+
+    activity_.erase(std::remove_if(activity_.begin(), activity_.end(),
+                                   [](const activity_t& entry) { return !entry.present; }),
+                    activity_.end());
+}
+
+// One promotion per round: the busiest peer without a slot takes a free one, or the
+// slot of the least active holder when it is KEY_SLOT_SWAP_FACTOR times busier
+void KeyManager::rebalance() {
+    uint64_t now_us = esp_timer_get_time();
+    esp_now_link_mode_t fallback = fallback_mode();
+    const activity_t* best = nullptr;
+    const activity_t* coldest = nullptr;
+
+    // activity_ holds the peer state from update_activity(), so no table copy is needed
+    for (const auto& entry : activity_) {
+        const activity_t* activity = &entry;
+        const uint8_t* mac_addr = entry.mac_addr;
+
+        bool idle = now_us - activity->last_active_us > KEY_SLOT_IDLE_MS * 1000ULL;
+        if (entry.mode == ESP_NOW_LINK_ENCRYPTED) {
+            if (idle) {
+                if (request_link_mode(mac_addr, fallback) != ESP_OK) {
+                    manager_.set_peer_link_mode(mac_addr, fallback);
+                }
+                continue;
+            }
+
+            // Nothing heard for a while: make sure the peer still runs the same mode
+            if (now_us - entry.last_seen_us > KEY_SLOT_CONFIRM_AFTER_MS * 1000ULL &&
+                request_link_mode(mac_addr, ESP_NOW_LINK_ENCRYPTED) == ESP_ERR_TIMEOUT) {
+                ESP_LOGW(KEY_MANAGER_TAG, "No answer over the encrypted link to %02x:%02x:%02x:%02x:%02x:%02x, "
+                         "falling back to %s", mac_addr[0], mac_addr[1], mac_addr[2],
+                         mac_addr[3], mac_addr[4], mac_addr[5], link_mode_name(fallback));
+                manager_.set_peer_link_mode(mac_addr, fallback);
+                continue;
+            }
+
+            if (!coldest || activity->rate < coldest->rate) {
+                coldest = activity;
+            }
+        } else if (!idle && activity->rate > 0.0f && (!best || activity->rate > best->rate)) {
+            best = activity;
+        }
+    }
+
+    if (!best) {
+        return;
+    }
+
+    if (manager_.get_encrypted_peer_count() + pending_promotions_.load() >= config_.max_encrypted_peers) {
+        if (!coldest || best->rate < coldest->rate * KEY_SLOT_SWAP_FACTOR) {
+            return;
+        }
+        if (request_link_mode(coldest->mac_addr, fallback) != ESP_OK) {
+            manager_.set_peer_link_mode(coldest->mac_addr, fallback);
+        }
+    }
+
+    esp_err_t ret = request_link_mode(best->mac_addr, ESP_NOW_LINK_ENCRYPTED);
+    ESP_LOGD(KEY_MANAGER_TAG, "Promoting %02x:%02x:%02x:%02x:%02x:%02x (%.1f frames/s): %s",
+             best->mac_addr[0], best->mac_addr[1], best->mac_addr[2],
+             best->mac_addr[3], best->mac_addr[4], best->mac_addr[5],
+             best->rate * 1000.0f / KEY_REBALANCE_INTERVAL_MS, esp_err_to_name(ret));
+}
+
+float KeyManager::measure_tag_cost_us(size_t len, uint32_t iterations) {
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    if (!info || iterations == 0 || mbedtls_md_setup(&ctx, info, 1) != 0) {
+        mbedtls_md_free(&ctx);
+        return 0.0f;
+    }
+
+    std::vector<uint8_t> frame(len + ESP_NOW_AUTH_TAG_LEN, 0xA5);
+    uint8_t key[ESP_NOW_KEY_LEN];
+    memset(key, 0x3C, sizeof(key));
+
+    uint64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++) {
+        compute_tag(&ctx, key, frame.data(), len, frame.data() + len);
+    }
+    uint64_t elapsed_us = esp_timer_get_time() - start_us;
+
+    mbedtls_md_free(&ctx);
+    return (float)elapsed_us / iterations;
+}
+
+const char* KeyManager::link_mode_name(uint8_t mode) {
+    switch (mode) {
+        case ESP_NOW_LINK_PLAINTEXT: return "plaintext";
+        case ESP_NOW_LINK_AUTH: return "auth";
+        case ESP_NOW_LINK_ENCRYPTED: return "encrypted";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_now.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <mbedtls/md.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "esp_now_protocol.hpp"
+
+#define KEY_MANAGER_TAG "KEY_MGR"
+#define KEY_REBALANCE_INTERVAL_MS 1000
+#define KEY_SLOT_RESPONSE_TIMEOUT_MS 200
+#define KEY_SLOT_SWITCH_DELAY_MS 20           // Responder switches once its response is on air
+#define KEY_SLOT_CONFIRM_AFTER_MS 3000        // Encrypted peers silent this long must confirm the mode
+#define KEY_SLOT_IDLE_MS 30000                // Encrypted peers without traffic this long give up the slot
+#define KEY_SLOT_SWAP_FACTOR 2.0f             // Frame rate a candidate needs over the coldest slot holder
+#define KEY_SWITCH_QUEUE_LEN 8
+#define KEY_TASK_STACK_SIZE 4096
+#define KEY_TASK_PRIORITY 3
+
+typedef enum {
+    ESP_NOW_LINK_PLAINTEXT = 0,      // No protection
+    ESP_NOW_LINK_AUTH = 1,           // HMAC tag on every frame, payload in the clear
+    ESP_NOW_LINK_ENCRYPTED = 2,      // Driver CCMP with the LMK; holds an encrypted driver slot
+} esp_now_link_mode_t;
+
+// Per-peer key state, kept in the peer table entry
+typedef struct {
+    bool keyed;                      // lmk is set
+    uint8_t mode;                    // esp_now_link_mode_t, the same on both ends
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint32_t frames;                 // Sent, and received with a valid tag or over CCMP
+    uint32_t auth_failures;          // Received frames dropped for a missing or bad tag
+    uint32_t promotions;
+    uint32_t demotions;
+    uint64_t mode_since_us;
+} esp_now_peer_security_t;
+
+// Applied at initialize(). With security enabled broadcasts carry a tag under a group key
+// derived from the PMK, so every node of the mesh needs the same configuration.
+typedef struct {
+    bool enabled;
+    uint8_t pmk[ESP_NOW_KEY_LEN];
+    uint8_t max_encrypted_peers;     // Encrypted driver slots to use, at most ESP_NOW_MAX_ENCRYPT_PEER_NUM
+    bool derive_peer_keys;           // Peers added without an LMK get one derived from the PMK and both MACs
+    bool auth_fallback;              // Keyed peers without a slot use AUTH; false sends them in the clear
+    bool require_secure;             // Drop frames other than discovery from peers without a key
+    bool auto_rebalance;             // Move the encrypted slots to the busiest keyed peers
+} esp_now_security_config_t;
+
+class ESPNowManager;
+
+// Key handling for the manager. Frames to keyed peers are either encrypted by the driver
+// (at most max_encrypted_peers at a time) or carry a software tag. Both ends must agree on
+// the mode, so every change is a request/response exchange: the initiator switches when
+// the response arrives, the responder KEY_SLOT_SWITCH_DELAY_MS after answering. The
+// rebalance task gives the encrypted slots to the peers with the highest frame rate.
+class KeyManager {
+private:
+    typedef struct {
+        uint8_t mac_addr[6];
+        uint8_t mode;
+        uint64_t at_us;
+    } link_switch_t;
+
+    typedef struct {
+        uint8_t mac_addr[6];
+        uint8_t mode;                // Peer state as of the last update_activity()
+        bool present;
+        uint32_t frames;
+        float rate;                  // Frames per rebalance interval, smoothed
+        uint64_t last_active_us;
+        uint64_t last_seen_us;
+    } activity_t;
+
+    ESPNowManager& manager_;
+    esp_now_security_config_t config_;
+    uint8_t group_key_[ESP_NOW_KEY_LEN];
+    mbedtls_md_context_t tx_hmac_;   // Send task only
+    mbedtls_md_context_t rx_hmac_;   // Receive task only
+    bool hmac_ready_;
+
+    QueueHandle_t switch_queue_;
+    TaskHandle_t switch_task_handle_;
+    TaskHandle_t rebalance_task_handle_;
+    SemaphoreHandle_t request_mutex_;
+    SemaphoreHandle_t response_signal_;
+    uint16_t next_request_id_;
+    std::atomic<uint16_t> awaiting_request_id_;
+    uint8_t awaiting_mac_[6];
+    esp_now_key_slot_response_t response_;
+    std::atomic<uint32_t> pending_promotions_;
+    std::atomic<bool> rebalance_enabled_;
+    std::vector<activity_t> activity_;  // Reserved for every peer at initialize()
+
+    static void switch_task(void* parameter);
+    static void rebalance_task(void* parameter);
+    void rebalance();
+    void update_activity(uint64_t now_us);
+    activity_t* find_activity(const uint8_t* mac_addr);
+    static void compute_tag(mbedtls_md_context_t* ctx, const uint8_t* key, const uint8_t* frame,
+                            size_t len, uint8_t* tag);
+
+public:
+    explicit KeyManager(ESPNowManager& manager);
+    ~KeyManager();
+
+    esp_err_t initialize(const esp_now_security_config_t& config);
+    void deinitialize();
+    bool is_enabled() const { return hmac_ready_; }
+    const esp_now_security_config_t& get_config() const { return config_; }
+    esp_now_link_mode_t fallback_mode() const;
+
+    // Send task: writes ESP_NOW_AUTH_TAG_LEN bytes at frame + len
+    void sign(const uint8_t* key, uint8_t* frame, size_t len);
+    // Receive task: len excludes the tag that follows the frame
+    bool verify(const uint8_t* key, const uint8_t* frame, size_t len);
+    const uint8_t* group_key() const { return group_key_; }
+    void derive_lmk(const uint8_t* mac_a, const uint8_t* mac_b, uint8_t* lmk) const;
+
+    // Called from the receive task
+    void handle_slot_request(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_slot_response(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    // Agrees on a mode with the peer and applies it here; ESP_ERR_INVALID_STATE when the
+    // peer refused (no free encrypted slot), ESP_ERR_TIMEOUT when it did not answer
+    esp_err_t request_link_mode(const uint8_t* mac_addr, esp_now_link_mode_t mode);
+    void set_auto_rebalance(bool enabled);
+
+    // CPU time of one tag over len bytes
+    float measure_tag_cost_us(size_t len, uint32_t iterations);
+    static const char* link_mode_name(uint8_t mode);
+};
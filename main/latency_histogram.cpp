@@ -0,0 +1,130 @@
+#include "latency_histogram.hpp"
+
+LatencyHistogram::LatencyHistogram() : reset_pending_(false) {
+    clear();
+}
+
+void LatencyHistogram::clear() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    min_.store(UINT32_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_index(uint32_t value) {
+    if (value < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+
+    uint32_t exponent = 31 - __builtin_clz(value);
+    uint32_t shift = exponent - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    uint32_t sub_bucket = (value >> shift) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+    return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+uint32_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    uint32_t shift = index / LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t)(LATENCY_HISTOGRAM_SUB_BUCKETS + index % LATENCY_HISTOGRAM_SUB_BUCKETS) << shift;
+    uint64_t upper = lower + ((uint64_t)1 << shift) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+void LatencyHistogram::record(uint32_t value) {
+    if (reset_pending_.load(std::memory_order_acquire)) {
+        clear();
+        reset_pending_.store(false, std::memory_order_release);
+    }
+
+    // Single writer: plain load/store avoids atomic read-modify-write instructions
+    std::atomic<uint32_t>& bucket = buckets_[bucket_index(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value < min_.load(std::memory_order_relaxed)) {
+        min_.store(value, std::memory_order_relaxed);
+    }
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+uint32_t LatencyHistogram::count() const {
+    return reset_pending_.load(std::memory_order_acquire) ? 0 : count_.load(std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::min() const {
+    return count() > 0 ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t LatencyHistogram::max() const {
+    return count() > 0 ? max_.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t LatencyHistogram::mean() const {
+    uint32_t samples = count();
+    return samples > 0 ? (uint32_t)(sum_.load(std::memory_order_relaxed) / samples) : 0;
+}
+
+uint32_t LatencyHistogram::value_at_percentile(float percentile) const {
+    uint32_t samples = count();
+    if (samples == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)(percentile / 100.0f * samples + 0.5f);
+    if (target < 1) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            uint32_t upper = bucket_upper_bound(i);
+            uint32_t highest = max_.load(std::memory_order_relaxed);
+            return upper < highest ? upper : highest;
+        }
+    }
+    return max_.load(std::memory_order_relaxed);
+}
+
+latency_summary_t LatencyHistogram::summary() const {
+    latency_summary_t summary;
+    summary.count = count();
+    summary.min = min();
+    summary.max = max();
+    summary.mean = mean();
+    summary.p50 = value_at_percentile(50.0f);
+    summary.p90 = value_at_percentile(90.0f);
+    summary.p99 = value_at_percentile(99.0f);
+    summary.p999 = value_at_percentile(99.9f);
+    return summary;
+}
+
+uint32_t LatencyHistogram::bucket(size_t index) const {
+    if (index >= LATENCY_HISTOGRAM_BUCKETS || reset_pending_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    return buckets_[index].load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    reset_pending_.store(true, std::memory_order_release);
+}
+
+void LatencyHistogram::print(const char* tag, const char* name) const {
+    latency_summary_t s = summary();
+    if (s.count == 0) {
+        ESP_LOGI(tag, "  %-20s no samples", name);
+        return;
+    }
+    ESP_LOGI(tag, "  %-20s n=%lu min=%lu p50=%lu p90=%lu p99=%lu p99.9=%lu max=%lu mean=%lu us",
+             name, s.count, s.min, s.p50, s.p90, s.p99, s.p999, s.max, s.mean);
+}
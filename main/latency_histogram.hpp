@@ -0,0 +1,61 @@
+#pragma once
+
+#include <esp_log.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 3  // 8 linear buckets per power of two, <= 12.5% error
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1u << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_BUCKETS ((32 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+} latency_summary_t;
+
+// Fixed-memory log-linear (HDR-style) histogram of 32-bit values, typically microseconds.
+// Values below LATENCY_HISTOGRAM_SUB_BUCKETS are exact; above that each power of two is
+// split into LATENCY_HISTOGRAM_SUB_BUCKETS linear buckets. record() is meant for a single
+// writer context and costs a few shifts and plain counter updates; readers may run
+// concurrently and see a slightly stale but never torn bucket.
+class LatencyHistogram {
+private:
+    std::atomic<uint32_t> buckets_[LATENCY_HISTOGRAM_BUCKETS];
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> min_;
+    std::atomic<uint32_t> max_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<bool> reset_pending_;
+
+    void clear();
+
+public:
+    LatencyHistogram();
+
+    // Writer side only
+    void record(uint32_t value);
+
+    uint32_t count() const;
+    uint32_t min() const;
+    uint32_t max() const;
+    uint32_t mean() const;
+    // Upper bound of the bucket holding the given percentile (0-100), clamped to max()
+    uint32_t value_at_percentile(float percentile) const;
+    latency_summary_t summary() const;
+
+    // Raw bucket access for export
+    uint32_t bucket(size_t index) const;
+    static size_t bucket_index(uint32_t value);
+    static uint32_t bucket_upper_bound(size_t index);
+
+    // Applied by the writer on its next record(); reads report empty until then
+    void reset();
+    void print(const char* tag, const char* name) const;
+};
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <esp_event.h>
 #include <esp_log.h>
 #include "freertos/FreeRTOS.h"
@@ -9,6 +11,9 @@
 #include "esp_now_manager.hpp"
 #include "test_framework.hpp"
 #include "performance_tests.hpp"
+#include "result_export.hpp"
+#include "benchmark_runner.hpp"
+#include "flash_log.hpp"
 
 static const char *TAG = "main";
 
@@ -16,6 +21,7 @@ static const char *TAG = "main";
 static ESPNowManager* esp_now_manager = nullptr;
 static TestFramework* test_framework = nullptr;
 static PerformanceTests* performance_tests = nullptr;
+static FlashLog* flash_log = nullptr;
 
 // Test configuration
 static test_role_t current_role = TEST_ROLE_PEER;
@@ -25,78 +31,32 @@ static uint64_t system_boot_time_us = 0;
 static uint64_t discovery_start_time_us = 0;
 static bool discovery_timing_active = false;
 
-// Task handles for background operations
-static TaskHandle_t discovery_task_handle = nullptr;
-static TaskHandle_t peer_cleanup_task_handle = nullptr;
-
 // ---- Background Tasks ----
 
-// Continuous discovery task - handles dynamic peer discovery
-static void continuous_discovery_task(void *arg) {
-    (void)arg;
-
-    const uint32_t DISCOVERY_INTERVAL_MS = 1000;      // Send discovery every 1 seconds
-    const uint32_t DISCOVERY_BURST_COUNT = 3;         // Send 3 discovery packets in a burst
-    const uint32_t DISCOVERY_BURST_INTERVAL_MS = 250; // 250ms between burst packets
-
-    ESP_LOGI(TAG, "Continuous discovery task started");
-
-    TickType_t last_discovery_time = 0;
-
-    while (true) {
-        TickType_t current_time = xTaskGetTickCount();
-
-        // Check if it's time for a discovery cycle
-        if ((current_time - last_discovery_time) >= pdMS_TO_TICKS(DISCOVERY_INTERVAL_MS)) {
-            ESP_LOGD(TAG, "Starting discovery burst cycle");
-
-            // Send discovery burst
-            for (uint32_t i = 0; i < DISCOVERY_BURST_COUNT; i++) {
-                esp_err_t ret = esp_now_manager->send_discovery_request();
-                if (ret != ESP_OK) {
-                    ESP_LOGW(TAG, "Discovery request failed: %s", esp_err_to_name(ret));
-                }
-
-                if (i < DISCOVERY_BURST_COUNT - 1) {
-                    vTaskDelay(pdMS_TO_TICKS(DISCOVERY_BURST_INTERVAL_MS));
-                }
-            }
-
-            last_discovery_time = current_time;
+// Summarizes what earlier runs left in the soak log (full dump: tools/decode_flash_log.py)
+static void report_flash_log_history() {
+    uint32_t records = 0;
+    uint32_t boots = 0;
+    uint32_t last_boot = 0;
+    bool have_summary = false;
+    flash_log_stability_summary_t summary = {};
+
+    flash_log->replay([&](uint32_t boot, const flash_log_record_header_t& header, const uint8_t* payload) {
+        records++;
+        if (boot != last_boot) {
+            boots++;
+            last_boot = boot;
         }
-
-        // Sleep for a short time before next check
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-}
-
-// Peer cleanup task - removes stale peers that haven't been seen recently
-static void peer_cleanup_task(void *arg) {
-    (void)arg;
-
-    const uint32_t CLEANUP_INTERVAL_MS = 30000;    // Check every 30 seconds
-    const uint64_t PEER_TIMEOUT_US = 60000000;     // Remove peers not seen for 60 seconds
-
-    ESP_LOGI(TAG, "Peer cleanup task started");
-
-    while (true) {
-        vTaskDelay(pdMS_TO_TICKS(CLEANUP_INTERVAL_MS));
-
-        auto peers = esp_now_manager->get_peers();
-        uint64_t current_time_us = esp_timer_get_time();
-
-        for (const auto& peer : peers) {
-            if ((current_time_us - peer.last_seen_us) > PEER_TIMEOUT_US) {
-                ESP_LOGI(TAG, "Removing stale peer: %02x:%02x:%02x:%02x:%02x:%02x (last seen %.1f seconds ago)",
-                         peer.mac_addr[0], peer.mac_addr[1], peer.mac_addr[2],
-                         peer.mac_addr[3], peer.mac_addr[4], peer.mac_addr[5],
-                         (current_time_us - peer.last_seen_us) / 1000000.0f);
-
-                esp_now_manager->remove_peer(peer.mac_addr);
-            }
+        if (header.type == FLASH_LOG_RECORD_STABILITY_SUMMARY && header.length >= sizeof(summary)) {
+            memcpy(&summary, payload, sizeof(summary));
+            have_summary = true;
         }
+    });
 
-        ESP_LOGD(TAG, "Peer cleanup completed, %zu active peers", esp_now_manager->get_peer_count());
+    ESP_LOGI(TAG, "Flash log: %lu records from %lu boots", records, boots);
+    if (have_summary) {
+        ESP_LOGI(TAG, "  Last stability run: %lu windows, %.2f%% uptime, %lu drops, RTT p99 %.2f ms",
+                 summary.windows, summary.uptime_percent, summary.connection_drops, summary.rtt_p99_ms);
     }
 }
 
@@ -117,10 +77,32 @@ void setup() {
     }
     ESP_ERROR_CHECK(ret);
 
+    // Soak-test log survives reboots and serial disconnects
+    flash_log = new FlashLog();
+    if (flash_log->initialize() == ESP_OK) {
+        report_flash_log_history();
+    } else {
+        delete flash_log;
+        flash_log = nullptr;
+    }
+
     ESP_LOGI(TAG, "Initializing ESP-NOW Manager for 5GHz operation");
 
     // Initialize ESP-NOW Manager
     esp_now_manager = &ESPNowManager::get_instance();
+
+#if CONFIG_ESPNOW_SECURITY_ENABLE
+    // A well-known key protects nothing; do not come up pretending to be secured
+    if (strlen(CONFIG_ESPNOW_PMK) == 0 || strcmp(CONFIG_ESPNOW_PMK, "pmk1234567890123") == 0) {
+        ESP_LOGE(TAG, "Security is enabled without a PMK of its own; set CONFIG_ESPNOW_PMK");
+        return;
+    }
+    esp_now_security_config_t security = ESPNowManager::default_security_config();
+    security.enabled = true;
+    memcpy(security.pmk, CONFIG_ESPNOW_PMK, std::min(strlen(CONFIG_ESPNOW_PMK), sizeof(security.pmk)));
+    esp_now_manager->set_security_config(security);
+#endif
+
     ret = esp_now_manager->initialize(36); // 5GHz channel 36
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize ESP-NOW Manager: %s", esp_err_to_name(ret));
@@ -128,6 +110,18 @@ void setup() {
     }
 
     ESP_LOGI(TAG, "ESP-NOW Manager initialized successfully");
+
+#if CONFIG_ESPNOW_MESH_ENABLE
+    esp_now_mesh_config_t mesh = MeshRouter::default_config();
+    mesh.enabled = true;
+    mesh.max_hops = CONFIG_ESPNOW_MESH_MAX_HOPS;
+    esp_now_manager->get_mesh_router().set_config(mesh);
+#endif
+#if CONFIG_ESPNOW_POWER_BALANCED
+    esp_now_manager->get_power_manager().set_profile(ESP_NOW_POWER_BALANCED);
+#elif CONFIG_ESPNOW_POWER_LOW_POWER
+    esp_now_manager->get_power_manager().set_profile(ESP_NOW_POWER_LOW_POWER);
+#endif
     ESP_LOGI(TAG, "DEVICE_MAC: %02x:%02x:%02x:%02x:%02x:%02x",
              esp_now_manager->get_local_mac()[0], esp_now_manager->get_local_mac()[1],
              esp_now_manager->get_local_mac()[2], esp_now_manager->get_local_mac()[3],
@@ -153,6 +147,7 @@ void setup() {
 
     // Initialize Performance Tests
     performance_tests = new PerformanceTests(*test_framework, *esp_now_manager);
+    performance_tests->set_flash_log(flash_log);
 
     // Set up callbacks
     esp_now_manager->set_peer_discovered_callback([](const esp_now_peer_info_t* peer) {
@@ -175,25 +170,33 @@ void setup() {
         ESP_LOGI(TAG, "========================================");
     });
 
+    // Stale peers are removed by the manager at their expiry deadline
+    esp_now_manager->set_peer_lost_callback([](const esp_now_peer_info_t* peer) {
+        ESP_LOGI(TAG, "PEER_LOST: %02x:%02x:%02x:%02x:%02x:%02x (%zu peers left)",
+                 peer->mac_addr[0], peer->mac_addr[1], peer->mac_addr[2],
+                 peer->mac_addr[3], peer->mac_addr[4], peer->mac_addr[5],
+                 esp_now_manager->get_peer_count());
+    });
+
     test_framework->set_test_completed_callback([](const test_result_t& result) {
         ESP_LOGI(TAG, "Test completed: %s - %s",
-                 result.test_name.c_str(),
+                 result.test_name,
                  result.status == TEST_STATUS_COMPLETED ? "PASSED" : "FAILED");
     });
 
     // Start background tasks for continuous operations
-    ESP_LOGI(TAG, "Starting background discovery and cleanup tasks");
+    ESP_LOGI(TAG, "Starting background discovery");
 
-    // Create continuous discovery task
-    xTaskCreate(continuous_discovery_task, "esp_discovery", 3072, nullptr, 4, &discovery_task_handle);
-    if (!discovery_task_handle) {
-        ESP_LOGE(TAG, "Failed to create discovery task");
+    // Continuous adaptive discovery: fast while the peer set changes, backing off once stable
+    esp_err_t discovery_ret = esp_now_manager->start_discovery(0);
+    if (discovery_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start discovery: %s", esp_err_to_name(discovery_ret));
     }
 
-    // Create peer cleanup task
-    xTaskCreate(peer_cleanup_task, "peer_cleanup", 2048, nullptr, 3, &peer_cleanup_task_handle);
-    if (!peer_cleanup_task_handle) {
-        ESP_LOGE(TAG, "Failed to create peer cleanup task");
+    // Keep per-peer clock offsets fresh for one-way latency and scheduled test starts
+    esp_err_t sync_ret = esp_now_manager->get_time_sync().start_periodic(TIME_SYNC_DEFAULT_INTERVAL_MS);
+    if (sync_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start clock sync: %s", esp_err_to_name(sync_ret));
     }
 
     discovery_start_time_us = esp_timer_get_time();
@@ -233,8 +236,19 @@ void loop() {
         tests_running = true;
 
         if (current_role == TEST_ROLE_COORDINATOR) {
+#if CONFIG_ESPNOW_BENCHMARK_GATE
+            // Check the console capture against baselines with tools/compare_benchmarks.py
+            ESP_LOGI(TAG, "Running as COORDINATOR - Starting benchmark gate");
+            BenchmarkRunner runner(*test_framework, *esp_now_manager);
+            runner.run(BenchmarkRunner::default_suite(), ResultExporter::console_sink);
+#else
             ESP_LOGI(TAG, "Running as COORDINATOR - Starting full test suite");
             performance_tests->run_full_performance_suite();
+
+            // Decode the console capture with tools/decode_results.py
+            ESP_LOGI(TAG, "Exporting binary results to console");
+            test_framework->export_results_binary(ResultExporter::console_sink);
+#endif
         } else {
             ESP_LOGI(TAG, "Running as PEER - Waiting for coordinator commands");
         }
@@ -244,12 +258,40 @@ void loop() {
     if (loop_count % 10 == 0) {
         esp_now_statistics_t stats = esp_now_manager->get_statistics();
         ESP_LOGI(TAG, "ESP-NOW Statistics:");
-        ESP_LOGI(TAG, "  Packets sent: %lu, received: %lu, lost: %lu",
-                 stats.total_packets_sent, stats.total_packets_received, stats.total_packets_lost);
+        ESP_LOGI(TAG, "  Packets sent: %lu, received: %lu, lost: %lu, retries: %lu",
+                 stats.total_packets_sent, stats.total_packets_received, stats.total_packets_lost,
+                 stats.total_retries);
         ESP_LOGI(TAG, "  Bytes sent: %llu, received: %llu",
                  stats.total_bytes_sent, stats.total_bytes_received);
+        if (stats.batches_sent > 0) {
+            ESP_LOGI(TAG, "  Coalesced: %lu messages in %lu frames",
+                     stats.messages_coalesced, stats.batches_sent);
+        }
         ESP_LOGI(TAG, "  Discovery requests: %lu, responses: %lu",
                  stats.discovery_requests_sent, stats.discovery_responses_received);
+        ESP_LOGI(TAG, "  Drops: rx size %lu, rx no buffer %lu, rx queue %lu, crc %lu, length %lu, auth %lu, tx timeout %lu, tx done %lu",
+                 stats.rx_dropped_invalid_size, stats.rx_dropped_no_buffer, stats.rx_dropped_queue_full,
+                 stats.rx_crc_errors, stats.rx_length_errors, stats.rx_auth_failures,
+                 stats.tx_queue_timeouts, stats.tx_done_dropped);
+        ESP_LOGI(TAG, "  High water: rx queue %u, tx queue %u, tx done %u; rx callback max %lu us",
+                 stats.rx_queue_high_water, stats.tx_queue_high_water, stats.tx_done_queue_high_water,
+                 stats.rx_callback.max_us);
+        reliable_stats_t reliable = esp_now_manager->get_reliable_channel().get_stats();
+        ESP_LOGI(TAG, "  Reliable: %lu sent, %lu acked, %lu failed, %lu retransmitted",
+                 reliable.frames_sent, reliable.frames_acked, reliable.frames_failed, reliable.retransmissions);
+        ESP_LOGI(TAG, "  Reliable rx: %lu delivered, %lu duplicates, %lu out of order, %lu lost",
+                 reliable.frames_received, reliable.duplicates, reliable.out_of_order, reliable.frames_lost);
+        esp_now_tx_class_stats_t control = esp_now_manager->get_tx_class_stats(ESP_NOW_TX_CLASS_CONTROL);
+        esp_now_tx_class_stats_t bulk = esp_now_manager->get_tx_class_stats(ESP_NOW_TX_CLASS_BULK);
+        ESP_LOGI(TAG, "  Queue delay: control avg %lu us (max %lu), bulk avg %lu us (max %lu, %lu rejected)",
+                 control.queue_delay_avg_us, control.queue_delay_max_us,
+                 bulk.queue_delay_avg_us, bulk.queue_delay_max_us, bulk.rejected);
+        esp_now_mesh_stats_t mesh = esp_now_manager->get_mesh_router().get_stats();
+        if (mesh.routes > 0 || mesh.delivered > 0) {
+            ESP_LOGI(TAG, "  Mesh: %lu routes, %lu forwarded, %lu delivered, drops dup %lu ttl %lu route %lu busy %lu",
+                     mesh.routes, mesh.forwarded, mesh.delivered, mesh.dropped_duplicate, mesh.dropped_ttl,
+                     mesh.dropped_no_route, mesh.dropped_busy);
+        }
         ESP_LOGI(TAG, "  Active peers: %zu", esp_now_manager->get_peer_count());
     }
 
@@ -259,12 +301,19 @@ void loop() {
                  esp_now_manager->get_peer_count());
 
         // Demonstrate some basic tests periodically
-        if (current_role == TEST_ROLE_PEER && !esp_now_manager->get_peers().empty()) {
+        if (current_role == TEST_ROLE_PEER) {
             // Run a quick latency test as peer
-            auto peers = esp_now_manager->get_peers();
-            if (!peers.empty()) {
+            uint8_t first_mac[6];
+            bool have_peer = false;
+            esp_now_manager->for_each_peer([&](const esp_now_peer_info_t& peer) {
+                if (!have_peer) {
+                    memcpy(first_mac, peer.mac_addr, 6);
+                    have_peer = true;
+                }
+            });
+            if (have_peer) {
                 ESP_LOGI(TAG, "Running quick ping test to first peer");
-                esp_now_manager->send_ping(peers[0].mac_addr);
+                esp_now_manager->send_ping(first_mac);
             }
         }
     }
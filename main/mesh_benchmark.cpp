@@ -0,0 +1,633 @@
+#include "mesh_benchmark.hpp"
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <string.h>
+#include <algorithm>
+
+#define BENCH_EVENT_ARMED (1 << 0)
+#define BENCH_EVENT_READY (1 << 1)
+#define BENCH_EVENT_REPORT (1 << 2)
+
+static const char* format_mac(const uint8_t* mac, char* buf, size_t len) {
+    snprintf(buf, len, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buf;
+}
+
+MeshBenchmark::MeshBenchmark(ESPNowManager& manager)
+    : manager_(manager), events_(nullptr), assigned_(false), armed_run_id_(0),
+      start_at_us_(0), run_duration_ms_(0), stop_requested_(false), frames_sent_(0),
+      send_failures_(0), next_run_id_(0), awaiting_run_id_(0), report_len_(0) {
+    memset(&assignment_, 0, sizeof(assignment_));
+    memset(rx_flows_, 0, sizeof(rx_flows_));
+    memset(awaiting_mac_, 0, sizeof(awaiting_mac_));
+}
+
+MeshBenchmark::~MeshBenchmark() {
+    deinitialize();
+}
+
+esp_err_t MeshBenchmark::initialize() {
+    if (events_) {
+        return ESP_OK;
+    }
+
+    events_ = xEventGroupCreate();
+    if (!events_) {
+        ESP_LOGE(MESH_BENCHMARK_TAG, "Failed to create benchmark event group");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Nonzero and different per boot, so stale frames from an earlier run never match
+    next_run_id_ = (esp_random() & 0xFFFF) | 1;
+    return ESP_OK;
+}
+
+void MeshBenchmark::deinitialize() {
+    stop_requested_ = true;
+    if (events_) {
+        vEventGroupDelete(events_);
+        events_ = nullptr;
+    }
+    assigned_ = false;
+}
+
+bool MeshBenchmark::is_local(const uint8_t* mac_addr) {
+    return memcmp(mac_addr, manager_.get_local_mac(), 6) == 0;
+}
+
+void MeshBenchmark::handle_message(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!events_) {
+        return;
+    }
+
+    switch (msg->msg_type) {
+        case ESP_NOW_MSG_TYPE_TEST_DATA:      handle_data(mac_addr, msg); break;
+        case ESP_NOW_MSG_TYPE_TEST_START:     handle_start(msg); break;
+        case ESP_NOW_MSG_TYPE_TEST_STOP:      handle_stop(msg); break;
+        case ESP_NOW_MSG_TYPE_BENCH_ASSIGN:   handle_assign(mac_addr, msg); break;
+        case ESP_NOW_MSG_TYPE_BENCH_READY:    handle_ready(mac_addr, msg); break;
+        case ESP_NOW_MSG_TYPE_BENCH_ECHO:     handle_echo(msg); break;
+        case ESP_NOW_MSG_TYPE_BENCH_COLLECT:  handle_collect(mac_addr, msg); break;
+        case ESP_NOW_MSG_TYPE_BENCH_REPORT:   handle_report(mac_addr, msg); break;
+        default: break;
+    }
+}
+
+// ---- Participant side ----
+
+void MeshBenchmark::apply_assignment(const esp_now_bench_assign_t& assignment) {
+    stop_requested_ = true;  // A new assignment cancels whatever was still sending
+
+    assignment_ = assignment;
+    memset(rx_flows_, 0, sizeof(rx_flows_));
+    frames_sent_ = 0;
+    send_failures_ = 0;
+    rtt_.reset();
+    armed_run_id_ = 0;
+    assigned_ = true;
+
+    if ((assignment.roles & ESP_NOW_BENCH_ROLE_SEND) && !manager_.is_peer_registered(assignment.dst_mac)) {
+        manager_.add_peer(assignment.dst_mac);
+    }
+
+    ESP_LOGI(MESH_BENCHMARK_TAG, "Run %04x assigned: %s%s, %u byte frames for %lu ms",
+             assignment.run_id,
+             (assignment.roles & ESP_NOW_BENCH_ROLE_SEND) ? "send " : "",
+             (assignment.roles & ESP_NOW_BENCH_ROLE_RECEIVE) ? "receive" : "",
+             assignment.payload_len, assignment.duration_ms);
+}
+
+void MeshBenchmark::arm(uint16_t run_id, uint64_t start_at_us, uint32_t duration_ms) {
+    start_at_us_ = start_at_us;
+    run_duration_ms_ = duration_ms;
+    stop_requested_ = false;
+    armed_run_id_ = run_id;
+    xEventGroupSetBits(events_, BENCH_EVENT_ARMED);
+}
+
+void MeshBenchmark::handle_assign(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_assign_t)) {
+        return;
+    }
+
+    esp_now_bench_assign_t assignment;
+    memcpy(&assignment, msg->payload, sizeof(assignment));
+    apply_assignment(assignment);
+
+    esp_now_bench_ref_t ready = {assignment.run_id};
+    manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BENCH_READY, (const uint8_t*)&ready, sizeof(ready),
+                          pdMS_TO_TICKS(10));
+}
+
+void MeshBenchmark::handle_start(const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_start_t)) {
+        return;  // Plain session start from start_test_session()
+    }
+
+    esp_now_bench_start_t start;
+    memcpy(&start, msg->payload, sizeof(start));
+    if (!assigned_ || start.run_id != assignment_.run_id || armed_run_id_ == start.run_id) {
+        return;
+    }
+
+    arm(start.run_id, esp_timer_get_time() + start.start_delay_us, start.duration_ms);
+}
+
+void MeshBenchmark::handle_stop(const esp_now_message_t* msg) {
+    if (msg->payload_length >= sizeof(esp_now_bench_ref_t)) {
+        esp_now_bench_ref_t ref;
+        memcpy(&ref, msg->payload, sizeof(ref));
+        if (!assigned_ || ref.run_id != assignment_.run_id) {
+            return;
+        }
+    }
+    stop_requested_ = true;
+}
+
+void MeshBenchmark::handle_data(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_data_t) || !assigned_ ||
+        !(assignment_.roles & ESP_NOW_BENCH_ROLE_RECEIVE)) {
+        return;
+    }
+
+    esp_now_bench_data_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+    if (header.run_id != assignment_.run_id) {
+        return;
+    }
+
+    rx_flow_t* flow = nullptr;
+    for (auto& candidate : rx_flows_) {
+        if (candidate.in_use && memcmp(candidate.src_mac, mac_addr, 6) == 0) {
+            flow = &candidate;
+            break;
+        }
+        if (!candidate.in_use && !flow) {
+            flow = &candidate;
+        }
+    }
+    if (!flow) {
+        return;
+    }
+
+    uint64_t now = esp_timer_get_time();
+    if (!flow->in_use) {
+        flow->in_use = true;
+        memcpy(flow->src_mac, mac_addr, 6);
+        flow->first_rx_us = now;
+    }
+    flow->frames++;
+    flow->bytes += msg->payload_length;
+    flow->max_seq = std::max(flow->max_seq, header.seq);
+    flow->last_rx_us = now;
+
+    if (header.flags & ESP_NOW_BENCH_FLAG_ECHO) {
+        manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BENCH_ECHO, msg->payload, sizeof(header), 0);
+    }
+}
+
+void MeshBenchmark::handle_echo(const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_data_t) || !assigned_) {
+        return;
+    }
+
+    esp_now_bench_data_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+    if (header.run_id == assignment_.run_id) {
+        rtt_.record(esp_timer_get_time() - header.tx_timestamp_us);
+    }
+}
+
+void MeshBenchmark::handle_collect(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_ref_t) || !assigned_) {
+        return;
+    }
+
+    esp_now_bench_ref_t ref;
+    memcpy(&ref, msg->payload, sizeof(ref));
+    if (ref.run_id != assignment_.run_id) {
+        return;
+    }
+
+    uint8_t report[ESP_NOW_MAX_PAYLOAD_LEN];
+    size_t len = build_report(ref.run_id, report, sizeof(report));
+    manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_BENCH_REPORT, report, len, pdMS_TO_TICKS(10));
+}
+
+size_t MeshBenchmark::build_report(uint16_t run_id, uint8_t* out, size_t capacity) const {
+    esp_now_bench_report_t report = {};
+    report.run_id = run_id;
+    report.roles = assignment_.roles;
+    report.frames_sent = frames_sent_.load();
+    report.send_failures = send_failures_.load();
+
+    latency_summary_t rtt = rtt_.summary();
+    report.rtt_samples = rtt.count;
+    report.rtt_p50_us = rtt.p50;
+    report.rtt_p99_us = rtt.p99;
+    report.rtt_max_us = rtt.max;
+
+    size_t offset = sizeof(report);
+    for (const auto& flow : rx_flows_) {
+        if (!flow.in_use || offset + sizeof(esp_now_bench_flow_report_t) > capacity) {
+            continue;
+        }
+        esp_now_bench_flow_report_t entry;
+        memcpy(entry.src_mac, flow.src_mac, 6);
+        entry.frames = flow.frames;
+        entry.bytes = flow.bytes;
+        entry.max_seq = flow.max_seq;
+        entry.active_us = flow.last_rx_us - flow.first_rx_us;
+        memcpy(out + offset, &entry, sizeof(entry));
+        offset += sizeof(entry);
+        report.flow_count++;
+    }
+
+    memcpy(out, &report, sizeof(report));
+    return offset;
+}
+
+esp_err_t MeshBenchmark::service(TickType_t wait_ticks) {
+    if (!events_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(events_, BENCH_EVENT_ARMED, pdTRUE, pdFALSE, wait_ticks);
+    if (!(bits & BENCH_EVENT_ARMED)) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_now_bench_assign_t assignment = assignment_;
+    if (assignment.roles & ESP_NOW_BENCH_ROLE_SEND) {
+        run_sender(assignment, start_at_us_, run_duration_ms_);
+    }
+    return ESP_OK;
+}
+
+void MeshBenchmark::run_sender(const esp_now_bench_assign_t& assignment, uint64_t start_at_us,
+                               uint32_t duration_ms) {
+    int64_t wait_us = (int64_t)(start_at_us - esp_timer_get_time());
+    if (wait_us > 1000) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+    }
+    while (esp_timer_get_time() < start_at_us && !stop_requested_) {
+    }
+
+    size_t len = std::min((size_t)assignment.payload_len, manager_.get_max_payload_len(assignment.dst_mac));
+    if (len < sizeof(esp_now_bench_data_t)) {
+        return;
+    }
+    std::vector<uint8_t> payload(len, 0x5A);
+
+    esp_now_bench_data_t header = {};
+    header.run_id = assignment.run_id;
+    uint64_t echo_interval_us = (uint64_t)assignment.echo_interval_ms * 1000;
+    uint64_t last_echo_us = 0;
+    uint64_t end_us = start_at_us + (uint64_t)duration_ms * 1000;
+
+    // Paced only by the flow-control window, so senders contend for the channel
+    uint64_t now;
+    while (!stop_requested_ && (now = esp_timer_get_time()) < end_us) {
+        bool echo = echo_interval_us > 0 && now - last_echo_us >= echo_interval_us;
+        header.flags = echo ? ESP_NOW_BENCH_FLAG_ECHO : 0;
+        header.tx_timestamp_us = now;
+        memcpy(payload.data(), &header, sizeof(header));
+
+        esp_err_t ret = manager_.send_message(assignment.dst_mac, ESP_NOW_MSG_TYPE_TEST_DATA,
+                                              payload.data(), payload.size(), pdMS_TO_TICKS(20));
+        if (ret == ESP_OK) {
+            frames_sent_++;
+            header.seq++;
+            if (echo) {
+                last_echo_us = now;
+            }
+        } else if (ret != ESP_ERR_TIMEOUT) {
+            send_failures_++;
+            vTaskDelay(1);
+        }
+    }
+}
+
+// ---- Coordinator side ----
+
+void MeshBenchmark::handle_ready(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_ref_t)) {
+        return;
+    }
+
+    esp_now_bench_ref_t ref;
+    memcpy(&ref, msg->payload, sizeof(ref));
+    if (ref.run_id == awaiting_run_id_ && memcmp(mac_addr, awaiting_mac_, 6) == 0) {
+        xEventGroupSetBits(events_, BENCH_EVENT_READY);
+    }
+}
+
+void MeshBenchmark::handle_report(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_bench_report_t) || msg->payload_length > sizeof(report_buffer_)) {
+        return;
+    }
+
+    esp_now_bench_report_t report;
+    memcpy(&report, msg->payload, sizeof(report));
+    if (report.run_id == awaiting_run_id_ && memcmp(mac_addr, awaiting_mac_, 6) == 0) {
+        memcpy(report_buffer_, msg->payload, msg->payload_length);
+        report_len_ = msg->payload_length;
+        xEventGroupSetBits(events_, BENCH_EVENT_REPORT);
+    }
+}
+
+esp_err_t MeshBenchmark::request(const uint8_t* mac_addr, esp_now_msg_type_t msg_type, uint16_t run_id,
+                                 const void* payload, size_t len, EventBits_t reply_bit) {
+    memcpy(awaiting_mac_, mac_addr, 6);
+    awaiting_run_id_ = run_id;
+
+    for (int attempt = 0; attempt < BENCH_CONTROL_RETRIES; attempt++) {
+        xEventGroupClearBits(events_, reply_bit);
+        if (manager_.send_message(mac_addr, msg_type, (const uint8_t*)payload, len, pdMS_TO_TICKS(50)) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        EventBits_t bits = xEventGroupWaitBits(events_, reply_bit, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(BENCH_CONTROL_TIMEOUT_MS));
+        if (bits & reply_bit) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t MeshBenchmark::run(const bench_plan_t& plan, bench_run_result_t* result) {
+    if (!events_ || !result) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (plan.flow_count == 0 || plan.flow_count > BENCH_MAX_FLOWS || plan.duration_ms == 0 ||
+        plan.payload_len < sizeof(esp_now_bench_data_t) || plan.payload_len > ESP_NOW_MAX_PAYLOAD_LEN_V2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    typedef struct {
+        uint8_t mac[6];
+        esp_now_bench_assign_t assignment;
+        size_t report_len;
+        uint8_t report[ESP_NOW_MAX_PAYLOAD_LEN];
+    } node_t;
+
+    uint16_t run_id = next_run_id_;
+    next_run_id_ = next_run_id_ == 0xFFFF ? 1 : next_run_id_ + 1;
+
+    std::vector<node_t> nodes;
+    auto find_node = [&nodes](const uint8_t* mac) -> node_t* {
+        for (auto& node : nodes) {
+            if (memcmp(node.mac, mac, 6) == 0) {
+                return &node;
+            }
+        }
+        return nullptr;
+    };
+    auto add_node = [&](const uint8_t* mac) -> node_t* {
+        node_t* node = find_node(mac);
+        if (!node) {
+            node_t fresh = {};
+            memcpy(fresh.mac, mac, 6);
+            fresh.assignment.run_id = run_id;
+            fresh.assignment.payload_len = plan.payload_len;
+            fresh.assignment.duration_ms = plan.duration_ms;
+            fresh.assignment.echo_interval_ms = BENCH_ECHO_INTERVAL_MS;
+            nodes.push_back(fresh);
+            node = &nodes.back();
+        }
+        return node;
+    };
+
+    nodes.reserve(plan.flow_count * 2);
+    for (size_t i = 0; i < plan.flow_count; i++) {
+        const bench_flow_t& flow = plan.flows[i];
+        if (memcmp(flow.src_mac, flow.dst_mac, 6) == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        node_t* src = add_node(flow.src_mac);
+        if (src->assignment.roles & ESP_NOW_BENCH_ROLE_SEND) {
+            return ESP_ERR_INVALID_ARG;  // One outgoing flow per node
+        }
+        src->assignment.roles |= ESP_NOW_BENCH_ROLE_SEND;
+        memcpy(src->assignment.dst_mac, flow.dst_mac, 6);
+        add_node(flow.dst_mac)->assignment.roles |= ESP_NOW_BENCH_ROLE_RECEIVE;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->run_id = run_id;
+    result->payload_len = plan.payload_len;
+    result->duration_ms = plan.duration_ms;
+    result->flow_count = plan.flow_count;
+    result->nodes = nodes.size();
+
+    ESP_LOGI(MESH_BENCHMARK_TAG, "Run %04x: %zu flows over %zu nodes, %u byte frames, %lu ms",
+             run_id, plan.flow_count, nodes.size(), plan.payload_len, plan.duration_ms);
+
+    // Assign roles; the coordinator's own share is applied directly
+    bool local_participates = false;
+    esp_now_bench_ref_t ref = {run_id};
+    for (auto& node : nodes) {
+        if (is_local(node.mac)) {
+            apply_assignment(node.assignment);
+            local_participates = true;
+            continue;
+        }
+        if (request(node.mac, ESP_NOW_MSG_TYPE_BENCH_ASSIGN, run_id, &node.assignment,
+                    sizeof(node.assignment), BENCH_EVENT_READY) != ESP_OK) {
+            char mac_str[18];
+            ESP_LOGE(MESH_BENCHMARK_TAG, "Node %s did not accept run %04x",
+                     format_mac(node.mac, mac_str, sizeof(mac_str)), run_id);
+            manager_.send_broadcast(ESP_NOW_MSG_TYPE_TEST_STOP, (const uint8_t*)&ref, sizeof(ref));
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    // One broadcast frame is the common time reference; the repeat covers a lost frame
+    const uint32_t start_delay_us = BENCH_START_DELAY_MS * 1000;
+    esp_now_bench_start_t start = {run_id, start_delay_us, plan.duration_ms};
+    uint64_t t0 = esp_timer_get_time();
+    manager_.send_broadcast(ESP_NOW_MSG_TYPE_TEST_START, (const uint8_t*)&start, sizeof(start));
+    if (local_participates) {
+        arm(run_id, t0 + start_delay_us, plan.duration_ms);
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+    uint64_t elapsed_us = esp_timer_get_time() - t0;
+    if (elapsed_us < start_delay_us) {
+        start.start_delay_us = start_delay_us - elapsed_us;
+        manager_.send_broadcast(ESP_NOW_MSG_TYPE_TEST_START, (const uint8_t*)&start, sizeof(start));
+    }
+
+    uint64_t collect_at = t0 + start_delay_us + ((uint64_t)plan.duration_ms + BENCH_DRAIN_MS) * 1000;
+    int64_t remaining_us = (int64_t)(collect_at - esp_timer_get_time());
+    if (remaining_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS(remaining_us / 1000));
+    }
+    manager_.send_broadcast(ESP_NOW_MSG_TYPE_TEST_STOP, (const uint8_t*)&ref, sizeof(ref));
+
+    for (auto& node : nodes) {
+        if (is_local(node.mac)) {
+            node.report_len = build_report(run_id, node.report, sizeof(node.report));
+        } else if (request(node.mac, ESP_NOW_MSG_TYPE_BENCH_COLLECT, run_id, &ref, sizeof(ref),
+                           BENCH_EVENT_REPORT) == ESP_OK) {
+            node.report_len = std::min(report_len_, sizeof(node.report));
+            memcpy(node.report, report_buffer_, node.report_len);
+        }
+        if (node.report_len >= sizeof(esp_now_bench_report_t)) {
+            result->nodes_reporting++;
+        }
+    }
+
+    // Join both ends of every flow
+    uint32_t flows_reported = 0;
+    for (size_t i = 0; i < plan.flow_count; i++) {
+        bench_flow_result_t& flow = result->flows[i];
+        memcpy(flow.src_mac, plan.flows[i].src_mac, 6);
+        memcpy(flow.dst_mac, plan.flows[i].dst_mac, 6);
+
+        node_t* src = find_node(flow.src_mac);
+        node_t* dst = find_node(flow.dst_mac);
+        if (src->report_len < sizeof(esp_now_bench_report_t) || dst->report_len < sizeof(esp_now_bench_report_t)) {
+            continue;
+        }
+
+        esp_now_bench_report_t sender;
+        memcpy(&sender, src->report, sizeof(sender));
+        flow.frames_sent = sender.frames_sent;
+        flow.send_failures = sender.send_failures;
+        flow.rtt_samples = sender.rtt_samples;
+        flow.rtt_p50_us = sender.rtt_p50_us;
+        flow.rtt_p99_us = sender.rtt_p99_us;
+        flow.rtt_max_us = sender.rtt_max_us;
+
+        esp_now_bench_report_t receiver;
+        memcpy(&receiver, dst->report, sizeof(receiver));
+        for (uint8_t f = 0; f < receiver.flow_count; f++) {
+            size_t offset = sizeof(receiver) + f * sizeof(esp_now_bench_flow_report_t);
+            if (offset + sizeof(esp_now_bench_flow_report_t) > dst->report_len) {
+                break;
+            }
+            esp_now_bench_flow_report_t entry;
+            memcpy(&entry, dst->report + offset, sizeof(entry));
+            if (memcmp(entry.src_mac, flow.src_mac, 6) == 0) {
+                flow.frames_received = entry.frames;
+                flow.bytes_received = entry.bytes;
+                break;
+            }
+        }
+
+        flow.reported = true;
+        flow.goodput_kbps = (float)flow.bytes_received * 8.0f / plan.duration_ms;
+        flow.loss_percent = flow.frames_sent > 0 ?
+            (1.0f - (float)std::min(flow.frames_received, flow.frames_sent) / flow.frames_sent) * 100.0f : 0.0f;
+
+        result->aggregate_goodput_kbps += flow.goodput_kbps;
+        result->mean_loss_percent += flow.loss_percent;
+        flows_reported++;
+    }
+    if (flows_reported > 0) {
+        result->mean_loss_percent /= flows_reported;
+    }
+
+    return flows_reported == plan.flow_count ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+void MeshBenchmark::print_run(const bench_run_result_t& result) {
+    ESP_LOGI(MESH_BENCHMARK_TAG, "Run %04x: %zu flows, %u byte frames, %lu ms, %lu/%lu nodes reported",
+             result.run_id, result.flow_count, result.payload_len, result.duration_ms,
+             result.nodes_reporting, result.nodes);
+    ESP_LOGI(MESH_BENCHMARK_TAG, "  %-17s    %-17s %8s %8s %7s %10s %16s",
+             "SRC", "DST", "SENT", "RECV", "LOSS%", "KBPS", "RTT p50/p99 ms");
+
+    for (size_t i = 0; i < result.flow_count; i++) {
+        const bench_flow_result_t& flow = result.flows[i];
+        char src[18], dst[18];
+        format_mac(flow.src_mac, src, sizeof(src));
+        format_mac(flow.dst_mac, dst, sizeof(dst));
+        if (!flow.reported) {
+            ESP_LOGW(MESH_BENCHMARK_TAG, "  %s -> %s   (no report)", src, dst);
+            continue;
+        }
+        ESP_LOGI(MESH_BENCHMARK_TAG, "  %s -> %s %8lu %8lu %7.2f %10.1f %7.2f/%-7.2f",
+                 src, dst, flow.frames_sent, flow.frames_received, flow.loss_percent, flow.goodput_kbps,
+                 flow.rtt_p50_us / 1000.0f, flow.rtt_p99_us / 1000.0f);
+    }
+
+    ESP_LOGI(MESH_BENCHMARK_TAG, "  Aggregate goodput %.1f kbps, mean loss %.2f%%",
+             result.aggregate_goodput_kbps, result.mean_loss_percent);
+}
+
+esp_err_t MeshBenchmark::run_scaling_sweep(const std::vector<esp_now_peer_info_t>& peers, bool include_local,
+                                           const std::vector<uint16_t>& payload_sizes, uint32_t duration_ms) {
+    std::vector<const uint8_t*> nodes;
+    if (include_local) {
+        nodes.push_back(manager_.get_local_mac());
+    }
+    for (const auto& peer : peers) {
+        if (nodes.size() >= BENCH_MAX_FLOWS) {
+            break;
+        }
+        nodes.push_back(peer.mac_addr);
+    }
+    if (nodes.size() < 2 || payload_sizes.empty()) {
+        ESP_LOGW(MESH_BENCHMARK_TAG, "Scaling sweep needs at least two nodes and one payload size");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t columns = payload_sizes.size();
+    std::vector<float> goodput(nodes.size() * columns, 0.0f);
+    std::vector<float> loss(nodes.size() * columns, 0.0f);
+    std::vector<bool> valid(nodes.size() * columns, false);
+
+    bench_run_result_t result;
+    for (size_t senders = 1; senders <= nodes.size(); senders++) {
+        for (size_t p = 0; p < columns; p++) {
+            bench_plan_t plan = {};
+            plan.flow_count = senders;
+            plan.payload_len = payload_sizes[p];
+            plan.duration_ms = duration_ms;
+            for (size_t i = 0; i < senders; i++) {
+                memcpy(plan.flows[i].src_mac, nodes[i], 6);
+                memcpy(plan.flows[i].dst_mac, nodes[(i + 1) % nodes.size()], 6);
+            }
+
+            esp_err_t ret = run(plan, &result);
+            if (ret == ESP_OK || ret == ESP_ERR_INVALID_RESPONSE) {
+                print_run(result);
+                size_t cell = (senders - 1) * columns + p;
+                goodput[cell] = result.aggregate_goodput_kbps;
+                loss[cell] = result.mean_loss_percent;
+                valid[cell] = ret == ESP_OK;
+            } else {
+                ESP_LOGW(MESH_BENCHMARK_TAG, "Run with %zu senders, %u bytes failed: %s",
+                         senders, payload_sizes[p], esp_err_to_name(ret));
+            }
+            vTaskDelay(pdMS_TO_TICKS(200));
+        }
+    }
+
+    // Senders x payload size; each cell is aggregate goodput kbps / mean loss %
+    char line[160];
+    int pos = snprintf(line, sizeof(line), "%8s", "senders");
+    for (size_t p = 0; p < columns && pos < (int)sizeof(line); p++) {
+        pos += snprintf(line + pos, sizeof(line) - pos, " %8uB %6s", payload_sizes[p], "loss");
+    }
+    ESP_LOGI(MESH_BENCHMARK_TAG, "========== MESH CAPACITY (%zu nodes, %lu ms runs) ==========",
+             nodes.size(), duration_ms);
+    ESP_LOGI(MESH_BENCHMARK_TAG, "%s", line);
+    for (size_t senders = 1; senders <= nodes.size(); senders++) {
+        pos = snprintf(line, sizeof(line), "%8zu", senders);
+        for (size_t p = 0; p < columns && pos < (int)sizeof(line); p++) {
+            size_t cell = (senders - 1) * columns + p;
+            if (valid[cell]) {
+                pos += snprintf(line + pos, sizeof(line) - pos, " %9.1f %5.1f%%", goodput[cell], loss[cell]);
+            } else {
+                pos += snprintf(line + pos, sizeof(line) - pos, " %9s %6s", "-", "-");
+            }
+        }
+        ESP_LOGI(MESH_BENCHMARK_TAG, "%s", line);
+    }
+    ESP_LOGI(MESH_BENCHMARK_TAG, "Goodput in kbps summed over all flows");
+
+    return ESP_OK;
+}
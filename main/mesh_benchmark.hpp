@@ -0,0 +1,141 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "esp_now_manager.hpp"
+#include "latency_histogram.hpp"
+
+#define MESH_BENCHMARK_TAG "MESH_BENCH"
+#define BENCH_MAX_FLOWS 8
+#define BENCH_START_DELAY_MS 300        // Lead time between TEST_START and the first frame
+#define BENCH_CONTROL_TIMEOUT_MS 250    // Per attempt, for READY and REPORT
+#define BENCH_CONTROL_RETRIES 3
+#define BENCH_DRAIN_MS 500              // After the run, for frames still in flight
+#define BENCH_ECHO_INTERVAL_MS 50
+
+typedef struct {
+    uint8_t src_mac[6];
+    uint8_t dst_mac[6];
+} bench_flow_t;
+
+// Each node sends at most one flow; a node may receive several
+typedef struct {
+    bench_flow_t flows[BENCH_MAX_FLOWS];
+    size_t flow_count;
+    uint16_t payload_len;
+    uint32_t duration_ms;
+} bench_plan_t;
+
+typedef struct {
+    uint8_t src_mac[6];
+    uint8_t dst_mac[6];
+    bool reported;               // Both ends answered BENCH_COLLECT
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t bytes_received;
+    uint32_t send_failures;
+    float goodput_kbps;
+    float loss_percent;
+    uint32_t rtt_samples;
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+    uint32_t rtt_max_us;
+} bench_flow_result_t;
+
+typedef struct {
+    uint16_t run_id;
+    uint16_t payload_len;
+    uint32_t duration_ms;
+    size_t flow_count;
+    bench_flow_result_t flows[BENCH_MAX_FLOWS];
+    uint32_t nodes;
+    uint32_t nodes_reporting;
+    float aggregate_goodput_kbps;
+    float mean_loss_percent;
+} bench_run_result_t;
+
+// Coordinator-driven multi-node benchmark. Every node (coordinator included) measures
+// its own share: senders count frames sent and RTT from echoed frames, receivers count
+// what actually arrived per sender. The coordinator collects both ends of every flow.
+class MeshBenchmark {
+private:
+    typedef struct {
+        bool in_use;
+        uint8_t src_mac[6];
+        uint32_t frames;
+        uint32_t bytes;
+        uint32_t max_seq;
+        uint64_t first_rx_us;
+        uint64_t last_rx_us;
+    } rx_flow_t;
+
+    ESPNowManager& manager_;
+    EventGroupHandle_t events_;
+
+    // Participant state. Assignment and rx flows are written by the receive task (or by
+    // the coordinator's task for its own share, before any traffic flows).
+    esp_now_bench_assign_t assignment_;
+    bool assigned_;
+    uint16_t armed_run_id_;
+    uint64_t start_at_us_;
+    uint32_t run_duration_ms_;
+    std::atomic<bool> stop_requested_;
+    rx_flow_t rx_flows_[BENCH_MAX_FLOWS];
+    std::atomic<uint32_t> frames_sent_;
+    std::atomic<uint32_t> send_failures_;
+    LatencyHistogram rtt_;       // Receive task only
+
+    // Coordinator state
+    uint16_t next_run_id_;
+    uint8_t awaiting_mac_[6];
+    uint16_t awaiting_run_id_;
+    uint8_t report_buffer_[ESP_NOW_MAX_PAYLOAD_LEN];
+    size_t report_len_;
+
+    void apply_assignment(const esp_now_bench_assign_t& assignment);
+    void arm(uint16_t run_id, uint64_t start_at_us, uint32_t duration_ms);
+    size_t build_report(uint16_t run_id, uint8_t* out, size_t capacity) const;
+    void run_sender(const esp_now_bench_assign_t& assignment, uint64_t start_at_us, uint32_t duration_ms);
+
+    void handle_assign(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_start(const esp_now_message_t* msg);
+    void handle_stop(const esp_now_message_t* msg);
+    void handle_data(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_echo(const esp_now_message_t* msg);
+    void handle_collect(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_ready(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_report(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    esp_err_t request(const uint8_t* mac_addr, esp_now_msg_type_t msg_type, uint16_t run_id,
+                      const void* payload, size_t len, EventBits_t reply_bit);
+    bool is_local(const uint8_t* mac_addr);
+
+public:
+    explicit MeshBenchmark(ESPNowManager& manager);
+    ~MeshBenchmark();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Called from the receive task for TEST_* and BENCH_* messages
+    void handle_message(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    // Runs this node's share of a started run; ESP_ERR_TIMEOUT if none was armed in time
+    esp_err_t service(TickType_t wait_ticks);
+
+    // Coordinator: blocks for the whole run including result collection
+    esp_err_t run(const bench_plan_t& plan, bench_run_result_t* result);
+
+    // Coordinator: k = 1..N concurrent senders in a ring (node i sends to node i+1) for
+    // every payload size, then a senders x payload matrix of aggregate goodput and loss
+    esp_err_t run_scaling_sweep(const std::vector<esp_now_peer_info_t>& peers, bool include_local,
+                                const std::vector<uint16_t>& payload_sizes, uint32_t duration_ms);
+
+    static void print_run(const bench_run_result_t& result);
+};
@@ -0,0 +1,406 @@
+#include "mesh_router.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+
+static_assert(MESSAGE_BUS_MAX_RETAINED + ESP_NOW_MESH_MAX_FORWARDS < ESP_NOW_RX_POOL_SIZE,
+              "Forwards and subscriber queues must leave receive buffers for the driver");
+
+MeshRouter::MeshRouter(ESPNowManager& manager)
+    : manager_(manager), config_(default_config()), routes_mutex_(nullptr), seen_next_(0),
+      advert_cursor_(0), next_seq_(0), routes_changed_(false), last_triggered_advert_us_(0),
+      originated_(0), delivered_(0), forwarded_(0), dropped_duplicate_(0), dropped_ttl_(0),
+      dropped_no_route_(0), dropped_busy_(0), route_changes_(0) {
+    memset(routes_, 0, sizeof(routes_));
+    memset(seen_, 0, sizeof(seen_));
+}
+
+MeshRouter::~MeshRouter() {
+    deinitialize();
+}
+
+esp_err_t MeshRouter::initialize() {
+    if (routes_mutex_) {
+        return ESP_OK;
+    }
+
+    routes_mutex_ = xSemaphoreCreateMutex();
+    if (!routes_mutex_) {
+        ESP_LOGE(MESH_ROUTER_TAG, "Failed to create route table mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(routes_, 0, sizeof(routes_));
+    memset(seen_, 0, sizeof(seen_));
+    seen_next_ = 0;
+    advert_cursor_ = 0;
+    next_seq_ = (uint16_t)esp_timer_get_time();
+    return ESP_OK;
+}
+
+void MeshRouter::deinitialize() {
+    if (routes_mutex_) {
+        vSemaphoreDelete(routes_mutex_);
+        routes_mutex_ = nullptr;
+    }
+}
+
+esp_now_mesh_config_t MeshRouter::default_config() {
+    esp_now_mesh_config_t config = {};
+    config.enabled = false;
+    config.max_hops = ESP_NOW_MESH_DEFAULT_MAX_HOPS;
+    config.route_timeout_ms = ESP_NOW_MESH_DEFAULT_ROUTE_TIMEOUT_MS;
+    config.min_link_rssi = ESP_NOW_MESH_DEFAULT_MIN_LINK_RSSI;
+    return config;
+}
+
+void MeshRouter::set_config(const esp_now_mesh_config_t& config) {
+    config_ = config;
+    config_.max_hops = std::max<uint8_t>(config.max_hops, 1);
+}
+
+// One per link, plus one per ESP_NOW_MESH_RSSI_STEP_DB below ESP_NOW_MESH_RSSI_GOOD_DBM
+uint8_t MeshRouter::link_cost(int8_t rssi) {
+    int penalty = rssi < ESP_NOW_MESH_RSSI_GOOD_DBM ?
+                  (ESP_NOW_MESH_RSSI_GOOD_DBM - rssi + ESP_NOW_MESH_RSSI_STEP_DB - 1) / ESP_NOW_MESH_RSSI_STEP_DB : 0;
+    return (uint8_t)std::min(1 + penalty, ESP_NOW_MESH_MAX_LINK_COST);
+}
+
+bool MeshRouter::expired(const route_entry_t& route, uint64_t now_us) const {
+    return now_us - route.updated_us > (uint64_t)config_.route_timeout_ms * 1000;
+}
+
+// Caller holds routes_mutex_
+MeshRouter::route_entry_t* MeshRouter::find_route(const uint8_t* destination, uint64_t now_us) {
+    for (auto& route : routes_) {
+        if (route.used && memcmp(route.destination, destination, 6) == 0) {
+            if (expired(route, now_us)) {
+                route.used = false;
+                return nullptr;
+            }
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+// Caller holds routes_mutex_. The current next hop always refreshes its route, better or
+// worse; another neighbour takes it over only when cheaper by the hysteresis.
+void MeshRouter::learn(const uint8_t* destination, const uint8_t* next_hop, uint8_t hops, uint32_t cost,
+                       uint64_t now_us) {
+    if (hops > config_.max_hops || cost >= ESP_NOW_MESH_COST_UNREACHABLE) {
+        return;
+    }
+
+    route_entry_t* route = find_route(destination, now_us);
+    if (route) {
+        bool same_hop = memcmp(route->next_hop, next_hop, 6) == 0;
+        if (!same_hop && cost + ESP_NOW_MESH_COST_HYSTERESIS > route->cost) {
+            return;
+        }
+        if (!same_hop || route->cost != cost || route->hops != hops) {
+            routes_changed_ = true;
+            if (!same_hop) {
+                route_changes_++;
+            }
+        }
+    } else {
+        for (auto& candidate : routes_) {
+            if (!candidate.used || expired(candidate, now_us)) {
+                route = &candidate;
+                break;
+            }
+        }
+        if (!route) {
+            return;
+        }
+        route->used = true;
+        memcpy(route->destination, destination, 6);
+        routes_changed_ = true;
+        route_changes_++;
+    }
+
+    memcpy(route->next_hop, next_hop, 6);
+    route->hops = hops;
+    route->cost = (uint8_t)cost;
+    route->updated_us = now_us;
+}
+
+void MeshRouter::handle_advert(const uint8_t* neighbor, const uint8_t* data, size_t len, int8_t link_rssi) {
+    if (!config_.enabled || !routes_mutex_ || link_rssi == 0 || link_rssi < config_.min_link_rssi) {
+        return;
+    }
+
+    const uint8_t* local_mac = manager_.get_local_mac();
+    uint64_t now_us = esp_timer_get_time();
+    uint8_t cost = link_cost(link_rssi);
+
+    xSemaphoreTake(routes_mutex_, portMAX_DELAY);
+    learn(neighbor, neighbor, 1, cost, now_us);
+
+    esp_now_mesh_advert_t advert;
+    if (len >= sizeof(advert)) {
+        memcpy(&advert, data, sizeof(advert));
+        size_t count = std::min<size_t>(advert.count, (len - sizeof(advert)) / sizeof(esp_now_mesh_route_entry_t));
+        if (advert.ext_type != ESP_NOW_DISCOVERY_EXT_MESH_ROUTES) {
+            count = 0;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            esp_now_mesh_route_entry_t entry;
+            memcpy(&entry, data + sizeof(advert) + i * sizeof(entry), sizeof(entry));
+            // Split horizon: never learn a route back through ourselves
+            if (memcmp(entry.destination, local_mac, 6) == 0 || memcmp(entry.via, local_mac, 6) == 0 ||
+                memcmp(entry.destination, neighbor, 6) == 0) {
+                continue;
+            }
+            learn(entry.destination, neighbor, entry.hops + 1, (uint32_t)entry.cost + cost, now_us);
+        }
+    }
+
+    // Spread a change sooner than the discovery backoff would
+    bool advertise = routes_changed_.exchange(false) &&
+                     now_us - last_triggered_advert_us_ >= ESP_NOW_MESH_TRIGGERED_ADVERT_MS * 1000ULL;
+    if (advertise) {
+        last_triggered_advert_us_ = now_us;
+    }
+    xSemaphoreGive(routes_mutex_);
+
+    if (advertise) {
+        manager_.send_discovery_request();
+    }
+}
+
+size_t MeshRouter::write_advert(uint8_t* out, size_t capacity) {
+    if (!config_.enabled || !routes_mutex_ || capacity < sizeof(esp_now_mesh_advert_t)) {
+        return 0;
+    }
+
+    size_t max_entries = std::min<size_t>((capacity - sizeof(esp_now_mesh_advert_t)) / sizeof(esp_now_mesh_route_entry_t),
+                                          ESP_NOW_MESH_MAX_ADVERT_ENTRIES);
+    uint64_t now_us = esp_timer_get_time();
+    esp_now_mesh_advert_t advert = {ESP_NOW_DISCOVERY_EXT_MESH_ROUTES, 0};
+
+    xSemaphoreTake(routes_mutex_, portMAX_DELAY);
+    for (size_t n = 0; n < ESP_NOW_MESH_MAX_ROUTES && advert.count < max_entries; n++) {
+        route_entry_t& route = routes_[(advert_cursor_ + n) % ESP_NOW_MESH_MAX_ROUTES];
+        if (!route.used || expired(route, now_us) || route.hops >= config_.max_hops) {
+            continue;
+        }
+
+        esp_now_mesh_route_entry_t entry;
+        memcpy(entry.destination, route.destination, 6);
+        memcpy(entry.via, route.next_hop, 6);
+        entry.hops = route.hops;
+        entry.cost = route.cost;
+        memcpy(out + sizeof(advert) + advert.count * sizeof(entry), &entry, sizeof(entry));
+        advert.count++;
+    }
+    // More routes than fit: the next advert starts where this one stopped
+    advert_cursor_ = (advert_cursor_ + max_entries) % ESP_NOW_MESH_MAX_ROUTES;
+    xSemaphoreGive(routes_mutex_);
+
+    memcpy(out, &advert, sizeof(advert));
+    return sizeof(advert) + advert.count * sizeof(esp_now_mesh_route_entry_t);
+}
+
+void MeshRouter::on_neighbor_lost(const uint8_t* neighbor) {
+    if (!routes_mutex_) {
+        return;
+    }
+
+    xSemaphoreTake(routes_mutex_, portMAX_DELAY);
+    for (auto& route : routes_) {
+        if (route.used && memcmp(route.next_hop, neighbor, 6) == 0) {
+            route.used = false;
+            route_changes_++;
+        }
+    }
+    xSemaphoreGive(routes_mutex_);
+}
+
+bool MeshRouter::next_hop_for(const uint8_t* destination, uint8_t* next_hop) {
+    xSemaphoreTake(routes_mutex_, portMAX_DELAY);
+    route_entry_t* route = find_route(destination, esp_timer_get_time());
+    if (route) {
+        memcpy(next_hop, route->next_hop, 6);
+    }
+    xSemaphoreGive(routes_mutex_);
+    return route != nullptr;
+}
+
+// Receive task only
+bool MeshRouter::check_and_remember(const uint8_t* origin, uint16_t seq) {
+    uint64_t key = peer_table_key(origin);
+    for (const auto& entry : seen_) {
+        if (entry.used && entry.origin == key && entry.seq == seq) {
+            return false;
+        }
+    }
+
+    seen_[seen_next_].origin = key;
+    seen_[seen_next_].seq = seq;
+    seen_[seen_next_].used = true;
+    seen_next_ = (seen_next_ + 1) % ESP_NOW_MESH_SEEN_CACHE_SIZE;
+    return true;
+}
+
+esp_err_t MeshRouter::send(const uint8_t* destination, uint8_t inner_type, const uint8_t* data, size_t len,
+                           TickType_t wait_ticks) {
+    if (!routes_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > ESP_NOW_MESH_MAX_PAYLOAD_LEN ||
+        (inner_type != ESP_NOW_MSG_TYPE_DATA && inner_type < ESP_NOW_MSG_TYPE_USER_FIRST)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Neighbours without an advertised route are reached directly
+    uint8_t next_hop[6];
+    if (!next_hop_for(destination, next_hop)) {
+        if (!manager_.is_peer_registered(destination)) {
+            dropped_no_route_++;
+            return ESP_ERR_NOT_FOUND;
+        }
+        memcpy(next_hop, destination, 6);
+    }
+
+    uint8_t frame[ESP_NOW_MAX_PAYLOAD_LEN];
+    esp_now_mesh_header_t header;
+    memcpy(header.origin, manager_.get_local_mac(), 6);
+    memcpy(header.destination, destination, 6);
+    header.origin_seq = next_seq_++;
+    header.ttl = config_.max_hops;
+    header.hops = 0;
+    header.inner_type = inner_type;
+    memcpy(frame, &header, sizeof(header));
+    if (data && len > 0) {
+        memcpy(frame + sizeof(header), data, len);
+    }
+
+    esp_err_t ret = manager_.send_message(next_hop, ESP_NOW_MSG_TYPE_MESH_DATA, frame, sizeof(header) + len,
+                                          wait_ticks);
+    if (ret == ESP_OK) {
+        originated_++;
+    }
+    return ret;
+}
+
+bool MeshRouter::route(esp_now_buffer_t* buffer) {
+    esp_now_message_t* msg = &buffer->msg;
+    if (msg->payload_length < sizeof(esp_now_mesh_header_t)) {
+        return false;
+    }
+
+    esp_now_mesh_header_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+    const uint8_t* local_mac = manager_.get_local_mac();
+
+    if (memcmp(header.origin, local_mac, 6) == 0 || !check_and_remember(header.origin, header.origin_seq)) {
+        dropped_duplicate_++;
+        return false;
+    }
+
+    if (memcmp(header.destination, local_mac, 6) == 0) {
+        if (header.inner_type != ESP_NOW_MSG_TYPE_DATA && header.inner_type < ESP_NOW_MSG_TYPE_USER_FIRST) {
+            return false;
+        }
+
+        // Unwrap in place: the buffer now carries the inner message from its origin
+        size_t inner_len = msg->payload_length - sizeof(header);
+        memmove(msg->payload, msg->payload + sizeof(header), inner_len);
+        msg->msg_type = header.inner_type;
+        msg->payload_length = inner_len;
+        msg->crc32 = esp_now_message_crc(msg);
+        memcpy(buffer->mac_addr, header.origin, 6);
+        buffer->rx_hops = header.hops + 1;
+        buffer->frame_len = esp_now_message_wire_len(msg);
+        delivered_++;
+        return true;
+    }
+
+    if (!config_.enabled) {
+        dropped_no_route_++;
+        return false;
+    }
+    if (header.ttl <= 1) {
+        dropped_ttl_++;
+        return false;
+    }
+
+    uint8_t next_hop[6];
+    if (!next_hop_for(header.destination, next_hop)) {
+        if (!manager_.is_peer_registered(header.destination)) {
+            dropped_no_route_++;
+            return false;
+        }
+        memcpy(next_hop, header.destination, 6);
+    }
+    if (memcmp(next_hop, buffer->mac_addr, 6) == 0) {
+        // The route points back where the frame came from; the tables have not converged
+        dropped_no_route_++;
+        return false;
+    }
+
+    header.ttl--;
+    header.hops++;
+    memcpy(msg->payload, &header, sizeof(header));
+
+    if (manager_.forward_buffer(buffer, next_hop) != ESP_OK) {
+        dropped_busy_++;
+        return false;
+    }
+    forwarded_++;
+    return false;
+}
+
+std::vector<esp_now_mesh_route_t> MeshRouter::get_routes() {
+    std::vector<esp_now_mesh_route_t> routes;
+    if (!routes_mutex_) {
+        return routes;
+    }
+
+    uint64_t now_us = esp_timer_get_time();
+    xSemaphoreTake(routes_mutex_, portMAX_DELAY);
+    for (const auto& entry : routes_) {
+        if (!entry.used || expired(entry, now_us)) continue;
+        esp_now_mesh_route_t route;
+        memcpy(route.destination, entry.destination, 6);
+        memcpy(route.next_hop, entry.next_hop, 6);
+        route.hops = entry.hops;
+        route.cost = entry.cost;
+        route.age_ms = (now_us - entry.updated_us) / 1000;
+        routes.push_back(route);
+    }
+    xSemaphoreGive(routes_mutex_);
+    return routes;
+}
+
+esp_now_mesh_stats_t MeshRouter::get_stats() {
+    esp_now_mesh_stats_t stats = {};
+    stats.originated = originated_.load();
+    stats.delivered = delivered_.load();
+    stats.forwarded = forwarded_.load();
+    stats.dropped_duplicate = dropped_duplicate_.load();
+    stats.dropped_ttl = dropped_ttl_.load();
+    stats.dropped_no_route = dropped_no_route_.load();
+    stats.dropped_busy = dropped_busy_.load();
+    stats.route_changes = route_changes_.load();
+    stats.routes = get_routes().size();
+    return stats;
+}
+
+void MeshRouter::print_routes() {
+    std::vector<esp_now_mesh_route_t> routes = get_routes();
+    ESP_LOGI(MESH_ROUTER_TAG, "%zu routes", routes.size());
+    for (const auto& route : routes) {
+        ESP_LOGI(MESH_ROUTER_TAG, "  %02x:%02x:%02x:%02x:%02x:%02x via %02x:%02x:%02x:%02x:%02x:%02x, "
+                 "%u hops, cost %u, %lu ms old",
+                 route.destination[0], route.destination[1], route.destination[2],
+                 route.destination[3], route.destination[4], route.destination[5],
+                 route.next_hop[0], route.next_hop[1], route.next_hop[2],
+                 route.next_hop[3], route.next_hop[4], route.next_hop[5],
+                 route.hops, route.cost, route.age_ms);
+    }
+}
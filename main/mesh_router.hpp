@@ -0,0 +1,137 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "esp_now_protocol.hpp"
+#include "message_pool.hpp"
+
+#define MESH_ROUTER_TAG "MESH"
+#define ESP_NOW_MESH_MAX_ROUTES 64
+#define ESP_NOW_MESH_SEEN_CACHE_SIZE 32       // (origin, seq) pairs remembered for loop suppression
+#define ESP_NOW_MESH_MAX_FORWARDS 4           // Receive buffers queued or in flight as forwards
+#define ESP_NOW_MESH_DEFAULT_MAX_HOPS 4
+#define ESP_NOW_MESH_DEFAULT_ROUTE_TIMEOUT_MS 100000  // Above the slowest discovery interval
+#define ESP_NOW_MESH_DEFAULT_MIN_LINK_RSSI -88
+#define ESP_NOW_MESH_RSSI_GOOD_DBM -65        // Links at or above cost 1
+#define ESP_NOW_MESH_RSSI_STEP_DB 5           // Each step below RSSI_GOOD adds 1 to the link cost
+#define ESP_NOW_MESH_MAX_LINK_COST 8
+#define ESP_NOW_MESH_COST_HYSTERESIS 1        // A new next hop must be this much cheaper
+#define ESP_NOW_MESH_TRIGGERED_ADVERT_MS 1000 // Earliest re-advertisement after a route change
+#define ESP_NOW_MESH_COST_UNREACHABLE 0xFF
+
+class ESPNowManager;
+
+typedef struct {
+    bool enabled;                // Forward for others and advertise routes in discovery
+    uint8_t max_hops;            // TTL of originated frames; longer routes are not learned
+    uint32_t route_timeout_ms;
+    int8_t min_link_rssi;        // Weaker neighbours are not used as next hops
+} esp_now_mesh_config_t;
+
+typedef struct {
+    uint8_t destination[6];
+    uint8_t next_hop[6];
+    uint8_t hops;
+    uint8_t cost;
+    uint32_t age_ms;
+} esp_now_mesh_route_t;
+
+typedef struct {
+    uint32_t originated;
+    uint32_t delivered;          // Addressed to this node
+    uint32_t forwarded;
+    uint32_t dropped_duplicate;  // Seen before: a loop or a retransmission along two paths
+    uint32_t dropped_ttl;
+    uint32_t dropped_no_route;
+    uint32_t dropped_busy;       // ESP_NOW_MESH_MAX_FORWARDS already queued
+    uint32_t route_changes;
+    uint32_t routes;
+} esp_now_mesh_stats_t;
+
+// Multi-hop forwarding for MESH_DATA frames. Routes are a distance vector carried in
+// discovery frames; the cost of a link grows as its RSSI drops, so a clean two-hop path
+// beats a marginal direct one. Frames for other nodes are forwarded from the receive
+// task in the receive buffer itself: the TTL is patched in place and the buffer goes
+// straight to the send task, without a copy or a wakeup of the application.
+class MeshRouter {
+private:
+    typedef struct {
+        bool used;
+        uint8_t destination[6];
+        uint8_t next_hop[6];
+        uint8_t hops;
+        uint8_t cost;
+        uint64_t updated_us;
+    } route_entry_t;
+
+    typedef struct {
+        uint64_t origin;
+        uint16_t seq;
+        bool used;
+    } seen_entry_t;
+
+    ESPNowManager& manager_;
+    esp_now_mesh_config_t config_;
+    SemaphoreHandle_t routes_mutex_;
+    route_entry_t routes_[ESP_NOW_MESH_MAX_ROUTES];
+    seen_entry_t seen_[ESP_NOW_MESH_SEEN_CACHE_SIZE];   // Receive task only
+    size_t seen_next_;
+    size_t advert_cursor_;                              // Rotates adverts when routes exceed one frame
+    std::atomic<uint16_t> next_seq_;
+    std::atomic<bool> routes_changed_;
+    uint64_t last_triggered_advert_us_;
+
+    std::atomic<uint32_t> originated_;
+    std::atomic<uint32_t> delivered_;
+    std::atomic<uint32_t> forwarded_;
+    std::atomic<uint32_t> dropped_duplicate_;
+    std::atomic<uint32_t> dropped_ttl_;
+    std::atomic<uint32_t> dropped_no_route_;
+    std::atomic<uint32_t> dropped_busy_;
+    std::atomic<uint32_t> route_changes_;
+
+    route_entry_t* find_route(const uint8_t* destination, uint64_t now_us);
+    void learn(const uint8_t* destination, const uint8_t* next_hop, uint8_t hops, uint32_t cost, uint64_t now_us);
+    bool check_and_remember(const uint8_t* origin, uint16_t seq);
+    bool next_hop_for(const uint8_t* destination, uint8_t* next_hop);
+    bool expired(const route_entry_t& route, uint64_t now_us) const;
+    static uint8_t link_cost(int8_t rssi);
+
+public:
+    explicit MeshRouter(ESPNowManager& manager);
+    ~MeshRouter();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    void set_config(const esp_now_mesh_config_t& config);
+    esp_now_mesh_config_t get_config() const { return config_; }
+    static esp_now_mesh_config_t default_config();
+
+    // Sends len bytes (at most ESP_NOW_MESH_MAX_PAYLOAD_LEN) to any node of the mesh; they
+    // arrive as a message of inner_type from this node. inner_type is ESP_NOW_MSG_TYPE_DATA
+    // or an application type. ESP_ERR_NOT_FOUND without a route.
+    esp_err_t send(const uint8_t* destination, uint8_t inner_type, const uint8_t* data, size_t len,
+                   TickType_t wait_ticks = portMAX_DELAY);
+
+    // Receive task, for every MESH_DATA frame. Returns true when the frame was for this
+    // node: the buffer then holds the inner message, from the origin, to be dispatched.
+    bool route(esp_now_buffer_t* buffer);
+
+    // Discovery: writes the advert after the capabilities; returns the bytes used
+    size_t write_advert(uint8_t* out, size_t capacity);
+    // Receive task: routes from a neighbour's discovery frame, heard at link_rssi
+    void handle_advert(const uint8_t* neighbor, const uint8_t* data, size_t len, int8_t link_rssi);
+    // Drops every route through a neighbour that left the peer table
+    void on_neighbor_lost(const uint8_t* neighbor);
+
+    std::vector<esp_now_mesh_route_t> get_routes();
+    esp_now_mesh_stats_t get_stats();
+    void print_routes();
+};
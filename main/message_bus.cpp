@@ -0,0 +1,300 @@
+#include "message_bus.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+
+static_assert(MESSAGE_BUS_MAX_SUBSCRIBERS <= 16, "topic_masks_ holds one bit per subscription");
+static_assert(MESSAGE_BUS_MAX_RETAINED < ESP_NOW_RX_POOL_SIZE, "Queues must leave receive buffers for the driver");
+
+MessageBus::MessageBus(ESPNowManager& manager)
+    : manager_(manager), mutex_(nullptr), retained_(0) {
+    for (auto& sub : subscriptions_) {
+        sub.bus = this;
+        sub.state = SUBSCRIPTION_FREE;
+        sub.queue = nullptr;
+        sub.task_handle = nullptr;
+        sub.stopped = nullptr;
+    }
+    memset(topic_masks_, 0, sizeof(topic_masks_));
+}
+
+MessageBus::~MessageBus() {
+    deinitialize();
+}
+
+esp_err_t MessageBus::initialize() {
+    if (mutex_) {
+        return ESP_OK;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    if (!mutex_) {
+        ESP_LOGE(MESSAGE_BUS_TAG, "Failed to create message bus mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    memset(topic_masks_, 0, sizeof(topic_masks_));
+    retained_ = 0;
+    return ESP_OK;
+}
+
+void MessageBus::deinitialize() {
+    if (!mutex_) {
+        return;
+    }
+
+    for (int i = 0; i < MESSAGE_BUS_MAX_SUBSCRIBERS; i++) {
+        if (subscriptions_[i].state == SUBSCRIPTION_ACTIVE) {
+            unsubscribe(i);
+        }
+    }
+
+    vSemaphoreDelete(mutex_);
+    mutex_ = nullptr;
+}
+
+message_bus_subscription_config_t MessageBus::inline_config() {
+    message_bus_subscription_config_t config = {};
+    config.delivery = MESSAGE_BUS_DELIVER_INLINE;
+    config.drop_policy = MESSAGE_BUS_DROP_NEWEST;
+    return config;
+}
+
+message_bus_subscription_config_t MessageBus::queued_config(uint8_t depth, message_bus_drop_policy_t policy) {
+    message_bus_subscription_config_t config = {};
+    config.delivery = MESSAGE_BUS_DELIVER_QUEUED;
+    config.drop_policy = policy;
+    config.queue_depth = depth;
+    config.task_priority = MESSAGE_BUS_TASK_PRIORITY;
+    config.task_stack_size = MESSAGE_BUS_TASK_STACK_SIZE;
+    return config;
+}
+
+esp_err_t MessageBus::subscribe(uint8_t msg_type, const message_bus_subscription_config_t& config,
+                                message_bus_handler_t handler, int* subscription_id) {
+    return subscribe(msg_type, msg_type, config, handler, subscription_id);
+}
+
+esp_err_t MessageBus::subscribe(uint8_t first_type, uint8_t last_type, const message_bus_subscription_config_t& config,
+                                message_bus_handler_t handler, int* subscription_id) {
+    if (!mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!handler || first_type > last_type ||
+        (config.delivery == MESSAGE_BUS_DELIVER_QUEUED && config.queue_depth == 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    int id = -1;
+    for (int i = 0; i < MESSAGE_BUS_MAX_SUBSCRIBERS; i++) {
+        if (subscriptions_[i].state == SUBSCRIPTION_FREE) {
+            id = i;
+            break;
+        }
+    }
+    if (id < 0) {
+        xSemaphoreGive(mutex_);
+        ESP_LOGW(MESSAGE_BUS_TAG, "All %d subscriptions in use", MESSAGE_BUS_MAX_SUBSCRIBERS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    subscription_t* sub = &subscriptions_[id];
+    sub->first_type = first_type;
+    sub->last_type = last_type;
+    sub->config = config;
+    sub->handler = handler;
+    sub->delivered = 0;
+    sub->dropped = 0;
+    sub->queue_high_water = 0;
+    sub->handler_max_us = 0;
+
+    if (config.delivery == MESSAGE_BUS_DELIVER_QUEUED) {
+        sub->queue = xQueueCreate(config.queue_depth, sizeof(esp_now_buffer_t*));
+        sub->stopped = xSemaphoreCreateBinary();
+        UBaseType_t priority = config.task_priority;
+        uint32_t stack = config.task_stack_size ? config.task_stack_size : MESSAGE_BUS_TASK_STACK_SIZE;
+        if (!sub->queue || !sub->stopped ||
+            xTaskCreate(subscriber_task, "esp_now_sub", stack, sub, priority, &sub->task_handle) != pdPASS) {
+            if (sub->queue) vQueueDelete(sub->queue);
+            if (sub->stopped) vSemaphoreDelete(sub->stopped);
+            sub->queue = nullptr;
+            sub->stopped = nullptr;
+            sub->task_handle = nullptr;
+            sub->handler = nullptr;
+            xSemaphoreGive(mutex_);
+            ESP_LOGE(MESSAGE_BUS_TAG, "Failed to create subscriber queue or task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    sub->state = SUBSCRIPTION_ACTIVE;
+    for (int type = first_type; type <= last_type; type++) {
+        topic_masks_[type] |= (uint16_t)(1u << id);
+    }
+    xSemaphoreGive(mutex_);
+
+    ESP_LOGD(MESSAGE_BUS_TAG, "Subscription %d: types 0x%02x-0x%02x, %s", id, first_type, last_type,
+             config.delivery == MESSAGE_BUS_DELIVER_QUEUED ? "queued" : "inline");
+    if (subscription_id) {
+        *subscription_id = id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t MessageBus::unsubscribe(int subscription_id) {
+    if (!mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (subscription_id < 0 || subscription_id >= MESSAGE_BUS_MAX_SUBSCRIBERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    subscription_t* sub = &subscriptions_[subscription_id];
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (sub->state != SUBSCRIPTION_ACTIVE) {
+        xSemaphoreGive(mutex_);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sub->state = SUBSCRIPTION_STOPPING;
+    for (int type = sub->first_type; type <= sub->last_type; type++) {
+        topic_masks_[type] &= (uint16_t)~(1u << subscription_id);
+    }
+    xSemaphoreGive(mutex_);
+
+    // Publishing is over for this subscription; let its task finish what it holds
+    if (sub->queue) {
+        esp_now_buffer_t* stop = nullptr;
+        xQueueSend(sub->queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(sub->stopped, portMAX_DELAY);
+        vQueueDelete(sub->queue);
+        vSemaphoreDelete(sub->stopped);
+        sub->queue = nullptr;
+        sub->stopped = nullptr;
+        sub->task_handle = nullptr;
+    }
+
+    sub->handler = nullptr;
+    sub->state = SUBSCRIPTION_FREE;
+    return ESP_OK;
+}
+
+void MessageBus::publish(esp_now_buffer_t* buffer) {
+    if (!mutex_ || topic_masks_[buffer->msg.msg_type] == 0) {
+        return;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint16_t mask = topic_masks_[buffer->msg.msg_type];
+    while (mask) {
+        int id = __builtin_ctz(mask);
+        mask &= mask - 1;
+        subscription_t* sub = &subscriptions_[id];
+
+        if (sub->config.delivery == MESSAGE_BUS_DELIVER_QUEUED) {
+            enqueue(sub, buffer);
+            continue;
+        }
+
+        uint64_t start_us = esp_timer_get_time();
+        sub->handler(buffer->mac_addr, &buffer->msg);
+        record_handler_time(sub, esp_timer_get_time() - start_us);
+        sub->delivered++;
+    }
+    xSemaphoreGive(mutex_);
+}
+
+// Receive task, under mutex_. Never blocks: a full queue or a spent retain budget costs
+// this subscriber a frame, per its drop policy
+void MessageBus::enqueue(subscription_t* sub, esp_now_buffer_t* buffer) {
+    bool full = uxQueueSpacesAvailable(sub->queue) == 0;
+    if (full || retained_.load() >= MESSAGE_BUS_MAX_RETAINED) {
+        esp_now_buffer_t* oldest = nullptr;
+        if (sub->config.drop_policy != MESSAGE_BUS_DROP_OLDEST ||
+            xQueueReceive(sub->queue, &oldest, 0) != pdTRUE) {
+            sub->dropped++;
+            return;
+        }
+        release(oldest);
+        sub->dropped++;
+    }
+
+    // A batch record is copied out of the receive task's scratch buffer here
+    buffer = manager_.retain_buffer(buffer);
+    if (!buffer) {
+        sub->dropped++;
+        return;
+    }
+    retained_++;
+
+    if (xQueueSend(sub->queue, &buffer, 0) != pdTRUE) {
+        release(buffer);
+        sub->dropped++;
+        return;
+    }
+
+    uint16_t depth = uxQueueMessagesWaiting(sub->queue);
+    if (depth > sub->queue_high_water.load()) {
+        sub->queue_high_water = depth;
+    }
+}
+
+void MessageBus::release(esp_now_buffer_t* buffer) {
+    retained_--;
+    manager_.release_message(&buffer->msg);
+}
+
+void MessageBus::record_handler_time(subscription_t* sub, uint32_t elapsed_us) {
+    if (elapsed_us > sub->handler_max_us.load()) {
+        sub->handler_max_us = elapsed_us;
+    }
+}
+
+void MessageBus::subscriber_task(void* parameter) {
+    subscription_t* sub = static_cast<subscription_t*>(parameter);
+    MessageBus* bus = sub->bus;
+    esp_now_buffer_t* buffer = nullptr;
+
+    while (true) {
+        if (xQueueReceive(sub->queue, &buffer, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (!buffer) {
+            break;
+        }
+
+        uint64_t start_us = esp_timer_get_time();
+        sub->handler(buffer->mac_addr, &buffer->msg);
+        record_handler_time(sub, esp_timer_get_time() - start_us);
+        sub->delivered++;
+        bus->release(buffer);
+    }
+
+    // Frames queued behind the stop request go back to the pool
+    while (xQueueReceive(sub->queue, &buffer, 0) == pdTRUE) {
+        if (buffer) {
+            bus->release(buffer);
+        }
+    }
+
+    xSemaphoreGive(sub->stopped);
+    vTaskDelete(nullptr);
+}
+
+esp_err_t MessageBus::get_stats(int subscription_id, message_bus_subscription_stats_t* stats) const {
+    if (subscription_id < 0 || subscription_id >= MESSAGE_BUS_MAX_SUBSCRIBERS || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const subscription_t* sub = &subscriptions_[subscription_id];
+    if (sub->state == SUBSCRIPTION_FREE) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    stats->delivered = sub->delivered.load();
+    stats->dropped = sub->dropped.load();
+    stats->queue_high_water = sub->queue_high_water.load();
+    stats->handler_max_us = sub->handler_max_us.load();
+    return ESP_OK;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+#include "message_pool.hpp"
+#include "delegate.hpp"
+
+#define MESSAGE_BUS_TAG "MSG_BUS"
+#define MESSAGE_BUS_MAX_SUBSCRIBERS 16
+#define MESSAGE_BUS_MAX_RETAINED 8          // Receive buffers held by all queues together
+#define MESSAGE_BUS_DEFAULT_QUEUE_DEPTH 4
+#define MESSAGE_BUS_TASK_STACK_SIZE 3072
+#define MESSAGE_BUS_TASK_PRIORITY 2
+
+class ESPNowManager;
+
+typedef Delegate<void(const uint8_t* mac_addr, const esp_now_message_t* msg)> message_bus_handler_t;
+
+typedef enum {
+    MESSAGE_BUS_DELIVER_INLINE = 0,  // On the receive task; for short, latency-critical handlers
+    MESSAGE_BUS_DELIVER_QUEUED = 1,  // Own bounded queue and task; the receive task never waits
+} message_bus_delivery_t;
+
+typedef enum {
+    MESSAGE_BUS_DROP_NEWEST = 0,     // A full queue keeps what it has
+    MESSAGE_BUS_DROP_OLDEST = 1,     // A full queue discards its oldest frame for the new one
+} message_bus_drop_policy_t;
+
+typedef struct {
+    message_bus_delivery_t delivery;
+    message_bus_drop_policy_t drop_policy;
+    uint8_t queue_depth;             // Queued delivery only
+    UBaseType_t task_priority;
+    uint32_t task_stack_size;
+} message_bus_subscription_config_t;
+
+typedef struct {
+    uint32_t delivered;
+    uint32_t dropped;                // Queue full, or the shared retain budget was spent
+    uint16_t queue_high_water;
+    uint32_t handler_max_us;
+} message_bus_subscription_stats_t;
+
+// Fans received frames out to the subscribers of their message type, internal or
+// user-defined (ESP_NOW_MSG_TYPE_USER_FIRST..LAST). Queued subscribers hold a reference on
+// the receive buffer instead of a copy; MESSAGE_BUS_MAX_RETAINED caps what all queues
+// together may hold, so slow consumers can never drain the receive pool.
+class MessageBus {
+private:
+    enum subscription_state_t : uint8_t {
+        SUBSCRIPTION_FREE = 0,
+        SUBSCRIPTION_ACTIVE,
+        SUBSCRIPTION_STOPPING,
+    };
+
+    typedef struct {
+        MessageBus* bus;
+        std::atomic<uint8_t> state;
+        uint8_t first_type;
+        uint8_t last_type;
+        message_bus_subscription_config_t config;
+        message_bus_handler_t handler;
+        QueueHandle_t queue;         // esp_now_buffer_t*; nullptr is the stop request
+        TaskHandle_t task_handle;
+        SemaphoreHandle_t stopped;
+        std::atomic<uint32_t> delivered;
+        std::atomic<uint32_t> dropped;
+        std::atomic<uint16_t> queue_high_water;
+        std::atomic<uint32_t> handler_max_us;
+    } subscription_t;
+
+    ESPNowManager& manager_;
+    SemaphoreHandle_t mutex_;        // Held while publishing and while changing subscriptions
+    subscription_t subscriptions_[MESSAGE_BUS_MAX_SUBSCRIBERS];
+    uint16_t topic_masks_[256];      // Subscribers of each message type, bit per subscription
+    std::atomic<uint32_t> retained_;
+
+    static void subscriber_task(void* parameter);
+    void enqueue(subscription_t* sub, esp_now_buffer_t* buffer);
+    void release(esp_now_buffer_t* buffer);
+    static void record_handler_time(subscription_t* sub, uint32_t elapsed_us);
+
+public:
+    explicit MessageBus(ESPNowManager& manager);
+    ~MessageBus();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Subscribes to every type in first_type..last_type. The message is borrowed for the
+    // duration of the handler; ESP_ERR_NO_MEM when all subscriptions are taken. Inline
+    // handlers run with the bus locked and must not subscribe or unsubscribe.
+    esp_err_t subscribe(uint8_t first_type, uint8_t last_type, const message_bus_subscription_config_t& config,
+                        message_bus_handler_t handler, int* subscription_id);
+    esp_err_t subscribe(uint8_t msg_type, const message_bus_subscription_config_t& config,
+                        message_bus_handler_t handler, int* subscription_id);
+    // Waits for a queued subscriber to drain; must not be called from its own handler
+    esp_err_t unsubscribe(int subscription_id);
+
+    // Called from the receive task for every dispatched frame
+    void publish(esp_now_buffer_t* buffer);
+
+    esp_err_t get_stats(int subscription_id, message_bus_subscription_stats_t* stats) const;
+    bool has_subscribers(uint8_t msg_type) const { return topic_masks_[msg_type] != 0; }
+
+    static message_bus_subscription_config_t inline_config();
+    static message_bus_subscription_config_t queued_config(uint8_t depth = MESSAGE_BUS_DEFAULT_QUEUE_DEPTH,
+                                                           message_bus_drop_policy_t policy = MESSAGE_BUS_DROP_OLDEST);
+};
@@ -0,0 +1,102 @@
+#include "message_pool.hpp"
+#include <new>
+
+MessagePool::MessagePool()
+    : buffers_(nullptr), capacity_(0), free_queue_(nullptr) {
+}
+
+MessagePool::~MessagePool() {
+    deinitialize();
+}
+
+esp_err_t MessagePool::initialize(size_t capacity) {
+    if (buffers_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    buffers_ = new (std::nothrow) esp_now_buffer_t[capacity];
+    free_queue_ = xQueueCreate(capacity, sizeof(esp_now_buffer_t*));
+
+    if (!buffers_ || !free_queue_) {
+        ESP_LOGE(MESSAGE_POOL_TAG, "Failed to allocate pool of %zu buffers", capacity);
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    capacity_ = capacity;
+    for (size_t i = 0; i < capacity_; i++) {
+        esp_now_buffer_t* buffer = &buffers_[i];
+        buffer->ref_count.store(0);
+        xQueueSend(free_queue_, &buffer, 0);
+    }
+
+    ESP_LOGI(MESSAGE_POOL_TAG, "Message pool ready: %zu buffers, %zu bytes",
+             capacity_, capacity_ * sizeof(esp_now_buffer_t));
+    return ESP_OK;
+}
+
+void MessagePool::deinitialize() {
+    if (free_queue_) {
+        vQueueDelete(free_queue_);
+        free_queue_ = nullptr;
+    }
+
+    delete[] buffers_;
+    buffers_ = nullptr;
+    capacity_ = 0;
+}
+
+esp_now_buffer_t* MessagePool::acquire(TickType_t wait_ticks) {
+    if (!free_queue_) {
+        return nullptr;
+    }
+
+    esp_now_buffer_t* buffer = nullptr;
+    if (xQueueReceive(free_queue_, &buffer, wait_ticks) != pdPASS) {
+        return nullptr;
+    }
+
+    buffer->ref_count.store(1, std::memory_order_relaxed);
+    return buffer;
+}
+
+void MessagePool::retain(esp_now_buffer_t* buffer) {
+    if (buffer) {
+        buffer->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MessagePool::release(esp_now_buffer_t* buffer) {
+    if (!buffer || !owns(buffer)) {
+        return;
+    }
+
+    // Last reference returns the buffer to the free list
+    if (buffer->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        xQueueSend(free_queue_, &buffer, 0);
+    }
+}
+
+esp_now_buffer_t* MessagePool::from_message(const esp_now_message_t* msg) const {
+    if (!msg) {
+        return nullptr;
+    }
+
+    esp_now_buffer_t* buffer = (esp_now_buffer_t*)((uint8_t*)msg - offsetof(esp_now_buffer_t, msg));
+    return owns(buffer) ? buffer : nullptr;
+}
+
+bool MessagePool::owns(const esp_now_buffer_t* buffer) const {
+    if (!buffers_ || buffer < buffers_ || buffer >= buffers_ + capacity_) {
+        return false;
+    }
+    return ((const uint8_t*)buffer - (const uint8_t*)buffers_) % sizeof(esp_now_buffer_t) == 0;
+}
+
+size_t MessagePool::available() const {
+    return free_queue_ ? uxQueueMessagesWaiting(free_queue_) : 0;
+}
+
+size_t MessagePool::capacity() const {
+    return capacity_;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+
+#define MESSAGE_POOL_TAG "MSG_POOL"
+
+// Preallocated frame buffer. The receive callback copies the frame in once;
+// from then on only the pointer travels through the queues.
+typedef struct {
+    uint8_t mac_addr[6];
+    int8_t rssi;         // From recv_info->rx_ctrl
+    uint8_t rx_rate;
+    uint8_t rx_channel;
+    bool rx_broadcast;   // Sent to the broadcast address
+    uint8_t rx_hops;     // Mesh links travelled; 0 for frames from a neighbour
+    uint16_t frame_len;
+    bool power_held;     // Counted against a sleeping destination's budget (send side)
+    uint64_t rx_timestamp_us;
+    std::atomic<uint8_t> ref_count;
+    esp_now_message_t msg;
+} esp_now_buffer_t;
+
+// Fixed-size pool of message buffers. The free list is a FreeRTOS queue of
+// pointers, so acquire/release are safe from the Wi-Fi task and app tasks alike.
+class MessagePool {
+private:
+    esp_now_buffer_t* buffers_;
+    size_t capacity_;
+    QueueHandle_t free_queue_;
+
+public:
+    MessagePool();
+    ~MessagePool();
+
+    esp_err_t initialize(size_t capacity);
+    void deinitialize();
+
+    // Returns a buffer holding one reference, or nullptr if the pool is exhausted
+    esp_now_buffer_t* acquire(TickType_t wait_ticks = 0);
+    void retain(esp_now_buffer_t* buffer);
+    void release(esp_now_buffer_t* buffer);
+
+    // Maps a message handed out by the pool back to its owning buffer
+    esp_now_buffer_t* from_message(const esp_now_message_t* msg) const;
+    bool owns(const esp_now_buffer_t* buffer) const;
+
+    size_t available() const;
+    size_t capacity() const;
+};
@@ -0,0 +1,129 @@
+#include "peer_expiry.hpp"
+#include <new>
+
+PeerExpiryQueue::PeerExpiryQueue()
+    : heap_(nullptr), positions_(nullptr), size_(0), capacity_(0) {
+}
+
+PeerExpiryQueue::~PeerExpiryQueue() {
+    deinitialize();
+}
+
+esp_err_t PeerExpiryQueue::initialize(size_t capacity) {
+    if (heap_ || capacity == 0 || capacity > INT16_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    heap_ = new (std::nothrow) entry_t[capacity];
+    positions_ = new (std::nothrow) int16_t[capacity];
+    if (!heap_ || !positions_) {
+        ESP_LOGE(PEER_EXPIRY_TAG, "Failed to allocate expiry queue for %zu peers", capacity);
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    capacity_ = capacity;
+    clear();
+    return ESP_OK;
+}
+
+void PeerExpiryQueue::deinitialize() {
+    delete[] heap_;
+    delete[] positions_;
+    heap_ = nullptr;
+    positions_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+}
+
+void PeerExpiryQueue::clear() {
+    for (size_t i = 0; i < capacity_; i++) {
+        positions_[i] = NOT_QUEUED;
+    }
+    size_ = 0;
+}
+
+bool PeerExpiryQueue::contains(size_t slot) const {
+    return slot < capacity_ && positions_[slot] != NOT_QUEUED;
+}
+
+void PeerExpiryQueue::schedule(size_t slot, uint64_t deadline_us) {
+    if (slot >= capacity_) {
+        return;
+    }
+
+    if (positions_[slot] == NOT_QUEUED) {
+        heap_[size_].deadline_us = deadline_us;
+        heap_[size_].slot = slot;
+        positions_[slot] = size_;
+        size_++;
+        sift_up(size_ - 1);
+        return;
+    }
+
+    size_t index = positions_[slot];
+    uint64_t previous = heap_[index].deadline_us;
+    heap_[index].deadline_us = deadline_us;
+    if (deadline_us < previous) {
+        sift_up(index);
+    } else {
+        sift_down(index);
+    }
+}
+
+void PeerExpiryQueue::remove(size_t slot) {
+    if (!contains(slot)) {
+        return;
+    }
+
+    size_t index = positions_[slot];
+    size_--;
+    if (index != size_) {
+        swap_entries(index, size_);
+        // The entry moved in from the end may belong above or below this position
+        if (index > 0 && heap_[index].deadline_us < heap_[(index - 1) / 2].deadline_us) {
+            sift_up(index);
+        } else {
+            sift_down(index);
+        }
+    }
+    positions_[slot] = NOT_QUEUED;
+}
+
+void PeerExpiryQueue::swap_entries(size_t a, size_t b) {
+    entry_t tmp = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = tmp;
+    positions_[heap_[a].slot] = a;
+    positions_[heap_[b].slot] = b;
+}
+
+void PeerExpiryQueue::sift_up(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap_[parent].deadline_us <= heap_[index].deadline_us) {
+            break;
+        }
+        swap_entries(parent, index);
+        index = parent;
+    }
+}
+
+void PeerExpiryQueue::sift_down(size_t index) {
+    while (true) {
+        size_t smallest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if (left < size_ && heap_[left].deadline_us < heap_[smallest].deadline_us) {
+            smallest = left;
+        }
+        if (right < size_ && heap_[right].deadline_us < heap_[smallest].deadline_us) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        swap_entries(index, smallest);
+        index = smallest;
+    }
+}
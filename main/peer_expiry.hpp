@@ -0,0 +1,51 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define PEER_EXPIRY_TAG "PEER_EXPIRY"
+
+// Indexed min-heap of peer deadlines, one entry per peer table slot. The entry of a
+// slot can be moved or removed in O(log n) through its heap position. Deadlines are
+// allowed to be stale-early: last_seen_us only grows, so the owner re-checks the peer
+// when the head comes due and moves it later instead of touching the heap on every
+// received frame. All memory is allocated in initialize(). Not thread safe; callers lock.
+class PeerExpiryQueue {
+private:
+    typedef struct {
+        uint64_t deadline_us;
+        uint16_t slot;
+    } entry_t;
+
+    entry_t* heap_;
+    int16_t* positions_;   // Heap index of each slot, NOT_QUEUED when absent
+    size_t size_;
+    size_t capacity_;
+
+    static const int16_t NOT_QUEUED = -1;
+
+    void sift_up(size_t index);
+    void sift_down(size_t index);
+    void swap_entries(size_t a, size_t b);
+
+public:
+    PeerExpiryQueue();
+    ~PeerExpiryQueue();
+
+    esp_err_t initialize(size_t capacity);
+    void deinitialize();
+    void clear();
+
+    // Inserts the slot or moves its deadline, in either direction
+    void schedule(size_t slot, uint64_t deadline_us);
+    void remove(size_t slot);
+    bool contains(size_t slot) const;
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    // Valid only when not empty
+    uint64_t next_deadline_us() const { return heap_[0].deadline_us; }
+    size_t next_slot() const { return heap_[0].slot; }
+};
@@ -0,0 +1,188 @@
+#include "peer_table.hpp"
+#include <string.h>
+#include <new>
+
+PeerTable::PeerTable()
+    : slots_(nullptr), slot_keys_(nullptr), slot_used_(nullptr), free_slots_(nullptr),
+      free_count_(0), capacity_(0), index_(nullptr), index_mask_(0), deleted_count_(0) {
+}
+
+PeerTable::~PeerTable() {
+    deinitialize();
+}
+
+esp_err_t PeerTable::initialize(size_t capacity) {
+    if (slots_ || capacity == 0 || capacity > INT16_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Keep the index at most half full so probe sequences stay short
+    size_t index_size = 1;
+    while (index_size < capacity * 2) {
+        index_size <<= 1;
+    }
+
+    slots_ = new (std::nothrow) esp_now_peer_info_t[capacity];
+    slot_keys_ = new (std::nothrow) uint64_t[capacity];
+    slot_used_ = new (std::nothrow) bool[capacity];
+    free_slots_ = new (std::nothrow) uint16_t[capacity];
+    index_ = new (std::nothrow) int16_t[index_size];
+
+    if (!slots_ || !slot_keys_ || !slot_used_ || !free_slots_ || !index_) {
+        ESP_LOGE(PEER_TABLE_TAG, "Failed to allocate peer table for %zu peers", capacity);
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    capacity_ = capacity;
+    index_mask_ = index_size - 1;
+    clear();
+
+    ESP_LOGI(PEER_TABLE_TAG, "Peer table ready: %zu slots, %zu index entries", capacity_, index_size);
+    return ESP_OK;
+}
+
+void PeerTable::deinitialize() {
+    delete[] slots_;
+    delete[] slot_keys_;
+    delete[] slot_used_;
+    delete[] free_slots_;
+    delete[] index_;
+    slots_ = nullptr;
+    slot_keys_ = nullptr;
+    slot_used_ = nullptr;
+    free_slots_ = nullptr;
+    index_ = nullptr;
+    capacity_ = 0;
+    free_count_ = 0;
+    index_mask_ = 0;
+    deleted_count_ = 0;
+}
+
+void PeerTable::clear() {
+    if (!slots_) {
+        return;
+    }
+
+    // Hand out low slot numbers first
+    for (size_t i = 0; i < capacity_; i++) {
+        slot_used_[i] = false;
+        free_slots_[i] = capacity_ - 1 - i;
+    }
+    free_count_ = capacity_;
+
+    for (size_t i = 0; i <= index_mask_; i++) {
+        index_[i] = INDEX_EMPTY;
+    }
+    deleted_count_ = 0;
+}
+
+size_t PeerTable::hash(uint64_t key) const {
+    // Fibonacci hashing; the low MAC bytes vary most between devices of one vendor
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & index_mask_;
+}
+
+int PeerTable::find_index_position(uint64_t key) const {
+    if (!index_) {
+        return -1;
+    }
+
+    for (size_t pos = hash(key), probes = 0; probes <= index_mask_; pos = (pos + 1) & index_mask_, probes++) {
+        int16_t slot = index_[pos];
+        if (slot == INDEX_EMPTY) {
+            return -1;
+        }
+        if (slot >= 0 && slot_keys_[slot] == key) {
+            return (int)pos;
+        }
+    }
+    return -1;
+}
+
+int PeerTable::find_slot(const uint8_t* mac_addr) const {
+    int pos = find_index_position(peer_table_key(mac_addr));
+    return pos < 0 ? -1 : index_[pos];
+}
+
+esp_now_peer_info_t* PeerTable::find(const uint8_t* mac_addr) {
+    int slot = find_slot(mac_addr);
+    return slot < 0 ? nullptr : &slots_[slot];
+}
+
+esp_now_peer_info_t* PeerTable::insert(const uint8_t* mac_addr, int* slot_out) {
+    if (!slots_ || free_count_ == 0) {
+        return nullptr;
+    }
+
+    uint64_t key = peer_table_key(mac_addr);
+    if (find_index_position(key) >= 0) {
+        return nullptr;
+    }
+
+    // The index is never more than half full, so an empty or deleted position always exists
+    size_t pos = hash(key);
+    while (index_[pos] >= 0) {
+        pos = (pos + 1) & index_mask_;
+    }
+    if (index_[pos] == INDEX_DELETED) {
+        deleted_count_--;
+    }
+
+    uint16_t slot = free_slots_[--free_count_];
+    slot_used_[slot] = true;
+    slot_keys_[slot] = key;
+    index_[pos] = slot;
+
+    esp_now_peer_info_t* entry = &slots_[slot];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->mac_addr, mac_addr, 6);
+
+    if (slot_out) {
+        *slot_out = slot;
+    }
+    return entry;
+}
+
+bool PeerTable::remove(const uint8_t* mac_addr) {
+    int pos = find_index_position(peer_table_key(mac_addr));
+    if (pos < 0) {
+        return false;
+    }
+
+    int16_t slot = index_[pos];
+    index_[pos] = INDEX_DELETED;
+    deleted_count_++;
+    slot_used_[slot] = false;
+    free_slots_[free_count_++] = slot;
+
+    // Tombstones lengthen failed lookups; sweep them once they pile up
+    if (deleted_count_ > (index_mask_ + 1) / 4) {
+        rebuild_index();
+    }
+    return true;
+}
+
+void PeerTable::rebuild_index() {
+    for (size_t i = 0; i <= index_mask_; i++) {
+        index_[i] = INDEX_EMPTY;
+    }
+    deleted_count_ = 0;
+
+    for (size_t slot = 0; slot < capacity_; slot++) {
+        if (!slot_used_[slot]) {
+            continue;
+        }
+        size_t pos = hash(slot_keys_[slot]);
+        while (index_[pos] != INDEX_EMPTY) {
+            pos = (pos + 1) & index_mask_;
+        }
+        index_[pos] = slot;
+    }
+}
+
+esp_now_peer_info_t* PeerTable::at(size_t slot) {
+    if (slot >= capacity_ || !slot_used_[slot]) {
+        return nullptr;
+    }
+    return &slots_[slot];
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "rate_control.hpp"
+#include "key_manager.hpp"
+
+#define PEER_TABLE_TAG "PEER_TABLE"
+
+typedef struct {
+    uint8_t mac_addr[6];
+    int8_t rssi;                 // Smoothed (EWMA) RSSI of received frames, dBm
+    int8_t rssi_last;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int16_t rssi_ewma_q4;        // EWMA state in 1/16 dB
+    uint32_t rssi_samples;
+    uint8_t last_rx_rate;        // rx_ctrl rate/channel of the most recent frame
+    uint8_t last_rx_channel;
+    uint8_t channel;             // Driver registration channel; 0 follows the manager's channel
+    uint8_t espnow_version;      // Negotiated protocol version (1 = legacy 250-byte frames)
+    uint16_t max_payload_len;    // Largest payload this peer can receive from us
+    bool driver_registered;      // Currently holds one of the driver's peer slots
+    uint64_t driver_last_used_us;
+    uint64_t last_seen_us;
+    uint32_t timeout_ms;         // Expiry override; 0 uses the manager's timeout
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t packets_lost;
+    esp_now_peer_rate_t rate;    // PHY rate mode and link adaptation state
+    esp_now_peer_security_t security;
+    bool is_active;
+} esp_now_peer_info_t;
+
+static inline uint64_t peer_table_key(const uint8_t* mac_addr) {
+    return ((uint64_t)mac_addr[0] << 40) | ((uint64_t)mac_addr[1] << 32) |
+           ((uint64_t)mac_addr[2] << 24) | ((uint64_t)mac_addr[3] << 16) |
+           ((uint64_t)mac_addr[4] << 8) | (uint64_t)mac_addr[5];
+}
+
+// Fixed-capacity peer table. Entries live in slots that never move, so a slot
+// index (or pointer) stays valid until that peer is removed. Lookup goes
+// through an open-addressed index keyed by the MAC packed into a uint64_t.
+// All memory is allocated in initialize(). Not thread safe; callers lock.
+class PeerTable {
+private:
+    esp_now_peer_info_t* slots_;
+    uint64_t* slot_keys_;
+    bool* slot_used_;
+    uint16_t* free_slots_;
+    size_t free_count_;
+    size_t capacity_;
+
+    int16_t* index_;       // Slot number, INDEX_EMPTY or INDEX_DELETED
+    size_t index_mask_;
+    size_t deleted_count_;
+
+    static const int16_t INDEX_EMPTY = -1;
+    static const int16_t INDEX_DELETED = -2;
+
+    size_t hash(uint64_t key) const;
+    int find_index_position(uint64_t key) const;
+    void rebuild_index();
+
+public:
+    PeerTable();
+    ~PeerTable();
+
+    esp_err_t initialize(size_t capacity);
+    void deinitialize();
+
+    esp_now_peer_info_t* find(const uint8_t* mac_addr);
+    int find_slot(const uint8_t* mac_addr) const;
+
+    // Returns the new zeroed entry, or nullptr if the table is full or the MAC exists
+    esp_now_peer_info_t* insert(const uint8_t* mac_addr, int* slot = nullptr);
+    bool remove(const uint8_t* mac_addr);
+    void clear();
+
+    // Entry at a slot index, nullptr if the slot is free
+    esp_now_peer_info_t* at(size_t slot);
+    size_t slot_count() const { return capacity_; }
+    size_t size() const { return capacity_ - free_count_; }
+    size_t capacity() const { return capacity_; }
+    bool full() const { return free_count_ == 0; }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+        for (size_t i = 0; i < capacity_; i++) {
+            if (slot_used_[i]) {
+                fn(slots_[i]);
+            }
+        }
+    }
+};
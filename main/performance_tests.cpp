@@ -1,12 +1,11 @@
 #include "performance_tests.hpp"
+#include "result_export.hpp"
 #include <esp_timer.h>
-#include <esp_random.h>
 #include <cmath>
 #include <algorithm>
-#include <numeric>
 
 PerformanceTests::PerformanceTests(TestFramework& framework, ESPNowManager& manager)
-    : test_framework_(framework), esp_now_manager_(manager),
+    : test_framework_(framework), esp_now_manager_(manager), flash_log_(nullptr),
       test_active_(false), current_test_sequence_(0) {
 }
 
@@ -36,8 +35,11 @@ esp_err_t PerformanceTests::test_basic_discovery(discovery_test_result_t& result
         return ret;
     }
 
-    // Wait for discovery to complete
-    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    // Discovery runs in the background; block until its run reports completion
+    if (esp_now_manager_.wait_for_discovery(pdMS_TO_TICKS(timeout_ms + 1000)) != ESP_OK) {
+        ESP_LOGW(PERFORMANCE_TESTS_TAG, "Discovery did not complete in time");
+        esp_now_manager_.stop_discovery();
+    }
 
     uint64_t end_time = esp_timer_get_time();
 
@@ -56,7 +58,7 @@ esp_err_t PerformanceTests::test_basic_discovery(discovery_test_result_t& result
         result.max_discovery_time_ms = avg_time * 1.2f;
 
         for (uint32_t i = 0; i < result.devices_found; i++) {
-            result.individual_discovery_times.push_back((uint32_t)(avg_time + (i * 100)));
+            result.individual_discovery_times_ms.add(avg_time + (i * 100));
         }
     }
 
@@ -77,76 +79,138 @@ esp_err_t PerformanceTests::test_ping_pong_latency(latency_test_result_t& result
     result.ping_count = ping_count;
     test_active_ = true;
 
-    // Setup ping response tracking
-    ping_timestamps_.clear();
-    ping_sequence_numbers_.clear();
-    ping_timestamps_.reserve(ping_count);
-    ping_sequence_numbers_.reserve(ping_count);
+    // Real RTT: PONGs are matched to PINGs by id, several pings in flight
+    rtt_measure_config_t config = RttEngine::default_config(ping_count);
+    config.interval_ms = 5;
+    rtt_run_stats_t rtt_stats = {};
 
-    setup_ping_response_handler();
+    esp_err_t ret = esp_now_manager_.get_rtt_engine().measure(target_mac, config,
+        [this, &result](const rtt_sample_t& sample) {
+            float latency_ms = sample.rtt_us / 1000.0f;
+            result.latency_ms.add(latency_ms);
 
-    // Send pings and measure latencies
-    for (uint32_t i = 0; i < ping_count && test_active_; i++) {
-        uint64_t ping_start_time = esp_timer_get_time();
+            if (ping_response_callback_) {
+                ping_response_callback_(sample.ping_id, latency_ms);
+            }
+        }, &rtt_stats);
 
-        // Store timestamp and sequence for matching responses
-        ping_timestamps_.push_back(ping_start_time);
-        ping_sequence_numbers_.push_back(i);
+    if (ret != ESP_OK) {
+        test_active_ = false;
+        ESP_LOGE(PERFORMANCE_TESTS_TAG, "RTT measurement failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
-        esp_err_t ret = esp_now_manager_.send_ping(target_mac);
-        if (ret != ESP_OK) {
-            ESP_LOGW(PERFORMANCE_TESTS_TAG, "Failed to send ping %lu: %s", i, esp_err_to_name(ret));
-            result.packets_lost++;
-            continue;
-        }
+    result.packets_lost = rtt_stats.timed_out + rtt_stats.send_failures;
 
-        // Wait for response (in real implementation, this would be handled by callback)
-        vTaskDelay(pdMS_TO_TICKS(10));
+    result.avg_latency_ms = result.latency_ms.mean();
+    result.min_latency_ms = result.latency_ms.min();
+    result.max_latency_ms = result.latency_ms.max();
+    result.stddev_latency_ms = result.latency_ms.stddev();
+    result.jitter_ms = result.latency_ms.jitter();
+
+    result.packet_loss_percent = ((float)result.packets_lost / ping_count) * 100.0f;
+
+    test_active_ = false;
+    log_latency_result(result);
 
-        // Simulate response time measurement (in real implementation, would be precise)
-        uint64_t response_time = esp_timer_get_time();
-        float latency_ms = (response_time - ping_start_time) / 1000.0f;
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Latency test completed: avg %.2f ms, loss %.1f%%",
+             result.avg_latency_ms, result.packet_loss_percent);
 
-        // Add some realistic variation (3-15ms for ESP-NOW)
-        latency_ms += 3.0f + ((esp_random() % 12000) / 1000.0f);
+    return ESP_OK;
+}
 
-        result.latency_measurements.push_back(latency_ms);
+esp_err_t PerformanceTests::test_variable_payload_latency(std::vector<latency_test_result_t>& results,
+                                                         const uint8_t* target_mac, uint32_t ping_count) {
+    // The responder echoes the full PING payload, so RTT covers the payload size both ways
+    const size_t payload_sizes[] = {sizeof(esp_now_ping_payload_t), 64, 128, ESP_NOW_MAX_PAYLOAD_LEN,
+                                    512, 1024, ESP_NOW_MAX_PAYLOAD_LEN_V2};
+    size_t max_payload = esp_now_manager_.get_max_payload_len(target_mac);
 
-        // Small delay between pings to avoid overwhelming the network
-        if (i < ping_count - 1) {
-            vTaskDelay(pdMS_TO_TICKS(5));
-        }
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting variable payload latency test (%lu pings per size)", ping_count);
+
+    results.clear();
+    test_active_ = true;
+
+    for (size_t size : payload_sizes) {
+        if (size > max_payload || !test_active_) continue;
+
+        latency_test_result_t result = {};
+        result.ping_count = ping_count;
+
+        rtt_measure_config_t config = RttEngine::default_config(ping_count);
+        config.payload_len = size;
+        rtt_run_stats_t rtt_stats = {};
+
+        esp_now_manager_.get_rtt_engine().measure(target_mac, config,
+            [&result](const rtt_sample_t& sample) {
+                result.latency_ms.add(sample.rtt_us / 1000.0f);
+            }, &rtt_stats);
+
+        result.packets_lost = rtt_stats.timed_out + rtt_stats.send_failures;
+        result.packet_loss_percent = ping_count > 0 ? ((float)result.packets_lost / ping_count) * 100.0f : 0.0f;
+
+        result.avg_latency_ms = result.latency_ms.mean();
+        result.min_latency_ms = result.latency_ms.min();
+        result.max_latency_ms = result.latency_ms.max();
+        result.stddev_latency_ms = result.latency_ms.stddev();
+        result.jitter_ms = result.latency_ms.jitter();
+
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "  %4zu bytes: avg %.2f ms, min %.2f ms, max %.2f ms, loss %.1f%%",
+                 size, result.avg_latency_ms, result.min_latency_ms, result.max_latency_ms,
+                 result.packet_loss_percent);
+        results.push_back(result);
     }
 
-    // Calculate statistics
-    if (!result.latency_measurements.empty()) {
-        result.avg_latency_ms = std::accumulate(result.latency_measurements.begin(),
-                                               result.latency_measurements.end(), 0.0f) /
-                               result.latency_measurements.size();
+    test_active_ = false;
+    return ESP_OK;
+}
 
-        auto minmax = std::minmax_element(result.latency_measurements.begin(),
-                                         result.latency_measurements.end());
-        result.min_latency_ms = *minmax.first;
-        result.max_latency_ms = *minmax.second;
+esp_err_t PerformanceTests::test_callback_overhead(const uint8_t* target_mac, uint32_t iterations) {
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting driver callback overhead benchmark (%lu iterations)", iterations);
 
-        // Calculate standard deviation
-        float sum_squared_diff = 0.0f;
-        for (float latency : result.latency_measurements) {
-            float diff = latency - result.avg_latency_ms;
-            sum_squared_diff += diff * diff;
-        }
-        result.stddev_latency_ms = std::sqrt(sum_squared_diff / result.latency_measurements.size());
+    test_active_ = true;
 
-        result.jitter_ms = calculate_jitter(result.latency_measurements);
+    // Before: the work the receive/send callbacks used to do inline on the Wi-Fi task,
+    // i.e. a CRC over a full v1 frame plus a peers_mutex_ round trip with a peer lookup
+    esp_now_message_t frame = {};
+    frame.payload_length = ESP_NOW_MAX_PAYLOAD_LEN;
+    memset(frame.payload, 0xA5, frame.payload_length);
+
+    uint64_t inline_total_us = 0;
+    uint32_t inline_max_us = 0;
+    for (uint32_t i = 0; i < iterations && test_active_; i++) {
+        uint64_t start = esp_timer_get_time();
+        volatile uint32_t crc = esp_now_message_crc(&frame);
+        (void)crc;
+        esp_now_manager_.is_peer_registered(target_mac);
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+        inline_total_us += elapsed;
+        inline_max_us = std::max(inline_max_us, elapsed);
     }
 
-    result.packet_loss_percent = ((float)result.packets_lost / ping_count) * 100.0f;
+    // After: the real callbacks, driven by ping traffic (TX completions and PONG receptions)
+    esp_now_manager_.reset_callback_timing();
+    for (uint32_t i = 0; i < iterations && test_active_; i++) {
+        esp_now_manager_.send_ping(target_mac);
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    vTaskDelay(pdMS_TO_TICKS(200)); // Let outstanding completions arrive
+
+    esp_now_callback_timing_t rx_timing = esp_now_manager_.get_receive_callback_timing();
+    esp_now_callback_timing_t tx_timing = esp_now_manager_.get_send_callback_timing();
 
     test_active_ = false;
-    log_latency_result(result);
 
-    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Latency test completed: avg %.2f ms, loss %.1f%%",
-             result.avg_latency_ms, result.packet_loss_percent);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Callback Overhead Result:");
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Inline validation + peer stats (before): avg %.2f us, max %lu us",
+             iterations > 0 ? (float)inline_total_us / iterations : 0.0f, inline_max_us);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Receive callback (after): avg %.2f us, max %lu us over %lu frames",
+             rx_timing.invocations > 0 ? (float)rx_timing.total_us / rx_timing.invocations : 0.0f,
+             rx_timing.max_us, rx_timing.invocations);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Send callback (after): avg %.2f us, max %lu us over %lu frames",
+             tx_timing.invocations > 0 ? (float)tx_timing.total_us / tx_timing.invocations : 0.0f,
+             tx_timing.max_us, tx_timing.invocations);
 
     return ESP_OK;
 }
@@ -170,37 +234,45 @@ esp_err_t PerformanceTests::test_unidirectional_throughput(throughput_test_resul
     uint64_t end_time = start_time + (duration_ms * 1000);
 
     uint32_t packets_sent = 0;
-    uint32_t total_bytes_sent = 0;
-    uint32_t send_failures = 0;
 
-    // Send packets continuously for the duration
+    esp_now_peer_info_t peer_before = {};
+    esp_now_manager_.get_peer_info(target_mac, &peer_before);
+
+    // Send as fast as the flow-control window allows; send_message blocks on backpressure
     while (esp_timer_get_time() < end_time && test_active_) {
         esp_err_t ret = esp_now_manager_.send_message(target_mac, ESP_NOW_MSG_TYPE_TEST_DATA,
-                                                     payload.data(), payload.size());
+                                                     payload.data(), payload.size(),
+                                                     pdMS_TO_TICKS(100));
         if (ret == ESP_OK) {
             packets_sent++;
-            total_bytes_sent += packet_size;
-        } else {
-            send_failures++;
         }
+    }
 
-        // Small delay to prevent overwhelming the system
-        vTaskDelay(pdMS_TO_TICKS(1));
+    // Let queued frames complete so every sent frame has an outcome
+    for (int i = 0; i < 100 && esp_now_manager_.get_send_queue_depth() > 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
 
     uint64_t actual_end_time = esp_timer_get_time();
     uint32_t actual_duration_ms = (actual_end_time - start_time) / 1000;
 
-    // Calculate throughput
+    esp_now_peer_info_t peer_after = {};
+    esp_now_manager_.get_peer_info(target_mac, &peer_after);
+    uint32_t packets_acked = peer_after.packets_sent - peer_before.packets_sent;
+    uint32_t packets_lost = peer_after.packets_lost - peer_before.packets_lost;
+
+    // Calculate throughput from frames the peer acknowledged
     if (actual_duration_ms > 0) {
-        result.throughput_bps = (total_bytes_sent * 8 * 1000.0f) / actual_duration_ms;
+        result.throughput_bps = ((float)packets_acked * packet_size * 8 * 1000.0f) / actual_duration_ms;
     }
 
     result.packets_sent = packets_sent;
-    result.packets_received = packets_sent; // Assume all sent packets were received for now
+    result.packets_received = packets_acked;
     result.duration_ms = actual_duration_ms;
-    result.packet_loss_percent = ((float)send_failures / (packets_sent + send_failures)) * 100.0f;
-    result.avg_rssi_dbm = simulate_rssi_measurement();
+    if (packets_acked + packets_lost > 0) {
+        result.packet_loss_percent = ((float)packets_lost / (packets_acked + packets_lost)) * 100.0f;
+    }
+    result.avg_rssi_dbm = read_peer_rssi(target_mac);
 
     test_active_ = false;
     log_throughput_result(result);
@@ -211,6 +283,107 @@ esp_err_t PerformanceTests::test_unidirectional_throughput(throughput_test_resul
     return ESP_OK;
 }
 
+esp_err_t PerformanceTests::test_variable_payload_throughput(std::vector<throughput_test_result_t>& results,
+                                                            const uint8_t* target_mac,
+                                                            uint32_t duration_ms) {
+    // v1 sizes first, then the ESP-NOW v2 sizes if the peer negotiated large frames
+    const uint32_t payload_sizes[] = {16, 64, 128, 200, ESP_NOW_MAX_PAYLOAD_LEN,
+                                      512, 1024, ESP_NOW_MAX_PAYLOAD_LEN_V2};
+    size_t max_payload = esp_now_manager_.get_max_payload_len(target_mac);
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting variable payload throughput test (max payload %zu bytes)",
+             max_payload);
+
+    results.clear();
+
+    for (uint32_t size : payload_sizes) {
+        if (size > max_payload) {
+            ESP_LOGI(PERFORMANCE_TESTS_TAG, "Skipping %lu byte payload (peer limit %zu bytes)", size, max_payload);
+            continue;
+        }
+
+        throughput_test_result_t result = {};
+        esp_err_t ret = test_unidirectional_throughput(result, target_mac, duration_ms, size);
+        if (ret == ESP_OK) {
+            results.push_back(result);
+        }
+    }
+
+    analyze_throughput_consistency(results);
+    return ESP_OK;
+}
+
+esp_err_t PerformanceTests::test_encryption_overhead(std::vector<latency_test_result_t>& latency_results,
+                                                    std::vector<throughput_test_result_t>& throughput_results,
+                                                    const uint8_t* target_mac, uint32_t ping_count) {
+    KeyManager& keys = esp_now_manager_.get_key_manager();
+    if (!keys.is_enabled()) {
+        ESP_LOGW(PERFORMANCE_TESTS_TAG, "Peer security is disabled");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_now_peer_info_t peer;
+    if (esp_now_manager_.get_peer_info(target_mac, &peer) != ESP_OK || !peer.security.keyed) {
+        ESP_LOGW(PERFORMANCE_TESTS_TAG, "Encryption overhead test needs a keyed peer");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting encryption overhead test (%lu pings per mode)", ping_count);
+
+    const size_t frame_sizes[] = {ESP_NOW_MESSAGE_HEADER_LEN + 32, ESP_NOW_MAX_DATA_LEN, ESP_NOW_MAX_DATA_LEN_V2};
+    for (size_t size : frame_sizes) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "Tag over %zu byte frame: %.1f us", size, keys.measure_tag_cost_us(size, 200));
+    }
+
+    // Rebalancing would move the peer to another mode in the middle of a measurement
+    keys.set_auto_rebalance(false);
+
+    // Plaintext is only negotiable when require_secure is off
+    const esp_now_link_mode_t modes[] = {ESP_NOW_LINK_PLAINTEXT, ESP_NOW_LINK_AUTH, ESP_NOW_LINK_ENCRYPTED};
+    std::vector<esp_now_link_mode_t> measured;
+    latency_results.clear();
+    throughput_results.clear();
+
+    for (esp_now_link_mode_t mode : modes) {
+        esp_err_t ret = keys.request_link_mode(target_mac, mode);
+        if (ret != ESP_OK) {
+            ESP_LOGW(PERFORMANCE_TESTS_TAG, "Skipping %s mode: %s", KeyManager::link_mode_name(mode), esp_err_to_name(ret));
+            continue;
+        }
+        // The peer switches a moment after answering
+        vTaskDelay(pdMS_TO_TICKS(KEY_SLOT_SWITCH_DELAY_MS * 2));
+
+        latency_test_result_t latency = {};
+        throughput_test_result_t throughput = {};
+        if (test_ping_pong_latency(latency, target_mac, ping_count) != ESP_OK ||
+            test_unidirectional_throughput(throughput, target_mac, 5000, 200) != ESP_OK) {
+            ESP_LOGW(PERFORMANCE_TESTS_TAG, "Measurement in %s mode failed", KeyManager::link_mode_name(mode));
+            continue;
+        }
+        latency_results.push_back(latency);
+        throughput_results.push_back(throughput);
+        measured.push_back(mode);
+    }
+
+    keys.request_link_mode(target_mac, (esp_now_link_mode_t)peer.security.mode);
+    keys.set_auto_rebalance(esp_now_manager_.get_security_config().auto_rebalance);
+
+    if (measured.empty()) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Mode        RTT avg ms  vs first  Throughput kbps  vs first");
+    for (size_t i = 0; i < measured.size(); i++) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "%-10s  %10.3f  %+8.3f  %15.1f  %+8.1f",
+                 KeyManager::link_mode_name(measured[i]), latency_results[i].avg_latency_ms,
+                 latency_results[i].avg_latency_ms - latency_results[0].avg_latency_ms,
+                 throughput_results[i].throughput_bps / 1000.0f,
+                 (throughput_results[i].throughput_bps - throughput_results[0].throughput_bps) / 1000.0f);
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t PerformanceTests::test_distance_performance(std::vector<range_test_result_t>& results,
                                                      const uint8_t* target_mac,
                                                      uint32_t max_distance_meters,
@@ -237,34 +410,33 @@ esp_err_t PerformanceTests::test_distance_performance(std::vector<range_test_res
         uint32_t test_packets = 100;
         uint32_t successful_packets = 0;
 
+        uint32_t rssi_samples = 0;
+        read_peer_rssi(target_mac, &rssi_samples);
+
         for (uint32_t i = 0; i < test_packets; i++) {
             esp_err_t ret = esp_now_manager_.send_ping(target_mac);
             if (ret == ESP_OK) {
                 successful_packets++;
-
-                // Simulate RSSI measurement (would be real in actual implementation)
-                int8_t rssi = simulate_rssi_measurement();
-                // Adjust RSSI based on distance (rough approximation)
-                rssi -= (distance / 10) * 3; // 3 dB per 10 meters
-                range_result.rssi_measurements.push_back(rssi);
             }
 
             vTaskDelay(pdMS_TO_TICKS(50)); // 50ms between packets
+
+            // Record the RSSI of the PONG frame if one arrived since the last sample
+            esp_now_peer_info_t peer;
+            if (esp_now_manager_.get_peer_info(target_mac, &peer) == ESP_OK &&
+                peer.rssi_samples != rssi_samples) {
+                rssi_samples = peer.rssi_samples;
+                range_result.rssi_dbm.add(peer.rssi_last);
+            }
         }
 
         range_result.packets_sent = test_packets;
         range_result.packets_received = successful_packets;
         range_result.packet_loss_percent = ((float)(test_packets - successful_packets) / test_packets) * 100.0f;
 
-        if (!range_result.rssi_measurements.empty()) {
-            auto minmax = std::minmax_element(range_result.rssi_measurements.begin(),
-                                             range_result.rssi_measurements.end());
-            range_result.min_rssi_dbm = *minmax.first;
-            range_result.max_rssi_dbm = *minmax.second;
-            range_result.avg_rssi_dbm = std::accumulate(range_result.rssi_measurements.begin(),
-                                                       range_result.rssi_measurements.end(), 0) /
-                                       range_result.rssi_measurements.size();
-        }
+        range_result.min_rssi_dbm = (int8_t)range_result.rssi_dbm.min();
+        range_result.max_rssi_dbm = (int8_t)range_result.rssi_dbm.max();
+        range_result.avg_rssi_dbm = (int8_t)std::lround(range_result.rssi_dbm.mean());
 
         range_result.connection_stable = (range_result.packet_loss_percent < 10.0f);
 
@@ -306,6 +478,12 @@ esp_err_t PerformanceTests::run_full_performance_suite() {
         return ESP_ERR_NOT_FOUND;
     }
 
+    // Prefer the peer with the best measured link
+    auto ranked_peers = esp_now_manager_.get_peers_by_rssi(INT8_MIN);
+    if (!ranked_peers.empty()) {
+        peers = ranked_peers;
+    }
+
     const uint8_t* target_mac = peers[0].mac_addr;
 
     // Latency tests
@@ -315,6 +493,12 @@ esp_err_t PerformanceTests::run_full_performance_suite() {
         ESP_LOGE(PERFORMANCE_TESTS_TAG, "Latency test suite failed");
     }
 
+    // Driver callback cost
+    ret = test_callback_overhead(target_mac, 1000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(PERFORMANCE_TESTS_TAG, "Callback overhead benchmark failed");
+    }
+
     // Throughput tests
     std::vector<throughput_test_result_t> throughput_results;
     ret = run_throughput_test_suite(throughput_results, target_mac);
@@ -322,6 +506,16 @@ esp_err_t PerformanceTests::run_full_performance_suite() {
         ESP_LOGE(PERFORMANCE_TESTS_TAG, "Throughput test suite failed");
     }
 
+    // Cost of each link mode; needs peer security
+    if (esp_now_manager_.get_key_manager().is_enabled()) {
+        std::vector<latency_test_result_t> crypto_latency;
+        std::vector<throughput_test_result_t> crypto_throughput;
+        ret = test_encryption_overhead(crypto_latency, crypto_throughput, target_mac);
+        if (ret != ESP_OK) {
+            ESP_LOGE(PERFORMANCE_TESTS_TAG, "Encryption overhead test failed");
+        }
+    }
+
     // Reliability tests
     std::vector<range_test_result_t> range_results;
     std::vector<throughput_test_result_t> reliability_results;
@@ -330,6 +524,13 @@ esp_err_t PerformanceTests::run_full_performance_suite() {
         ESP_LOGE(PERFORMANCE_TESTS_TAG, "Reliability test suite failed");
     }
 
+    // Aggregate capacity and contention as concurrent senders are added
+    std::vector<uint16_t> bench_payloads = {64, 200, (uint16_t)ESP_NOW_MAX_PAYLOAD_LEN};
+    ret = test_framework_.get_mesh_benchmark().run_scaling_sweep(peers, true, bench_payloads, 5000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(PERFORMANCE_TESTS_TAG, "Mesh scaling benchmark failed");
+    }
+
     // Generate comprehensive report
     generate_performance_report();
 
@@ -426,6 +627,13 @@ esp_err_t PerformanceTests::run_throughput_test_suite(std::vector<throughput_tes
         results.push_back(large_result);
     }
 
+    // Payload sweep, including ESP-NOW v2 frame sizes where negotiated
+    std::vector<throughput_test_result_t> sweep_results;
+    ret = test_variable_payload_throughput(sweep_results, target_mac, 15000);
+    if (ret == ESP_OK) {
+        results.insert(results.end(), sweep_results.begin(), sweep_results.end());
+    }
+
     return ESP_OK;
 }
 
@@ -449,6 +657,12 @@ esp_err_t PerformanceTests::run_reliability_test_suite(std::vector<range_test_re
         reliability_results.push_back(loss_result);
     }
 
+    // Channel survey and move away from interference, if a better channel exists
+    ret = test_interference_resilience(reliability_results, target_mac);
+    if (ret != ESP_OK) {
+        ESP_LOGW(PERFORMANCE_TESTS_TAG, "Interference resilience test failed: %s", esp_err_to_name(ret));
+    }
+
     return ESP_OK;
 }
 
@@ -462,60 +676,349 @@ esp_err_t PerformanceTests::test_packet_loss_analysis(throughput_test_result_t&
 
     result.packet_size = 100; // Fixed size for loss analysis
     uint32_t packets_sent = 0;
-    uint32_t send_failures = 0;
+
+    // Loss is measured by the reliable channel's ACKs rather than local send errors
+    ReliableChannel& channel = esp_now_manager_.get_reliable_channel();
+    reliable_stats_t before = {};
+    channel.get_peer_stats(target_mac, &before);
 
     uint64_t start_time = esp_timer_get_time();
 
     for (uint32_t i = 0; i < packet_count && test_active_; i++) {
         uint8_t test_data[100];
         memset(test_data, 0xAA, sizeof(test_data));
+        memcpy(test_data, &i, sizeof(i));
 
-        esp_err_t ret = esp_now_manager_.send_message(target_mac, ESP_NOW_MSG_TYPE_TEST_DATA,
-                                                     test_data, sizeof(test_data));
-        if (ret == ESP_OK) {
+        if (channel.send(target_mac, test_data, sizeof(test_data)) == ESP_OK) {
             packets_sent++;
-        } else {
-            send_failures++;
         }
 
         // 10ms between packets
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 
+    // Wait for the last frames to be acknowledged or given up on
+    for (int i = 0; i < 200 && channel.get_outstanding(target_mac) > 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
     uint64_t end_time = esp_timer_get_time();
+
+    reliable_stats_t after = {};
+    channel.get_peer_stats(target_mac, &after);
+    uint32_t transmissions = after.transmissions - before.transmissions;
+    uint32_t retransmissions = after.retransmissions - before.retransmissions;
+    uint32_t failed = after.frames_failed - before.frames_failed;
+
     result.duration_ms = (end_time - start_time) / 1000;
     result.packets_sent = packets_sent;
-    result.packets_received = packets_sent; // Would need ACK mechanism for accurate count
-    result.packet_loss_percent = ((float)send_failures / (packets_sent + send_failures)) * 100.0f;
+    result.packets_received = after.frames_acked - before.frames_acked;
+    // Frames the application lost despite retransmission
+    result.packet_loss_percent = packets_sent > 0 ? ((float)failed / packets_sent) * 100.0f : 0.0f;
 
     test_active_ = false;
     log_throughput_result(result);
 
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Air loss before retransmission: %.1f%% (%lu of %lu transmissions retried)",
+             transmissions > 0 ? ((float)retransmissions / transmissions) * 100.0f : 0.0f,
+             retransmissions, transmissions);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "Packet loss analysis completed: %.1f%% loss",
              result.packet_loss_percent);
 
     return ESP_OK;
 }
 
-void PerformanceTests::setup_ping_response_handler() {
-    // In a real implementation, this would set up proper response handling
-    // For now, it's a placeholder for the response tracking mechanism
+esp_err_t PerformanceTests::test_interference_resilience(std::vector<throughput_test_result_t>& results,
+                                                        const uint8_t* target_mac) {
+    ChannelManager& channels = esp_now_manager_.get_channel_manager();
+    uint8_t start_channel = esp_now_manager_.get_channel();
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting interference resilience test on channel %u", start_channel);
+
+    throughput_test_result_t before = {};
+    esp_err_t ret = test_unidirectional_throughput(before, target_mac, 5000, 200);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    results.push_back(before);
+
+    uint8_t candidates[ESP_NOW_CHANNEL_SURVEY_MAX];
+    size_t count = channels.default_candidates(candidates, sizeof(candidates));
+    uint8_t selected = start_channel;
+    ret = channels.select_channel(candidates, count, CHANNEL_SURVEY_DEFAULT_DWELL_MS, &selected);
+    if (ret != ESP_OK && ret != ESP_ERR_TIMEOUT) {
+        ESP_LOGE(PERFORMANCE_TESTS_TAG, "Channel selection failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(PERFORMANCE_TESTS_TAG, "Not every peer confirmed the move to channel %u", selected);
+    }
+
+    if (selected == start_channel) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "Channel %u is already the best candidate", start_channel);
+        return ESP_OK;
+    }
+
+    throughput_test_result_t after = {};
+    ret = test_unidirectional_throughput(after, target_mac, 5000, 200);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    results.push_back(after);
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Channel %u -> %u: %.1f -> %.1f kbps, loss %.1f%% -> %.1f%%",
+             start_channel, selected, before.throughput_bps / 1000.0f, after.throughput_bps / 1000.0f,
+             before.packet_loss_percent, after.packet_loss_percent);
+    return ESP_OK;
 }
 
-float PerformanceTests::calculate_jitter(const std::vector<float>& latencies) {
-    if (latencies.size() < 2) return 0.0f;
+esp_err_t PerformanceTests::test_connection_stability(stability_test_result_t& result,
+                                                     const uint8_t* target_mac, uint32_t duration_hours) {
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting connection stability test (%lu hours)", duration_hours);
 
-    std::vector<float> differences;
-    for (size_t i = 1; i < latencies.size(); i++) {
-        differences.push_back(std::abs(latencies[i] - latencies[i-1]));
+    memset(&result, 0, sizeof(result));
+    result.test_duration_hours = duration_hours;
+    test_active_ = true;
+
+    // One probe window per second; a window without a single PONG counts as link down
+    const uint32_t window_ms = 1000;
+    rtt_measure_config_t config = RttEngine::default_config(5);
+    config.interval_ms = 20;
+
+    uint64_t start_time = esp_timer_get_time();
+    uint64_t end_time = start_time + (uint64_t)duration_hours * 3600ULL * 1000000ULL;
+    uint32_t windows = 0;
+    uint32_t windows_up = 0;
+    bool link_up = true;
+    uint64_t down_since_us = 0;
+
+    if (flash_log_) {
+        flash_log_stability_start_t start = {};
+        start.duration_hours = duration_hours;
+        memcpy(start.target_mac, target_mac, 6);
+        flash_log_->append(FLASH_LOG_RECORD_STABILITY_START, &start, sizeof(start));
     }
+    flash_log_stability_interval_t interval = {};
+    float interval_rtt_sum_ms = 0.0f;
+    uint32_t interval_rtt_samples = 0;
 
-    return std::accumulate(differences.begin(), differences.end(), 0.0f) / differences.size();
+    while (esp_timer_get_time() < end_time && test_active_) {
+        uint64_t window_start = esp_timer_get_time();
+
+        rtt_run_stats_t rtt_stats = {};
+        esp_now_manager_.get_rtt_engine().measure(target_mac, config,
+            [&](const rtt_sample_t& sample) {
+                float rtt_ms = sample.rtt_us / 1000.0f;
+                result.latency_ms.add(rtt_ms);
+                interval_rtt_sum_ms += rtt_ms;
+                interval_rtt_samples++;
+                if (rtt_ms > interval.rtt_max_ms) {
+                    interval.rtt_max_ms = rtt_ms;
+                }
+            }, &rtt_stats);
+
+        if (interval.windows == 0) {
+            interval.first_window = windows;
+        }
+        windows++;
+        interval.windows++;
+        interval.packets_sent += rtt_stats.sent;
+        interval.packets_received += rtt_stats.received;
+        result.total_packets_sent += rtt_stats.sent;
+        result.total_packets_received += rtt_stats.received;
+        if (rtt_stats.sent > 0) {
+            result.packet_loss_percent.add(
+                ((float)(rtt_stats.sent - rtt_stats.received) / rtt_stats.sent) * 100.0f);
+        }
+
+        bool up = rtt_stats.received > 0;
+        if (up) {
+            windows_up++;
+            interval.windows_up++;
+            if (!link_up) {
+                float outage_ms = (esp_timer_get_time() - down_since_us) / 1000.0f;
+                result.successful_reconnections++;
+                result.reconnection_times_ms.add(outage_ms);
+                ESP_LOGI(PERFORMANCE_TESTS_TAG, "Link restored after %.0f ms", outage_ms);
+                log_link_event(windows, true, outage_ms);
+            }
+        } else {
+            if (link_up) {
+                result.connection_drops++;
+                result.last_drop_time_us = window_start;
+                down_since_us = window_start;
+                ESP_LOGW(PERFORMANCE_TESTS_TAG, "Link lost (drop %lu)", result.connection_drops);
+                log_link_event(windows, false, 0.0f);
+            }
+            // Rediscovery re-registers a peer that rebooted or changed its capabilities
+            result.reconnection_attempts++;
+            esp_now_manager_.send_discovery_request();
+        }
+        link_up = up;
+
+        if (flash_log_ && interval.windows >= STABILITY_LOG_INTERVAL_WINDOWS) {
+            interval.rtt_mean_ms = interval_rtt_samples > 0 ? interval_rtt_sum_ms / interval_rtt_samples : 0.0f;
+            interval.connection_drops = result.connection_drops;
+            flash_log_->append(FLASH_LOG_RECORD_STABILITY_INTERVAL, &interval, sizeof(interval));
+            memset(&interval, 0, sizeof(interval));
+            interval_rtt_sum_ms = 0.0f;
+            interval_rtt_samples = 0;
+        }
+
+        if (windows % STABILITY_SNAPSHOT_WINDOWS == 0) {
+            ESP_LOGI(PERFORMANCE_TESTS_TAG, "Stability: %lu min, %lu drops, loss %.2f%%, RTT p50 %.2f / p99 %.2f ms",
+                     windows / 60, result.connection_drops, result.packet_loss_percent.mean(),
+                     result.latency_ms.p50(), result.latency_ms.p99());
+            if (flash_log_) {
+                result_statistics_record_t snapshot;
+                ResultExporter::encode_statistics(esp_now_manager_.get_statistics(), &snapshot);
+                flash_log_->append(FLASH_LOG_RECORD_STATISTICS, &snapshot, sizeof(snapshot));
+            }
+        }
+
+        uint32_t elapsed_ms = (esp_timer_get_time() - window_start) / 1000;
+        if (elapsed_ms < window_ms) {
+            vTaskDelay(pdMS_TO_TICKS(window_ms - elapsed_ms));
+        }
+    }
+
+    result.uptime_percent = windows > 0 ? ((float)windows_up / windows) * 100.0f : 0.0f;
+    result.avg_packet_loss_percent = result.packet_loss_percent.mean();
+
+    if (flash_log_) {
+        flash_log_stability_summary_t summary = {};
+        summary.windows = windows;
+        summary.packets_sent = result.total_packets_sent;
+        summary.packets_received = result.total_packets_received;
+        summary.connection_drops = result.connection_drops;
+        summary.reconnection_attempts = result.reconnection_attempts;
+        summary.successful_reconnections = result.successful_reconnections;
+        summary.uptime_percent = result.uptime_percent;
+        summary.avg_packet_loss_percent = result.avg_packet_loss_percent;
+        summary.rtt_p50_ms = result.latency_ms.p50();
+        summary.rtt_p99_ms = result.latency_ms.p99();
+        summary.rtt_max_ms = result.latency_ms.max();
+        summary.reconnection_mean_ms = result.reconnection_times_ms.mean();
+        flash_log_->append(FLASH_LOG_RECORD_STABILITY_SUMMARY, &summary, sizeof(summary));
+        flash_log_->flush();
+    }
+
+    test_active_ = false;
+    log_stability_result(result);
+    return ESP_OK;
+}
+
+esp_err_t PerformanceTests::test_power_consumption_analysis(std::vector<power_test_result_t>& results,
+                                                            const uint8_t* target_mac, uint32_t duration_minutes) {
+    PowerManager& power = esp_now_manager_.get_power_manager();
+    esp_now_power_config_t original = power.get_config();
+    uint32_t profile_ms = std::max<uint32_t>(duration_minutes * 60000 / 3, 10000);
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Starting power consumption analysis (%lu s per profile, current %s)",
+             profile_ms / 1000, current_sensor_ ? "measured" : "estimated");
+
+    results.clear();
+    test_active_ = true;
+    const esp_now_power_profile_t profiles[] = {ESP_NOW_POWER_LOW_LATENCY, ESP_NOW_POWER_BALANCED,
+                                                ESP_NOW_POWER_LOW_POWER};
+
+    for (esp_now_power_profile_t profile : profiles) {
+        if (!test_active_) {
+            break;
+        }
+
+        esp_now_power_config_t config = PowerManager::profile_config(profile);
+        if (power.set_config(config) != ESP_OK) {
+            continue;
+        }
+        // The peer learns the window phase from the first WAKE broadcasts
+        vTaskDelay(pdMS_TO_TICKS(2 * config.wake_interval_ms + 100));
+        power.reset_stats();
+
+        power_test_result_t result = {};
+        result.profile = profile;
+
+        // One ping a second; the PONG waits at the peer for our next window
+        rtt_measure_config_t rtt_config = RttEngine::default_config(1);
+        rtt_config.window = 1;
+        rtt_config.timeout_ms = 2 * config.wake_interval_ms + 200;
+
+        StreamingStats current_ma;
+        uint64_t start_us = esp_timer_get_time();
+        while (esp_timer_get_time() - start_us < profile_ms * 1000ULL && test_active_) {
+            uint64_t second_start_us = esp_timer_get_time();
+            rtt_run_stats_t rtt_stats = {};
+            esp_now_manager_.get_rtt_engine().measure(target_mac, rtt_config,
+                [&result](const rtt_sample_t& sample) {
+                    result.latency_ms.add(sample.rtt_us / 1000.0f);
+                }, &rtt_stats);
+            result.pings_sent += rtt_stats.sent;
+            result.pings_lost += rtt_stats.sent - rtt_stats.received;
+
+            if (current_sensor_) {
+                current_ma.add(current_sensor_());
+            }
+
+            uint32_t elapsed_ms = (esp_timer_get_time() - second_start_us) / 1000;
+            if (elapsed_ms < 1000) {
+                vTaskDelay(pdMS_TO_TICKS(1000 - elapsed_ms));
+            }
+        }
+
+        esp_now_power_stats_t stats = power.get_stats();
+        result.duration_ms = stats.elapsed_us / 1000;
+        result.duty_cycle_percent = stats.duty_cycle_percent;
+        result.current_measured = current_ma.count() > 0;
+        result.current_ma = result.current_measured ? current_ma.mean() :
+            POWER_RADIO_SLEEP_CURRENT_MA +
+            (POWER_RADIO_ON_CURRENT_MA - POWER_RADIO_SLEEP_CURRENT_MA) * stats.duty_cycle_percent / 100.0f;
+        result.battery_life_hours = result.current_ma > 0.0f ? POWER_BATTERY_CAPACITY_MAH / result.current_ma : 0.0f;
+        results.push_back(result);
+    }
+
+    power.set_config(original);
+    test_active_ = false;
+
+    if (results.empty()) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Profile      Duty %%  Current mA  Battery h  RTT p50 ms  RTT p99 ms  Loss %%");
+    for (const auto& result : results) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "%-11s  %6.2f  %9.1f%c  %9.1f  %10.2f  %10.2f  %6.1f",
+                 PowerManager::profile_name(result.profile), result.duty_cycle_percent, result.current_ma,
+                 result.current_measured ? ' ' : '*', result.battery_life_hours,
+                 result.latency_ms.p50(), result.latency_ms.p99(),
+                 result.pings_sent > 0 ? 100.0f * result.pings_lost / result.pings_sent : 0.0f);
+    }
+    if (!results[0].current_measured) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "* estimated from the duty cycle (%.0f mA on, %.0f mA asleep)",
+                 POWER_RADIO_ON_CURRENT_MA, POWER_RADIO_SLEEP_CURRENT_MA);
+    }
+
+    return ESP_OK;
 }
 
-int8_t PerformanceTests::simulate_rssi_measurement() {
-    // Simulate RSSI values typical for ESP-NOW (range: -30 to -90 dBm)
-    return -30 - (esp_random() % 60);
+void PerformanceTests::log_link_event(uint32_t window, bool link_up, float outage_ms) {
+    if (!flash_log_) {
+        return;
+    }
+    flash_log_link_event_t event = {};
+    event.window = window;
+    event.link_up = link_up;
+    event.outage_ms = outage_ms;
+    flash_log_->append(FLASH_LOG_RECORD_LINK_EVENT, &event, sizeof(event));
+}
+
+int8_t PerformanceTests::read_peer_rssi(const uint8_t* mac_addr, uint32_t* samples) {
+    esp_now_peer_info_t peer;
+    if (esp_now_manager_.get_peer_info(mac_addr, &peer) != ESP_OK || peer.rssi_samples == 0) {
+        if (samples) *samples = 0;
+        return 0;
+    }
+
+    if (samples) *samples = peer.rssi_samples;
+    return peer.rssi;
 }
 
 void PerformanceTests::log_throughput_result(const throughput_test_result_t& result) {
@@ -534,6 +1037,8 @@ void PerformanceTests::log_latency_result(const latency_test_result_t& result) {
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Avg Latency: %.2f ms", result.avg_latency_ms);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Min/Max Latency: %.2f/%.2f ms", result.min_latency_ms, result.max_latency_ms);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Std Dev: %.2f ms", result.stddev_latency_ms);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Percentiles p50/p90/p99: %.2f/%.2f/%.2f ms",
+             result.latency_ms.p50(), result.latency_ms.p90(), result.latency_ms.p99());
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Jitter: %.2f ms", result.jitter_ms);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Packet Loss: %.1f%%", result.packet_loss_percent);
 }
@@ -563,6 +1068,43 @@ void PerformanceTests::log_stability_result(const stability_test_result_t& resul
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Successful Reconnections: %lu/%lu", result.successful_reconnections, result.reconnection_attempts);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Uptime: %.1f%%", result.uptime_percent);
     ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Avg Packet Loss: %.1f%%", result.avg_packet_loss_percent);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  RTT avg/p99/max: %.2f/%.2f/%.2f ms",
+             result.latency_ms.mean(), result.latency_ms.p99(), result.latency_ms.max());
+    if (result.reconnection_times_ms.count() > 0) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Reconnection time avg/max: %.0f/%.0f ms",
+                 result.reconnection_times_ms.mean(), result.reconnection_times_ms.max());
+    }
+}
+
+void PerformanceTests::analyze_throughput_consistency(const std::vector<throughput_test_result_t>& results) {
+    if (results.empty()) return;
+
+    float sum = 0.0f;
+    float best_bps = 0.0f;
+    uint32_t best_size = 0;
+    for (const auto& result : results) {
+        sum += result.throughput_bps;
+        if (result.throughput_bps > best_bps) {
+            best_bps = result.throughput_bps;
+            best_size = result.packet_size;
+        }
+    }
+    float mean = sum / results.size();
+
+    float sum_squared_diff = 0.0f;
+    for (const auto& result : results) {
+        float diff = result.throughput_bps - mean;
+        sum_squared_diff += diff * diff;
+    }
+    float stddev = std::sqrt(sum_squared_diff / results.size());
+
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "Throughput Consistency (%zu runs):", results.size());
+    for (const auto& result : results) {
+        ESP_LOGI(PERFORMANCE_TESTS_TAG, "  %4lu bytes: %.0f bps (%lu frames)",
+                 result.packet_size, result.throughput_bps, result.packets_sent);
+    }
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Mean: %.0f bps, Std Dev: %.0f bps", mean, stddev);
+    ESP_LOGI(PERFORMANCE_TESTS_TAG, "  Best: %.0f bps at %lu bytes", best_bps, best_size);
 }
 
 void PerformanceTests::generate_performance_report() {
@@ -585,4 +1127,12 @@ bool PerformanceTests::is_test_active() const {
 
 void PerformanceTests::set_ping_response_callback(std::function<void(uint32_t, float)> callback) {
     ping_response_callback_ = callback;
+}
+
+void PerformanceTests::set_flash_log(FlashLog* log) {
+    flash_log_ = log;
+}
+
+void PerformanceTests::set_current_sensor(std::function<float()> sensor) {
+    current_sensor_ = sensor;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "test_framework.hpp"
 #include "esp_now_manager.hpp"
+#include "streaming_stats.hpp"
+#include "flash_log.hpp"
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -10,6 +12,15 @@
 
 #define PERFORMANCE_TESTS_TAG "PERF_TESTS"
 
+// Stability windows aggregated into one flash log record, and windows between stat snapshots
+#define STABILITY_LOG_INTERVAL_WINDOWS 60
+#define STABILITY_SNAPSHOT_WINDOWS 600
+
+// Current estimates for test_power_consumption_analysis when no current sensor is set
+#define POWER_RADIO_ON_CURRENT_MA 80.0f      // Radio receiving, CPU at full clock
+#define POWER_RADIO_SLEEP_CURRENT_MA 22.0f   // Modem sleep, CPU at full clock
+#define POWER_BATTERY_CAPACITY_MAH 2000.0f
+
 typedef struct {
     uint32_t packet_size;
     uint32_t packets_sent;
@@ -23,7 +34,7 @@ typedef struct {
 
 typedef struct {
     uint32_t ping_count;
-    std::vector<float> latency_measurements;
+    StreamingStats latency_ms;
     float min_latency_ms;
     float max_latency_ms;
     float avg_latency_ms;
@@ -35,7 +46,7 @@ typedef struct {
 
 typedef struct {
     uint32_t test_distance_meters;
-    std::vector<int8_t> rssi_measurements;
+    StreamingStats rssi_dbm;
     int8_t min_rssi_dbm;
     int8_t max_rssi_dbm;
     int8_t avg_rssi_dbm;
@@ -48,7 +59,7 @@ typedef struct {
 typedef struct {
     uint32_t devices_found;
     uint32_t discovery_time_ms;
-    std::vector<uint32_t> individual_discovery_times;
+    StreamingStats individual_discovery_times_ms;
     float avg_discovery_time_ms;
     float min_discovery_time_ms;
     float max_discovery_time_ms;
@@ -64,33 +75,47 @@ typedef struct {
     uint32_t successful_reconnections;
     float avg_packet_loss_percent;
     float uptime_percent;
-    std::vector<uint64_t> connection_drop_times;
-    std::vector<uint32_t> reconnection_times_ms;
+    uint64_t last_drop_time_us;
+    StreamingStats latency_ms;
+    StreamingStats packet_loss_percent;   // Per one-second probe window
+    StreamingStats reconnection_times_ms;
 } stability_test_result_t;
 
+typedef struct {
+    esp_now_power_profile_t profile;
+    uint32_t duration_ms;
+    float duty_cycle_percent;    // Radio held on
+    float current_ma;
+    bool current_measured;       // false: estimated from the duty cycle
+    float battery_life_hours;    // At POWER_BATTERY_CAPACITY_MAH
+    StreamingStats latency_ms;   // RTT, including the hold until this node's next window
+    uint32_t pings_sent;
+    uint32_t pings_lost;
+} power_test_result_t;
+
 class PerformanceTests {
 private:
     TestFramework& test_framework_;
     ESPNowManager& esp_now_manager_;
+    FlashLog* flash_log_;
 
     // Test state tracking
     bool test_active_;
     uint32_t current_test_sequence_;
-    std::vector<uint64_t> ping_timestamps_;
-    std::vector<uint32_t> ping_sequence_numbers_;
 
-    // Callback tracking for ping responses
+    // Invoked for every measured PONG (ping id, RTT in ms)
     std::function<void(uint32_t, float)> ping_response_callback_;
+    // Optional; returns the board's supply current in mA
+    std::function<float()> current_sensor_;
 
     // Test utilities
-    void setup_ping_response_handler();
-    float calculate_jitter(const std::vector<float>& latencies);
-    int8_t simulate_rssi_measurement(); // In real implementation, would get actual RSSI
+    int8_t read_peer_rssi(const uint8_t* mac_addr, uint32_t* samples = nullptr); // 0 if unmeasured
     void log_throughput_result(const throughput_test_result_t& result);
     void log_latency_result(const latency_test_result_t& result);
     void log_range_result(const range_test_result_t& result);
     void log_discovery_result(const discovery_test_result_t& result);
     void log_stability_result(const stability_test_result_t& result);
+    void log_link_event(uint32_t window, bool link_up, float outage_ms);
 
 public:
     PerformanceTests(TestFramework& framework, ESPNowManager& manager);
@@ -112,6 +137,9 @@ public:
                                      const std::vector<uint8_t*>& target_macs,
                                      uint32_t ping_count = 100);
 
+    // Hot-path Benchmarks
+    esp_err_t test_callback_overhead(const uint8_t* target_mac, uint32_t iterations = 1000);
+
     // Throughput Performance Tests
     esp_err_t test_unidirectional_throughput(throughput_test_result_t& result,
                                             const uint8_t* target_mac, uint32_t duration_ms = 30000,
@@ -122,6 +150,11 @@ public:
     esp_err_t test_variable_payload_throughput(std::vector<throughput_test_result_t>& results,
                                               const uint8_t* target_mac, uint32_t duration_ms = 15000);
 
+    // Latency and throughput of a keyed peer in each link mode, plus the CPU cost of a tag
+    esp_err_t test_encryption_overhead(std::vector<latency_test_result_t>& latency_results,
+                                      std::vector<throughput_test_result_t>& throughput_results,
+                                      const uint8_t* target_mac, uint32_t ping_count = 200);
+
     // Range and Reliability Tests
     esp_err_t test_distance_performance(std::vector<range_test_result_t>& results,
                                        const uint8_t* target_mac, uint32_t max_distance_meters = 50,
@@ -134,7 +167,10 @@ public:
     // Long-term Stability Tests
     esp_err_t test_connection_stability(stability_test_result_t& result,
                                        const uint8_t* target_mac, uint32_t duration_hours = 24);
-    esp_err_t test_power_consumption_analysis(uint32_t duration_minutes = 60);
+    // Each power profile in turn on this node, for a third of the duration: radio duty
+    // cycle and current against the RTT to target_mac
+    esp_err_t test_power_consumption_analysis(std::vector<power_test_result_t>& results,
+                                             const uint8_t* target_mac, uint32_t duration_minutes = 60);
 
     // Comprehensive Test Suites
     esp_err_t run_discovery_test_suite(std::vector<discovery_test_result_t>& results);
@@ -163,4 +199,7 @@ public:
 
     // Configuration
     void set_ping_response_callback(std::function<void(uint32_t, float)> callback);
+    // Optional; long-running tests persist samples and snapshots to it
+    void set_flash_log(FlashLog* log);
+    void set_current_sensor(std::function<float()> sensor);
 };
\ No newline at end of file
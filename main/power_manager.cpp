@@ -0,0 +1,365 @@
+#include "power_manager.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+#include <string.h>
+#include <algorithm>
+
+PowerManager::PowerManager(ESPNowManager& manager)
+    : manager_(manager), config_(profile_config(ESP_NOW_POWER_LOW_LATENCY)), mutex_(nullptr),
+      task_handle_(nullptr), sleeper_count_(0), stats_since_us_(0), awake_us_(0), awake_since_us_(0),
+      windows_(0), frames_held_(0), frames_rejected_(0) {
+    memset(sleepers_, 0, sizeof(sleepers_));
+}
+
+PowerManager::~PowerManager() {
+    deinitialize();
+}
+
+esp_err_t PowerManager::initialize() {
+    if (mutex_) {
+        return ESP_OK;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    if (!mutex_) {
+        ESP_LOGE(POWER_MANAGER_TAG, "Failed to create power mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(sleepers_, 0, sizeof(sleepers_));
+    sleeper_count_ = 0;
+    reset_stats();
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    apply_driver_mode(esp_timer_get_time());
+    xSemaphoreGive(mutex_);
+
+    if (xTaskCreate(power_task, "esp_now_power", POWER_TASK_STACK_SIZE, this,
+                    POWER_TASK_PRIORITY, &task_handle_) != pdPASS) {
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void PowerManager::deinitialize() {
+    if (task_handle_) {
+        vTaskDelete(task_handle_);
+        task_handle_ = nullptr;
+    }
+
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+esp_now_power_config_t PowerManager::profile_config(esp_now_power_profile_t profile) {
+    esp_now_power_config_t config = {};
+    config.profile = profile;
+    switch (profile) {
+        case ESP_NOW_POWER_BALANCED:
+            config.wake_interval_ms = 100;
+            config.wake_window_ms = 10;
+            config.discovery_min_interval_ms = 1000;
+            break;
+        case ESP_NOW_POWER_LOW_POWER:
+            config.wake_interval_ms = 1000;
+            config.wake_window_ms = 10;
+            config.discovery_min_interval_ms = 5000;
+            break;
+        default:
+            config.wake_interval_ms = 0;
+            config.wake_window_ms = 0;
+            config.discovery_min_interval_ms = ESPNowManager::default_discovery_config().min_interval_ms;
+            break;
+    }
+    return config;
+}
+
+const char* PowerManager::profile_name(esp_now_power_profile_t profile) {
+    switch (profile) {
+        case ESP_NOW_POWER_LOW_LATENCY: return "low-latency";
+        case ESP_NOW_POWER_BALANCED: return "balanced";
+        case ESP_NOW_POWER_LOW_POWER: return "low-power";
+        default: return "unknown";
+    }
+}
+
+// Caller holds mutex_. The driver's own ESP-NOW wake window is closed: windows are
+// opened by power_task, at a phase the peers can follow.
+void PowerManager::apply_driver_mode(uint64_t now_us) {
+    if (config_.wake_interval_ms == 0) {
+        set_radio_awake(true, now_us);
+        return;
+    }
+
+    esp_now_set_wake_window(0);
+    esp_wifi_connectionless_module_set_wake_interval(config_.wake_interval_ms);
+    set_radio_awake(false, now_us);
+}
+
+// Caller holds mutex_
+void PowerManager::set_radio_awake(bool awake, uint64_t now_us) {
+    esp_err_t ret = esp_wifi_set_ps(awake ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+    if (ret != ESP_OK) {
+        ESP_LOGW(POWER_MANAGER_TAG, "Failed to set power save mode: %s", esp_err_to_name(ret));
+    }
+
+    if (awake && awake_since_us_ == 0) {
+        awake_since_us_ = now_us;
+    } else if (!awake && awake_since_us_ != 0) {
+        awake_us_ += now_us - awake_since_us_;
+        awake_since_us_ = 0;
+    }
+}
+
+void PowerManager::announce(uint16_t interval_ms, uint16_t window_ms) {
+    esp_now_power_wake_t wake = {interval_ms, window_ms};
+    uint8_t broadcast_addr[] = ESP_NOW_BROADCAST_ADDR;
+    manager_.send_message(broadcast_addr, ESP_NOW_MSG_TYPE_POWER_WAKE, (const uint8_t*)&wake, sizeof(wake), 0);
+}
+
+esp_err_t PowerManager::set_config(const esp_now_power_config_t& config) {
+    if (config.wake_interval_ms != 0 &&
+        (config.wake_window_ms == 0 || config.wake_window_ms >= config.wake_interval_ms)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!mutex_) {
+        config_ = config;
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool was_sleeping = config_.wake_interval_ms != 0;
+    config_ = config;
+    apply_driver_mode(esp_timer_get_time());
+    xSemaphoreGive(mutex_);
+
+    // Peers stop holding frames for us; a sleeping profile announces itself with its first window
+    if (was_sleeping && config.wake_interval_ms == 0) {
+        announce(0, 0);
+    }
+
+    esp_now_discovery_config_t discovery = manager_.get_discovery_config();
+    discovery.min_interval_ms = config.discovery_min_interval_ms;
+    manager_.set_discovery_config(discovery);
+
+    xTaskNotifyGive(task_handle_);
+    ESP_LOGI(POWER_MANAGER_TAG, "Power profile %s: interval %u ms, window %u ms",
+             profile_name(config.profile), config.wake_interval_ms, config.wake_window_ms);
+    return ESP_OK;
+}
+
+esp_err_t PowerManager::set_profile(esp_now_power_profile_t profile) {
+    return set_config(profile_config(profile));
+}
+
+void PowerManager::power_task(void* parameter) {
+    PowerManager* power = static_cast<PowerManager*>(parameter);
+    uint64_t next_window_us = esp_timer_get_time();
+
+    while (true) {
+        xSemaphoreTake(power->mutex_, portMAX_DELAY);
+        esp_now_power_config_t config = power->config_;
+        xSemaphoreGive(power->mutex_);
+
+        if (config.wake_interval_ms == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            next_window_us = esp_timer_get_time();
+            continue;
+        }
+
+        // A notification is a new configuration: start its schedule from now
+        uint64_t now_us = esp_timer_get_time();
+        if (next_window_us > now_us &&
+            ulTaskNotifyTake(pdTRUE, std::max<TickType_t>(pdMS_TO_TICKS((next_window_us - now_us) / 1000), 1)) > 0) {
+            next_window_us = esp_timer_get_time();
+            continue;
+        }
+
+        now_us = esp_timer_get_time();
+        xSemaphoreTake(power->mutex_, portMAX_DELAY);
+        power->set_radio_awake(true, now_us);
+        power->windows_++;
+        xSemaphoreGive(power->mutex_);
+        power->announce(config.wake_interval_ms, config.wake_window_ms);
+
+        bool reconfigured = ulTaskNotifyTake(pdTRUE, std::max<TickType_t>(pdMS_TO_TICKS(config.wake_window_ms), 1)) > 0;
+
+        now_us = esp_timer_get_time();
+        xSemaphoreTake(power->mutex_, portMAX_DELAY);
+        if (power->config_.wake_interval_ms != 0) {
+            power->set_radio_awake(false, now_us);
+        }
+        xSemaphoreGive(power->mutex_);
+
+        next_window_us += config.wake_interval_ms * 1000ULL;
+        if (reconfigured || next_window_us <= now_us) {
+            next_window_us = now_us + (reconfigured ? 0 : config.wake_interval_ms * 1000ULL);
+        }
+    }
+}
+
+void PowerManager::handle_wake(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_power_wake_t) || !mutex_) {
+        return;
+    }
+
+    esp_now_power_wake_t wake;
+    memcpy(&wake, msg->payload, sizeof(wake));
+    uint64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    sleeper_t* entry = nullptr;
+    for (auto& sleeper : sleepers_) {
+        if (sleeper.used && memcmp(sleeper.mac_addr, mac_addr, 6) == 0) {
+            entry = &sleeper;
+            break;
+        }
+    }
+
+    if (wake.interval_ms == 0 || wake.window_ms == 0) {
+        if (entry) {
+            entry->used = false;
+            sleeper_count_--;
+        }
+    } else {
+        if (!entry) {
+            // Full: take over the sleeper heard from longest ago
+            for (auto& sleeper : sleepers_) {
+                if (!sleeper.used) {
+                    entry = &sleeper;
+                    break;
+                }
+                if (!entry || sleeper.window_start_us < entry->window_start_us) {
+                    entry = &sleeper;
+                }
+            }
+            if (!entry->used) {
+                sleeper_count_++;
+            }
+            entry->used = true;
+            entry->queued = 0;
+            memcpy(entry->mac_addr, mac_addr, 6);
+        }
+        entry->interval_ms = wake.interval_ms;
+        entry->window_ms = std::min(wake.window_ms, wake.interval_ms);
+        entry->window_start_us = now_us;
+    }
+    xSemaphoreGive(mutex_);
+}
+
+// Caller holds mutex_. nullptr unless mac_addr sleeps on a schedule still trusted: once
+// its WAKEs stop, better a frame it may miss than one held forever.
+PowerManager::sleeper_t* PowerManager::find_sleeper(const uint8_t* mac_addr, uint64_t now_us) {
+    for (auto& sleeper : sleepers_) {
+        if (sleeper.used && memcmp(sleeper.mac_addr, mac_addr, 6) == 0) {
+            uint64_t since_us = now_us - sleeper.window_start_us;
+            return since_us > sleeper.interval_ms * 1000ULL * ESP_NOW_POWER_MISSED_WAKES ? nullptr : &sleeper;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t PowerManager::next_delivery_us(const uint8_t* mac_addr, uint64_t now_us) {
+    if (sleeper_count_.load(std::memory_order_relaxed) == 0 || !mutex_) {
+        return now_us;
+    }
+
+    uint64_t deliver_us = now_us;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const sleeper_t* sleeper = find_sleeper(mac_addr, now_us);
+    if (sleeper) {
+        uint64_t interval_us = sleeper->interval_ms * 1000ULL;
+        uint64_t window_us = sleeper->window_ms * 1000ULL;
+        uint64_t guard_us = std::min<uint64_t>(ESP_NOW_POWER_WAKE_GUARD_MS * 1000ULL, window_us / 4);
+        uint64_t phase_us = (now_us - sleeper->window_start_us) % interval_us;
+        if (phase_us < guard_us || phase_us >= window_us - guard_us) {
+            deliver_us = now_us - phase_us + (phase_us < guard_us ? 0 : interval_us) + guard_us;
+            frames_held_++;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return deliver_us;
+}
+
+bool PowerManager::admit(const uint8_t* mac_addr, bool* counted) {
+    *counted = false;
+    if (sleeper_count_.load(std::memory_order_relaxed) == 0 || !mutex_) {
+        return true;
+    }
+
+    bool admitted = true;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    sleeper_t* sleeper = find_sleeper(mac_addr, esp_timer_get_time());
+    if (sleeper) {
+        admitted = sleeper->queued < ESP_NOW_POWER_MAX_HELD_PER_SLEEPER;
+        if (admitted) {
+            sleeper->queued++;
+            *counted = true;
+        } else {
+            frames_rejected_++;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return admitted;
+}
+
+void PowerManager::release(const uint8_t* mac_addr) {
+    if (!mutex_) {
+        return;
+    }
+
+    // The entry may have been dropped or reused since; its count then started over
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& sleeper : sleepers_) {
+        if (sleeper.used && memcmp(sleeper.mac_addr, mac_addr, 6) == 0) {
+            if (sleeper.queued > 0) {
+                sleeper.queued--;
+            }
+            break;
+        }
+    }
+    xSemaphoreGive(mutex_);
+}
+
+esp_now_power_stats_t PowerManager::get_stats() {
+    esp_now_power_stats_t stats = {};
+    stats.profile = config_.profile;
+    stats.frames_held = frames_held_.load();
+    stats.frames_rejected = frames_rejected_.load();
+    stats.sleepers = sleeper_count_.load();
+    if (!mutex_) {
+        return stats;
+    }
+
+    uint64_t now_us = esp_timer_get_time();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stats.windows = windows_;
+    stats.awake_us = awake_us_ + (awake_since_us_ ? now_us - awake_since_us_ : 0);
+    stats.elapsed_us = now_us - stats_since_us_;
+    xSemaphoreGive(mutex_);
+
+    stats.duty_cycle_percent = stats.elapsed_us > 0 ? 100.0f * stats.awake_us / stats.elapsed_us : 0.0f;
+    return stats;
+}
+
+void PowerManager::reset_stats() {
+    uint64_t now_us = esp_timer_get_time();
+    if (mutex_) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+    stats_since_us_ = now_us;
+    awake_us_ = 0;
+    awake_since_us_ = awake_since_us_ ? now_us : 0;
+    windows_ = 0;
+    frames_held_ = 0;
+    frames_rejected_ = 0;
+    if (mutex_) {
+        xSemaphoreGive(mutex_);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+
+#define POWER_MANAGER_TAG "POWER_MGR"
+#define ESP_NOW_POWER_MAX_SLEEPERS 16        // Sleeping peers this node holds frames for
+#define ESP_NOW_POWER_WAKE_GUARD_MS 2        // Held frames go out this long after a window opens, and not in its last stretch
+#define ESP_NOW_POWER_MISSED_WAKES 3         // Silent intervals before a sleeper's schedule is no longer trusted
+#define ESP_NOW_POWER_MAX_HELD_PER_SLEEPER 4 // Send buffers one sleeping peer may tie up; awake peers keep the rest
+#define ESP_NOW_POWER_ADMIT_POLL_MS 10       // A sender over its budget retries this often, up to its wait
+#define POWER_TASK_STACK_SIZE 3072
+#define POWER_TASK_PRIORITY 6                // Windows open on time even under load
+
+class ESPNowManager;
+
+typedef enum {
+    ESP_NOW_POWER_LOW_LATENCY = 0,   // Radio always on
+    ESP_NOW_POWER_BALANCED = 1,
+    ESP_NOW_POWER_LOW_POWER = 2,
+} esp_now_power_profile_t;
+
+// wake_interval_ms = 0 keeps the radio on. Otherwise the radio sleeps (modem sleep) and
+// opens a wake_window_ms listening window every wake_interval_ms, announced by a
+// POWER_WAKE broadcast; peers hold unicast frames for this node until the next window,
+// so delivery latency is bounded by wake_interval_ms.
+typedef struct {
+    esp_now_power_profile_t profile;
+    uint16_t wake_interval_ms;
+    uint16_t wake_window_ms;
+    uint32_t discovery_min_interval_ms;  // Applied to the discovery config with the profile
+} esp_now_power_config_t;
+
+typedef struct {
+    esp_now_power_profile_t profile;
+    uint32_t windows;
+    uint64_t awake_us;               // Radio held on: windows, or all of the time when always on
+    uint64_t elapsed_us;
+    float duty_cycle_percent;
+    uint32_t frames_held;            // Sends to sleeping peers deferred to their next window
+    uint32_t frames_rejected;        // Admissions refused: the sleeper's budget was full
+    uint32_t sleepers;               // Peers whose wake schedule is known
+} esp_now_power_stats_t;
+
+// Local power profile and the hold side for sleeping peers. The window schedule is
+// driven here rather than by the driver's own wake window, which is not visible to
+// peers: each window starts with a POWER_WAKE broadcast, peers learn the phase from it
+// and the send task defers unicast frames to a sleeper until its next window.
+class PowerManager {
+private:
+    typedef struct {
+        bool used;
+        uint8_t mac_addr[6];
+        uint16_t interval_ms;
+        uint16_t window_ms;
+        uint64_t window_start_us;    // Reception of the last POWER_WAKE
+        uint8_t queued;              // Send buffers counted against the budget
+    } sleeper_t;
+
+    ESPNowManager& manager_;
+    esp_now_power_config_t config_;
+    SemaphoreHandle_t mutex_;
+    TaskHandle_t task_handle_;
+    sleeper_t sleepers_[ESP_NOW_POWER_MAX_SLEEPERS];
+    std::atomic<uint32_t> sleeper_count_;   // Lets the send task skip the table when zero
+
+    uint64_t stats_since_us_;
+    uint64_t awake_us_;
+    uint64_t awake_since_us_;        // 0 while the radio sleeps
+    uint32_t windows_;
+    std::atomic<uint32_t> frames_held_;
+    std::atomic<uint32_t> frames_rejected_;
+
+    static void power_task(void* parameter);
+    void apply_driver_mode(uint64_t now_us);
+    void set_radio_awake(bool awake, uint64_t now_us);
+    void announce(uint16_t interval_ms, uint16_t window_ms);
+    sleeper_t* find_sleeper(const uint8_t* mac_addr, uint64_t now_us);
+
+public:
+    explicit PowerManager(ESPNowManager& manager);
+    ~PowerManager();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    esp_err_t set_config(const esp_now_power_config_t& config);
+    esp_err_t set_profile(esp_now_power_profile_t profile);
+    esp_now_power_config_t get_config() const { return config_; }
+    static esp_now_power_config_t profile_config(esp_now_power_profile_t profile);
+    static const char* profile_name(esp_now_power_profile_t profile);
+
+    // Receive task
+    void handle_wake(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    // Send task: now_us when a frame to mac_addr can go out, else the start of the
+    // peer's next window
+    uint64_t next_delivery_us(const uint8_t* mac_addr, uint64_t now_us);
+    // send_message: false while mac_addr sleeps with ESP_NOW_POWER_MAX_HELD_PER_SLEEPER
+    // buffers queued. *counted says whether the frame took a share, to be returned by
+    // release() when its buffer is freed.
+    bool admit(const uint8_t* mac_addr, bool* counted);
+    void release(const uint8_t* mac_addr);
+
+    esp_now_power_stats_t get_stats();
+    void reset_stats();
+};
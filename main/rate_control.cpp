@@ -0,0 +1,182 @@
+#include "rate_control.hpp"
+#include <string.h>
+#include <algorithm>
+
+typedef struct {
+    wifi_phy_rate_t rate;
+    int8_t sensitivity_dbm;   // Typical receiver sensitivity, 20 MHz
+    float mbps;
+    const char* name;
+} rate_step_t;
+
+static const rate_step_t RATE_LADDER[] = {
+    {WIFI_PHY_RATE_MCS0_LGI, -90, 6.5f, "MCS0"},
+    {WIFI_PHY_RATE_MCS1_LGI, -87, 13.0f, "MCS1"},
+    {WIFI_PHY_RATE_MCS2_LGI, -85, 19.5f, "MCS2"},
+    {WIFI_PHY_RATE_MCS3_LGI, -82, 26.0f, "MCS3"},
+    {WIFI_PHY_RATE_MCS4_LGI, -78, 39.0f, "MCS4"},
+    {WIFI_PHY_RATE_MCS5_LGI, -75, 52.0f, "MCS5"},
+    {WIFI_PHY_RATE_MCS6_LGI, -73, 58.5f, "MCS6"},
+    {WIFI_PHY_RATE_MCS7_LGI, -71, 65.0f, "MCS7"},
+};
+
+static const size_t RATE_LADDER_STEPS = sizeof(RATE_LADDER) / sizeof(RATE_LADDER[0]);
+
+void RateController::reset(esp_now_peer_rate_t& state, esp_now_rate_mode_t mode) {
+    esp_now_rate_config_t fixed = state.fixed;
+    memset(&state, 0, sizeof(state));
+    state.mode = mode;
+    state.probe_windows = 1;
+    state.fixed = fixed;
+}
+
+size_t RateController::step_count() {
+    return RATE_LADDER_STEPS;
+}
+
+uint8_t RateController::rssi_ceiling(int rssi) {
+    uint8_t ceiling = 0;
+    for (size_t i = 0; i < RATE_LADDER_STEPS; i++) {
+        if (rssi >= RATE_LADDER[i].sensitivity_dbm + RATE_CONTROL_RSSI_MARGIN_DB) {
+            ceiling = i;
+        }
+    }
+    return ceiling;
+}
+
+const char* RateController::step_name(uint8_t step) {
+    return step < RATE_LADDER_STEPS ? RATE_LADDER[step].name : "?";
+}
+
+float RateController::step_mbps(uint8_t step) {
+    return step < RATE_LADDER_STEPS ? RATE_LADDER[step].mbps : 0.0f;
+}
+
+const char* RateController::mode_name(uint8_t mode) {
+    switch (mode) {
+        case ESP_NOW_RATE_MODE_DEFAULT: return "default";
+        case ESP_NOW_RATE_MODE_AUTO: return "auto";
+        case ESP_NOW_RATE_MODE_FIXED: return "fixed";
+        default: return "unknown";
+    }
+}
+
+bool RateController::rate_config(const esp_now_peer_rate_t& state, esp_now_rate_config_t* config) {
+    if (state.mode == ESP_NOW_RATE_MODE_FIXED) {
+        *config = state.fixed;
+        return true;
+    }
+
+    if (state.mode != ESP_NOW_RATE_MODE_AUTO) {
+        return false;
+    }
+
+    memset(config, 0, sizeof(*config));
+    config->phymode = WIFI_PHY_MODE_HT20;
+    config->rate = RATE_LADDER[std::min<size_t>(state.step, RATE_LADDER_STEPS - 1)].rate;
+    config->ersu = false;
+    config->dcm = false;
+    return true;
+}
+
+bool RateController::step_down(esp_now_peer_rate_t& state) {
+    if (state.probing) {
+        state.probe_windows = std::min<uint8_t>(state.probe_windows * 2, RATE_CONTROL_MAX_PROBE_WINDOWS);
+    }
+
+    state.probing = false;
+    state.consecutive_failures = 0;
+    state.clean_windows = 0;
+    state.window_attempts = 0;
+    state.window_failures = 0;
+
+    if (state.step == 0) {
+        return false;
+    }
+    state.step--;
+    state.step_downs++;
+    state.applied = false;
+    return true;
+}
+
+bool RateController::on_tx_result(esp_now_peer_rate_t& state, bool success, int8_t rssi, uint32_t rssi_samples) {
+    if (state.mode != ESP_NOW_RATE_MODE_AUTO) {
+        return false;
+    }
+
+    state.window_attempts++;
+    if (success) {
+        state.consecutive_failures = 0;
+    } else {
+        state.window_failures++;
+        state.consecutive_failures++;
+        if (state.consecutive_failures >= RATE_CONTROL_STEP_DOWN_FAILURES) {
+            return step_down(state);
+        }
+    }
+
+    if (state.window_attempts < RATE_CONTROL_WINDOW) {
+        return false;
+    }
+
+    uint32_t failure_percent = state.window_failures * 100 / state.window_attempts;
+    state.window_attempts = 0;
+    state.window_failures = 0;
+
+    if (failure_percent > RATE_CONTROL_MAX_FAILURE_PERCENT) {
+        return step_down(state);
+    }
+
+    // A probe that survived its first window resets the backoff
+    if (state.probing) {
+        state.probing = false;
+        state.probe_windows = 1;
+    }
+
+    if (failure_percent > 0) {
+        state.clean_windows = 0;
+        return false;
+    }
+
+    state.clean_windows++;
+    uint8_t ceiling = rssi_samples > 0 ? rssi_ceiling(rssi) : RATE_LADDER_STEPS - 1;
+    if (state.clean_windows < state.probe_windows || state.step >= ceiling) {
+        return false;
+    }
+
+    state.step++;
+    state.step_ups++;
+    state.probing = true;
+    state.clean_windows = 0;
+    state.applied = false;
+    return true;
+}
+
+bool RateController::on_rssi(esp_now_peer_rate_t& state, int8_t rssi, uint32_t rssi_samples) {
+    if (state.mode != ESP_NOW_RATE_MODE_AUTO) {
+        return false;
+    }
+
+    // Start as high as the link budget allows; failures walk it down from there
+    if (rssi_samples == 1) {
+        uint8_t start = rssi_ceiling(rssi);
+        if (start == state.step) {
+            return false;
+        }
+        state.step = start;
+        state.applied = false;
+        return true;
+    }
+
+    uint8_t ceiling = rssi_ceiling(rssi + RATE_CONTROL_RSSI_HYSTERESIS_DB);
+    if (state.step <= ceiling) {
+        return false;
+    }
+
+    state.step = ceiling;
+    state.step_downs++;
+    state.probing = false;
+    state.clean_windows = 0;
+    state.applied = false;
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_now.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define RATE_CONTROL_TAG "RATE_CTRL"
+#define RATE_CONTROL_WINDOW 20                 // Unicast attempts per evaluation window
+#define RATE_CONTROL_STEP_DOWN_FAILURES 2      // Consecutive failures that drop a step at once
+#define RATE_CONTROL_MAX_FAILURE_PERCENT 10    // Window failure rate that drops a step
+#define RATE_CONTROL_MAX_PROBE_WINDOWS 8       // Clean windows required after repeated failed probes
+#define RATE_CONTROL_RSSI_MARGIN_DB 5          // Above the step's sensitivity before it is allowed
+#define RATE_CONTROL_RSSI_HYSTERESIS_DB 3      // Below the allowed level before it is forced down
+
+typedef enum {
+    ESP_NOW_RATE_MODE_DEFAULT = 0,   // Driver default rate, never touched
+    ESP_NOW_RATE_MODE_AUTO = 1,      // Link adaptation over the rate ladder
+    ESP_NOW_RATE_MODE_FIXED = 2,     // Caller supplied esp_now_rate_config_t
+} esp_now_rate_mode_t;
+
+// Per-peer rate state, kept in the peer table entry
+typedef struct {
+    uint8_t mode;                    // esp_now_rate_mode_t
+    uint8_t step;                    // Ladder step in AUTO mode
+    bool applied;                    // Current setting handed to the driver
+    bool probing;                    // First window after a step up
+    uint8_t consecutive_failures;
+    uint8_t clean_windows;
+    uint8_t probe_windows;           // Clean windows needed before the next step up
+    uint16_t window_attempts;
+    uint16_t window_failures;
+    uint32_t step_ups;
+    uint32_t step_downs;
+    esp_now_rate_config_t fixed;
+} esp_now_peer_rate_t;
+
+// AARF-style link adaptation over a ladder of HT20 MCS rates. A step is allowed once the
+// peer's smoothed RSSI clears its sensitivity plus a margin; within that ceiling the step
+// goes up after clean windows and down on consecutive failures or a lossy window. A failed
+// probe doubles the clean windows needed before the next one. Not thread safe; callers lock.
+class RateController {
+public:
+    static void reset(esp_now_peer_rate_t& state, esp_now_rate_mode_t mode);
+
+    // Unicast attempt outcome; true when the step changed
+    static bool on_tx_result(esp_now_peer_rate_t& state, bool success, int8_t rssi, uint32_t rssi_samples);
+
+    // New RSSI estimate; true when the step changed. The first estimate picks the start step.
+    static bool on_rssi(esp_now_peer_rate_t& state, int8_t rssi, uint32_t rssi_samples);
+
+    // Driver setting for the state; false when the driver default applies
+    static bool rate_config(const esp_now_peer_rate_t& state, esp_now_rate_config_t* config);
+
+    static size_t step_count();
+    static uint8_t rssi_ceiling(int rssi);
+    static const char* step_name(uint8_t step);
+    static float step_mbps(uint8_t step);
+    static const char* mode_name(uint8_t mode);
+
+private:
+    static bool step_down(esp_now_peer_rate_t& state);
+};
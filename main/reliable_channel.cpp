@@ -0,0 +1,572 @@
+#include "reliable_channel.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <string.h>
+#include <algorithm>
+
+static inline bool seq_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+ReliableChannel::ReliableChannel(ESPNowManager& manager)
+    : manager_(manager), config_(default_config()), session_(0),
+      mutex_(nullptr), space_sem_(nullptr), task_handle_(nullptr) {
+    memset(peers_, 0, sizeof(peers_));
+    memset(tx_entries_, 0, sizeof(tx_entries_));
+    memset(&totals_, 0, sizeof(totals_));
+}
+
+ReliableChannel::~ReliableChannel() {
+    deinitialize();
+}
+
+esp_err_t ReliableChannel::initialize() {
+    if (mutex_) {
+        return ESP_OK;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    space_sem_ = xSemaphoreCreateBinary();
+
+    if (!mutex_ || !space_sem_) {
+        ESP_LOGE(RELIABLE_CHANNEL_TAG, "Failed to create reliable channel mutex");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(peers_, 0, sizeof(peers_));
+    memset(tx_entries_, 0, sizeof(tx_entries_));
+    memset(&totals_, 0, sizeof(totals_));
+
+    // A new session tells receivers to drop the sequence state of our previous boot
+    session_ = (uint16_t)(esp_random() | 1);
+
+    if (xTaskCreate(retransmit_task, "esp_now_rel", 4096, this, 5, &task_handle_) != pdPASS) {
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void ReliableChannel::deinitialize() {
+    if (task_handle_) {
+        vTaskDelete(task_handle_);
+        task_handle_ = nullptr;
+    }
+
+    if (space_sem_) {
+        vSemaphoreDelete(space_sem_);
+        space_sem_ = nullptr;
+    }
+
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+reliable_config_t ReliableChannel::default_config() {
+    reliable_config_t config;
+    config.ack_delay_ms = 5;
+    config.ack_every = 4;
+    config.rto_ms = 30;
+    config.max_attempts = 6;
+    return config;
+}
+
+void ReliableChannel::set_config(const reliable_config_t& config) {
+    config_ = config;
+    config_.ack_every = std::max<uint32_t>(config.ack_every, 1);
+    config_.max_attempts = std::max<uint32_t>(config.max_attempts, 1);
+}
+
+reliable_config_t ReliableChannel::get_config() const {
+    return config_;
+}
+
+void ReliableChannel::count(peer_state_t& peer, uint32_t reliable_stats_t::*field, uint32_t n) {
+    peer.stats.*field += n;
+    totals_.*field += n;
+}
+
+int ReliableChannel::find_peer(const uint8_t* mac_addr) const {
+    for (int i = 0; i < RELIABLE_CHANNEL_MAX_PEERS; i++) {
+        if (peers_[i].in_use && memcmp(peers_[i].mac_addr, mac_addr, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Caller holds mutex_. Reuses the least recently active peer without outstanding frames.
+int ReliableChannel::get_or_create_peer(const uint8_t* mac_addr, uint64_t now_us) {
+    int index = find_peer(mac_addr);
+    if (index >= 0) {
+        peers_[index].last_activity_us = now_us;
+        return index;
+    }
+
+    for (int i = 0; i < RELIABLE_CHANNEL_MAX_PEERS; i++) {
+        if (!peers_[i].in_use) {
+            index = i;
+            break;
+        }
+        if (peers_[i].tx_outstanding == 0 &&
+            (index < 0 || peers_[i].last_activity_us < peers_[index].last_activity_us)) {
+            index = i;
+        }
+    }
+
+    if (index < 0) {
+        return -1;
+    }
+
+    peer_state_t& peer = peers_[index];
+    memset(&peer, 0, sizeof(peer));
+    peer.in_use = true;
+    memcpy(peer.mac_addr, mac_addr, 6);
+    peer.last_activity_us = now_us;
+    return index;
+}
+
+uint32_t ReliableChannel::window_base(int peer_index) const {
+    uint32_t base = peers_[peer_index].next_tx_seq;
+    for (const auto& entry : tx_entries_) {
+        if (entry.in_use && entry.peer_index == peer_index && seq_before(entry.seq, base)) {
+            base = entry.seq;
+        }
+    }
+    return base;
+}
+
+// Caller holds mutex_. Never blocks: a backpressured frame is retried by the timer.
+bool ReliableChannel::transmit(tx_entry_t& entry, uint64_t now_us) {
+    esp_now_reliable_header_t header;
+    memcpy(&header, entry.payload, sizeof(header));
+    header.window_base = window_base(entry.peer_index);
+    memcpy(entry.payload, &header, sizeof(header));
+
+    peer_state_t& peer = peers_[entry.peer_index];
+    esp_err_t ret = manager_.send_message(peer.mac_addr, ESP_NOW_MSG_TYPE_RELIABLE_DATA,
+                                          entry.payload, entry.len, 0);
+    entry.retransmit_now = false;
+    entry.last_tx_us = now_us;
+    if (ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_NO_MEM) {
+        // Not on air; retry on the next timer tick without consuming an attempt
+        entry.retransmit_now = true;
+        return false;
+    }
+    if (ret != ESP_OK) {
+        // Will not clear by itself: spend every attempt so the next timer tick fails the frame
+        ESP_LOGW(RELIABLE_CHANNEL_TAG, "Frame %lu cannot be sent: %s", entry.seq, esp_err_to_name(ret));
+        entry.attempts = config_.max_attempts;
+        entry.last_tx_us = 0;
+        return false;
+    }
+
+    if (entry.attempts > 0) {
+        count(peer, &reliable_stats_t::retransmissions);
+    }
+    entry.attempts++;
+    count(peer, &reliable_stats_t::transmissions);
+    return true;
+}
+
+esp_err_t ReliableChannel::send(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                                TickType_t wait_ticks, uint32_t* seq) {
+    if (!mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > ESP_NOW_RELIABLE_MAX_PAYLOAD_LEN || (len > 0 && !data) ||
+        len > manager_.get_max_payload_len(mac_addr) - sizeof(esp_now_reliable_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+
+    while (true) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        uint64_t now_us = esp_timer_get_time();
+
+        int peer_index = get_or_create_peer(mac_addr, now_us);
+        tx_entry_t* entry = nullptr;
+        if (peer_index >= 0 &&
+            peers_[peer_index].next_tx_seq - window_base(peer_index) < RELIABLE_CHANNEL_RX_WINDOW) {
+            for (auto& candidate : tx_entries_) {
+                if (!candidate.in_use) {
+                    entry = &candidate;
+                    break;
+                }
+            }
+        }
+
+        if (entry) {
+            peer_state_t& peer = peers_[peer_index];
+            memset(entry, 0, offsetof(tx_entry_t, payload));
+            entry->in_use = true;
+            entry->peer_index = peer_index;
+            entry->seq = peer.next_tx_seq++;
+            entry->len = sizeof(esp_now_reliable_header_t) + len;
+
+            esp_now_reliable_header_t header = {};
+            header.session = session_;
+            header.seq = entry->seq;
+            memcpy(entry->payload, &header, sizeof(header));
+            if (len > 0) {
+                memcpy(entry->payload + sizeof(header), data, len);
+            }
+
+            peer.tx_outstanding++;
+            count(peer, &reliable_stats_t::frames_sent);
+            if (seq) {
+                *seq = entry->seq;
+            }
+
+            transmit(*entry, now_us);
+            xSemaphoreGive(mutex_);
+            xTaskNotifyGive(task_handle_);
+            return ESP_OK;
+        }
+
+        xSemaphoreGive(mutex_);
+
+        // Several senders may share one wakeup, so poll as well
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait_ticks) {
+            return ESP_ERR_TIMEOUT;
+        }
+        xSemaphoreTake(space_sem_, std::min<TickType_t>(wait_ticks - elapsed, pdMS_TO_TICKS(10) + 1));
+    }
+}
+
+// Caller holds mutex_. Settles everything below target; unreceived seqs count as lost.
+void ReliableChannel::rx_skip_to(peer_state_t& peer, uint32_t target) {
+    while (seq_before(peer.rx_next, target)) {
+        if (!(peer.rx_window & 1)) {
+            count(peer, &reliable_stats_t::frames_lost);
+        }
+        peer.rx_window >>= 1;
+        peer.rx_next++;
+    }
+    while (peer.rx_window & 1) {
+        peer.rx_window >>= 1;
+        peer.rx_next++;
+    }
+}
+
+// Caller holds mutex_
+void ReliableChannel::send_ack(int peer_index) {
+    peer_state_t& peer = peers_[peer_index];
+
+    esp_now_reliable_ack_t ack;
+    ack.session = peer.rx_session;
+    ack.cumulative_ack = peer.rx_next;
+    ack.sack_bitmap = peer.rx_window >> 1;
+
+    if (manager_.send_message(peer.mac_addr, ESP_NOW_MSG_TYPE_RELIABLE_ACK,
+                              (const uint8_t*)&ack, sizeof(ack), 0) == ESP_OK) {
+        peer.rx_unacked = 0;
+        peer.ack_deadline_us = 0;
+        count(peer, &reliable_stats_t::acks_sent);
+    }
+}
+
+void ReliableChannel::handle_data(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!mutex_ || msg->payload_length < sizeof(esp_now_reliable_header_t)) {
+        return;
+    }
+
+    esp_now_reliable_header_t header;
+    memcpy(&header, msg->payload, sizeof(header));
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint64_t now_us = esp_timer_get_time();
+
+    int peer_index = get_or_create_peer(mac_addr, now_us);
+    if (peer_index < 0) {
+        xSemaphoreGive(mutex_);
+        return;
+    }
+    peer_state_t& peer = peers_[peer_index];
+
+    if (!peer.rx_synced || peer.rx_session != header.session) {
+        peer.rx_synced = true;
+        peer.rx_session = header.session;
+        peer.rx_next = header.window_base;
+        peer.rx_window = 0;
+        peer.rx_highest = header.window_base - 1;
+        peer.rx_unacked = 0;
+    }
+
+    if (seq_before(peer.rx_next, header.window_base)) {
+        rx_skip_to(peer, header.window_base);
+    }
+
+    bool deliver = false;
+    if (seq_before(header.seq, peer.rx_next)) {
+        count(peer, &reliable_stats_t::duplicates);
+    } else {
+        if (header.seq - peer.rx_next >= RELIABLE_CHANNEL_RX_WINDOW) {
+            rx_skip_to(peer, header.seq - (RELIABLE_CHANNEL_RX_WINDOW - 1));
+        }
+
+        uint32_t bit = 1u << (header.seq - peer.rx_next);
+        if (peer.rx_window & bit) {
+            count(peer, &reliable_stats_t::duplicates);
+        } else {
+            peer.rx_window |= bit;
+            deliver = true;
+            count(peer, &reliable_stats_t::frames_received);
+
+            if (seq_before(peer.rx_highest, header.seq)) {
+                if (header.seq - peer.rx_highest > 1) {
+                    count(peer, &reliable_stats_t::gaps_detected, header.seq - peer.rx_highest - 1);
+                }
+                peer.rx_highest = header.seq;
+            } else {
+                count(peer, &reliable_stats_t::out_of_order);
+            }
+            rx_skip_to(peer, peer.rx_next);
+        }
+    }
+
+    // A duplicate means our last ACK was lost and a hole needs the sender's
+    // attention, so both are answered right away; everything else is batched
+    peer.rx_unacked++;
+    if (!deliver || peer.rx_unacked >= config_.ack_every || peer.rx_window != 0) {
+        send_ack(peer_index);
+    } else if (peer.ack_deadline_us == 0) {
+        peer.ack_deadline_us = now_us + config_.ack_delay_ms * 1000ULL;
+    }
+    bool ack_pending = peer.ack_deadline_us != 0;
+    xSemaphoreGive(mutex_);
+
+    if (ack_pending) {
+        xTaskNotifyGive(task_handle_);
+    }
+
+    if (deliver && receive_callback_) {
+        receive_callback_(mac_addr, msg->payload + sizeof(header), msg->payload_length - sizeof(header));
+    }
+}
+
+void ReliableChannel::handle_ack(const uint8_t* mac_addr, const esp_now_message_t* msg) {
+    if (!mutex_ || msg->payload_length < sizeof(esp_now_reliable_ack_t)) {
+        return;
+    }
+
+    esp_now_reliable_ack_t ack;
+    memcpy(&ack, msg->payload, sizeof(ack));
+    if (ack.session != session_) {
+        return;
+    }
+
+    uint32_t acked[RELIABLE_CHANNEL_TX_SLOTS];
+    size_t acked_count = 0;
+    bool retransmit = false;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    int peer_index = find_peer(mac_addr);
+    if (peer_index < 0) {
+        xSemaphoreGive(mutex_);
+        return;
+    }
+    peer_state_t& peer = peers_[peer_index];
+    count(peer, &reliable_stats_t::acks_received);
+    peer.last_activity_us = esp_timer_get_time();
+
+    // Highest seq the receiver holds; anything unacked below it was lost on air
+    uint32_t highest_sacked = ack.cumulative_ack;
+    for (int i = 31; i >= 0; i--) {
+        if (ack.sack_bitmap & (1u << i)) {
+            highest_sacked = ack.cumulative_ack + 1 + i;
+            break;
+        }
+    }
+
+    for (auto& entry : tx_entries_) {
+        if (!entry.in_use || entry.peer_index != peer_index) {
+            continue;
+        }
+
+        uint32_t offset = entry.seq - ack.cumulative_ack - 1;
+        bool is_acked = seq_before(entry.seq, ack.cumulative_ack) ||
+                        (entry.seq != ack.cumulative_ack && offset < 32 && (ack.sack_bitmap & (1u << offset)));
+
+        if (is_acked) {
+            entry.in_use = false;
+            peer.tx_outstanding--;
+            count(peer, &reliable_stats_t::frames_acked);
+            acked[acked_count++] = entry.seq;
+        } else if (seq_before(entry.seq, highest_sacked) && entry.attempts == 1 && !entry.retransmit_now) {
+            // Selective ACK shows a hole: retransmit once without waiting for the timeout
+            entry.retransmit_now = true;
+            retransmit = true;
+        }
+    }
+
+    xSemaphoreGive(mutex_);
+
+    if (acked_count > 0) {
+        xSemaphoreGive(space_sem_);
+    }
+    if (retransmit) {
+        xTaskNotifyGive(task_handle_);
+    }
+
+    if (delivery_callback_) {
+        for (size_t i = 0; i < acked_count; i++) {
+            delivery_callback_(mac_addr, acked[i], true);
+        }
+    }
+}
+
+uint64_t ReliableChannel::retransmit_due_us(const tx_entry_t& entry) const {
+    uint32_t shift = std::min<uint32_t>(entry.attempts > 0 ? entry.attempts - 1 : 0, 4);
+    return entry.last_tx_us + ((uint64_t)config_.rto_ms * 1000 << shift);
+}
+
+// Returns the time in ms until the next timer is due
+uint32_t ReliableChannel::service_timers(uint64_t now_us) {
+    uint8_t failed_macs[RELIABLE_CHANNEL_TX_SLOTS][6];
+    uint32_t failed_seqs[RELIABLE_CHANNEL_TX_SLOTS];
+    size_t failed_count = 0;
+    uint64_t next_due_us = UINT64_MAX;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+
+    for (auto& entry : tx_entries_) {
+        if (!entry.in_use) {
+            continue;
+        }
+
+        uint64_t due_us = retransmit_due_us(entry);
+
+        if (entry.retransmit_now || due_us <= now_us) {
+            peer_state_t& peer = peers_[entry.peer_index];
+            if (!entry.retransmit_now && entry.attempts >= config_.max_attempts) {
+                entry.in_use = false;
+                peer.tx_outstanding--;
+                count(peer, &reliable_stats_t::frames_failed);
+                memcpy(failed_macs[failed_count], peer.mac_addr, 6);
+                failed_seqs[failed_count++] = entry.seq;
+                continue;
+            }
+            transmit(entry, now_us);
+            due_us = entry.retransmit_now ? now_us + 1000 : retransmit_due_us(entry);
+        }
+        next_due_us = std::min(next_due_us, due_us);
+    }
+
+    for (int i = 0; i < RELIABLE_CHANNEL_MAX_PEERS; i++) {
+        peer_state_t& peer = peers_[i];
+        if (!peer.in_use || peer.ack_deadline_us == 0) {
+            continue;
+        }
+        if (peer.ack_deadline_us <= now_us) {
+            send_ack(i);
+        }
+        if (peer.ack_deadline_us != 0) {
+            next_due_us = std::min(next_due_us, std::max(peer.ack_deadline_us, now_us + 1000));
+        }
+    }
+
+    xSemaphoreGive(mutex_);
+
+    if (failed_count > 0) {
+        xSemaphoreGive(space_sem_);
+        for (size_t i = 0; i < failed_count; i++) {
+            ESP_LOGW(RELIABLE_CHANNEL_TAG, "Frame %lu to %02x:%02x:%02x:%02x:%02x:%02x not acknowledged",
+                     failed_seqs[i], failed_macs[i][0], failed_macs[i][1], failed_macs[i][2],
+                     failed_macs[i][3], failed_macs[i][4], failed_macs[i][5]);
+            if (delivery_callback_) {
+                delivery_callback_(failed_macs[i], failed_seqs[i], false);
+            }
+        }
+    }
+
+    if (next_due_us == UINT64_MAX) {
+        return UINT32_MAX;
+    }
+    return next_due_us <= now_us ? 1 : (uint32_t)((next_due_us - now_us + 999) / 1000);
+}
+
+void ReliableChannel::retransmit_task(void* parameter) {
+    ReliableChannel* channel = (ReliableChannel*)parameter;
+    TickType_t wait_ticks = portMAX_DELAY;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait_ticks);
+
+        uint32_t next_ms = channel->service_timers(esp_timer_get_time());
+        if (next_ms == UINT32_MAX) {
+            wait_ticks = portMAX_DELAY;
+        } else {
+            wait_ticks = std::max<TickType_t>(pdMS_TO_TICKS(next_ms), 1);
+        }
+    }
+}
+
+reliable_stats_t ReliableChannel::get_stats() {
+    reliable_stats_t stats = {};
+    if (mutex_ && xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) == pdTRUE) {
+        stats = totals_;
+        xSemaphoreGive(mutex_);
+    }
+    return stats;
+}
+
+esp_err_t ReliableChannel::get_peer_stats(const uint8_t* mac_addr, reliable_stats_t* stats) {
+    if (!mutex_ || xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int index = find_peer(mac_addr);
+    if (index >= 0 && stats) {
+        *stats = peers_[index].stats;
+    }
+
+    xSemaphoreGive(mutex_);
+    return index >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+size_t ReliableChannel::get_outstanding(const uint8_t* mac_addr) {
+    if (!mutex_ || xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return 0;
+    }
+
+    size_t outstanding = 0;
+    int index = mac_addr ? find_peer(mac_addr) : -1;
+    for (const auto& entry : tx_entries_) {
+        if (entry.in_use && (!mac_addr || entry.peer_index == index)) {
+            outstanding++;
+        }
+    }
+
+    xSemaphoreGive(mutex_);
+    return outstanding;
+}
+
+void ReliableChannel::reset_stats() {
+    if (!mutex_ || xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+
+    memset(&totals_, 0, sizeof(totals_));
+    for (auto& peer : peers_) {
+        memset(&peer.stats, 0, sizeof(peer.stats));
+    }
+
+    xSemaphoreGive(mutex_);
+}
+
+void ReliableChannel::set_receive_callback(reliable_receive_callback_t callback) {
+    receive_callback_ = callback;
+}
+
+void ReliableChannel::set_delivery_callback(reliable_delivery_callback_t callback) {
+    delivery_callback_ = callback;
+}
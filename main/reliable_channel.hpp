@@ -0,0 +1,136 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "delegate.hpp"
+#include "esp_now_protocol.hpp"
+
+#define RELIABLE_CHANNEL_TAG "RELIABLE"
+#define RELIABLE_CHANNEL_MAX_PEERS 8
+#define RELIABLE_CHANNEL_TX_SLOTS 16  // Unacknowledged frames across all peers
+#define RELIABLE_CHANNEL_RX_WINDOW 32 // Receiver tracking window; bounds the sender's seq span
+
+class ESPNowManager;
+
+typedef struct {
+    uint32_t ack_delay_ms;   // Max time a received frame waits for a batched ACK
+    uint32_t ack_every;      // Send the ACK immediately after this many new frames
+    uint32_t rto_ms;         // Initial retransmit timeout, doubled per attempt
+    uint32_t max_attempts;   // Transmissions before a frame is reported as failed
+} reliable_config_t;
+
+typedef struct {
+    uint32_t frames_sent;        // Unique frames accepted by send()
+    uint32_t transmissions;      // Including retransmissions
+    uint32_t retransmissions;
+    uint32_t frames_acked;
+    uint32_t frames_failed;
+    uint32_t acks_received;
+    uint32_t frames_received;    // Unique frames delivered to the application
+    uint32_t duplicates;
+    uint32_t out_of_order;       // Frames that arrived after a higher sequence number
+    uint32_t gaps_detected;      // Sequence numbers found missing when a later frame arrived
+    uint32_t frames_lost;        // Gaps never filled before the sender gave up on them
+    uint32_t acks_sent;
+} reliable_stats_t;
+
+// Delivery is immediate and may be out of order; duplicates are suppressed
+typedef Delegate<void(const uint8_t* mac_addr, const uint8_t* data, size_t len)> reliable_receive_callback_t;
+typedef Delegate<void(const uint8_t* mac_addr, uint32_t seq, bool delivered)> reliable_delivery_callback_t;
+
+// Optional per-peer reliable delivery on top of ESP-NOW. Frames carry a per-peer
+// sequence number; the receiver answers with batched selective ACKs and the
+// sender retransmits from a bounded window, so several frames stay in flight.
+class ReliableChannel {
+private:
+    typedef struct {
+        bool in_use;
+        uint8_t mac_addr[6];
+        uint64_t last_activity_us;
+
+        uint32_t next_tx_seq;
+        uint32_t tx_outstanding;
+
+        bool rx_synced;
+        uint16_t rx_session;
+        uint32_t rx_next;        // Every seq below this is settled
+        uint32_t rx_window;      // Bit i: rx_next + i received
+        uint32_t rx_highest;
+        uint32_t rx_unacked;
+        uint64_t ack_deadline_us; // 0 when no ACK is pending
+
+        reliable_stats_t stats;
+    } peer_state_t;
+
+    typedef struct {
+        bool in_use;
+        bool retransmit_now;
+        uint8_t peer_index;
+        uint8_t attempts;
+        uint16_t len;
+        uint32_t seq;
+        uint64_t last_tx_us;
+        uint8_t payload[ESP_NOW_MAX_PAYLOAD_LEN];  // Header plus application data
+    } tx_entry_t;
+
+    ESPNowManager& manager_;
+    reliable_config_t config_;
+    uint16_t session_;
+
+    peer_state_t peers_[RELIABLE_CHANNEL_MAX_PEERS];
+    tx_entry_t tx_entries_[RELIABLE_CHANNEL_TX_SLOTS];
+    reliable_stats_t totals_;
+
+    SemaphoreHandle_t mutex_;
+    SemaphoreHandle_t space_sem_;  // Given whenever a tx entry is freed
+    TaskHandle_t task_handle_;
+
+    reliable_receive_callback_t receive_callback_;
+    reliable_delivery_callback_t delivery_callback_;
+
+    static void retransmit_task(void* parameter);
+    uint32_t service_timers(uint64_t now_us);
+    uint64_t retransmit_due_us(const tx_entry_t& entry) const;
+
+    int find_peer(const uint8_t* mac_addr) const;
+    int get_or_create_peer(const uint8_t* mac_addr, uint64_t now_us);
+    uint32_t window_base(int peer_index) const;
+    bool transmit(tx_entry_t& entry, uint64_t now_us);
+    void send_ack(int peer_index);
+    void rx_skip_to(peer_state_t& peer, uint32_t target);
+    void count(peer_state_t& peer, uint32_t reliable_stats_t::*field, uint32_t n = 1);
+
+public:
+    explicit ReliableChannel(ESPNowManager& manager);
+    ~ReliableChannel();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Queues data for reliable delivery; blocks up to wait_ticks while the send window is full.
+    // ESP_ERR_INVALID_SIZE when len does not fit one frame to mac_addr.
+    esp_err_t send(const uint8_t* mac_addr, const uint8_t* data, size_t len,
+                   TickType_t wait_ticks = pdMS_TO_TICKS(1000), uint32_t* seq = nullptr);
+
+    // Called from the receive task
+    void handle_data(const uint8_t* mac_addr, const esp_now_message_t* msg);
+    void handle_ack(const uint8_t* mac_addr, const esp_now_message_t* msg);
+
+    void set_config(const reliable_config_t& config);
+    reliable_config_t get_config() const;
+    static reliable_config_t default_config();
+
+    reliable_stats_t get_stats();
+    esp_err_t get_peer_stats(const uint8_t* mac_addr, reliable_stats_t* stats);
+    size_t get_outstanding(const uint8_t* mac_addr = nullptr);
+    void reset_stats();
+
+    void set_receive_callback(reliable_receive_callback_t callback);
+    void set_delivery_callback(reliable_delivery_callback_t callback);
+};
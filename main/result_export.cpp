@@ -0,0 +1,224 @@
+#include "result_export.hpp"
+#include <esp_crc.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#if CONFIG_ESP_CONSOLE_UART
+#include <driver/uart_vfs.h>
+#endif
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
+#include <driver/usb_serial_jtag_vfs.h>
+#endif
+
+static_assert(sizeof(result_record_header_t) == 8, "record header layout is part of the format");
+static_assert(sizeof(result_test_record_t) == 304, "test record layout is part of the format");
+static_assert(sizeof(result_histogram_record_t) == 44, "histogram record layout is part of the format");
+static_assert(sizeof(result_statistics_record_t) == 80, "statistics record layout is part of the format");
+static_assert(sizeof(result_benchmark_record_t) == 72, "benchmark record layout is part of the format");
+
+ResultExporter::ResultExporter(result_export_sink_t sink) : sink_(sink), records_(0) {
+}
+
+esp_err_t ResultExporter::write_record(uint8_t type, const void* payload, size_t len) {
+    if (!sink_ || len > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // One sink call per record: console writes from other tasks cannot split it
+    uint8_t* frame = new (std::nothrow) uint8_t[sizeof(result_record_header_t) + len];
+    if (!frame) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    result_record_header_t header;
+    header.sync = RESULT_EXPORT_SYNC;
+    header.type = type;
+    header.length = len;
+    header.crc32 = esp_crc32_le(0, (const uint8_t*)payload, len);
+    memcpy(frame, &header, sizeof(header));
+    if (len > 0) {
+        memcpy(frame + sizeof(header), payload, len);
+    }
+
+    esp_err_t ret = sink_(frame, sizeof(header) + len);
+    delete[] frame;
+    if (ret == ESP_OK) {
+        records_++;
+    }
+    return ret;
+}
+
+void ResultExporter::fill_summary(result_stream_summary_t* out, const StreamingStats& stats) {
+    out->count = stats.count();
+    out->mean = stats.mean();
+    out->stddev = stats.stddev();
+    out->min = stats.min();
+    out->max = stats.max();
+    out->p50 = stats.p50();
+    out->p90 = stats.p90();
+    out->p99 = stats.p99();
+    out->jitter = stats.jitter();
+}
+
+esp_err_t ResultExporter::begin(const uint8_t* device_mac) {
+    records_ = 0;
+
+    result_stream_header_t header = {};
+    header.magic = RESULT_EXPORT_MAGIC;
+    header.format_version = RESULT_EXPORT_FORMAT_VERSION;
+    if (device_mac) {
+        memcpy(header.device_mac, device_mac, 6);
+    }
+    header.device_time_us = esp_timer_get_time();
+    return write_record(RESULT_RECORD_HEADER, &header, sizeof(header));
+}
+
+esp_err_t ResultExporter::write_test_result(const test_result_t& result) {
+    result_test_record_t record = {};
+    memcpy(record.test_name, result.test_name, sizeof(record.test_name));
+    record.test_name[sizeof(record.test_name) - 1] = '\0';
+    record.status = result.status;
+    record.reliability_passed = result.reliability_passed;
+    record.avg_rssi_dbm = result.avg_rssi_dbm;
+    record.start_time_us = result.start_time_us;
+    record.end_time_us = result.end_time_us;
+    record.iterations_completed = result.iterations_completed;
+    record.iterations_total = result.iterations_total;
+    record.avg_latency_ms = result.avg_latency_ms;
+    record.min_latency_ms = result.min_latency_ms;
+    record.max_latency_ms = result.max_latency_ms;
+    record.stddev_latency_ms = result.stddev_latency_ms;
+    record.avg_throughput_bps = result.avg_throughput_bps;
+    record.avg_packet_loss_percent = result.avg_packet_loss_percent;
+    record.discovery_time_ms = result.discovery_time_ms;
+    record.devices_discovered = result.devices_discovered;
+    record.max_range_meters = result.max_range_meters;
+    fill_summary(&record.latency_ms, result.latency_ms);
+    fill_summary(&record.throughput_bps, result.throughput_bps);
+    fill_summary(&record.packet_loss_percent, result.packet_loss_percent);
+    fill_summary(&record.rssi_dbm, result.rssi_dbm);
+    memcpy(record.error_message, result.error_message, sizeof(record.error_message));
+    record.error_message[sizeof(record.error_message) - 1] = '\0';
+
+    return write_record(RESULT_RECORD_TEST_RESULT, &record, sizeof(record));
+}
+
+esp_err_t ResultExporter::write_histogram(uint8_t stage, const char* name, const LatencyHistogram& histogram) {
+    // Sized for the worst case so the CRC covers exactly what is sent
+    size_t max_len = sizeof(result_histogram_record_t) +
+                     LATENCY_HISTOGRAM_BUCKETS * sizeof(result_histogram_bucket_t);
+    uint8_t* payload = new (std::nothrow) uint8_t[max_len];
+    if (!payload) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    result_histogram_record_t record = {};
+    record.stage = stage;
+    record.sub_bucket_bits = LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    snprintf(record.name, sizeof(record.name), "%s", name ? name : "");
+    record.count = histogram.count();
+    record.min = histogram.min();
+    record.max = histogram.max();
+    record.mean = histogram.mean();
+
+    size_t offset = sizeof(record);
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        uint32_t count = histogram.bucket(i);
+        if (count == 0) {
+            continue;
+        }
+        result_histogram_bucket_t entry = {(uint16_t)i, count};
+        memcpy(payload + offset, &entry, sizeof(entry));
+        offset += sizeof(entry);
+        record.bucket_entries++;
+    }
+    memcpy(payload, &record, sizeof(record));
+
+    esp_err_t ret = write_record(RESULT_RECORD_HISTOGRAM, payload, offset);
+    delete[] payload;
+    return ret;
+}
+
+void ResultExporter::encode_statistics(const esp_now_statistics_t& stats, result_statistics_record_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->snapshot_time_us = stats.snapshot_time_us;
+    out->session_start_time_us = stats.session_start_time_us;
+    out->packets_sent = stats.total_packets_sent;
+    out->packets_received = stats.total_packets_received;
+    out->packets_lost = stats.total_packets_lost;
+    out->retries = stats.total_retries;
+    out->bytes_sent = stats.total_bytes_sent;
+    out->bytes_received = stats.total_bytes_received;
+    out->rx_dropped_invalid_size = stats.rx_dropped_invalid_size;
+    out->rx_dropped_no_buffer = stats.rx_dropped_no_buffer;
+    out->rx_dropped_queue_full = stats.rx_dropped_queue_full;
+    out->rx_crc_errors = stats.rx_crc_errors;
+    out->rx_length_errors = stats.rx_length_errors;
+    out->tx_queue_timeouts = stats.tx_queue_timeouts;
+    out->tx_done_dropped = stats.tx_done_dropped;
+    out->rx_queue_high_water = stats.rx_queue_high_water;
+    out->tx_queue_high_water = stats.tx_queue_high_water;
+}
+
+esp_err_t ResultExporter::write_statistics(const esp_now_statistics_t& stats) {
+    result_statistics_record_t record;
+    encode_statistics(stats, &record);
+    return write_record(RESULT_RECORD_STATISTICS, &record, sizeof(record));
+}
+
+esp_err_t ResultExporter::write_benchmark(const result_benchmark_record_t& record) {
+    return write_record(RESULT_RECORD_BENCHMARK, &record, sizeof(record));
+}
+
+esp_err_t ResultExporter::end() {
+    result_stream_end_t trailer = {records_};
+    return write_record(RESULT_RECORD_END, &trailer, sizeof(trailer));
+}
+
+uint32_t ResultExporter::records_written() const {
+    return records_;
+}
+
+esp_err_t ResultExporter::console_sink(const uint8_t* data, size_t len) {
+    if (fwrite(data, 1, len, stdout) != len) {
+        return ESP_FAIL;
+    }
+    fflush(stdout);
+    return ESP_OK;
+}
+
+ConsoleExportScope::ConsoleExportScope(const char* keep_tag) : saved_level_(esp_log_level_get("*")) {
+    fflush(stdout);
+    set_line_endings(true);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    if (keep_tag) {
+        esp_log_level_set(keep_tag, saved_level_);
+    }
+}
+
+ConsoleExportScope::~ConsoleExportScope() {
+    fflush(stdout);
+    esp_log_level_set("*", saved_level_);
+    set_line_endings(false);
+}
+
+void ConsoleExportScope::set_line_endings(bool raw) {
+#if CONFIG_ESP_CONSOLE_UART || CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
+#if CONFIG_LIBC_STDOUT_LINE_ENDING_LF
+    esp_line_endings_t cooked = ESP_LINE_ENDINGS_LF;
+#elif CONFIG_LIBC_STDOUT_LINE_ENDING_CR
+    esp_line_endings_t cooked = ESP_LINE_ENDINGS_CR;
+#else
+    esp_line_endings_t cooked = ESP_LINE_ENDINGS_CRLF;
+#endif
+#if CONFIG_ESP_CONSOLE_UART
+    uart_vfs_dev_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, raw ? ESP_LINE_ENDINGS_LF : cooked);
+#endif
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
+    usb_serial_jtag_vfs_set_tx_line_endings(raw ? ESP_LINE_ENDINGS_LF : cooked);
+#endif
+#else
+    (void)raw;
+#endif
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "esp_now_manager.hpp"
+#include "latency_histogram.hpp"
+#include "streaming_stats.hpp"
+#include "test_framework.hpp"
+
+#define RESULT_EXPORT_TAG "RESULT_EXPORT"
+#define RESULT_EXPORT_FORMAT_VERSION 1
+#define RESULT_EXPORT_SYNC 0xA5
+#define RESULT_EXPORT_MAGIC 0x58524E45  // "ENRX"
+
+// Stream format: a sequence of records, each a header followed by length payload bytes.
+// All fields are little-endian (native on ESP32). The per-record sync byte and CRC let a
+// decoder skip interleaved console text or a torn tail and resynchronize.
+typedef enum {
+    RESULT_RECORD_HEADER = 0x01,
+    RESULT_RECORD_TEST_RESULT = 0x02,
+    RESULT_RECORD_HISTOGRAM = 0x03,
+    RESULT_RECORD_STATISTICS = 0x04,
+    RESULT_RECORD_BENCHMARK = 0x05,
+    RESULT_RECORD_END = 0x7F,
+} result_record_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync;
+    uint8_t type;
+    uint16_t length;
+    uint32_t crc32;       // esp_crc32_le(0, payload, length), equal to zlib.crc32
+} result_record_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t format_version;
+    uint8_t device_mac[6];
+    uint64_t device_time_us;
+} result_stream_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t count;
+    float mean;
+    float stddev;
+    float min;
+    float max;
+    float p50;
+    float p90;
+    float p99;
+    float jitter;
+} result_stream_summary_t;
+
+typedef struct __attribute__((packed)) {
+    char test_name[TEST_NAME_MAX_LEN];
+    uint8_t status;
+    uint8_t reliability_passed;
+    int8_t avg_rssi_dbm;
+    uint8_t reserved;
+    uint64_t start_time_us;
+    uint64_t end_time_us;
+    uint32_t iterations_completed;
+    uint32_t iterations_total;
+    float avg_latency_ms;
+    float min_latency_ms;
+    float max_latency_ms;
+    float stddev_latency_ms;
+    uint32_t avg_throughput_bps;
+    float avg_packet_loss_percent;
+    uint32_t discovery_time_ms;
+    uint32_t devices_discovered;
+    uint32_t max_range_meters;
+    result_stream_summary_t latency_ms;
+    result_stream_summary_t throughput_bps;
+    result_stream_summary_t packet_loss_percent;
+    result_stream_summary_t rssi_dbm;
+    char error_message[TEST_ERROR_MAX_LEN];
+} result_test_record_t;
+
+// Followed by bucket_entries x result_histogram_bucket_t, non-empty buckets only
+typedef struct __attribute__((packed)) {
+    uint8_t stage;
+    uint8_t sub_bucket_bits;
+    uint16_t bucket_entries;
+    char name[24];
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+} result_histogram_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t index;
+    uint32_t count;
+} result_histogram_bucket_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t snapshot_time_us;
+    uint64_t session_start_time_us;
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t packets_lost;
+    uint32_t retries;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint32_t rx_dropped_invalid_size;
+    uint32_t rx_dropped_no_buffer;
+    uint32_t rx_dropped_queue_full;
+    uint32_t rx_crc_errors;
+    uint32_t rx_length_errors;
+    uint32_t tx_queue_timeouts;
+    uint32_t tx_done_dropped;
+    uint16_t rx_queue_high_water;
+    uint16_t tx_queue_high_water;
+} result_statistics_record_t;
+
+typedef enum {
+    RESULT_BENCH_OK = 0,
+    RESULT_BENCH_FAILED = 1,
+    RESULT_BENCH_SKIPPED = 2,     // Not enough peers, or payload beyond the negotiated size
+} result_bench_status_t;
+
+// One benchmark case. The name is derived from the parameters, so it stays the key a
+// host baseline is matched on from one firmware build to the next.
+typedef struct __attribute__((packed)) {
+    char case_name[TEST_NAME_MAX_LEN];
+    uint8_t kind;
+    uint8_t status;
+    uint16_t payload_len;
+    uint8_t peers;
+    uint8_t queue_depth;
+    uint16_t reserved;
+    uint32_t duration_ms;
+    uint32_t samples;
+    float latency_mean_ms;
+    float latency_p50_ms;
+    float latency_p99_ms;
+    float latency_max_ms;
+    float goodput_kbps;
+    float loss_percent;
+} result_benchmark_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t records;     // Records written before this one, including the header
+} result_stream_end_t;
+
+// Receives the encoded stream one complete record (header and payload) per call
+typedef std::function<esp_err_t(const uint8_t* data, size_t len)> result_export_sink_t;
+
+// Writes records straight to the sink as they are produced; nothing beyond the record
+// being encoded is held in RAM.
+class ResultExporter {
+private:
+    result_export_sink_t sink_;
+    uint32_t records_;
+
+    esp_err_t write_record(uint8_t type, const void* payload, size_t len);
+    static void fill_summary(result_stream_summary_t* out, const StreamingStats& stats);
+
+public:
+    explicit ResultExporter(result_export_sink_t sink);
+
+    esp_err_t begin(const uint8_t* device_mac);
+    esp_err_t write_test_result(const test_result_t& result);
+    esp_err_t write_histogram(uint8_t stage, const char* name, const LatencyHistogram& histogram);
+    esp_err_t write_statistics(const esp_now_statistics_t& stats);
+    esp_err_t write_benchmark(const result_benchmark_record_t& record);
+    esp_err_t end();
+
+    uint32_t records_written() const;
+
+    // Shared with FlashLog, which stores the same statistics payload
+    static void encode_statistics(const esp_now_statistics_t& stats, result_statistics_record_t* out);
+
+    // Raw bytes to the console (UART or USB-CDC); hold a ConsoleExportScope while exporting
+    static esp_err_t console_sink(const uint8_t* data, size_t len);
+};
+
+// For the lifetime of an export: console output is sent without LF to CRLF translation,
+// which would corrupt every 0x0A byte of a record, and logging below ERROR is silenced
+// except for keep_tag. Records are written whole, so anything still logged falls
+// between them and the decoder skips it.
+class ConsoleExportScope {
+private:
+    esp_log_level_t saved_level_;
+
+    static void set_line_endings(bool raw);
+
+public:
+    explicit ConsoleExportScope(const char* keep_tag = nullptr);
+    ~ConsoleExportScope();
+
+    ConsoleExportScope(const ConsoleExportScope&) = delete;
+    ConsoleExportScope& operator=(const ConsoleExportScope&) = delete;
+};
@@ -0,0 +1,242 @@
+#include "rtt_engine.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <algorithm>
+
+RttEngine::RttEngine(ESPNowManager& manager)
+    : manager_(manager), slots_lock_(portMUX_INITIALIZER_UNLOCKED), next_ping_id_(1),
+      late_responses_(0), sample_queue_(nullptr), run_mutex_(nullptr) {
+    clear_slots();
+}
+
+RttEngine::~RttEngine() {
+    deinitialize();
+}
+
+esp_err_t RttEngine::initialize() {
+    if (sample_queue_) {
+        return ESP_OK;
+    }
+
+    sample_queue_ = xQueueCreate(RTT_ENGINE_SLOTS, sizeof(rtt_sample_t));
+    run_mutex_ = xSemaphoreCreateMutex();
+
+    if (!sample_queue_ || !run_mutex_) {
+        ESP_LOGE(RTT_ENGINE_TAG, "Failed to create RTT engine queue or mutex");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void RttEngine::deinitialize() {
+    if (sample_queue_) {
+        vQueueDelete(sample_queue_);
+        sample_queue_ = nullptr;
+    }
+
+    if (run_mutex_) {
+        vSemaphoreDelete(run_mutex_);
+        run_mutex_ = nullptr;
+    }
+}
+
+rtt_measure_config_t RttEngine::default_config(uint32_t count) {
+    rtt_measure_config_t config;
+    config.count = count;
+    config.window = RTT_ENGINE_DEFAULT_WINDOW;
+    config.timeout_ms = 100;
+    config.interval_ms = 0;
+    config.payload_len = sizeof(esp_now_ping_payload_t);
+    return config;
+}
+
+esp_err_t RttEngine::send_ping(const uint8_t* mac_addr, size_t payload_len, uint32_t* ping_id) {
+    uint8_t payload[ESP_NOW_MAX_PAYLOAD_LEN_V2];
+    payload_len = std::max(payload_len, sizeof(esp_now_ping_payload_t));
+    if (payload_len > sizeof(payload)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_now_ping_payload_t ping;
+    uint64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&slots_lock_);
+    ping.ping_id = next_ping_id_++;
+    ping.tx_timestamp_us = now_us;
+    ping_slot_t& slot = slots_[ping.ping_id & (RTT_ENGINE_SLOTS - 1)];
+    slot.ping_id = ping.ping_id;
+    slot.tx_timestamp_us = now_us;
+    slot.in_flight = true;
+    portEXIT_CRITICAL(&slots_lock_);
+
+    memcpy(payload, &ping, sizeof(ping));
+    if (payload_len > sizeof(ping)) {
+        memset(payload + sizeof(ping), 0x5A, payload_len - sizeof(ping));
+    }
+
+    esp_err_t ret = manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_PING, payload, payload_len);
+    if (ret != ESP_OK) {
+        portENTER_CRITICAL(&slots_lock_);
+        if (slot.ping_id == ping.ping_id) {
+            slot.in_flight = false;
+        }
+        portEXIT_CRITICAL(&slots_lock_);
+        return ret;
+    }
+
+    if (ping_id) {
+        *ping_id = ping.ping_id;
+    }
+    return ESP_OK;
+}
+
+void RttEngine::handle_pong(const esp_now_message_t* msg, uint64_t rx_timestamp_us) {
+    // Legacy peers echo only a 4-byte sequence number; those cannot be matched
+    if (msg->payload_length < sizeof(esp_now_ping_payload_t)) {
+        return;
+    }
+
+    esp_now_ping_payload_t pong;
+    memcpy(&pong, msg->payload, sizeof(pong));
+
+    rtt_sample_t sample;
+    bool matched = false;
+
+    portENTER_CRITICAL(&slots_lock_);
+    ping_slot_t& slot = slots_[pong.ping_id & (RTT_ENGINE_SLOTS - 1)];
+    if (slot.in_flight && slot.ping_id == pong.ping_id) {
+        slot.in_flight = false;
+        sample.ping_id = pong.ping_id;
+        sample.rtt_us = (uint32_t)(rx_timestamp_us - slot.tx_timestamp_us);
+        sample.tx_us = slot.tx_timestamp_us;
+        sample.peer_tx_us = msg->timestamp_us;
+        sample.rx_us = rx_timestamp_us;
+        matched = true;
+    }
+    portEXIT_CRITICAL(&slots_lock_);
+
+    if (!matched) {
+        late_responses_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (sample_queue_) {
+        xQueueSend(sample_queue_, &sample, 0);
+    }
+}
+
+void RttEngine::clear_slots() {
+    portENTER_CRITICAL(&slots_lock_);
+    for (auto& slot : slots_) {
+        slot.ping_id = 0;
+        slot.tx_timestamp_us = 0;
+        slot.in_flight = false;
+    }
+    portEXIT_CRITICAL(&slots_lock_);
+}
+
+uint32_t RttEngine::expire_slots(uint64_t now_us, uint64_t timeout_us) {
+    uint32_t expired = 0;
+
+    portENTER_CRITICAL(&slots_lock_);
+    for (auto& slot : slots_) {
+        if (slot.in_flight && (now_us - slot.tx_timestamp_us) >= timeout_us) {
+            slot.in_flight = false;
+            expired++;
+        }
+    }
+    portEXIT_CRITICAL(&slots_lock_);
+
+    return expired;
+}
+
+uint64_t RttEngine::oldest_in_flight_us() {
+    uint64_t oldest = UINT64_MAX;
+
+    portENTER_CRITICAL(&slots_lock_);
+    for (const auto& slot : slots_) {
+        if (slot.in_flight && slot.tx_timestamp_us < oldest) {
+            oldest = slot.tx_timestamp_us;
+        }
+    }
+    portEXIT_CRITICAL(&slots_lock_);
+
+    return oldest;
+}
+
+esp_err_t RttEngine::measure(const uint8_t* mac_addr, const rtt_measure_config_t& config,
+                             rtt_sample_callback_t on_sample, rtt_run_stats_t* stats) {
+    if (!sample_queue_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(run_mutex_, 0) != pdTRUE) {
+        ESP_LOGW(RTT_ENGINE_TAG, "RTT measurement already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t window = std::min<uint32_t>(std::max<uint32_t>(config.window, 1), RTT_ENGINE_SLOTS);
+    uint64_t timeout_us = (uint64_t)std::max<uint32_t>(config.timeout_ms, 1) * 1000;
+
+    clear_slots();
+    xQueueReset(sample_queue_);
+    uint32_t late_at_start = late_responses_.load(std::memory_order_relaxed);
+
+    rtt_run_stats_t run = {};
+    uint32_t outstanding = 0;
+
+    while (run.sent + run.send_failures < config.count || outstanding > 0) {
+        // Keep the window full
+        while (outstanding < window && run.sent + run.send_failures < config.count) {
+            if (send_ping(mac_addr, config.payload_len) == ESP_OK) {
+                run.sent++;
+                outstanding++;
+            } else {
+                run.send_failures++;
+            }
+
+            if (config.interval_ms > 0) {
+                vTaskDelay(pdMS_TO_TICKS(config.interval_ms));
+            }
+        }
+
+        if (outstanding == 0) {
+            continue;
+        }
+
+        // Block until a PONG arrives or the oldest outstanding ping times out
+        uint64_t now_us = esp_timer_get_time();
+        uint64_t oldest_us = oldest_in_flight_us();
+        uint64_t deadline_us = (oldest_us == UINT64_MAX) ? now_us : oldest_us + timeout_us;
+        TickType_t wait_ticks = deadline_us > now_us ?
+            pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000) : 0;
+
+        rtt_sample_t sample;
+        if (xQueueReceive(sample_queue_, &sample, std::max<TickType_t>(wait_ticks, 1)) == pdPASS) {
+            outstanding--;
+            run.received++;
+            if (on_sample) {
+                on_sample(sample);
+            }
+            continue;
+        }
+
+        uint32_t expired = expire_slots(esp_timer_get_time(), timeout_us);
+        expired = std::min(expired, outstanding);
+        outstanding -= expired;
+        run.timed_out += expired;
+    }
+
+    run.late_responses = late_responses_.load(std::memory_order_relaxed) - late_at_start;
+    xSemaphoreGive(run_mutex_);
+
+    if (stats) {
+        *stats = run;
+    }
+
+    ESP_LOGD(RTT_ENGINE_TAG, "RTT run: %lu sent, %lu received, %lu timed out, %lu late",
+             run.sent, run.received, run.timed_out, run.late_responses);
+    return ESP_OK;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <functional>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+
+#define RTT_ENGINE_TAG "RTT_ENGINE"
+#define RTT_ENGINE_SLOTS 64          // Ping table size (power of two), also the max window
+#define RTT_ENGINE_DEFAULT_WINDOW 4  // Pings kept in flight by default
+
+class ESPNowManager;
+
+typedef struct {
+    uint32_t ping_id;
+    uint32_t rtt_us;
+    uint64_t tx_us;          // Local PING send time
+    uint64_t peer_tx_us;     // PONG header timestamp, in the responder's clock
+    uint64_t rx_us;          // Local PONG receive time
+} rtt_sample_t;
+
+typedef struct {
+    uint32_t count;        // Pings to send
+    uint32_t window;       // Max pings in flight (1 = stop-and-wait)
+    uint32_t timeout_ms;   // Per-ping response timeout
+    uint32_t interval_ms;  // Optional pacing between sends
+    size_t payload_len;    // PING payload size (>= sizeof(esp_now_ping_payload_t))
+} rtt_measure_config_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t timed_out;
+    uint32_t send_failures;
+    uint32_t late_responses;  // PONGs that arrived after their ping timed out
+} rtt_run_stats_t;
+
+typedef std::function<void(const rtt_sample_t&)> rtt_sample_callback_t;
+
+// Matches PONGs to outstanding PINGs by ping id (ring table indexed by id) and
+// measures true round-trip time from send to the PONG's driver receive timestamp.
+class RttEngine {
+private:
+    typedef struct {
+        uint32_t ping_id;
+        uint64_t tx_timestamp_us;
+        bool in_flight;
+    } ping_slot_t;
+
+    ESPNowManager& manager_;
+    ping_slot_t slots_[RTT_ENGINE_SLOTS];
+    portMUX_TYPE slots_lock_;
+    uint32_t next_ping_id_;
+    std::atomic<uint32_t> late_responses_;
+
+    QueueHandle_t sample_queue_;
+    SemaphoreHandle_t run_mutex_;
+
+    void clear_slots();
+    uint32_t expire_slots(uint64_t now_us, uint64_t timeout_us);
+    uint64_t oldest_in_flight_us();
+
+public:
+    explicit RttEngine(ESPNowManager& manager);
+    ~RttEngine();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Sends one PING and registers it in the ping table
+    esp_err_t send_ping(const uint8_t* mac_addr, size_t payload_len, uint32_t* ping_id = nullptr);
+
+    // Called from the receive task for every PONG
+    void handle_pong(const esp_now_message_t* msg, uint64_t rx_timestamp_us);
+
+    // Windowed RTT measurement; blocks until all pings are answered or timed out
+    esp_err_t measure(const uint8_t* mac_addr, const rtt_measure_config_t& config,
+                      rtt_sample_callback_t on_sample, rtt_run_stats_t* stats = nullptr);
+
+    static rtt_measure_config_t default_config(uint32_t count);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+#include <atomic>
+
+// Counters owned by exactly one writer context. The writer bumps seq_ to an odd value
+// while it updates, so a reader retries until it copies the block between two reads
+// of the same even sequence. Writers never wait; reset is requested by readers and
+// carried out by the writer on its next update.
+template <typename T>
+class StatsShard {
+private:
+    std::atomic<uint32_t> seq_;
+    std::atomic<bool> reset_pending_;
+    T value_;
+
+public:
+    StatsShard() : seq_(0), reset_pending_(false), value_() {}
+
+    // Writer side only
+    template <typename F>
+    void update(F fn) {
+        seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (reset_pending_.exchange(false, std::memory_order_acquire)) {
+            value_ = T();
+        }
+        fn(value_);
+        std::atomic_thread_fence(std::memory_order_release);
+        seq_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Any task; blocks for a tick if it keeps catching the writer mid-update
+    // (a preempted lower-priority writer needs the CPU to finish)
+    T read() const {
+        for (uint32_t attempt = 0;; attempt++) {
+            if (reset_pending_.load(std::memory_order_acquire)) {
+                return T();
+            }
+
+            uint32_t before = seq_.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                T copy = value_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == before) {
+                    return copy;
+                }
+            }
+
+            if (attempt >= 4) {
+                vTaskDelay(1);
+            }
+        }
+    }
+
+    void request_reset() {
+        reset_pending_.store(true, std::memory_order_release);
+    }
+};
@@ -0,0 +1,141 @@
+#include "streaming_stats.hpp"
+#include <esp_random.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+static const float STREAMING_STATS_QUANTILES[3] = {0.50f, 0.90f, 0.99f};
+
+void StreamingStats::reset() {
+    memset(this, 0, sizeof(*this));
+}
+
+void StreamingStats::add(float value) {
+    count_++;
+
+    double delta = value - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (value - mean_);
+
+    if (count_ == 1) {
+        min_ = value;
+        max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        abs_diff_sum_ += std::fabs(value - last_);
+    }
+    last_ = value;
+
+    for (size_t i = 0; i < 3; i++) {
+        p2_add(quantiles_[i], STREAMING_STATS_QUANTILES[i], value, count_);
+    }
+
+    // Algorithm R
+    if (count_ <= STREAMING_STATS_RESERVOIR_SIZE) {
+        reservoir_[count_ - 1] = value;
+    } else {
+        uint32_t slot = esp_random() % count_;
+        if (slot < STREAMING_STATS_RESERVOIR_SIZE) {
+            reservoir_[slot] = value;
+        }
+    }
+}
+
+void StreamingStats::p2_add(p2_estimator_t& e, float quantile, float value, uint32_t count) {
+    if (count <= 5) {
+        e.heights[count - 1] = value;
+        if (count == 5) {
+            std::sort(e.heights, e.heights + 5);
+            for (int i = 0; i < 5; i++) {
+                e.positions[i] = i + 1;
+            }
+            e.desired[0] = 1.0f;
+            e.desired[1] = 1.0f + 2.0f * quantile;
+            e.desired[2] = 1.0f + 4.0f * quantile;
+            e.desired[3] = 3.0f + 2.0f * quantile;
+            e.desired[4] = 5.0f;
+        }
+        return;
+    }
+
+    const float increments[5] = {0.0f, quantile / 2.0f, quantile, (1.0f + quantile) / 2.0f, 1.0f};
+
+    int cell;
+    if (value < e.heights[0]) {
+        e.heights[0] = value;
+        cell = 0;
+    } else if (value >= e.heights[4]) {
+        e.heights[4] = value;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (cell < 3 && value >= e.heights[cell + 1]) {
+            cell++;
+        }
+    }
+
+    for (int i = cell + 1; i < 5; i++) {
+        e.positions[i]++;
+    }
+    for (int i = 0; i < 5; i++) {
+        e.desired[i] += increments[i];
+    }
+
+    // Move the middle markers toward their desired positions
+    for (int i = 1; i < 4; i++) {
+        float d = e.desired[i] - e.positions[i];
+        if ((d >= 1.0f && e.positions[i + 1] - e.positions[i] > 1) ||
+            (d <= -1.0f && e.positions[i - 1] - e.positions[i] < -1)) {
+            int step = d >= 0 ? 1 : -1;
+            float n_prev = e.positions[i - 1], n = e.positions[i], n_next = e.positions[i + 1];
+            float q_prev = e.heights[i - 1], q = e.heights[i], q_next = e.heights[i + 1];
+
+            float parabolic = q + step / (n_next - n_prev) *
+                ((n - n_prev + step) * (q_next - q) / (n_next - n) +
+                 (n_next - n - step) * (q - q_prev) / (n - n_prev));
+
+            if (q_prev < parabolic && parabolic < q_next) {
+                e.heights[i] = parabolic;
+            } else {
+                float q_step = e.heights[i + step];
+                float n_step = e.positions[i + step];
+                e.heights[i] = q + step * (q_step - q) / (n_step - n);
+            }
+            e.positions[i] += step;
+        }
+    }
+}
+
+float StreamingStats::percentile_estimate(size_t index) const {
+    if (count_ == 0 || index >= 3) {
+        return 0.0f;
+    }
+
+    if (count_ < 5) {
+        // Too few samples for the markers; use the exact order statistic
+        float sorted[5];
+        memcpy(sorted, quantiles_[index].heights, count_ * sizeof(float));
+        std::sort(sorted, sorted + count_);
+        size_t rank = (size_t)(STREAMING_STATS_QUANTILES[index] * (count_ - 1) + 0.5f);
+        return sorted[rank];
+    }
+
+    return quantiles_[index].heights[2];
+}
+
+float StreamingStats::variance() const {
+    return count_ > 1 ? (float)(m2_ / (count_ - 1)) : 0.0f;
+}
+
+float StreamingStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+float StreamingStats::jitter() const {
+    return count_ > 1 ? (float)(abs_diff_sum_ / (count_ - 1)) : 0.0f;
+}
+
+size_t StreamingStats::reservoir_size() const {
+    return std::min<size_t>(count_, STREAMING_STATS_RESERVOIR_SIZE);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STREAMING_STATS_RESERVOIR_SIZE 32
+
+// Constant-size online summary of a sample stream: Welford mean/variance, min/max,
+// mean absolute successive difference (jitter), P-squared estimates of the 50th, 90th
+// and 99th percentiles, and a uniform reservoir of raw samples. The all-zero state is
+// a valid empty accumulator, so containing structs may be memset or value-initialized.
+class StreamingStats {
+private:
+    // Jain & Chlamtac P-squared estimator for one quantile; five markers, no sample storage
+    struct p2_estimator_t {
+        float heights[5];
+        int32_t positions[5];
+        float desired[5];
+    };
+
+    uint32_t count_;
+    double mean_;
+    double m2_;
+    float min_;
+    float max_;
+    float last_;
+    double abs_diff_sum_;
+    p2_estimator_t quantiles_[3];
+    float reservoir_[STREAMING_STATS_RESERVOIR_SIZE];
+
+    static void p2_add(p2_estimator_t& estimator, float quantile, float value, uint32_t count);
+
+public:
+    void add(float value);
+    void reset();
+
+    uint32_t count() const { return count_; }
+    float mean() const { return count_ > 0 ? (float)mean_ : 0.0f; }
+    float variance() const;      // Sample variance (n - 1)
+    float stddev() const;
+    float min() const { return count_ > 0 ? min_ : 0.0f; }
+    float max() const { return count_ > 0 ? max_ : 0.0f; }
+    float jitter() const;
+    float p50() const { return percentile_estimate(0); }
+    float p90() const { return percentile_estimate(1); }
+    float p99() const { return percentile_estimate(2); }
+    float percentile_estimate(size_t index) const;
+
+    // Uniform sample of at most STREAMING_STATS_RESERVOIR_SIZE values, in arrival order
+    // until the reservoir fills, unordered afterwards
+    const float* reservoir() const { return reservoir_; }
+    size_t reservoir_size() const;
+};
@@ -1,4 +1,5 @@
 #include "test_framework.hpp"
+#include "result_export.hpp"
 #include <esp_timer.h>
 #include <esp_system.h>
 #include <cmath>
@@ -8,8 +9,9 @@
 
 TestFramework::TestFramework()
     : initialized_(false), role_(TEST_ROLE_PEER),
-      esp_now_manager_(ESPNowManager::get_instance()),
-      results_mutex_(nullptr), coordination_task_handle_(nullptr) {
+      esp_now_manager_(ESPNowManager::get_instance()), mesh_benchmark_(esp_now_manager_),
+      results_mutex_(nullptr), coordination_task_handle_(nullptr), start_signal_(nullptr),
+      scheduled_start_us_(0), benchmark_subscription_(-1), schedule_subscription_(-1) {
     memset(&config_, 0, sizeof(config_));
 }
 
@@ -31,23 +33,36 @@ esp_err_t TestFramework::initialize(test_role_t role, const test_configuration_t
     config_ = config;
 
     results_mutex_ = xSemaphoreCreateMutex();
-    if (!results_mutex_) {
-        ESP_LOGE(TEST_FRAMEWORK_TAG, "Failed to create results mutex");
+    start_signal_ = xSemaphoreCreateBinary();
+    if (!results_mutex_ || !start_signal_) {
+        ESP_LOGE(TEST_FRAMEWORK_TAG, "Failed to create results mutex or start signal");
         return ESP_ERR_NO_MEM;
     }
 
-    if (role_ == TEST_ROLE_COORDINATOR) {
-        xTaskCreate(coordination_task, "test_coord", 4096, this, 6, &coordination_task_handle_);
+    esp_err_t ret = mesh_benchmark_.initialize();
+    if (ret != ESP_OK) {
+        return ret;
     }
 
-    // Set up ESP-NOW callbacks
-    esp_now_manager_.set_receive_callback([this](const uint8_t* mac, const esp_now_message_t* msg) {
-        if (msg->msg_type >= ESP_NOW_MSG_TYPE_TEST_START && msg->msg_type <= ESP_NOW_MSG_TYPE_TEST_DATA) {
-            // Handle test-related messages
-            ESP_LOGD(TEST_FRAMEWORK_TAG, "Received test message type %d from %02x:%02x:%02x:%02x:%02x:%02x",
-                     msg->msg_type, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        }
-    });
+    // Every role runs its share of coordinator-driven benchmarks from this task
+    xTaskCreate(coordination_task, "test_coord", 4096, this, 6, &coordination_task_handle_);
+
+    // Benchmark echoes are timed, so both run inline; the receive callback stays free for the application
+    MessageBus& bus = esp_now_manager_.get_message_bus();
+    ret = bus.subscribe(ESP_NOW_MSG_TYPE_TEST_START, ESP_NOW_MSG_TYPE_BENCH_REPORT, MessageBus::inline_config(),
+                        [this](const uint8_t* mac, const esp_now_message_t* msg) {
+                            mesh_benchmark_.handle_message(mac, msg);
+                        }, &benchmark_subscription_);
+    if (ret == ESP_OK) {
+        ret = bus.subscribe(ESP_NOW_MSG_TYPE_TEST_SCHEDULE, MessageBus::inline_config(),
+                            [this](const uint8_t* mac, const esp_now_message_t* msg) {
+                                handle_test_schedule(msg);
+                            }, &schedule_subscription_);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TEST_FRAMEWORK_TAG, "Failed to subscribe to test messages: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
     initialized_ = true;
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Test framework initialized successfully");
@@ -59,16 +74,28 @@ esp_err_t TestFramework::deinitialize() {
         return ESP_OK;
     }
 
+    MessageBus& bus = esp_now_manager_.get_message_bus();
+    bus.unsubscribe(benchmark_subscription_);
+    bus.unsubscribe(schedule_subscription_);
+    benchmark_subscription_ = -1;
+    schedule_subscription_ = -1;
+
     if (coordination_task_handle_) {
         vTaskDelete(coordination_task_handle_);
         coordination_task_handle_ = nullptr;
     }
+    mesh_benchmark_.deinitialize();
 
     if (results_mutex_) {
         vSemaphoreDelete(results_mutex_);
         results_mutex_ = nullptr;
     }
 
+    if (start_signal_) {
+        vSemaphoreDelete(start_signal_);
+        start_signal_ = nullptr;
+    }
+
     test_results_.clear();
     initialized_ = false;
 
@@ -81,13 +108,16 @@ void TestFramework::coordination_task(void *parameter) {
 
     while (true) {
         framework->handle_coordination_messages();
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 void TestFramework::handle_coordination_messages() {
-    // Handle coordination between devices for synchronized testing
-    // This would typically involve sending/receiving test coordination messages
+    // Blocks until a benchmark run is armed, then sends this node's share of it
+    mesh_benchmark_.service(pdMS_TO_TICKS(100));
+}
+
+MeshBenchmark& TestFramework::get_mesh_benchmark() {
+    return mesh_benchmark_;
 }
 
 esp_err_t TestFramework::start_test_session() {
@@ -116,28 +146,69 @@ esp_err_t TestFramework::synchronize_test_start(uint32_t timeout_ms) {
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Synchronizing test start with timeout %lu ms", timeout_ms);
 
     uint64_t start_time = get_timestamp_us();
-    uint64_t timeout_us = timeout_ms * 1000;
+    uint64_t timeout_us = timeout_ms * 1000ULL;
 
-    if (role_ == TEST_ROLE_COORDINATOR) {
-        // Wait for all peers to be ready, then send start signal
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Give peers time to prepare
-        esp_now_manager_.send_broadcast(ESP_NOW_MSG_TYPE_TEST_START, nullptr, 0);
-    } else {
-        // Wait for start signal from coordinator
-        while ((get_timestamp_us() - start_time) < timeout_us) {
-            // Check for test start message (would be handled in receive callback)
-            vTaskDelay(pdMS_TO_TICKS(10));
+    if (role_ != TEST_ROLE_COORDINATOR) {
+        // Wait for the coordinator's schedule, then for the instant itself
+        if (xSemaphoreTake(start_signal_, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            ESP_LOGW(TEST_FRAMEWORK_TAG, "No test schedule received from coordinator");
+            return ESP_ERR_TIMEOUT;
         }
+        TimeSync::sleep_until_us(scheduled_start_us_.load());
+        return ESP_OK;
     }
 
-    return ESP_OK;
+    TimeSync& time_sync = esp_now_manager_.get_time_sync();
+    std::vector<esp_now_peer_info_t> peers = esp_now_manager_.get_peers();
+    std::vector<esp_now_peer_info_t> synced;
+
+    for (const auto& peer : peers) {
+        if (!peer.is_active) continue;
+        if ((get_timestamp_us() - start_time) >= timeout_us) {
+            ESP_LOGW(TEST_FRAMEWORK_TAG, "Start synchronization timed out before all peers were synced");
+            break;
+        }
+        if (time_sync.sync_peer(peer.mac_addr) == ESP_OK) {
+            synced.push_back(peer);
+        } else {
+            ESP_LOGW(TEST_FRAMEWORK_TAG, "Could not sync clock with %s, peer will not start on time",
+                     format_mac_address(peer.mac_addr).c_str());
+        }
+    }
+
+    // One instant in our clock, translated into each peer's
+    uint64_t start_at_us = get_timestamp_us() + TEST_START_LEAD_MS * 1000ULL;
+    for (const auto& peer : synced) {
+        uint64_t peer_start_us;
+        if (time_sync.local_to_peer(peer.mac_addr, start_at_us, &peer_start_us) != ESP_OK) {
+            continue;
+        }
+        esp_now_test_schedule_t schedule = {peer_start_us};
+        esp_now_manager_.send_message(peer.mac_addr, ESP_NOW_MSG_TYPE_TEST_SCHEDULE,
+                                      (const uint8_t*)&schedule, sizeof(schedule));
+    }
+
+    ESP_LOGI(TEST_FRAMEWORK_TAG, "Test start scheduled for %zu of %zu peers", synced.size(), peers.size());
+    TimeSync::sleep_until_us(start_at_us);
+    return (synced.empty() && !peers.empty()) ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+void TestFramework::handle_test_schedule(const esp_now_message_t* msg) {
+    if (msg->payload_length < sizeof(esp_now_test_schedule_t) || !start_signal_) {
+        return;
+    }
+
+    esp_now_test_schedule_t schedule;
+    memcpy(&schedule, msg->payload, sizeof(schedule));
+    scheduled_start_us_ = schedule.start_at_us;
+    xSemaphoreGive(start_signal_);
 }
 
 esp_err_t TestFramework::run_discovery_test(const std::string& test_name, uint32_t timeout_ms) {
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Running discovery test: %s", test_name.c_str());
 
     test_result_t result = {};
-    result.test_name = test_name;
+    snprintf(result.test_name, sizeof(result.test_name), "%s", test_name.c_str());
     result.status = TEST_STATUS_RUNNING;
     result.start_time_us = get_timestamp_us();
     result.iterations_total = 1;
@@ -149,18 +220,18 @@ esp_err_t TestFramework::run_discovery_test(const std::string& test_name, uint32
     esp_err_t ret = esp_now_manager_.start_discovery(timeout_ms);
     if (ret != ESP_OK) {
         result.status = TEST_STATUS_FAILED;
-        result.error_message = "Failed to start discovery";
+        snprintf(result.error_message, sizeof(result.error_message), "Failed to start discovery");
         result.end_time_us = get_timestamp_us();
 
-        if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-            test_results_.push_back(result);
-            xSemaphoreGive(results_mutex_);
-        }
+        store_result(result);
         return ret;
     }
 
-    // Wait for discovery to complete
-    vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+    // Discovery runs in the background; block until its run reports completion
+    if (esp_now_manager_.wait_for_discovery(pdMS_TO_TICKS(timeout_ms + 1000)) != ESP_OK) {
+        ESP_LOGW(TEST_FRAMEWORK_TAG, "Discovery did not complete in time");
+        esp_now_manager_.stop_discovery();
+    }
 
     // Record results
     uint32_t final_peers = esp_now_manager_.get_peer_count();
@@ -170,10 +241,7 @@ esp_err_t TestFramework::run_discovery_test(const std::string& test_name, uint32
     result.status = TEST_STATUS_COMPLETED;
     result.iterations_completed = 1;
 
-    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        test_results_.push_back(result);
-        xSemaphoreGive(results_mutex_);
-    }
+    store_result(result);
 
     if (test_completed_callback_) {
         test_completed_callback_(result);
@@ -188,61 +256,47 @@ esp_err_t TestFramework::run_latency_test(const std::string& test_name, const ui
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Running latency test: %s (%lu pings)", test_name.c_str(), ping_count);
 
     test_result_t result = {};
-    result.test_name = test_name;
+    snprintf(result.test_name, sizeof(result.test_name), "%s", test_name.c_str());
     result.status = TEST_STATUS_RUNNING;
     result.start_time_us = get_timestamp_us();
     result.iterations_total = ping_count;
 
-    // Set up ping response tracking
-    std::vector<uint64_t> ping_times;
-    std::vector<bool> ping_responses;
-    ping_times.resize(ping_count);
-    ping_responses.resize(ping_count, false);
-
     uint32_t successful_pings = 0;
 
-    // Send pings and measure response times
-    for (uint32_t i = 0; i < ping_count; i++) {
-        uint64_t ping_start = get_timestamp_us();
-
-        esp_err_t ret = esp_now_manager_.send_ping(target_mac);
-        if (ret != ESP_OK) {
-            ESP_LOGW(TEST_FRAMEWORK_TAG, "Failed to send ping %lu", i);
-            continue;
-        }
+    // Windowed ping/pong: RTT is measured from send to the PONG's receive timestamp
+    rtt_measure_config_t rtt_config = RttEngine::default_config(ping_count);
+    rtt_run_stats_t rtt_stats = {};
 
-        // Wait for response (simplified - in real implementation would use callback)
-        vTaskDelay(pdMS_TO_TICKS(100));
-
-        // For now, simulate some response time measurement
-        uint64_t response_time_us = get_timestamp_us() - ping_start;
-        float latency_ms = response_time_us / 1000.0f;
-
-        result.latency_measurements.push_back(latency_ms);
-        successful_pings++;
-        result.iterations_completed = i + 1;
+    esp_err_t ret = esp_now_manager_.get_rtt_engine().measure(target_mac, rtt_config,
+        [&](const rtt_sample_t& sample) {
+            result.latency_ms.add(sample.rtt_us / 1000.0f);
+            successful_pings++;
+            result.iterations_completed = successful_pings;
 
-        if (test_progress_callback_) {
-            test_progress_callback_(test_name, i + 1, ping_count);
-        }
+            if (test_progress_callback_) {
+                test_progress_callback_(test_name, successful_pings, ping_count);
+            }
+        }, &rtt_stats);
 
-        // Small delay between pings
-        vTaskDelay(pdMS_TO_TICKS(10));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TEST_FRAMEWORK_TAG, "RTT measurement failed: %s", esp_err_to_name(ret));
+    } else if (rtt_stats.send_failures > 0 || rtt_stats.timed_out > 0) {
+        ESP_LOGW(TEST_FRAMEWORK_TAG, "%lu pings failed to send, %lu timed out",
+                 rtt_stats.send_failures, rtt_stats.timed_out);
     }
 
+    result.avg_packet_loss_percent = calculate_packet_loss_rate(ping_count, successful_pings);
+
     result.end_time_us = get_timestamp_us();
     result.status = successful_pings > 0 ? TEST_STATUS_COMPLETED : TEST_STATUS_FAILED;
 
     if (successful_pings == 0) {
-        result.error_message = "No successful ping responses";
+        snprintf(result.error_message, sizeof(result.error_message), "No successful ping responses");
     } else {
         calculate_statistics(result);
     }
 
-    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        test_results_.push_back(result);
-        xSemaphoreGive(results_mutex_);
-    }
+    store_result(result);
 
     if (test_completed_callback_) {
         test_completed_callback_(result);
@@ -252,16 +306,90 @@ esp_err_t TestFramework::run_latency_test(const std::string& test_name, const ui
     return ESP_OK;
 }
 
+esp_err_t TestFramework::run_one_way_latency_test(const std::string& test_name, const uint8_t* target_mac,
+                                                 uint32_t ping_count) {
+    ESP_LOGI(TEST_FRAMEWORK_TAG, "Running one-way latency test: %s (%lu pings)", test_name.c_str(), ping_count);
+
+    test_result_t forward = {};
+    snprintf(forward.test_name, sizeof(forward.test_name), "%s fwd", test_name.c_str());
+    forward.status = TEST_STATUS_RUNNING;
+    forward.start_time_us = get_timestamp_us();
+    forward.iterations_total = ping_count;
+
+    test_result_t reverse = forward;
+    snprintf(reverse.test_name, sizeof(reverse.test_name), "%s rev", test_name.c_str());
+
+    TimeSync& time_sync = esp_now_manager_.get_time_sync();
+    esp_err_t ret = time_sync.sync_peer(target_mac);
+    if (ret == ESP_OK) {
+        rtt_measure_config_t rtt_config = RttEngine::default_config(ping_count);
+        ret = esp_now_manager_.get_rtt_engine().measure(target_mac, rtt_config,
+            [&](const rtt_sample_t& sample) {
+                uint64_t peer_tx_local_us;
+                if (time_sync.peer_to_local(target_mac, sample.peer_tx_us, &peer_tx_local_us) != ESP_OK) {
+                    return;
+                }
+                forward.latency_ms.add((int64_t)(peer_tx_local_us - sample.tx_us) / 1000.0f);
+                reverse.latency_ms.add((int64_t)(sample.rx_us - peer_tx_local_us) / 1000.0f);
+                forward.iterations_completed++;
+                reverse.iterations_completed++;
+
+                if (test_progress_callback_) {
+                    test_progress_callback_(test_name, forward.iterations_completed, ping_count);
+                }
+            });
+    }
+
+    for (test_result_t* result : {&forward, &reverse}) {
+        result->end_time_us = get_timestamp_us();
+        result->avg_packet_loss_percent = calculate_packet_loss_rate(ping_count, result->iterations_completed);
+        if (result->iterations_completed == 0) {
+            result->status = TEST_STATUS_FAILED;
+            snprintf(result->error_message, sizeof(result->error_message), "%s",
+                     ret == ESP_OK ? "No successful ping responses" : "Clock sync with target failed");
+        } else {
+            result->status = TEST_STATUS_COMPLETED;
+            calculate_statistics(*result);
+        }
+
+        store_result(*result);
+        if (test_completed_callback_) {
+            test_completed_callback_(*result);
+        }
+        log_test_result(*result);
+    }
+
+    time_sync_peer_state_t state;
+    if (time_sync.get_peer_state(target_mac, &state) == ESP_OK) {
+        ESP_LOGI(TEST_FRAMEWORK_TAG, "  Clock offset: %lld us (sync delay %lu us, drift %.2f ppm)",
+                 state.offset_us, state.delay_us, state.drift_ppm);
+    }
+
+    return forward.iterations_completed > 0 ? ESP_OK : ESP_FAIL;
+}
+
 esp_err_t TestFramework::run_throughput_test(const std::string& test_name, const uint8_t* target_mac,
                                             uint32_t duration_ms, size_t payload_size) {
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Running throughput test: %s (%lu ms, %zu bytes payload)",
              test_name.c_str(), duration_ms, payload_size);
 
     test_result_t result = {};
-    result.test_name = test_name;
+    snprintf(result.test_name, sizeof(result.test_name), "%s", test_name.c_str());
     result.status = TEST_STATUS_RUNNING;
     result.start_time_us = get_timestamp_us();
 
+    size_t max_payload = esp_now_manager_.get_max_payload_len(target_mac);
+    if (payload_size > max_payload) {
+        ESP_LOGW(TEST_FRAMEWORK_TAG, "Payload %zu bytes exceeds negotiated peer limit of %zu bytes",
+                 payload_size, max_payload);
+        result.status = TEST_STATUS_FAILED;
+        snprintf(result.error_message, sizeof(result.error_message), "Payload exceeds negotiated frame size");
+        result.end_time_us = get_timestamp_us();
+
+        store_result(result);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
     // Create test payload
     std::vector<uint8_t> payload(payload_size, 0xAA);
 
@@ -271,15 +399,18 @@ esp_err_t TestFramework::run_throughput_test(const std::string& test_name, const
     uint64_t test_end_time = result.start_time_us + (duration_ms * 1000);
 
     while (get_timestamp_us() < test_end_time) {
+        // Paced by the sender's flow-control window rather than a fixed delay
         esp_err_t ret = esp_now_manager_.send_message(target_mac, ESP_NOW_MSG_TYPE_TEST_DATA,
-                                                     payload.data(), payload.size());
+                                                     payload.data(), payload.size(),
+                                                     pdMS_TO_TICKS(100));
         if (ret == ESP_OK) {
             packets_sent++;
             total_bytes_sent += payload.size();
         }
+    }
 
-        // Small delay to prevent overwhelming the network
-        vTaskDelay(pdMS_TO_TICKS(1));
+    for (int i = 0; i < 100 && esp_now_manager_.get_send_queue_depth() > 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
 
     result.end_time_us = get_timestamp_us();
@@ -290,15 +421,20 @@ esp_err_t TestFramework::run_throughput_test(const std::string& test_name, const
         uint32_t actual_duration_ms = (result.end_time_us - result.start_time_us) / 1000;
         uint32_t throughput_bps = (total_bytes_sent * 8 * 1000) / actual_duration_ms;
         result.avg_throughput_bps = throughput_bps;
-        result.throughput_measurements.push_back(throughput_bps);
+        result.throughput_bps.add(throughput_bps);
+
+        esp_now_peer_info_t peer;
+        if (esp_now_manager_.get_peer_info(target_mac, &peer) == ESP_OK) {
+            ESP_LOGI(TEST_FRAMEWORK_TAG, "  PHY rate: %s %s (%lu up, %lu down)",
+                     RateController::mode_name(peer.rate.mode),
+                     peer.rate.mode == ESP_NOW_RATE_MODE_AUTO ? RateController::step_name(peer.rate.step) : "",
+                     peer.rate.step_ups, peer.rate.step_downs);
+        }
     } else {
-        result.error_message = "No packets sent successfully";
+        snprintf(result.error_message, sizeof(result.error_message), "No packets sent successfully");
     }
 
-    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        test_results_.push_back(result);
-        xSemaphoreGive(results_mutex_);
-    }
+    store_result(result);
 
     if (test_completed_callback_) {
         test_completed_callback_(result);
@@ -314,7 +450,7 @@ esp_err_t TestFramework::run_reliability_test(const std::string& test_name, cons
              test_name.c_str(), packet_count, interval_ms);
 
     test_result_t result = {};
-    result.test_name = test_name;
+    snprintf(result.test_name, sizeof(result.test_name), "%s", test_name.c_str());
     result.status = TEST_STATUS_RUNNING;
     result.start_time_us = get_timestamp_us();
     result.iterations_total = packet_count;
@@ -349,13 +485,10 @@ esp_err_t TestFramework::run_reliability_test(const std::string& test_name, cons
 
     float packet_loss_rate = calculate_packet_loss_rate(packets_sent, packets_acknowledged);
     result.avg_packet_loss_percent = packet_loss_rate;
-    result.packet_loss_rates.push_back(packet_loss_rate);
+    result.packet_loss_percent.add(packet_loss_rate);
     result.reliability_passed = (packet_loss_rate < 1.0f); // Pass if < 1% loss
 
-    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        test_results_.push_back(result);
-        xSemaphoreGive(results_mutex_);
-    }
+    store_result(result);
 
     if (test_completed_callback_) {
         test_completed_callback_(result);
@@ -370,7 +503,7 @@ esp_err_t TestFramework::run_range_test(const std::string& test_name, const uint
     ESP_LOGI(TEST_FRAMEWORK_TAG, "Running range test: %s", test_name.c_str());
 
     test_result_t result = {};
-    result.test_name = test_name;
+    snprintf(result.test_name, sizeof(result.test_name), "%s", test_name.c_str());
     result.status = TEST_STATUS_RUNNING;
     result.start_time_us = get_timestamp_us();
 
@@ -398,7 +531,13 @@ esp_err_t TestFramework::run_range_test(const std::string& test_name, const uint
         }
 
         float success_rate = (float)successful_packets / total_packets * 100.0f;
-        ESP_LOGI(TEST_FRAMEWORK_TAG, "Step %lu success rate: %.1f%%", step + 1, success_rate);
+        esp_now_peer_info_t peer;
+        if (esp_now_manager_.get_peer_info(target_mac, &peer) == ESP_OK && peer.rssi_samples > 0) {
+            ESP_LOGI(TEST_FRAMEWORK_TAG, "Step %lu success rate: %.1f%%, RSSI %d dBm (min %d, max %d)",
+                     step + 1, success_rate, peer.rssi, peer.rssi_min, peer.rssi_max);
+        } else {
+            ESP_LOGI(TEST_FRAMEWORK_TAG, "Step %lu success rate: %.1f%%", step + 1, success_rate);
+        }
 
         if (success_rate >= 90.0f) {
             max_successful_range = step + 1;
@@ -412,10 +551,7 @@ esp_err_t TestFramework::run_range_test(const std::string& test_name, const uint
     result.status = TEST_STATUS_COMPLETED;
     result.iterations_completed = test_steps;
 
-    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        test_results_.push_back(result);
-        xSemaphoreGive(results_mutex_);
-    }
+    store_result(result);
 
     if (test_completed_callback_) {
         test_completed_callback_(result);
@@ -452,18 +588,41 @@ esp_err_t TestFramework::run_all_performance_tests() {
         return ESP_ERR_NOT_FOUND;
     }
 
+    // Prefer the peer with the best measured link
+    auto ranked_peers = esp_now_manager_.get_peers_by_rssi(INT8_MIN);
+    if (!ranked_peers.empty()) {
+        peers = ranked_peers;
+    }
+
     const uint8_t* target_mac = peers[0].mac_addr;
     esp_err_t ret;
 
     ret = run_latency_test("Latency Test - 100 pings", target_mac, 100);
     if (ret != ESP_OK) return ret;
 
+    // Legacy peers do not answer TIME_REQUEST; that only loses the one-way figures
+    if (run_one_way_latency_test("One-way Latency", target_mac, 100) != ESP_OK) {
+        ESP_LOGW(TEST_FRAMEWORK_TAG, "One-way latency unavailable for this peer");
+    }
+
     ret = run_throughput_test("Throughput Test - Small Payload", target_mac, 30000, 64);
     if (ret != ESP_OK) return ret;
 
     ret = run_throughput_test("Throughput Test - Large Payload", target_mac, 30000, 200);
     if (ret != ESP_OK) return ret;
 
+    // Sweep the ESP-NOW v2 frame sizes when the peer negotiated large frames
+    size_t max_payload = esp_now_manager_.get_max_payload_len(target_mac);
+    if (max_payload > ESP_NOW_MAX_PAYLOAD_LEN) {
+        const size_t large_sizes[] = {512, 1024, ESP_NOW_MAX_PAYLOAD_LEN_V2};
+        for (size_t size : large_sizes) {
+            if (size > max_payload) continue;
+            ret = run_throughput_test("Throughput Test - v2 " + std::to_string(size) + "B Payload",
+                                      target_mac, 30000, size);
+            if (ret != ESP_OK) return ret;
+        }
+    }
+
     ret = run_reliability_test("Reliability Test", target_mac, 1000, 10);
     if (ret != ESP_OK) return ret;
 
@@ -507,7 +666,7 @@ std::vector<test_result_t> TestFramework::get_test_results() {
 test_result_t* TestFramework::get_test_result(const std::string& test_name) {
     if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
         for (auto& result : test_results_) {
-            if (result.test_name == test_name) {
+            if (test_name == result.test_name) {
                 xSemaphoreGive(results_mutex_);
                 return &result;
             }
@@ -535,13 +694,14 @@ esp_err_t TestFramework::print_test_summary() {
         if (result.status == TEST_STATUS_COMPLETED) passed++;
         else if (result.status == TEST_STATUS_FAILED) failed++;
 
-        ESP_LOGI(TEST_FRAMEWORK_TAG, "\nTest: %s", result.test_name.c_str());
+        ESP_LOGI(TEST_FRAMEWORK_TAG, "\nTest: %s", result.test_name);
         ESP_LOGI(TEST_FRAMEWORK_TAG, "  Status: %s",
                  result.status == TEST_STATUS_COMPLETED ? "PASSED" :
                  result.status == TEST_STATUS_FAILED ? "FAILED" : "UNKNOWN");
 
         if (result.avg_latency_ms > 0) {
-            ESP_LOGI(TEST_FRAMEWORK_TAG, "  Avg Latency: %.2f ms", result.avg_latency_ms);
+            ESP_LOGI(TEST_FRAMEWORK_TAG, "  Avg Latency: %.2f ms (p50 %.2f, p99 %.2f)", result.avg_latency_ms,
+                     result.latency_ms.p50(), result.latency_ms.p99());
         }
 
         if (result.avg_throughput_bps > 0) {
@@ -552,37 +712,91 @@ esp_err_t TestFramework::print_test_summary() {
             ESP_LOGI(TEST_FRAMEWORK_TAG, "  Devices Discovered: %lu", result.devices_discovered);
         }
 
-        if (!result.error_message.empty()) {
-            ESP_LOGI(TEST_FRAMEWORK_TAG, "  Error: %s", result.error_message.c_str());
+        if (result.error_message[0] != '\0') {
+            ESP_LOGI(TEST_FRAMEWORK_TAG, "  Error: %s", result.error_message);
         }
     }
 
     ESP_LOGI(TEST_FRAMEWORK_TAG, "\nOverall: %lu passed, %lu failed", passed, failed);
+    esp_now_manager_.print_latency_histograms();
     ESP_LOGI(TEST_FRAMEWORK_TAG, "==================================\n");
 
     return ESP_OK;
 }
 
+esp_err_t TestFramework::export_results_binary(std::function<esp_err_t(const uint8_t*, size_t)> sink) {
+    if (!sink || !results_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ConsoleExportScope console_scope;
+    ResultExporter exporter(sink);
+    esp_err_t ret = exporter.begin(esp_now_manager_.get_local_mac());
+
+    // Copy one result at a time so the sink never runs with the results lock held
+    for (size_t i = 0; ret == ESP_OK; i++) {
+        test_result_t result;
+        bool have_result = false;
+        if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (i < test_results_.size()) {
+            result = test_results_[i];
+            have_result = true;
+        }
+        xSemaphoreGive(results_mutex_);
+
+        if (!have_result) {
+            break;
+        }
+        ret = exporter.write_test_result(result);
+    }
+
+    for (int stage = 0; ret == ESP_OK && stage < ESP_NOW_STAGE_COUNT; stage++) {
+        esp_now_latency_stage_t s = (esp_now_latency_stage_t)stage;
+        ret = exporter.write_histogram(stage, ESPNowManager::latency_stage_name(s),
+                                       esp_now_manager_.get_latency_histogram(s));
+    }
+
+    if (ret == ESP_OK) {
+        ret = exporter.write_statistics(esp_now_manager_.get_statistics());
+    }
+    if (ret == ESP_OK) {
+        ret = exporter.end();
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TEST_FRAMEWORK_TAG, "Binary export failed after %lu records: %s",
+                 exporter.records_written(), esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 uint64_t TestFramework::get_timestamp_us() {
     return esp_timer_get_time();
 }
 
 void TestFramework::calculate_statistics(test_result_t& result) {
-    if (result.latency_measurements.empty()) return;
+    if (result.latency_ms.count() == 0) return;
 
-    result.avg_latency_ms = calculate_average(result.latency_measurements);
-
-    auto minmax = std::minmax_element(result.latency_measurements.begin(),
-                                     result.latency_measurements.end());
-    result.min_latency_ms = *minmax.first;
-    result.max_latency_ms = *minmax.second;
+    result.avg_latency_ms = result.latency_ms.mean();
+    result.min_latency_ms = result.latency_ms.min();
+    result.max_latency_ms = result.latency_ms.max();
+    result.stddev_latency_ms = result.latency_ms.stddev();
+}
 
-    result.stddev_latency_ms = calculate_standard_deviation(result.latency_measurements,
-                                                           result.avg_latency_ms);
+void TestFramework::store_result(const test_result_t& result) {
+    if (xSemaphoreTake(results_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        if (test_results_.size() >= TEST_FRAMEWORK_MAX_RESULTS) {
+            test_results_.erase(test_results_.begin());
+        }
+        test_results_.push_back(result);
+        xSemaphoreGive(results_mutex_);
+    }
 }
 
 void TestFramework::log_test_result(const test_result_t& result) {
-    ESP_LOGI(TEST_FRAMEWORK_TAG, "Test completed: %s", result.test_name.c_str());
+    ESP_LOGI(TEST_FRAMEWORK_TAG, "Test completed: %s", result.test_name);
     ESP_LOGI(TEST_FRAMEWORK_TAG, "  Duration: %llu ms",
              (result.end_time_us - result.start_time_us) / 1000);
     ESP_LOGI(TEST_FRAMEWORK_TAG, "  Status: %s",
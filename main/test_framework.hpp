@@ -8,9 +8,16 @@
 #include <string>
 #include <functional>
 #include <chrono>
+#include <atomic>
 #include "esp_now_manager.hpp"
+#include "streaming_stats.hpp"
+#include "mesh_benchmark.hpp"
 
 #define TEST_FRAMEWORK_TAG "TEST_FW"
+#define TEST_FRAMEWORK_MAX_RESULTS 16  // Oldest results are dropped beyond this
+#define TEST_NAME_MAX_LEN 32
+#define TEST_ERROR_MAX_LEN 64
+#define TEST_START_LEAD_MS 100         // Scheduled start distance, after every peer was told
 
 typedef enum {
     TEST_ROLE_COORDINATOR = 0,
@@ -25,20 +32,21 @@ typedef enum {
     TEST_STATUS_FAILED = 3
 } test_status_t;
 
+// Constant size regardless of test length, so long soak runs do not grow the heap
 typedef struct {
-    std::string test_name;
+    char test_name[TEST_NAME_MAX_LEN];
     test_status_t status;
     uint64_t start_time_us;
     uint64_t end_time_us;
     uint32_t iterations_completed;
     uint32_t iterations_total;
-    std::string error_message;
+    char error_message[TEST_ERROR_MAX_LEN];
 
-    // Metrics storage
-    std::vector<float> latency_measurements;
-    std::vector<uint32_t> throughput_measurements;
-    std::vector<float> packet_loss_rates;
-    std::vector<int8_t> rssi_measurements;
+    // Online metric accumulators
+    StreamingStats latency_ms;
+    StreamingStats throughput_bps;
+    StreamingStats packet_loss_percent;
+    StreamingStats rssi_dbm;
 
     // Summary statistics
     float avg_latency_ms;
@@ -74,18 +82,26 @@ private:
     test_role_t role_;
     test_configuration_t config_;
     ESPNowManager& esp_now_manager_;
+    MeshBenchmark mesh_benchmark_;
 
     std::vector<test_result_t> test_results_;
     SemaphoreHandle_t results_mutex_;
     TaskHandle_t coordination_task_handle_;
+    SemaphoreHandle_t start_signal_;
+    std::atomic<uint64_t> scheduled_start_us_;   // Local clock, from the coordinator's TEST_SCHEDULE
+    int benchmark_subscription_;
+    int schedule_subscription_;
 
     test_completed_callback_t test_completed_callback_;
     test_progress_callback_t test_progress_callback_;
 
     uint64_t get_timestamp_us();
     void calculate_statistics(test_result_t& result);
+    void store_result(const test_result_t& result);
     void log_test_result(const test_result_t& result);
 
+    void handle_test_schedule(const esp_now_message_t* msg);
+
     static void coordination_task(void *parameter);
     void handle_coordination_messages();
 
@@ -99,12 +115,18 @@ public:
     // Test execution control
     esp_err_t start_test_session();
     esp_err_t stop_test_session();
+    // Coordinator: syncs clocks with every active peer and sends each the same start instant
+    // in its own clock. Peers: wait for that schedule. Both return at the agreed instant.
     esp_err_t synchronize_test_start(uint32_t timeout_ms = 10000);
 
     // Individual test execution
     esp_err_t run_discovery_test(const std::string& test_name, uint32_t timeout_ms);
     esp_err_t run_latency_test(const std::string& test_name, const uint8_t* target_mac,
                               uint32_t ping_count);
+    // Forward and reverse delay from PONG header timestamps, after a clock sync with the
+    // target; stores "<name> fwd" and "<name> rev" results (stddev is the jitter)
+    esp_err_t run_one_way_latency_test(const std::string& test_name, const uint8_t* target_mac,
+                                       uint32_t ping_count);
     esp_err_t run_throughput_test(const std::string& test_name, const uint8_t* target_mac,
                                  uint32_t duration_ms, size_t payload_size);
     esp_err_t run_reliability_test(const std::string& test_name, const uint8_t* target_mac,
@@ -123,14 +145,19 @@ public:
     void clear_test_results();
 
     // Data export
-    esp_err_t export_results_csv(const std::string& filename);
-    esp_err_t export_results_json(const std::string& filename);
+    // Versioned binary record stream (see result_export.hpp), decoded on the host by
+    // tools/decode_results.py. Results, stage histograms and link statistics are written
+    // one record at a time to the sink.
+    esp_err_t export_results_binary(std::function<esp_err_t(const uint8_t*, size_t)> sink);
     esp_err_t print_test_summary();
 
     // Configuration
     void set_test_configuration(const test_configuration_t& config);
     test_configuration_t get_test_configuration();
 
+    // Coordinator-driven multi-node benchmark; every role services its share
+    MeshBenchmark& get_mesh_benchmark();
+
     // Callbacks
     void set_test_completed_callback(test_completed_callback_t callback);
     void set_test_progress_callback(test_progress_callback_t callback);
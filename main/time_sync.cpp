@@ -0,0 +1,386 @@
+#include "time_sync.hpp"
+#include "esp_now_manager.hpp"
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static_assert(TIME_SYNC_MAX_PEERS == ESP_NOW_MAX_PEERS, "Every peer keeps its clock state and is synced by each pass");
+
+TimeSync::TimeSync(ESPNowManager& manager)
+    : manager_(manager), peers_mutex_(nullptr), round_mutex_(nullptr), response_queue_(nullptr),
+      next_seq_(1), periodic_task_handle_(nullptr), periodic_running_(false),
+      periodic_interval_ms_(TIME_SYNC_DEFAULT_INTERVAL_MS) {
+    memset(peers_, 0, sizeof(peers_));
+    memset(periodic_macs_, 0, sizeof(periodic_macs_));
+}
+
+TimeSync::~TimeSync() {
+    deinitialize();
+}
+
+esp_err_t TimeSync::initialize() {
+    if (response_queue_) {
+        return ESP_OK;
+    }
+
+    response_queue_ = xQueueCreate(TIME_SYNC_EXCHANGES, sizeof(exchange_t));
+    peers_mutex_ = xSemaphoreCreateMutex();
+    round_mutex_ = xSemaphoreCreateMutex();
+
+    if (!response_queue_ || !peers_mutex_ || !round_mutex_) {
+        ESP_LOGE(TIME_SYNC_TAG, "Failed to create time sync queue or mutexes");
+        deinitialize();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(peers_, 0, sizeof(peers_));
+    return ESP_OK;
+}
+
+void TimeSync::deinitialize() {
+    stop_periodic();
+
+    if (response_queue_) {
+        vQueueDelete(response_queue_);
+        response_queue_ = nullptr;
+    }
+
+    if (round_mutex_) {
+        vSemaphoreDelete(round_mutex_);
+        round_mutex_ = nullptr;
+    }
+
+    if (peers_mutex_) {
+        vSemaphoreDelete(peers_mutex_);
+        peers_mutex_ = nullptr;
+    }
+}
+
+void TimeSync::handle_request(const uint8_t* mac_addr, const esp_now_message_t* msg, uint64_t rx_timestamp_us) {
+    if (msg->payload_length < sizeof(esp_now_time_request_t)) {
+        return;
+    }
+
+    esp_now_time_request_t request;
+    memcpy(&request, msg->payload, sizeof(request));
+
+    esp_now_time_response_t response;
+    response.seq = request.seq;
+    response.t1_us = request.t1_us;
+    response.t2_us = rx_timestamp_us;
+    response.t3_us = esp_timer_get_time();
+    manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_TIME_RESPONSE, (const uint8_t*)&response, sizeof(response));
+}
+
+void TimeSync::handle_response(const uint8_t* mac_addr, const esp_now_message_t* msg, uint64_t rx_timestamp_us) {
+    if (msg->payload_length < sizeof(esp_now_time_response_t) || !response_queue_) {
+        return;
+    }
+
+    esp_now_time_response_t response;
+    memcpy(&response, msg->payload, sizeof(response));
+
+    exchange_t exchange;
+    memcpy(exchange.mac, mac_addr, 6);
+    exchange.seq = response.seq;
+    exchange.t1_us = response.t1_us;
+    exchange.t2_us = response.t2_us;
+    exchange.t3_us = response.t3_us;
+    exchange.t4_us = rx_timestamp_us;
+    xQueueSend(response_queue_, &exchange, 0);
+}
+
+esp_err_t TimeSync::sync_peer(const uint8_t* mac_addr, uint32_t exchanges) {
+    if (!round_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(round_mutex_, pdMS_TO_TICKS(2000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = run_round(mac_addr, exchanges);
+    xSemaphoreGive(round_mutex_);
+    return ret;
+}
+
+// Caller holds round_mutex_
+esp_err_t TimeSync::run_round(const uint8_t* mac_addr, uint32_t exchanges) {
+    xQueueReset(response_queue_);
+
+    bool have_best = false;
+    uint64_t best_delay_us = UINT64_MAX;
+    uint64_t best_local_us = 0;
+    int64_t best_offset_us = 0;
+
+    for (uint32_t i = 0; i < std::max<uint32_t>(exchanges, 1); i++) {
+        esp_now_time_request_t request;
+        request.seq = next_seq_.fetch_add(1, std::memory_order_relaxed);
+        request.t1_us = esp_timer_get_time();
+
+        if (manager_.send_message(mac_addr, ESP_NOW_MSG_TYPE_TIME_REQUEST,
+                                  (const uint8_t*)&request, sizeof(request)) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_EXCHANGE_INTERVAL_MS));
+            continue;
+        }
+
+        // Responses to earlier, timed-out requests are discarded by sequence
+        uint64_t deadline_us = request.t1_us + TIME_SYNC_RESPONSE_TIMEOUT_MS * 1000ULL;
+        exchange_t exchange;
+        bool answered = false;
+        while (!answered) {
+            uint64_t now_us = esp_timer_get_time();
+            if (now_us >= deadline_us) {
+                break;
+            }
+            TickType_t wait_ticks = std::max<TickType_t>(pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000), 1);
+            if (xQueueReceive(response_queue_, &exchange, wait_ticks) != pdPASS) {
+                break;
+            }
+            answered = exchange.seq == request.seq && memcmp(exchange.mac, mac_addr, 6) == 0;
+        }
+
+        if (answered && exchange.t4_us >= exchange.t1_us && exchange.t3_us >= exchange.t2_us) {
+            uint64_t delay_us = (exchange.t4_us - exchange.t1_us) - (exchange.t3_us - exchange.t2_us);
+            if (delay_us < best_delay_us) {
+                best_delay_us = delay_us;
+                best_offset_us = ((int64_t)(exchange.t2_us - exchange.t1_us) +
+                                  (int64_t)(exchange.t3_us - exchange.t4_us)) / 2;
+                best_local_us = exchange.t1_us + (exchange.t4_us - exchange.t1_us) / 2;
+                have_best = true;
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_EXCHANGE_INTERVAL_MS));
+    }
+
+    if (!have_best) {
+        ESP_LOGD(TIME_SYNC_TAG, "No time response from %02x:%02x:%02x:%02x:%02x:%02x",
+                 mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    peer_entry_t* entry = find_or_add_peer(mac_addr);
+    add_point(*entry, best_local_us, best_offset_us, (uint32_t)best_delay_us);
+    time_sync_peer_state_t state = entry->state;
+    xSemaphoreGive(peers_mutex_);
+
+    ESP_LOGD(TIME_SYNC_TAG, "Synced %02x:%02x:%02x:%02x:%02x:%02x: offset %lld us, delay %lu us, drift %.2f ppm",
+             mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5],
+             state.offset_us, state.delay_us, state.drift_ppm);
+    return ESP_OK;
+}
+
+// Caller holds peers_mutex_
+TimeSync::peer_entry_t* TimeSync::find_peer(const uint8_t* mac_addr) {
+    for (auto& entry : peers_) {
+        if (entry.in_use && memcmp(entry.mac, mac_addr, 6) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Caller holds peers_mutex_. Reuses the least recently synced entry when the table is full.
+TimeSync::peer_entry_t* TimeSync::find_or_add_peer(const uint8_t* mac_addr) {
+    peer_entry_t* entry = find_peer(mac_addr);
+    if (entry) {
+        return entry;
+    }
+
+    entry = &peers_[0];
+    for (auto& candidate : peers_) {
+        if (!candidate.in_use) {
+            entry = &candidate;
+            break;
+        }
+        if (candidate.last_used_us < entry->last_used_us) {
+            entry = &candidate;
+        }
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->in_use = true;
+    memcpy(entry->mac, mac_addr, 6);
+    return entry;
+}
+
+void TimeSync::add_point(peer_entry_t& entry, uint64_t local_us, int64_t offset_us, uint32_t delay_us) {
+    entry.history[entry.history_next] = {local_us, offset_us};
+    entry.history_next = (entry.history_next + 1) % TIME_SYNC_HISTORY;
+    entry.history_count = std::min<size_t>(entry.history_count + 1, TIME_SYNC_HISTORY);
+
+    entry.state.offset_us = offset_us;
+    entry.state.delay_us = delay_us;
+    entry.state.last_sync_us = local_us;
+    entry.state.rounds++;
+    entry.state.synced = true;
+    entry.state.drift_ppm = fit_drift_ppm(entry);
+    entry.last_used_us = local_us;
+}
+
+// Least-squares slope of offset over local time. Coordinates are taken relative to the
+// newest point so the doubles keep microsecond resolution.
+double TimeSync::fit_drift_ppm(const peer_entry_t& entry) {
+    if (entry.history_count < 2) {
+        return 0.0;
+    }
+
+    const offset_point_t& newest = entry.history[(entry.history_next + TIME_SYNC_HISTORY - 1) % TIME_SYNC_HISTORY];
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (size_t i = 0; i < entry.history_count; i++) {
+        double x = (double)(int64_t)(entry.history[i].local_us - newest.local_us);
+        double y = (double)(entry.history[i].offset_us - newest.offset_us);
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    double n = (double)entry.history_count;
+    double denominator = n * sum_xx - sum_x * sum_x;
+    if (denominator <= 0.0) {
+        return 0.0;
+    }
+
+    double ppm = (n * sum_xy - sum_x * sum_y) / denominator * 1e6;
+    if (ppm > TIME_SYNC_MAX_DRIFT_PPM || ppm < -TIME_SYNC_MAX_DRIFT_PPM) {
+        return entry.state.drift_ppm;
+    }
+    return ppm;
+}
+
+int64_t TimeSync::offset_at(const time_sync_peer_state_t& state, uint64_t local_us) {
+    double elapsed_us = (double)(int64_t)(local_us - state.last_sync_us);
+    return state.offset_us + (int64_t)(elapsed_us * state.drift_ppm / 1e6);
+}
+
+bool TimeSync::is_synced(const uint8_t* mac_addr) {
+    time_sync_peer_state_t state;
+    return get_peer_state(mac_addr, &state) == ESP_OK && state.synced;
+}
+
+esp_err_t TimeSync::get_peer_state(const uint8_t* mac_addr, time_sync_peer_state_t* state) {
+    if (!peers_mutex_ || !state) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    peer_entry_t* entry = find_peer(mac_addr);
+    if (entry) {
+        *state = entry->state;
+    }
+    xSemaphoreGive(peers_mutex_);
+    return entry ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void TimeSync::forget_peer(const uint8_t* mac_addr) {
+    if (!peers_mutex_ || xSemaphoreTake(peers_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return;
+    }
+    peer_entry_t* entry = find_peer(mac_addr);
+    if (entry) {
+        memset(entry, 0, sizeof(*entry));
+    }
+    xSemaphoreGive(peers_mutex_);
+}
+
+esp_err_t TimeSync::peer_to_local(const uint8_t* mac_addr, uint64_t peer_us, uint64_t* local_us) {
+    time_sync_peer_state_t state;
+    esp_err_t ret = get_peer_state(mac_addr, &state);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // The drift term depends on local time; one refinement step is well below a microsecond
+    uint64_t estimate_us = peer_us - state.offset_us;
+    *local_us = peer_us - offset_at(state, estimate_us);
+    return ESP_OK;
+}
+
+esp_err_t TimeSync::local_to_peer(const uint8_t* mac_addr, uint64_t local_us, uint64_t* peer_us) {
+    time_sync_peer_state_t state;
+    esp_err_t ret = get_peer_state(mac_addr, &state);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    *peer_us = local_us + offset_at(state, local_us);
+    return ESP_OK;
+}
+
+void TimeSync::sleep_until_us(uint64_t deadline_us) {
+    uint64_t now_us = esp_timer_get_time();
+    if (deadline_us > now_us + TIME_SYNC_SPIN_US) {
+        vTaskDelay(pdMS_TO_TICKS((deadline_us - now_us - TIME_SYNC_SPIN_US) / 1000));
+    }
+    while ((uint64_t)esp_timer_get_time() < deadline_us) {
+    }
+}
+
+esp_err_t TimeSync::start_periodic(uint32_t interval_ms) {
+    if (!round_mutex_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (periodic_task_handle_) {
+        return ESP_OK;
+    }
+
+    periodic_interval_ms_ = std::max<uint32_t>(interval_ms, 100);
+    periodic_running_ = true;
+    if (xTaskCreate(periodic_task, "time_sync", TIME_SYNC_TASK_STACK_SIZE, this,
+                    TIME_SYNC_TASK_PRIORITY, &periodic_task_handle_) != pdPASS) {
+        periodic_task_handle_ = nullptr;
+        periodic_running_ = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Taking round_mutex_ first guarantees the task is between rounds, not inside one
+void TimeSync::stop_periodic() {
+    if (!periodic_task_handle_) {
+        return;
+    }
+
+    periodic_running_ = false;
+    xSemaphoreTake(round_mutex_, portMAX_DELAY);
+    vTaskDelete(periodic_task_handle_);
+    periodic_task_handle_ = nullptr;
+    xSemaphoreGive(round_mutex_);
+}
+
+void TimeSync::periodic_task(void* parameter) {
+    TimeSync* sync = static_cast<TimeSync*>(parameter);
+
+    // Runs until stop_periodic() deletes it
+    for (;;) {
+        // The peer lock is only taken under round_mutex_, so stop_periodic() never
+        // deletes the task while it holds it
+        size_t count = 0;
+        if (sync->periodic_running_ && xSemaphoreTake(sync->round_mutex_, pdMS_TO_TICKS(1000)) == pdTRUE) {
+            sync->manager_.for_each_peer([&](const esp_now_peer_info_t& peer) {
+                if (peer.is_active && count < TIME_SYNC_MAX_PEERS) {
+                    memcpy(sync->periodic_macs_[count++], peer.mac_addr, 6);
+                }
+            });
+            xSemaphoreGive(sync->round_mutex_);
+        }
+
+        // One round at a time, so sync_peer() callers wait for a round rather than a pass
+        for (size_t i = 0; i < count && sync->periodic_running_; i++) {
+            if (xSemaphoreTake(sync->round_mutex_, pdMS_TO_TICKS(1000)) != pdTRUE) {
+                continue;
+            }
+            sync->run_round(sync->periodic_macs_[i], TIME_SYNC_EXCHANGES);
+            xSemaphoreGive(sync->round_mutex_);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(sync->periodic_interval_ms_));
+    }
+}
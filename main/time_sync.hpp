@@ -0,0 +1,117 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "esp_now_protocol.hpp"
+
+#define TIME_SYNC_TAG "TIME_SYNC"
+#define TIME_SYNC_MAX_PEERS 64                // ESP_NOW_MAX_PEERS; also the peers of one periodic pass
+#define TIME_SYNC_EXCHANGES 8                 // Exchanges per round; the fastest one is kept
+#define TIME_SYNC_HISTORY 8                   // Offset points per peer for the drift fit
+#define TIME_SYNC_RESPONSE_TIMEOUT_MS 50
+#define TIME_SYNC_EXCHANGE_INTERVAL_MS 5
+#define TIME_SYNC_DEFAULT_INTERVAL_MS 10000
+#define TIME_SYNC_MAX_DRIFT_PPM 200.0         // Crystal tolerance; larger fits are rejected
+#define TIME_SYNC_TASK_STACK_SIZE 3072
+#define TIME_SYNC_TASK_PRIORITY 2
+#define TIME_SYNC_SPIN_US 2000                // sleep_until_us() busy-waits this last stretch
+
+class ESPNowManager;
+
+typedef struct {
+    int64_t offset_us;       // peer_clock - local_clock at last_sync_us
+    double drift_ppm;        // Peer clock rate relative to ours, from the offset history
+    uint32_t delay_us;       // Round-trip delay of the exchange the offset came from
+    uint32_t rounds;
+    uint64_t last_sync_us;   // Local time of that exchange's midpoint
+    bool synced;
+} time_sync_peer_state_t;
+
+// NTP-style clock offset estimation per peer. A round sends TIME_SYNC_EXCHANGES requests
+// and keeps the exchange with the smallest round-trip delay, since queueing on either side
+// only ever adds delay and makes the two directions asymmetric. Successive rounds feed a
+// least-squares fit of offset over time, so peer_to_local() stays accurate between rounds.
+// All timestamps are esp_timer_get_time(); t2 and t4 are driver receive-callback times.
+class TimeSync {
+private:
+    typedef struct {
+        uint8_t mac[6];
+        uint32_t seq;
+        uint64_t t1_us;
+        uint64_t t2_us;
+        uint64_t t3_us;
+        uint64_t t4_us;
+    } exchange_t;
+
+    typedef struct {
+        uint64_t local_us;
+        int64_t offset_us;
+    } offset_point_t;
+
+    typedef struct {
+        bool in_use;
+        uint8_t mac[6];
+        time_sync_peer_state_t state;
+        offset_point_t history[TIME_SYNC_HISTORY];
+        size_t history_count;
+        size_t history_next;
+        uint64_t last_used_us;
+    } peer_entry_t;
+
+    ESPNowManager& manager_;
+    peer_entry_t peers_[TIME_SYNC_MAX_PEERS];
+    SemaphoreHandle_t peers_mutex_;
+    SemaphoreHandle_t round_mutex_;
+    QueueHandle_t response_queue_;
+    std::atomic<uint32_t> next_seq_;
+
+    TaskHandle_t periodic_task_handle_;
+    std::atomic<bool> periodic_running_;
+    uint32_t periodic_interval_ms_;
+    uint8_t periodic_macs_[TIME_SYNC_MAX_PEERS][6];  // Periodic task only
+
+    static void periodic_task(void* parameter);
+    esp_err_t run_round(const uint8_t* mac_addr, uint32_t exchanges);
+
+    peer_entry_t* find_peer(const uint8_t* mac_addr);
+    peer_entry_t* find_or_add_peer(const uint8_t* mac_addr);
+    void add_point(peer_entry_t& entry, uint64_t local_us, int64_t offset_us, uint32_t delay_us);
+    static double fit_drift_ppm(const peer_entry_t& entry);
+    static int64_t offset_at(const time_sync_peer_state_t& state, uint64_t local_us);
+
+public:
+    explicit TimeSync(ESPNowManager& manager);
+    ~TimeSync();
+
+    esp_err_t initialize();
+    void deinitialize();
+
+    // Called from the receive task; rx_timestamp_us is the driver receive time
+    void handle_request(const uint8_t* mac_addr, const esp_now_message_t* msg, uint64_t rx_timestamp_us);
+    void handle_response(const uint8_t* mac_addr, const esp_now_message_t* msg, uint64_t rx_timestamp_us);
+
+    // One round against a peer; ESP_ERR_TIMEOUT when no exchange completed
+    esp_err_t sync_peer(const uint8_t* mac_addr, uint32_t exchanges = TIME_SYNC_EXCHANGES);
+
+    // Re-syncs every active manager peer in the background, one round per peer per interval
+    esp_err_t start_periodic(uint32_t interval_ms = TIME_SYNC_DEFAULT_INTERVAL_MS);
+    void stop_periodic();
+
+    bool is_synced(const uint8_t* mac_addr);
+    esp_err_t get_peer_state(const uint8_t* mac_addr, time_sync_peer_state_t* state);
+    void forget_peer(const uint8_t* mac_addr);
+
+    // Clock conversion using the offset extrapolated with the drift estimate
+    esp_err_t peer_to_local(const uint8_t* mac_addr, uint64_t peer_us, uint64_t* local_us);
+    esp_err_t local_to_peer(const uint8_t* mac_addr, uint64_t local_us, uint64_t* peer_us);
+
+    // Sleeps in ticks while far away, then spins on esp_timer; returns at once if passed
+    static void sleep_until_us(uint64_t deadline_us);
+};
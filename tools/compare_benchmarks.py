@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""Compare BenchmarkRunner results against a stored baseline and flag regressions.
+
+Inputs are raw console captures (binary result stream) or the JSONL output of
+tools/decode_results.py --json. With several inputs, each metric is the median over
+the runs of a case, which takes most of the run-to-run noise out of the gate.
+
+    python3 tools/compare_benchmarks.py capture.bin --baseline bench_baseline.json
+    python3 tools/compare_benchmarks.py run1.bin run2.bin run3.bin --baseline b.json --update
+
+Exit status: 0 when no case regressed, 1 on a regression, a failed run, or a baseline
+case the run did not measure (missing or skipped; --allow-missing accepts those on a
+smaller bench), 2 when the inputs hold no benchmark records.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import decode_results  # noqa: E402
+
+BASELINE_FORMAT = 1
+
+# metric: (direction, relative tolerance, absolute tolerance). A change counts as a
+# regression when it is worse than both, so small values are not gated on noise.
+DEFAULT_THRESHOLDS = {
+    "latency_p50_ms": ("lower", 0.20, 0.5),
+    "latency_p99_ms": ("lower", 0.30, 1.0),
+    "goodput_kbps": ("higher", 0.10, 5.0),
+    "loss_percent": ("lower", 0.0, 1.0),
+}
+# Latency is only gated for RTT cases; goodput cases carry echo RTTs under load
+KIND_METRICS = {
+    "rtt": ("latency_p50_ms", "latency_p99_ms", "loss_percent"),
+    "goodput": ("goodput_kbps", "loss_percent"),
+}
+
+
+def load_records(path):
+    if path == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(path, "rb") as f:
+            data = f.read()
+
+    if data.lstrip().startswith(b"{"):
+        records = []
+        for line in data.decode("utf-8", "replace").splitlines():
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                record = json.loads(line)
+            except ValueError:
+                continue
+            if record.get("type") == "benchmark":
+                records.append(record)
+        return records
+
+    return [record for rtype, record in decode_results.iter_records(data)
+            if rtype == decode_results.RECORD_BENCHMARK]
+
+
+def summarize(paths):
+    """Per case: parameters, run count, failed/skipped counts and median metrics."""
+    runs = {}
+    for path in paths:
+        for record in load_records(path):
+            runs.setdefault(record["case_name"], []).append(record)
+
+    cases = {}
+    for name, records in runs.items():
+        measured = [r for r in records if r["status"] == "ok"]
+        case = {
+            "kind": records[0]["kind"],
+            "payload_len": records[0]["payload_len"],
+            "peers": records[0]["peers"],
+            "queue_depth": records[0]["queue_depth"],
+            "runs": len(measured),
+            "failed": sum(1 for r in records if r["status"] == "failed"),
+            "skipped": sum(1 for r in records if r["status"] == "skipped"),
+        }
+        if measured:
+            for metric in DEFAULT_THRESHOLDS:
+                case[metric] = statistics.median(r[metric] for r in measured)
+        cases[name] = case
+    return cases
+
+
+def parse_thresholds(baseline, overrides):
+    thresholds = dict(DEFAULT_THRESHOLDS)
+    for metric, value in baseline.get("thresholds", {}).items():
+        if metric in thresholds:
+            thresholds[metric] = (thresholds[metric][0], value["relative"], value["absolute"])
+    for override in overrides:
+        metric, _, value = override.partition("=")
+        if metric not in thresholds:
+            raise SystemExit("unknown metric %r (one of %s)" % (metric, ", ".join(thresholds)))
+        relative, _, absolute = value.partition(":")
+        thresholds[metric] = (thresholds[metric][0], float(relative) / 100.0,
+                              float(absolute) if absolute else thresholds[metric][2])
+    return thresholds
+
+
+def compare(current, baseline, thresholds, allow_missing=False):
+    """Returns (rows, regressions); a row is (case, metric, base, now, change %, verdict)."""
+    rows = []
+    regressions = 0
+    for name in sorted(set(baseline) | set(current)):
+        base = baseline.get(name)
+        now = current.get(name)
+        if now and now["failed"]:
+            rows.append((name, "-", None, None, None, "REGRESSION: %d of %d runs failed" % (
+                now["failed"], now["failed"] + now["runs"])))
+            regressions += 1
+            continue
+        if base is None:
+            rows.append((name, "-", None, None, None, "new (not in baseline)"))
+            continue
+        if now is None or not now["runs"]:
+            state = "missing from run" if now is None else "skipped"
+            if base.get("runs", 0) == 0 or allow_missing:
+                rows.append((name, "-", None, None, None, state))
+            else:
+                rows.append((name, "-", None, None, None, "REGRESSION: " + state))
+                regressions += 1
+            continue
+        if base.get("runs", 0) == 0:
+            rows.append((name, "-", None, None, None, "not measured in baseline"))
+            continue
+
+        for metric in KIND_METRICS.get(now["kind"], ()):
+            direction, relative, absolute = thresholds[metric]
+            before, after = base[metric], now[metric]
+            worse = after - before if direction == "lower" else before - after
+            allowed = max(abs(before) * relative, absolute)
+            change = 100.0 * (after - before) / before if before else 0.0
+            if worse > allowed:
+                verdict = "REGRESSION"
+                regressions += 1
+            elif -worse > allowed:
+                verdict = "improved"
+            else:
+                verdict = "ok"
+            rows.append((name, metric, before, after, change, verdict))
+    return rows, regressions
+
+
+def write_baseline(path, cases, thresholds):
+    baseline = {
+        "format": BASELINE_FORMAT,
+        "created": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "thresholds": {metric: {"relative": relative, "absolute": absolute}
+                       for metric, (_, relative, absolute) in thresholds.items()},
+        "cases": cases,
+    }
+    with open(path, "w") as f:
+        json.dump(baseline, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("inputs", nargs="+", help="captures or JSONL files, - for stdin")
+    parser.add_argument("--baseline", required=True, help="baseline JSON file")
+    parser.add_argument("--update", action="store_true",
+                        help="write the baseline from the inputs instead of comparing")
+    parser.add_argument("--threshold", action="append", default=[], metavar="METRIC=PCT[:ABS]",
+                        help="override a tolerance, e.g. latency_p99_ms=50:2")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="accept baseline cases the run skipped or lacks, e.g. on a bench with fewer peers")
+    parser.add_argument("--json", action="store_true", help="emit the comparison as JSON")
+    args = parser.parse_args()
+
+    current = summarize(args.inputs)
+    if not current:
+        print("no benchmark records in the inputs", file=sys.stderr)
+        return 2
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get("format", 0) > BASELINE_FORMAT:
+            print("unsupported baseline format %d" % baseline["format"], file=sys.stderr)
+            return 2
+    thresholds = parse_thresholds(baseline, args.threshold)
+
+    if args.update:
+        write_baseline(args.baseline, current, thresholds)
+        print("baseline %s: %d cases from %d inputs" % (args.baseline, len(current), len(args.inputs)),
+              file=sys.stderr)
+        return 0
+    if not baseline:
+        print("baseline %s not found; create it with --update" % args.baseline, file=sys.stderr)
+        return 2
+
+    rows, regressions = compare(current, baseline.get("cases", {}), thresholds, args.allow_missing)
+    if args.json:
+        print(json.dumps({"regressions": regressions, "rows": [
+            dict(zip(("case", "metric", "baseline", "current", "change_percent", "verdict"), row))
+            for row in rows]}, indent=2))
+    else:
+        print("%-24s %-16s %12s %12s %8s  %s" % ("case", "metric", "baseline", "current", "change", "verdict"))
+        for name, metric, before, after, change, verdict in rows:
+            if before is None:
+                print("%-24s %-16s %12s %12s %8s  %s" % (name, metric, "", "", "", verdict))
+            else:
+                print("%-24s %-16s %12.3f %12.3f %+7.1f%%  %s" % (name, metric, before, after, change, verdict))
+        print("\n%d regressions" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Decode a dump of the soaklog partition written by FlashLog (main/flash_log.hpp).
+
+Read the partition off a device with:
+
+    parttool.py --port PORT read_partition --partition-name soaklog --output soaklog.bin
+    python3 tools/decode_flash_log.py soaklog.bin            # human readable
+    python3 tools/decode_flash_log.py soaklog.bin --json     # one JSON object per record
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import decode_results  # noqa: E402
+
+SECTOR_SIZE = 4096
+SECTOR_MAGIC = 0x474C4E45
+FORMAT_VERSION = 1
+
+SECTOR_HEADER_FMT = struct.Struct("<IHHIII")
+RECORD_HEADER_FMT = struct.Struct("<HBBII")
+
+RECORD_BOOT = 0x01
+RECORD_STABILITY_START = 0x10
+RECORD_STABILITY_INTERVAL = 0x11
+RECORD_LINK_EVENT = 0x12
+RECORD_STABILITY_SUMMARY = 0x13
+RECORD_STATISTICS = 0x20
+
+RESET_REASONS = ["unknown", "poweron", "ext", "sw", "panic", "int_wdt", "task_wdt", "wdt",
+                 "deepsleep", "brownout", "sdio", "usb", "jtag", "efuse", "pwr_glitch", "cpu_lockup"]
+
+PAYLOADS = {
+    RECORD_BOOT: ("boot", struct.Struct("<II"), ("boot_count", "reset_reason")),
+    RECORD_STABILITY_START: ("stability_start", struct.Struct("<I6sH"),
+                             ("duration_hours", "target_mac", "reserved")),
+    RECORD_STABILITY_INTERVAL: ("stability_interval", struct.Struct("<IHHIIffI"),
+                                ("first_window", "windows", "windows_up", "packets_sent",
+                                 "packets_received", "rtt_mean_ms", "rtt_max_ms", "connection_drops")),
+    RECORD_LINK_EVENT: ("link_event", struct.Struct("<IB3sf"), ("window", "link_up", "reserved", "outage_ms")),
+    RECORD_STABILITY_SUMMARY: ("stability_summary", struct.Struct("<6I6f"),
+                               ("windows", "packets_sent", "packets_received", "connection_drops",
+                                "reconnection_attempts", "successful_reconnections", "uptime_percent",
+                                "avg_packet_loss_percent", "rtt_p50_ms", "rtt_p99_ms", "rtt_max_ms",
+                                "reconnection_mean_ms")),
+}
+
+
+def footprint(length):
+    return (RECORD_HEADER_FMT.size + length + 3) & ~3
+
+
+def decode_payload(rtype, payload):
+    if rtype == RECORD_STATISTICS:
+        return "statistics", dict(zip(decode_results.STATISTICS_FIELDS,
+                                      decode_results.STATISTICS_FMT.unpack_from(payload, 0)))
+    if rtype not in PAYLOADS:
+        return "type_0x%02x" % rtype, {"raw": payload.hex()}
+
+    name, fmt, fields = PAYLOADS[rtype]
+    record = dict(zip(fields, fmt.unpack_from(payload, 0)))
+    record.pop("reserved", None)
+    if "target_mac" in record:
+        record["target_mac"] = ":".join("%02x" % b for b in record["target_mac"])
+    if "reset_reason" in record and record["reset_reason"] < len(RESET_REASONS):
+        record["reset_reason"] = RESET_REASONS[record["reset_reason"]]
+    if "link_up" in record:
+        record["link_up"] = bool(record["link_up"])
+    return name, record
+
+
+def iter_records(data):
+    """Yield (boot, timestamp_ms, name, record) oldest first."""
+    sectors = []
+    for offset in range(0, len(data) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, version, _, sequence, boot, crc = SECTOR_HEADER_FMT.unpack_from(data, offset)
+        if magic != SECTOR_MAGIC or version != FORMAT_VERSION:
+            continue
+        if zlib.crc32(data[offset:offset + SECTOR_HEADER_FMT.size - 4]) != crc:
+            continue
+        sectors.append((sequence, offset, boot))
+
+    for _, base, boot in sorted(sectors):
+        offset = SECTOR_HEADER_FMT.size
+        while offset + RECORD_HEADER_FMT.size <= SECTOR_SIZE:
+            length, rtype, _, timestamp_ms, crc = RECORD_HEADER_FMT.unpack_from(data, base + offset)
+            if length == 0xFFFF or offset + footprint(length) > SECTOR_SIZE:
+                break
+            start = base + offset + RECORD_HEADER_FMT.size
+            payload = data[start:start + length]
+            if zlib.crc32(payload, zlib.crc32(data[base + offset:base + offset + 8])) != crc:
+                break
+            try:
+                name, record = decode_payload(rtype, payload)
+            except struct.error:
+                name, record = "truncated_0x%02x" % rtype, {"raw": payload.hex()}
+            yield boot, timestamp_ms, name, record
+            offset += footprint(length)
+
+
+def format_record(name, record):
+    if name == "boot":
+        return "boot %d (reset: %s)" % (record["boot_count"], record["reset_reason"])
+    if name == "stability_start":
+        return "stability test started: %d h against %s" % (record["duration_hours"], record["target_mac"])
+    if name == "stability_interval":
+        return "windows %d-%d: up %d/%d, rx %d/%d, RTT mean %.2f max %.2f ms, drops %d" % (
+            record["first_window"], record["first_window"] + record["windows"] - 1, record["windows_up"],
+            record["windows"], record["packets_received"], record["packets_sent"], record["rtt_mean_ms"],
+            record["rtt_max_ms"], record["connection_drops"])
+    if name == "link_event":
+        if record["link_up"]:
+            return "window %d: link restored after %.0f ms" % (record["window"], record["outage_ms"])
+        return "window %d: link lost" % record["window"]
+    if name == "stability_summary":
+        return ("stability test finished: %d windows, uptime %.2f%%, loss %.2f%%, drops %d, "
+                "RTT p50 %.2f p99 %.2f max %.2f ms" % (
+                    record["windows"], record["uptime_percent"], record["avg_packet_loss_percent"],
+                    record["connection_drops"], record["rtt_p50_ms"], record["rtt_p99_ms"], record["rtt_max_ms"]))
+    if name == "statistics":
+        return "statistics: sent %d, received %d, lost %d, retries %d" % (
+            record["packets_sent"], record["packets_received"], record["packets_lost"], record["retries"])
+    return "%s %s" % (name, record)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="partition dump")
+    parser.add_argument("--json", action="store_true", help="emit one JSON object per record")
+    parser.add_argument("--boot", type=int, help="only records written during this boot")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    count = 0
+    for boot, timestamp_ms, name, record in iter_records(data):
+        if args.boot is not None and boot != args.boot:
+            continue
+        count += 1
+        if args.json:
+            print(json.dumps({"boot": boot, "timestamp_ms": timestamp_ms, "type": name, **record}))
+        else:
+            print("[boot %d %10.3f s] %s" % (boot, timestamp_ms / 1000.0, format_record(name, record)))
+
+    print("%d records decoded" % count, file=sys.stderr)
+    return 0 if count else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+"""Decode the binary result stream written by TestFramework::export_results_binary and BenchmarkRunner.
+
+The input may be a raw console capture: bytes between records (log lines, boot
+messages) are skipped by scanning for the sync byte and checking each record's CRC.
+
+    python3 tools/decode_results.py capture.bin            # human readable
+    python3 tools/decode_results.py capture.bin --json     # one JSON object per record
+"""
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+SYNC = 0xA5
+MAGIC = 0x58524E45
+FORMAT_VERSION = 1
+
+RECORD_HEADER = 0x01
+RECORD_TEST_RESULT = 0x02
+RECORD_HISTOGRAM = 0x03
+RECORD_STATISTICS = 0x04
+RECORD_BENCHMARK = 0x05
+RECORD_END = 0x7F
+
+RECORD_HEADER_FMT = struct.Struct("<BBHI")
+STREAM_HEADER_FMT = struct.Struct("<IH6sQ")
+SUMMARY_FMT = struct.Struct("<I8f")
+SUMMARY_FIELDS = ("count", "mean", "stddev", "min", "max", "p50", "p90", "p99", "jitter")
+TEST_FIXED_FMT = struct.Struct("<32sBBbBQQIIffffIfIII")
+TEST_ERROR_LEN = 64
+HISTOGRAM_FMT = struct.Struct("<BBH24sIIII")
+BUCKET_FMT = struct.Struct("<HI")
+STATISTICS_FMT = struct.Struct("<QQIIIIQQIIIIIIIHH")
+STATISTICS_FIELDS = (
+    "snapshot_time_us", "session_start_time_us", "packets_sent", "packets_received",
+    "packets_lost", "retries", "bytes_sent", "bytes_received", "rx_dropped_invalid_size",
+    "rx_dropped_no_buffer", "rx_dropped_queue_full", "rx_crc_errors", "rx_length_errors",
+    "tx_queue_timeouts", "tx_done_dropped", "rx_queue_high_water", "tx_queue_high_water",
+)
+BENCHMARK_FMT = struct.Struct("<32sBBHBBHII6f")
+BENCHMARK_FIELDS = (
+    "duration_ms", "samples", "latency_mean_ms", "latency_p50_ms", "latency_p99_ms",
+    "latency_max_ms", "goodput_kbps", "loss_percent",
+)
+STATUS_NAMES = {0: "pending", 1: "running", 2: "completed", 3: "failed"}
+BENCH_KIND_NAMES = {0: "rtt", 1: "goodput"}
+BENCH_STATUS_NAMES = {0: "ok", 1: "failed", 2: "skipped"}
+
+
+def cstr(raw):
+    return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def bucket_upper_bound(index, sub_bucket_bits):
+    # Mirrors LatencyHistogram::bucket_upper_bound
+    sub_buckets = 1 << sub_bucket_bits
+    if index < sub_buckets:
+        return index
+    shift = (index >> sub_bucket_bits) - 1
+    sub = index & (sub_buckets - 1)
+    return min(((sub_buckets + sub + 1) << shift) - 1, 0xFFFFFFFF)
+
+
+def decode_summary(payload, offset):
+    values = SUMMARY_FMT.unpack_from(payload, offset)
+    return dict(zip(SUMMARY_FIELDS, values)), offset + SUMMARY_FMT.size
+
+
+def decode_test_result(payload):
+    fields = TEST_FIXED_FMT.unpack_from(payload, 0)
+    record = {
+        "test_name": cstr(fields[0]),
+        "status": STATUS_NAMES.get(fields[1], fields[1]),
+        "reliability_passed": bool(fields[2]),
+        "avg_rssi_dbm": fields[3],
+        "start_time_us": fields[5],
+        "end_time_us": fields[6],
+        "iterations_completed": fields[7],
+        "iterations_total": fields[8],
+        "avg_latency_ms": fields[9],
+        "min_latency_ms": fields[10],
+        "max_latency_ms": fields[11],
+        "stddev_latency_ms": fields[12],
+        "avg_throughput_bps": fields[13],
+        "avg_packet_loss_percent": fields[14],
+        "discovery_time_ms": fields[15],
+        "devices_discovered": fields[16],
+        "max_range_meters": fields[17],
+    }
+    offset = TEST_FIXED_FMT.size
+    for name in ("latency_ms", "throughput_bps", "packet_loss_percent", "rssi_dbm"):
+        record[name], offset = decode_summary(payload, offset)
+    record["error_message"] = cstr(payload[offset:offset + TEST_ERROR_LEN])
+    return record
+
+
+def decode_histogram(payload):
+    stage, bits, entries, name, count, vmin, vmax, mean = HISTOGRAM_FMT.unpack_from(payload, 0)
+    buckets = []
+    offset = HISTOGRAM_FMT.size
+    for _ in range(entries):
+        index, n = BUCKET_FMT.unpack_from(payload, offset)
+        offset += BUCKET_FMT.size
+        buckets.append({"index": index, "upper_bound_us": bucket_upper_bound(index, bits), "count": n})
+    return {
+        "stage": stage,
+        "name": cstr(name),
+        "count": count,
+        "min_us": vmin,
+        "max_us": vmax,
+        "mean_us": mean,
+        "buckets": buckets,
+    }
+
+
+def decode_benchmark(payload):
+    fields = BENCHMARK_FMT.unpack_from(payload, 0)
+    record = {
+        "case_name": cstr(fields[0]),
+        "kind": BENCH_KIND_NAMES.get(fields[1], fields[1]),
+        "status": BENCH_STATUS_NAMES.get(fields[2], fields[2]),
+        "payload_len": fields[3],
+        "peers": fields[4],
+        "queue_depth": fields[5],
+    }
+    record.update(zip(BENCHMARK_FIELDS, fields[7:]))
+    return record
+
+
+def histogram_percentile(histogram, percentile):
+    target = histogram["count"] * percentile / 100.0
+    seen = 0
+    for bucket in histogram["buckets"]:
+        seen += bucket["count"]
+        if seen >= target:
+            return min(bucket["upper_bound_us"], histogram["max_us"])
+    return histogram["max_us"]
+
+
+def decode_payload(rtype, payload):
+    if rtype == RECORD_HEADER:
+        magic, version, mac, device_time = STREAM_HEADER_FMT.unpack_from(payload, 0)
+        if magic != MAGIC:
+            raise ValueError("bad stream magic 0x%08x" % magic)
+        if version > FORMAT_VERSION:
+            raise ValueError("unsupported format version %d" % version)
+        return {"format_version": version, "device_mac": ":".join("%02x" % b for b in mac),
+                "device_time_us": device_time}
+    if rtype == RECORD_TEST_RESULT:
+        return decode_test_result(payload)
+    if rtype == RECORD_HISTOGRAM:
+        return decode_histogram(payload)
+    if rtype == RECORD_STATISTICS:
+        return dict(zip(STATISTICS_FIELDS, STATISTICS_FMT.unpack_from(payload, 0)))
+    if rtype == RECORD_BENCHMARK:
+        return decode_benchmark(payload)
+    if rtype == RECORD_END:
+        return {"records": struct.unpack_from("<I", payload, 0)[0]}
+    return {"raw": payload.hex()}
+
+
+def iter_records(data):
+    """Yield (type, decoded) for every record with a valid CRC; returns skipped byte count."""
+    pos = 0
+    skipped = 0
+    while pos + RECORD_HEADER_FMT.size <= len(data):
+        if data[pos] != SYNC:
+            pos += 1
+            skipped += 1
+            continue
+        _, rtype, length, crc = RECORD_HEADER_FMT.unpack_from(data, pos)
+        start = pos + RECORD_HEADER_FMT.size
+        payload = data[start:start + length]
+        if len(payload) != length or zlib.crc32(payload) & 0xFFFFFFFF != crc:
+            pos += 1
+            skipped += 1
+            continue
+        try:
+            decoded = decode_payload(rtype, payload)
+        except (struct.error, ValueError):
+            pos += 1
+            skipped += 1
+            continue
+        yield rtype, decoded
+        pos = start + length
+    return skipped
+
+
+def print_record(rtype, record):
+    if rtype == RECORD_HEADER:
+        print("Stream v%d from %s (device time %.3f s)" % (
+            record["format_version"], record["device_mac"], record["device_time_us"] / 1e6))
+    elif rtype == RECORD_TEST_RESULT:
+        print("\nTest: %s [%s]" % (record["test_name"], record["status"]))
+        print("  duration %.3f s, iterations %d/%d" % (
+            (record["end_time_us"] - record["start_time_us"]) / 1e6,
+            record["iterations_completed"], record["iterations_total"]))
+        for name in ("latency_ms", "throughput_bps", "packet_loss_percent", "rssi_dbm"):
+            s = record[name]
+            if s["count"]:
+                print("  %-20s n=%d mean=%.3f sd=%.3f min=%.3f p50=%.3f p90=%.3f p99=%.3f max=%.3f" % (
+                    name, s["count"], s["mean"], s["stddev"], s["min"], s["p50"], s["p90"],
+                    s["p99"], s["max"]))
+        if record["devices_discovered"]:
+            print("  devices discovered %d in %d ms" % (
+                record["devices_discovered"], record["discovery_time_ms"]))
+        if record["error_message"]:
+            print("  error: %s" % record["error_message"])
+    elif rtype == RECORD_HISTOGRAM:
+        if record["count"]:
+            print("Stage %-22s n=%d min=%d p50=%d p99=%d p99.9=%d max=%d us" % (
+                record["name"], record["count"], record["min_us"],
+                histogram_percentile(record, 50), histogram_percentile(record, 99),
+                histogram_percentile(record, 99.9), record["max_us"]))
+    elif rtype == RECORD_STATISTICS:
+        print("\nLink: sent %d, received %d, lost %d, retries %d, rx drops %d/%d/%d" % (
+            record["packets_sent"], record["packets_received"], record["packets_lost"],
+            record["retries"], record["rx_dropped_invalid_size"], record["rx_dropped_no_buffer"],
+            record["rx_dropped_queue_full"]))
+    elif rtype == RECORD_BENCHMARK:
+        if record["status"] == "skipped":
+            print("Bench %-24s skipped" % record["case_name"])
+        else:
+            print("Bench %-24s %-6s n=%d p50=%.3f p99=%.3f max=%.3f ms goodput=%.1f kbps loss=%.2f%%" % (
+                record["case_name"], record["status"], record["samples"], record["latency_p50_ms"],
+                record["latency_p99_ms"], record["latency_max_ms"], record["goodput_kbps"],
+                record["loss_percent"]))
+    elif rtype == RECORD_END:
+        print("End of stream (%d records)" % record["records"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="capture file, or - for stdin")
+    parser.add_argument("--json", action="store_true", help="emit one JSON object per record")
+    args = parser.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    records = iter_records(data)
+    count = 0
+    type_names = {RECORD_HEADER: "header", RECORD_TEST_RESULT: "test_result",
+                  RECORD_HISTOGRAM: "histogram", RECORD_STATISTICS: "statistics",
+                  RECORD_BENCHMARK: "benchmark", RECORD_END: "end"}
+    while True:
+        try:
+            rtype, record = next(records)
+        except StopIteration as stop:
+            skipped = stop.value or 0
+            break
+        count += 1
+        if args.json:
+            print(json.dumps({"type": type_names.get(rtype, rtype), **record}))
+        else:
+            print_record(rtype, record)
+
+    print("%d records decoded, %d bytes skipped" % (count, skipped), file=sys.stderr)
+    return 0 if count else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())